@@ -52,6 +52,7 @@
 #include <fmc++/mpl.hpp>
 #include <fmc++/ordered_map.hpp>
 #include <fmc/alignment.h>
+#include <fmc/counter_registry.h>
 #include <fmc/platform.h>
 
 #include <array>
@@ -225,53 +226,188 @@ struct log_bucket : sample {
   std::array<uint64_t, N + 1> buckets_;
 };
 
-class precision_sampler : sample {
+// Log-linear histogram of unsigned values in fixed memory. Every power of
+// two is divided in 2^Precision buckets, so values are recorded with a
+// relative error below 2^-Precision and values under 2^Precision are exact.
+template <unsigned Precision = 7> class hdr_histogram {
 public:
-  using buckets_t = fmc::ordered_multimap<uint64_t, uint64_t>;
-  void sample(uint64_t x) {
-    auto c = floor_log10(x).first;
-    auto b = uint64_t((x / c) * c);
-    if (auto where = buckets_.find(b); where == buckets_.end()) {
-      where = buckets_.emplace(b, 1);
-    } else {
-      where->second++;
+  static_assert(Precision > 0 && Precision < 16, "invalid precision");
+  static constexpr size_t N = (65 - Precision) << Precision;
+
+  static size_t index(uint64_t x) {
+    if (x < (1ull << Precision))
+      return x;
+    unsigned shift = FMC_FLOORLOG2(x) - Precision;
+    return (size_t(shift) << Precision) + (x >> shift);
+  }
+  // Lowest value recorded in the bucket
+  static uint64_t lower_bound(size_t idx) {
+    if (idx < (1ull << Precision))
+      return idx;
+    unsigned shift = (idx >> Precision) - 1;
+    return uint64_t(idx - (size_t(shift) << Precision)) << shift;
+  }
+
+  hdr_histogram() { clear(); }
+  void sample(uint64_t x) { add(index(x), 1); }
+  void add(size_t idx, uint64_t count) {
+    if (!count)
+      return;
+    buckets_[idx] += count;
+    groups_[idx >> Precision] += count;
+    total_ += count;
+    min_ = std::min(min_, idx);
+    max_ = std::max(max_, idx);
+  }
+  void merge(const hdr_histogram &other) {
+    for (size_t i = other.min_; i <= other.max_ && other.total_; ++i) {
+      add(i, other.buckets_[i]);
     }
   }
-  buckets_t::const_iterator sample_index(uint64_t count) const {
+  uint64_t count(size_t idx) const { return buckets_[idx]; }
+  uint64_t total() const { return total_; }
+  double percentile(double p) const {
+    if (!total_)
+      return NAN;
+    uint64_t sample_count =
+        std::max<uint64_t>((int64_t(total_ * p) + 99ull) / 100ull, 1ull);
+    // Skips the groups of buckets before the one with the sample
     uint64_t current = 0;
-    for (auto it = buckets_.cbegin(); it != buckets_.end(); ++it) {
-      current += it->second;
-      if (current >= count) {
-        return it;
+    size_t i = min_ >> Precision << Precision;
+    for (; i < max_ && current + groups_[i >> Precision] < sample_count;
+         i += 1ull << Precision) {
+      current += groups_[i >> Precision];
+    }
+    for (; i < max_; ++i) {
+      current += buckets_[i];
+      if (current >= sample_count) {
+        return double(lower_bound(i));
       }
     }
-    return buckets_.end();
+    return double(lower_bound(max_));
   }
-  uint64_t total() const {
-    uint64_t total = 0ULL;
-    for (auto &&[b, c] : buckets_) {
-      total += c;
-    }
-    return total;
+  double value() { return percentile(50); }
+  void clear() {
+    buckets_.fill(0ull);
+    groups_.fill(0ull);
+    total_ = 0;
+    min_ = N;
+    max_ = 0;
   }
-  double percentile(double p) const {
-    uint64_t total = 0;
-    for (auto &&[b, c] : buckets_) {
-      total += c;
+
+private:
+  std::array<uint64_t, N> buckets_;
+  std::array<uint64_t, (N >> Precision)> groups_;
+  uint64_t total_;
+  size_t min_;
+  size_t max_;
+};
+
+using precision_sampler = hdr_histogram<>;
+
+// Histogram recorded by several threads. Every thread records in its own
+// recorder with relaxed atomic updates, snapshots add the recorders up
+// without stopping them.
+template <unsigned Precision = 7> class atomic_hdr_histogram {
+public:
+  using histogram_t = hdr_histogram<Precision>;
+
+  class recorder {
+  public:
+    recorder() {
+      for (auto &bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+      }
+    }
+    // Must only be called by the thread that owns the recorder
+    void sample(uint64_t x) {
+      auto &bucket = buckets_[histogram_t::index(x)];
+      bucket.store(bucket.load(std::memory_order_relaxed) + 1,
+                   std::memory_order_relaxed);
     }
 
-    uint64_t sample_count = (int64_t(total * p) + 99ull) / 100ull;
+  private:
+    std::array<std::atomic<uint64_t>, histogram_t::N> buckets_;
+    recorder *next_ = nullptr;
+    friend class atomic_hdr_histogram;
+  };
 
-    auto it = sample_index(sample_count);
-    return it == buckets_.end() ? NAN : double(it->first);
+  atomic_hdr_histogram() = default;
+  atomic_hdr_histogram(const atomic_hdr_histogram &) = delete;
+  atomic_hdr_histogram &operator=(const atomic_hdr_histogram &) = delete;
+  ~atomic_hdr_histogram() {
+    auto *rec = head_.load(std::memory_order_acquire);
+    while (rec) {
+      auto *next = rec->next_;
+      delete rec;
+      rec = next;
+    }
+  }
+  // Creates a recorder for the calling thread, valid while the histogram is
+  // alive
+  recorder &add_recorder() {
+    auto *rec = new recorder();
+    rec->next_ = head_.load(std::memory_order_relaxed);
+    while (!head_.compare_exchange_weak(rec->next_, rec,
+                                        std::memory_order_release,
+                                        std::memory_order_relaxed)) {
+    }
+    return *rec;
+  }
+  // Adds the samples recorded so far to the histogram
+  void snapshot(histogram_t &out) const {
+    for (auto *rec = head_.load(std::memory_order_acquire); rec;
+         rec = rec->next_) {
+      for (size_t i = 0; i < histogram_t::N; ++i) {
+        out.add(i, rec->buckets_[i].load(std::memory_order_relaxed));
+      }
+    }
   }
-  double value() override { return percentile(50); }
-  void clear() { buckets_.clear(); }
 
 private:
-  buckets_t buckets_;
+  std::atomic<recorder *> head_ = nullptr;
+};
+
+// Registry of the process, opt-in by setting FMC_COUNTER_REGISTRY to the
+// path of the registry file
+struct counter_registry_handler {
+  counter_registry_handler() {
+    char *file_path = std::getenv("FMC_COUNTER_REGISTRY");
+    if (file_path != NULL) {
+      fmc_error_t *error;
+      registry_ = fmc_counter_registry_new(file_path, 1024, &error);
+      fmc_runtime_error_unless(!error)
+          << "unable to create counter registry " << file_path << ": "
+          << fmc_error_msg(error);
+    }
+  }
+  ~counter_registry_handler() {
+    if (registry_) {
+      fmc_error_t *error;
+      fmc_counter_registry_del(registry_, &error);
+    }
+  }
+  fmc_counter_registry_t *registry_ = nullptr;
 };
 
+inline fmc_counter_registry_t *counter_registry() {
+  static counter_registry_handler handler;
+  return handler.registry_;
+}
+
+inline fmc_counter *counter_registry_add(string_view name) {
+  auto *registry = counter_registry();
+  if (!registry)
+    return nullptr;
+  fmc_error_t *error;
+  std::string key(name);
+  auto *counter = fmc_counter_registry_add(registry, key.c_str(),
+                                           FMC_COUNTER_DOUBLE, &error);
+  fmc_runtime_error_unless(!error)
+      << "unable to add counter " << key << ": " << fmc_error_msg(error);
+  return counter;
+}
+
 class samples {
 private:
   samples(const samples &) = delete;
@@ -314,9 +450,23 @@ public:
     std::string key(raw_key);
     return map_.find(key);
   }
+  // Writes the current values to the counter registry. Meant to be called
+  // periodically, away from the code that records the samples.
+  void publish() {
+    for (auto &&[key, sampl] : map_) {
+      auto where = counters_.find(key);
+      if (where == counters_.end()) {
+        where = counters_.emplace(key, counter_registry_add(key)).first;
+      }
+      if (where->second) {
+        fmc_counter_set_double(where->second, sampl->value());
+      }
+    }
+  }
 
 private:
   map_t map_;
+  unordered_map<std::string, fmc_counter *> counters_;
 };
 
 struct rdtsc {
@@ -444,11 +594,18 @@ struct counter_outfile_handler {
 static counter_outfile_handler counter_outfile_handler_;
 
 template <class Record> struct counter_record {
-  counter_record(const char *name) { name_ = name; }
+  counter_record(const char *name) : counter_(counter_registry_add(name)) {
+    name_ = name;
+  }
 
   void start() { nr_.start(); }
 
-  void stop() { nr_.stop(); }
+  void stop() {
+    nr_.stop();
+    if (counter_) {
+      fmc_counter_set_double(counter_, nr_.value());
+    }
+  }
 
   double value() { return nr_.value(); }
   ~counter_record() {
@@ -456,6 +613,7 @@ template <class Record> struct counter_record {
   }
   Record nr_;
   const char *name_;
+  fmc_counter *counter_;
 };
 
 template <class Record>
@@ -478,17 +636,17 @@ using rdtsc_elapsed_counter = single_scope_sampler<rdtsc_counter_record>;
   static ::fmc::counter::counter_record<                                       \
       ::fmc::counter::rdtsc_record<::fmc::counter::ewma<10>>>                  \
       counter_##X##__LINE__("FMC_NANO_EWMA(" #X ")");                          \
-  ::fmc::counter::scoped_sampler<                                              \
-      ::fmc::counter::rdtsc_record<::fmc::counter::ewma<10>>>                  \
-      scoped_sampler_##X##__LINE__(counter_##X##__LINE__.nr_)
+  ::fmc::counter::scoped_sampler<::fmc::counter::counter_record<               \
+      ::fmc::counter::rdtsc_record<::fmc::counter::ewma<10>>>>                 \
+      scoped_sampler_##X##__LINE__(counter_##X##__LINE__)
 
 #define FMC_NANO_AVG(X)                                                        \
   static ::fmc::counter::counter_record<                                       \
       ::fmc::counter::rdtsc_record<::fmc::counter::avg>>                       \
       counter_##X##__LINE__("FMC_NANO_AVG(" #X ")");                           \
-  ::fmc::counter::scoped_sampler<                                              \
-      ::fmc::counter::rdtsc_record<::fmc::counter::avg>>                       \
-      scoped_sampler_##X##__LINE__(counter_##X##__LINE__.nr_)
+  ::fmc::counter::scoped_sampler<::fmc::counter::counter_record<               \
+      ::fmc::counter::rdtsc_record<::fmc::counter::avg>>>                      \
+      scoped_sampler_##X##__LINE__(counter_##X##__LINE__)
 
 #else
 
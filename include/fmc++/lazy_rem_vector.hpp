@@ -81,16 +81,36 @@ struct lazy_rem_vector : private std::vector<std::pair<T, bool>> {
 
   void release() {
     if (--lock_count == 0) {
-      if (removed_count > 0) {
-        removed_count = 0;
-
-        V::erase(std::remove_if(V::begin(), V::end(),
-                                [&](const typename V::value_type &val) {
-                                  return val.second;
-                                }),
-                 V::end());
+      compact();
+    }
+  }
+
+  // Marks matching elements as removed without erasing them, for vectors
+  // locked by their owner instead of with lock and release. Returns true if
+  // any element was marked.
+  template <typename F> bool mark_if(const F &f) {
+    bool marked = false;
+    for (auto &val : static_cast<V &>(*this)) {
+      if (!val.second && f(val.first)) {
+        ++removed_count;
+        val.second = true;
+        marked = true;
       }
     }
+    return marked;
+  }
+
+  // Erases the elements marked as removed
+  void compact() {
+    if (removed_count > 0) {
+      removed_count = 0;
+
+      V::erase(std::remove_if(V::begin(), V::end(),
+                              [&](const typename V::value_type &val) {
+                                return val.second;
+                              }),
+               V::end());
+    }
   }
 
 protected:
@@ -0,0 +1,171 @@
+/******************************************************************************
+        COPYRIGHT (c) 2019-2023 by Featuremine Corporation.
+
+        This Source Code Form is subject to the terms of the Mozilla Public
+        License, v. 2.0. If a copy of the MPL was not distributed with this
+        file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *****************************************************************************/
+
+/**
+ * @file counter_registry.h
+ * @date 18 Oct 2026
+ * @brief File contains C declaration of the shared memory counter registry
+ *
+ * A registry is a memory mapped file with a header followed by fixed size
+ * counter slots, one per cache line. The process that owns the registry
+ * updates the counters with relaxed atomic operations and other processes
+ * map the file read only to scrape them.
+ * @see http://www.featuremine.com
+ */
+
+#pragma once
+
+#include <fmc/error.h>
+#include <fmc/platform.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FMC_COUNTER_REGISTRY_MAGIC "FMCCNTRS"
+#define FMC_COUNTER_REGISTRY_VERSION 1
+#define FMC_COUNTER_NAME_SIZE 48
+
+typedef enum {
+  FMC_COUNTER_COUNT = 0,  // unsigned counter
+  FMC_COUNTER_GAUGE = 1,  // signed value
+  FMC_COUNTER_DOUBLE = 2, // floating point value
+} fmc_counter_kind;
+
+struct fmc_counter_registry_hdr {
+  char magic[8];
+  uint32_t version;
+  uint32_t capacity;
+  uint64_t count; // published slots
+  int64_t pid;
+  char reserved[32];
+};
+
+struct fmc_counter {
+  char name[FMC_COUNTER_NAME_SIZE];
+  uint32_t kind;
+  uint32_t reserved;
+  uint64_t value;
+};
+
+typedef struct fmc_counter_registry fmc_counter_registry_t;
+
+/**
+ * @brief Creates a registry file and maps it for writing
+ *
+ * Truncates the file if it exists.
+ *
+ * @param path path of the registry file
+ * @param capacity maximum number of counters
+ * @param error out-parameter for error handling
+ * @return the registry
+ */
+FMMODFUNC fmc_counter_registry_t *
+fmc_counter_registry_new(const char *path, size_t capacity,
+                         fmc_error_t **error);
+
+/**
+ * @brief Maps an existing registry file for reading
+ *
+ * @param path path of the registry file
+ * @param error out-parameter for error handling
+ * @return the registry
+ */
+FMMODFUNC fmc_counter_registry_t *
+fmc_counter_registry_open(const char *path, fmc_error_t **error);
+
+/**
+ * @brief Unmaps the registry file and deallocates the registry
+ *
+ * @param registry the registry
+ * @param error out-parameter for error handling
+ */
+FMMODFUNC void fmc_counter_registry_del(fmc_counter_registry_t *registry,
+                                        fmc_error_t **error);
+
+/**
+ * @brief Returns the counter with the given name, adding it if needed
+ *
+ * Names longer than FMC_COUNTER_NAME_SIZE - 1 are truncated.
+ *
+ * @param registry a registry created with fmc_counter_registry_new
+ * @param name name of the counter
+ * @param kind kind of the counter
+ * @param error out-parameter for error handling
+ * @return the counter, valid until the registry is deleted
+ */
+FMMODFUNC struct fmc_counter *
+fmc_counter_registry_add(fmc_counter_registry_t *registry, const char *name,
+                         fmc_counter_kind kind, fmc_error_t **error);
+
+/**
+ * @brief Returns the number of counters in the registry
+ *
+ * @param registry the registry
+ * @return the number of counters
+ */
+FMMODFUNC size_t fmc_counter_registry_count(fmc_counter_registry_t *registry);
+
+/**
+ * @brief Returns a counter of the registry
+ *
+ * @param registry the registry
+ * @param idx index of the counter, less than fmc_counter_registry_count
+ * @return the counter
+ */
+FMMODFUNC const struct fmc_counter *
+fmc_counter_registry_get(fmc_counter_registry_t *registry, size_t idx);
+
+/**
+ * @brief Returns the process id of the owner of the registry
+ *
+ * @param registry the registry
+ * @return the process id
+ */
+FMMODFUNC int64_t fmc_counter_registry_pid(fmc_counter_registry_t *registry);
+
+static inline void fmc_counter_add(struct fmc_counter *counter,
+                                   uint64_t value) {
+  __atomic_fetch_add(&counter->value, value, __ATOMIC_RELAXED);
+}
+
+static inline void fmc_counter_set(struct fmc_counter *counter,
+                                   int64_t value) {
+  __atomic_store_n(&counter->value, (uint64_t)value, __ATOMIC_RELAXED);
+}
+
+static inline void fmc_counter_set_double(struct fmc_counter *counter,
+                                          double value) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  __atomic_store_n(&counter->value, bits, __ATOMIC_RELAXED);
+}
+
+// Returns the value of the counter converted according to its kind
+static inline double fmc_counter_value(const struct fmc_counter *counter) {
+  uint64_t bits = __atomic_load_n(&counter->value, __ATOMIC_RELAXED);
+  switch (counter->kind) {
+  case FMC_COUNTER_GAUGE:
+    return (double)(int64_t)bits;
+  case FMC_COUNTER_DOUBLE: {
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+  default:
+    return (double)bits;
+  }
+}
+
+#ifdef __cplusplus
+}
+#endif
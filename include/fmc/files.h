@@ -252,6 +252,21 @@ FMMODFUNC void fmc_fresize(fmc_fd fd, size_t new_size, fmc_error_t **error);
  */
 FMMODFUNC void fmc_falloc(fmc_fd fd, long long sz, fmc_error_t **error);
 
+/**
+ * @brief Copies a range of a file into the same range of another file
+ *
+ * The copy is done by the kernel when possible, which may share the extents
+ * of both files instead of copying the data.
+ *
+ * @param dest destination file descriptor
+ * @param src source file descriptor
+ * @param offset offset of the range in both files
+ * @param sz size of the range in bytes
+ * @param error out-parameter for error handling
+ */
+FMMODFUNC void fmc_fcopy(fmc_fd dest, fmc_fd src, size_t offset, size_t sz,
+                         fmc_error_t **error);
+
 /**
  * @brief Maps a file descriptor into memory
  *
@@ -282,6 +297,45 @@ FMMODFUNC void fmc_fview_destroy(fmc_fview_t *view, size_t length,
  */
 FMMODFUNC void *fmc_fview_data(fmc_fview_t *view);
 
+/**
+ * @brief Returns the alignment required for the offset and length of the
+ * memory mappings of a file
+ *
+ * For files in hugetlbfs this is the huge page size of the file system,
+ * otherwise it is the page size (allocation granularity in Windows).
+ *
+ * @param fd the file descriptor
+ * @param error out-parameter for error handling
+ * @return the mapping granularity in bytes on success, 0 otherwise
+ */
+FMMODFUNC size_t fmc_fview_granularity(fmc_fd fd, fmc_error_t **error);
+
+/**
+ * @brief Returns whether the memory mappings of a file can be backed by huge
+ * pages
+ *
+ * Only files in tmpfs and hugetlbfs can be backed by huge pages.
+ *
+ * @param fd the file descriptor
+ * @param error out-parameter for error handling
+ * @return true if the file is in tmpfs or hugetlbfs
+ */
+FMMODFUNC bool fmc_fhugepages(fmc_fd fd, fmc_error_t **error);
+
+/**
+ * @brief Advises the system to back a memory mapping with huge pages
+ *
+ * Transparent huge pages are used only for mappings of files in tmpfs
+ * configured to allow them. It has no effect if the system does not support
+ * transparent huge pages.
+ *
+ * @param view the memory mapping handler
+ * @param length the length of the mapping
+ * @param error out-parameter for error handling
+ */
+FMMODFUNC void fmc_fview_advise_hugepages(fmc_fview_t *view, size_t length,
+                                          fmc_error_t **error);
+
 /**
  * @brief Remaps a virtual memory address
  *
@@ -306,6 +360,20 @@ FMMODFUNC void fmc_fview_remap(fmc_fview_t *view, fmc_fd fd, size_t old_size,
 FMMODFUNC void fmc_fview_sync(fmc_fview_t *view, size_t size,
                               fmc_error_t **error);
 
+/**
+ * @brief Synchronizes a range of a memory map with its file
+ *
+ * The beginning of the range is rounded down to the page size.
+ *
+ * @param view the memory mapping handler
+ * @param offset the offset of the range in the mapping
+ * @param size the size of the range
+ * @param wait wait for the range to be written to the file
+ * @param error out-parameter for error handling
+ */
+FMMODFUNC void fmc_fview_sync_2(fmc_fview_t *view, size_t offset, size_t size,
+                                bool wait, fmc_error_t **error);
+
 /**
  * @brief Make all changes done to all files actually appear on disk
  */
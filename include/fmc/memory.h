@@ -18,6 +18,9 @@
 
 #include <fmc/error.h>
 
+#include <stdbool.h>
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -42,6 +45,9 @@ struct fmc_pool_node {
 struct fmc_pool {
   struct fmc_pool_node *used;
   struct fmc_pool_node *free;
+  // Set by reactors that run components on several threads
+  bool concurrent;
+  int lock;
 };
 
 /**
@@ -58,6 +64,17 @@ FMMODFUNC void fmc_pool_init(struct fmc_pool *p);
  */
 FMMODFUNC void fmc_pool_destroy(struct fmc_pool *p);
 
+/**
+ * @brief Sets whether the arenas of the pools are backed by huge pages
+ *
+ * Nodes and buffers of every pool are carved from arenas shared by the
+ * process, only arenas mapped after the call are affected. Transparent huge
+ * pages are requested if there are no huge pages reserved.
+ *
+ * @param enable true to use huge pages
+ */
+FMMODFUNC void fmc_pool_huge_pages_set(bool enable);
+
 /**
  * @brief Initialize memory with allocated buffer
  *
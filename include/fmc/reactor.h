@@ -44,6 +44,7 @@ fmc_component_sys_destroy(&sys);
 #include <fmc/platform.h>
 #include <fmc/time.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -93,6 +94,14 @@ typedef void (*fmc_reactor_exec_clbck)(struct fmc_component *self,
 typedef void (*fmc_reactor_shutdown_clbck)(struct fmc_component *self,
                                            struct fmc_reactor_ctx *ctx);
 
+#define FMC_REACTOR_FD_READ 1u
+#define FMC_REACTOR_FD_WRITE 2u
+#define FMC_REACTOR_FD_ERROR 4u
+
+typedef void (*fmc_reactor_fd_clbck)(struct fmc_component *self,
+                                     struct fmc_reactor_ctx *ctx, int fd,
+                                     uint32_t events);
+
 struct fmc_reactor_ctx_out {
   struct fmc_reactor_ctx_out *next;
   struct fmc_reactor_ctx_out *prev;
@@ -106,6 +115,13 @@ struct fmc_reactor_ctx_dep {
   size_t inp_idx;
 };
 
+// Execution time statistics of a component, in nanoseconds
+struct fmc_reactor_stat {
+  size_t count;
+  int64_t total;
+  int64_t max;
+};
+
 struct fmc_reactor_ctx {
   struct fmc_reactor *reactor;
   struct fmc_component *comp;
@@ -121,6 +137,8 @@ struct fmc_reactor_ctx {
   fmc_array deps; // change to use a structure that holds both dep idx and input
                   // idx array of array of structures - no lists.
                   // fmc_reactor_ctx_dep
+  struct fmc_reactor_stat exec_stat; // updated while reactor stats are on
+  int worker; // worker thread the component is pinned to, -1 for any
 };
 
 struct fmc_reactor_stop_item {
@@ -141,11 +159,30 @@ struct fmc_reactor {
   struct fmc_reactor_stop_item *stop_list;
   struct fmc_pool pool;
   fmc_error_t err;
+  struct fmc_reactor_threads *threads; // NULL when running on a single thread
+  struct fmc_timer_wheel *wheel; // NULL when timers are kept in sched
+  struct fmc_reactor_io *io;     // NULL until the reactor waits for events
+  bool stats; // collect the execution times of the components
+  struct fmc_reactor_profile *profile; // NULL unless profiling
 };
 
 struct fmc_component_input;
 
 FMMODFUNC void fmc_reactor_init(struct fmc_reactor *reactor);
+
+/**
+ * @brief Initializes a reactor that keeps scheduled components in a
+ * hierarchical timer wheel instead of a binary heap
+ *
+ * Scheduling a component is a constant time operation, which pays off when
+ * many components are scheduled periodically.
+ *
+ * @param reactor the reactor
+ * @param tick resolution of the timer wheel in nanoseconds
+ * @param error out-parameter for error handling
+ */
+FMMODFUNC void fmc_reactor_init_wheel(struct fmc_reactor *reactor,
+                                      int64_t tick, fmc_error_t **error);
 FMMODFUNC void fmc_reactor_destroy(struct fmc_reactor *reactor);
 FMMODFUNC struct fmc_reactor_ctx *
 fmc_reactor_ctx_new(struct fmc_reactor *reactor, fmc_error_t **error);
@@ -160,6 +197,99 @@ FMMODFUNC void fmc_reactor_run(struct fmc_reactor *reactor, bool live,
                                fmc_error_t **error);
 FMMODFUNC void fmc_reactor_stop(struct fmc_reactor *reactor);
 
+/**
+ * @brief Runs the components of the reactor on a pool of worker threads
+ *
+ * Worker 0 is the thread that runs the reactor, the other workers are started
+ * by this function. Within a run, a component is executed once none of the
+ * components it depends on, directly or indirectly, is pending or running,
+ * so independent branches of the graph run in parallel. Components are
+ * executed concurrently with components they are not connected to and must
+ * not share unsynchronized state with them. With one thread the reactor
+ * runs every component on the calling thread in index order.
+ *
+ * @param reactor the reactor
+ * @param threads number of worker threads, including the thread that runs
+ * the reactor
+ * @param cpus CPU affinity of the workers 1 to threads - 1, negative values
+ * leave a worker unpinned. May be NULL.
+ * @param error out-parameter for error handling
+ */
+FMMODFUNC void fmc_reactor_threads_set(struct fmc_reactor *reactor,
+                                       size_t threads, const int *cpus,
+                                       fmc_error_t **error);
+
+/**
+ * @brief Pins a component to a worker thread
+ *
+ * @param ctx the reactor context of the component
+ * @param worker the worker index, -1 to run the component on any worker
+ */
+FMMODFUNC void fmc_reactor_ctx_worker_set(struct fmc_reactor_ctx *ctx,
+                                          int worker);
+
+/**
+ * @brief Registers a file descriptor with a readiness callback
+ *
+ * The callback runs on the thread that runs the reactor, before the queued
+ * components are executed, for as long as the file descriptor is ready.
+ * Once a file descriptor is registered, a live reactor that has nothing to
+ * run blocks until a file descriptor is ready or a component is scheduled.
+ *
+ * @param ctx the reactor context of the component
+ * @param fd the file descriptor
+ * @param events FMC_REACTOR_FD_READ and/or FMC_REACTOR_FD_WRITE
+ * @param cl the callback, receives the events that are ready, including
+ * FMC_REACTOR_FD_ERROR on error or hang up
+ * @param error out-parameter for error handling
+ */
+FMMODFUNC void fmc_reactor_ctx_fd_add(struct fmc_reactor_ctx *ctx, int fd,
+                                      uint32_t events, fmc_reactor_fd_clbck cl,
+                                      fmc_error_t **error);
+
+/**
+ * @brief Unregisters a file descriptor
+ *
+ * @param ctx the reactor context of the component
+ * @param fd the file descriptor
+ * @param error out-parameter for error handling
+ */
+FMMODFUNC void fmc_reactor_ctx_fd_rm(struct fmc_reactor_ctx *ctx, int fd,
+                                     fmc_error_t **error);
+
+/**
+ * @brief Makes a live reactor block when it has nothing to run
+ *
+ * Before blocking, the reactor keeps polling the file descriptors for the
+ * given budget, which keeps the latency of bursts low.
+ *
+ * @param reactor the reactor
+ * @param budget busy polling budget in nanoseconds
+ * @param error out-parameter for error handling
+ */
+FMMODFUNC void fmc_reactor_busy_poll_set(struct fmc_reactor *reactor,
+                                         int64_t budget, fmc_error_t **error);
+
+/**
+ * @brief Enables or disables the collection of component execution times
+ *
+ * @param reactor the reactor
+ * @param enable true to time every execution of the components
+ */
+FMMODFUNC void fmc_reactor_stats_set(struct fmc_reactor *reactor, bool enable);
+
+/**
+ * @brief Takes the execution time statistics of a component
+ *
+ * The statistics are reset, so every call returns the executions since the
+ * previous one. May be called from any thread.
+ *
+ * @param ctx the reactor context of the component
+ * @param stat out-parameter for the statistics
+ */
+FMMODFUNC void fmc_reactor_ctx_stat_take(struct fmc_reactor_ctx *ctx,
+                                         struct fmc_reactor_stat *stat);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,105 @@
+/******************************************************************************
+        COPYRIGHT (c) 2019-2023 by Featuremine Corporation.
+
+        This Source Code Form is subject to the terms of the Mozilla Public
+        License, v. 2.0. If a copy of the MPL was not distributed with this
+        file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *****************************************************************************/
+
+/**
+ * @file reactor_profile.h
+ * @date 18 Oct 2026
+ * @brief File contains reactor profiling interface
+ *
+ * The instrumentation is only compiled in when the library is built with
+ * FMC_REACTOR_PROFILE defined, otherwise fmc_reactor_profile_set fails and
+ * the reactor runs exactly as without profiling. Execution times are
+ * measured in time stamp counter cycles and kept in a histogram with 4
+ * buckets per power of two.
+ * @see http://www.featuremine.com
+ */
+
+#pragma once
+
+#include <fmc/component.h>
+#include <fmc/error.h>
+#include <fmc/platform.h>
+#include <fmc/reactor.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FMC_REACTOR_PROFILE_BUCKETS 256
+
+struct fmc_reactor_ctx_profile {
+  // Execution time histogram in cycles
+  uint64_t exec_hist[FMC_REACTOR_PROFILE_BUCKETS];
+  size_t execs;
+  uint64_t exec_cycles;
+  uint64_t exec_max;
+  // Components notified by each notification of an output
+  struct fmc_reactor_stat fanout;
+  // Nanoseconds from the moment the component is queued until it runs
+  struct fmc_reactor_stat dwell;
+  // Nanoseconds from the scheduled time until the component runs
+  struct fmc_reactor_stat lateness;
+};
+
+/**
+ * @brief Enables or disables the profiling of the reactor components
+ *
+ * Enabling the profiling resets it. Components created afterwards are not
+ * profiled. The profiling is not available while the reactor runs on worker
+ * threads.
+ *
+ * @param reactor the reactor
+ * @param enable true to enable the profiling
+ * @param error out-parameter for error handling, set if the library was
+ * built without FMC_REACTOR_PROFILE or the reactor runs on worker threads
+ */
+FMMODFUNC void fmc_reactor_profile_set(struct fmc_reactor *reactor,
+                                       bool enable, fmc_error_t **error);
+
+/**
+ * @brief Returns the profile of a component
+ *
+ * @param ctx the reactor context of the component
+ * @return the profile, NULL if the component is not profiled
+ */
+FMMODFUNC const struct fmc_reactor_ctx_profile *
+fmc_reactor_ctx_profile_get(struct fmc_reactor_ctx *ctx);
+
+/**
+ * @brief Returns the number of cycles per nanosecond of the profile clock
+ *
+ * @param reactor the reactor
+ * @return cycles per nanosecond, 0 if the profiling is disabled
+ */
+FMMODFUNC double fmc_reactor_profile_cycles_per_ns(struct fmc_reactor *reactor);
+
+/**
+ * @brief Returns the lowest number of cycles of a histogram bucket
+ *
+ * @param bucket the bucket index
+ * @return the number of cycles
+ */
+FMMODFUNC uint64_t fmc_reactor_profile_bucket_cycles(size_t bucket);
+
+/**
+ * @brief Returns a percentile of the execution times of a component
+ *
+ * @param profile the profile of the component
+ * @param percentile the percentile, from 0 to 100
+ * @return the lowest number of cycles of the bucket of the percentile
+ */
+FMMODFUNC uint64_t fmc_reactor_profile_percentile(
+    const struct fmc_reactor_ctx_profile *profile, double percentile);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,130 @@
+/******************************************************************************
+        COPYRIGHT (c) 2019-2023 by Featuremine Corporation.
+
+        This Source Code Form is subject to the terms of the Mozilla Public
+        License, v. 2.0. If a copy of the MPL was not distributed with this
+        file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *****************************************************************************/
+
+/**
+ * @file timer_wheel.h
+ * @date 18 Oct 2026
+ * @brief File contains hierarchical timer wheel interface
+ *
+ * Timers are kept in 11 levels of 64 slots. A timer is stored in the level
+ * of the highest 6 bit group in which its expiration tick differs from the
+ * current tick of the wheel, so adding and cancelling a timer are constant
+ * time operations. Timers are moved to lower levels as the wheel advances.
+ * @see http://www.featuremine.com
+ */
+
+#pragma once
+
+#include <fmc/error.h>
+#include <fmc/platform.h>
+#include <fmc/time.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FMC_TIMER_WHEEL_LEVELS 11
+#define FMC_TIMER_WHEEL_SLOTS 64
+
+struct fmc_timer {
+  struct fmc_timer *next;
+  struct fmc_timer *prev;
+  fmc_time64_t t;
+  size_t data;
+  uint8_t level;
+  uint8_t slot;
+};
+
+struct fmc_timer_wheel {
+  int64_t tick;
+  uint64_t cur;
+  size_t count;
+  fmc_time64_t next; // earliest expiration, valid if next_valid is set
+  bool next_valid;
+  uint64_t occupied[FMC_TIMER_WHEEL_LEVELS];
+  struct fmc_timer *slots[FMC_TIMER_WHEEL_LEVELS][FMC_TIMER_WHEEL_SLOTS];
+  struct fmc_timer *free; // released timers, reused by fmc_timer_wheel_add
+};
+
+/**
+ * @brief Initializes a timer wheel
+ *
+ * @param w pointer to the timer wheel to be initialized
+ * @param tick resolution of the wheel in nanoseconds. Timers that expire in
+ * the same tick share a slot.
+ */
+FMMODFUNC void fmc_timer_wheel_init(struct fmc_timer_wheel *w, int64_t tick);
+
+/**
+ * @brief Destroys a timer wheel and releases its timers
+ *
+ * @param w pointer to the timer wheel to be destroyed
+ */
+FMMODFUNC void fmc_timer_wheel_destroy(struct fmc_timer_wheel *w);
+
+/**
+ * @brief Adds a timer
+ *
+ * @param w timer wheel pointer
+ * @param t expiration time
+ * @param data value returned by fmc_timer_wheel_pop when the timer expires
+ * @param error out-parameter for error handling
+ * @return the timer, valid until it expires or is cancelled
+ */
+FMMODFUNC struct fmc_timer *fmc_timer_wheel_add(struct fmc_timer_wheel *w,
+                                                fmc_time64_t t, size_t data,
+                                                fmc_error_t **error);
+
+/**
+ * @brief Cancels a timer
+ *
+ * @param w timer wheel pointer
+ * @param timer the timer returned by fmc_timer_wheel_add
+ */
+FMMODFUNC void fmc_timer_wheel_cancel(struct fmc_timer_wheel *w,
+                                      struct fmc_timer *timer);
+
+/**
+ * @brief Cancels every timer with the given data
+ *
+ * Visits every timer of the wheel.
+ *
+ * @param w timer wheel pointer
+ * @param data the data of the timers to cancel
+ */
+FMMODFUNC void fmc_timer_wheel_cancel_data(struct fmc_timer_wheel *w,
+                                           size_t data);
+
+/**
+ * @brief Returns the expiration time of the earliest timer
+ *
+ * @param w timer wheel pointer
+ * @return the expiration time, fmc_time64_end() if there are no timers
+ */
+FMMODFUNC fmc_time64_t fmc_timer_wheel_next(struct fmc_timer_wheel *w);
+
+/**
+ * @brief Removes a timer that expires at or before now
+ *
+ * Timers are not returned in expiration order.
+ *
+ * @param w timer wheel pointer
+ * @param now the current time
+ * @param data out-parameter for the data of the expired timer
+ * @return true if an expired timer was removed, false otherwise
+ */
+FMMODFUNC bool fmc_timer_wheel_pop(struct fmc_timer_wheel *w,
+                                   fmc_time64_t now, size_t *data);
+
+#ifdef __cplusplus
+}
+#endif
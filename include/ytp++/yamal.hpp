@@ -299,13 +299,14 @@ public:
   using announcement_type = std::tuple<uint64_t, std::string_view,
                                        std::string_view, std::string_view>;
 
-  yamal_t(fmc_fd fd, bool enable_thread = true, bool closable = false) {
+  yamal_t(fmc_fd fd, bool enable_thread = true, bool closable = false,
+          size_t page_size = 0) {
     fmc_error_t *err = nullptr;
     yamal_ = std::shared_ptr<ytp_yamal_t>(
-        ytp_yamal_new_3(fd, enable_thread,
+        ytp_yamal_new_4(fd, enable_thread,
                         YTP_CLOSABLE_MODE(YTP_CLOSABLE * closable +
                                           YTP_UNCLOSABLE * !closable),
-                        &err),
+                        page_size, &err),
         [](auto yml) {
           fmc_error_t *err = nullptr;
           if (yml) {
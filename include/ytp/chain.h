@@ -0,0 +1,138 @@
+/******************************************************************************
+        COPYRIGHT (c) 2019-2023 by Featuremine Corporation.
+
+        This Source Code Form is subject to the terms of the Mozilla Public
+        License, v. 2.0. If a copy of the MPL was not distributed with this
+        file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *****************************************************************************/
+
+/**
+ * @file chain.h
+ * @date 18 Oct 2026
+ * @brief File contains C declaration of stream chain API
+ *
+ * A stream chain links the data messages of every stream in a sidecar yamal
+ * file, so readers of a few streams only touch the messages they consume.
+ * @see http://www.featuremine.com
+ */
+
+#pragma once
+
+#include <ytp/api.h>
+#include <ytp/cursor.h>
+#include <ytp/stream.h>
+#include <ytp/yamal.h>
+
+#include <fmc/error.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define YTP_CHAIN_LIST_LINKS 0
+#define YTP_CHAIN_LIST_STREAMS 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ytp_chain ytp_chain_t;
+
+/**
+ * @brief Allocates and initializes a ytp_chain_t object
+ *
+ * @param[in] yamal the ytp_yamal_t object with the data
+ * @param[in] sidecar the ytp_yamal_t object where the chains are stored
+ * @param[out] error out-parameter for error handling
+ * @return ytp_chain_t object
+ */
+FMMODFUNC ytp_chain_t *ytp_chain_new(ytp_yamal_t *yamal, ytp_yamal_t *sidecar,
+                                     fmc_error_t **error);
+
+/**
+ * @brief Destroys and deallocates a ytp_chain_t object
+ *
+ * @param[in] chain the ytp_chain_t object
+ * @param[out] error out-parameter for error handling
+ */
+FMMODFUNC void ytp_chain_del(ytp_chain_t *chain, fmc_error_t **error);
+
+/**
+ * @brief Links up to max_msgs data messages that are not in the sidecar yet
+ *
+ * The first call resumes from the last message linked in the sidecar. Only
+ * one ytp_chain_t object may update a sidecar at a time.
+ *
+ * @param[in] chain the ytp_chain_t object
+ * @param[in] max_msgs maximum number of data messages to link
+ * @param[out] error out-parameter for error handling
+ * @return number of data messages linked
+ */
+FMMODFUNC size_t ytp_chain_update(ytp_chain_t *chain, size_t max_msgs,
+                                  fmc_error_t **error);
+
+/**
+ * @brief Registers a stream announcement callback
+ *
+ * @param[in] chain the ytp_chain_t object
+ * @param[in] cb the callback pointer
+ * @param[in] closure the closure pointer
+ * @param[out] error out-parameter for error handling
+ */
+FMMODFUNC void ytp_chain_ann_cb(ytp_chain_t *chain, ytp_cursor_ann_cb_t cb,
+                                void *closure, fmc_error_t **error);
+
+/**
+ * @brief Unregisters a stream announcement callback
+ *
+ * @param[in] chain the ytp_chain_t object
+ * @param[in] cb the callback pointer
+ * @param[in] closure the closure pointer
+ * @param[out] error out-parameter for error handling
+ */
+FMMODFUNC void ytp_chain_ann_cb_rm(ytp_chain_t *chain, ytp_cursor_ann_cb_t cb,
+                                   void *closure, fmc_error_t **error);
+
+/**
+ * @brief Registers a data callback for a stream
+ *
+ * @param[in] chain the ytp_chain_t object
+ * @param[in] stream the stream id
+ * @param[in] cb the callback pointer
+ * @param[in] closure the closure pointer
+ * @param[out] error out-parameter for error handling
+ */
+FMMODFUNC void ytp_chain_data_cb(ytp_chain_t *chain, ytp_mmnode_offs stream,
+                                 ytp_cursor_data_cb_t cb, void *closure,
+                                 fmc_error_t **error);
+
+/**
+ * @brief Unregisters a data callback for a stream
+ *
+ * @param[in] chain the ytp_chain_t object
+ * @param[in] stream the stream id
+ * @param[in] cb the callback pointer
+ * @param[in] closure the closure pointer
+ * @param[out] error out-parameter for error handling
+ */
+FMMODFUNC void ytp_chain_data_cb_rm(ytp_chain_t *chain, ytp_mmnode_offs stream,
+                                    ytp_cursor_data_cb_t cb, void *closure,
+                                    fmc_error_t **error);
+
+/**
+ * @brief Reads the next announcement or linked message of the streams with
+ * callbacks and executes their callbacks
+ *
+ * Announcements are processed first, in order. Streams are merged by
+ * sequence number, only following their links in the sidecar. Streams start
+ * from their first message. Data callbacks receive the stream id of the
+ * original announcement, same as ytp_cursor_t.
+ *
+ * @param[in] chain the ytp_chain_t object
+ * @param[out] error out-parameter for error handling
+ * @return true if a message was processed, false otherwise
+ */
+FMMODFUNC bool ytp_chain_poll(ytp_chain_t *chain, fmc_error_t **error);
+
+#ifdef __cplusplus
+}
+#endif
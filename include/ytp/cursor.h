@@ -144,6 +144,22 @@ FMMODFUNC void ytp_cursor_data_cb_rm(ytp_cursor_t *cursor,
  */
 FMMODFUNC bool ytp_cursor_poll(ytp_cursor_t *cursor, fmc_error_t **error);
 
+/**
+ * @brief Reads up to max_msgs available messages and executes the callbacks
+ * that apply.
+ *
+ * Callback arrays are locked once for the whole batch, so callbacks removed
+ * while dispatching are only compacted when the batch finishes.
+ *
+ * @param[in] cursor the ytp_cursor_t object
+ * @param[in] max_msgs maximum number of messages to process
+ * @param[in] max_ns time budget in nanoseconds, negative for no limit
+ * @param[out] error out-parameter for error handling
+ * @return number of messages processed
+ */
+FMMODFUNC size_t ytp_cursor_poll_n(ytp_cursor_t *cursor, size_t max_msgs,
+                                   int64_t max_ns, fmc_error_t **error);
+
 // TODO: add ytp_cursor_poll_until
 
 /**
@@ -176,6 +192,22 @@ FMMODFUNC void ytp_cursor_all_cb_rm(ytp_cursor_t *cursor);
 FMMODFUNC void ytp_cursor_seek(ytp_cursor_t *cursor, ytp_mmnode_offs offset,
                                fmc_error_t **error);
 
+/**
+ * @brief Moves data pointer to the first message with a timestamp greater or
+ * equal than ts
+ *
+ * The time index written along with the data is binary searched and the data
+ * list is scanned from the last indexed message before ts. Timestamps are
+ * expected to be non-decreasing along the data list. If there is no such
+ * message the data pointer is moved to the end of the list.
+ *
+ * @param[in] cursor the ytp_cursor_t object
+ * @param[in] ts the timestamp in nanoseconds
+ * @param[out] error out-parameter for error handling
+ */
+FMMODFUNC void ytp_cursor_seek_time(ytp_cursor_t *cursor, int64_t ts,
+                                    fmc_error_t **error);
+
 /**
  * @brief Returns serializable offset of the current data iterator
  *
@@ -26,6 +26,8 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+#define YTP_DATA_TIME_INDEX_STREAM ((ytp_mmnode_offs)0)
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -41,6 +43,24 @@ extern "C" {
 FMMODFUNC char *ytp_data_reserve(ytp_yamal_t *yamal, size_t sz,
                                  fmc_error_t **error);
 
+/**
+ * @brief Reserves memory for a batch of data messages in the memory mapped
+ * list
+ *
+ * The space for all of the messages is claimed with a single atomic
+ * operation.
+ *
+ * @param[in] yamal
+ * @param[in] sizes the sizes of the data payloads
+ * @param[out] data the writable pointers for data, one per size
+ * @param[in] count the number of messages to reserve, up to
+ * YTP_YAMAL_BATCH_MAX
+ * @param[out] error out-parameter for error handling
+ */
+FMMODFUNC void ytp_data_reserve_batch(ytp_yamal_t *yamal, const size_t *sizes,
+                                      char **data, size_t count,
+                                      fmc_error_t **error);
+
 /**
  * @brief Commits the data to the memory mapped list
  *
@@ -55,6 +75,27 @@ FMMODFUNC ytp_iterator_t ytp_data_commit(ytp_yamal_t *yamal, int64_t ts,
                                          ytp_mmnode_offs stream, void *data,
                                          fmc_error_t **error);
 
+/**
+ * @brief Commits a batch of data messages to the memory mapped list
+ *
+ * The messages are linked in order and published with a single atomic
+ * operation.
+ *
+ * @param[in] yamal
+ * @param[in] ts the timestamp of each message
+ * @param[in] streams the stream of each message
+ * @param[in] data the values returned by ytp_data_reserve_batch
+ * @param[in] count the number of messages to commit, up to
+ * YTP_YAMAL_BATCH_MAX
+ * @param[out] error out-parameter for error handling
+ * @return ytp_iterator_t for the first message
+ */
+FMMODFUNC ytp_iterator_t ytp_data_commit_batch(ytp_yamal_t *yamal,
+                                               const int64_t *ts,
+                                               const ytp_mmnode_offs *streams,
+                                               char *const *data, size_t count,
+                                               fmc_error_t **error);
+
 /**
  * @brief Commits a new data node to an existing sublist (first_ptr, last_ptr)
  * that is not in the main memory mapped list
@@ -104,6 +145,23 @@ FMMODFUNC void ytp_data_read(ytp_yamal_t *yamal, ytp_iterator_t iterator,
                              ytp_mmnode_offs *stream, size_t *sz,
                              const char **data, fmc_error_t **error);
 
+/**
+ * @brief Configures the time index maintained alongside the data list
+ *
+ * The index is disabled by default. Once enabled, the first data message
+ * committed through the handle in every following interval sized block of
+ * the file is recorded in the index list, as an index message for stream
+ * YTP_DATA_TIME_INDEX_STREAM with the message timestamp as payload.
+ * The index must only be enabled on a single writer of the file,
+ * YTP_YAMAL_TIME_INDEX_INTERVAL_DEFAULT is a suitable interval.
+ *
+ * @param[in] yamal
+ * @param[in] interval block size in bytes, zero disables the index
+ * @param[out] error out-parameter for error handling
+ */
+FMMODFUNC void ytp_data_set_time_index(ytp_yamal_t *yamal, size_t interval,
+                                       fmc_error_t **error);
+
 /**
  * @brief Returns an iterator to the beginning of the list
  *
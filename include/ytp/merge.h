@@ -0,0 +1,152 @@
+/******************************************************************************
+        COPYRIGHT (c) 2019-2023 by Featuremine Corporation.
+
+        This Source Code Form is subject to the terms of the Mozilla Public
+        License, v. 2.0. If a copy of the MPL was not distributed with this
+        file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *****************************************************************************/
+
+/**
+ * @file merge.h
+ * @date 18 Oct 2026
+ * @brief File contains C declaration of merge cursor API
+ *
+ * A merge cursor reads the data of several yamal files in timestamp order.
+ * @see http://www.featuremine.com
+ */
+
+#pragma once
+
+#include <ytp/api.h>
+#include <ytp/cursor.h>
+#include <ytp/yamal.h>
+
+#include <fmc/error.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ytp_merge_cursor ytp_merge_cursor_t;
+
+typedef void (*ytp_merge_cursor_ann_cb_t)(
+    void *closure, size_t input, uint64_t seqno, ytp_mmnode_offs stream,
+    size_t peer_sz, const char *peer_name, size_t ch_sz, const char *ch_name,
+    size_t encoding_sz, const char *encoding_data, bool subscribed);
+
+/**
+ * @brief Allocates and initializes a ytp_merge_cursor_t object
+ *
+ * @param[in] yamals the ytp_yamal_t objects to merge, in tie break order
+ * @param[in] count the number of ytp_yamal_t objects
+ * @param[out] error out-parameter for error handling
+ * @return ytp_merge_cursor_t object
+ */
+FMMODFUNC ytp_merge_cursor_t *ytp_merge_cursor_new(ytp_yamal_t *const *yamals,
+                                                   size_t count,
+                                                   fmc_error_t **error);
+
+/**
+ * @brief Destroys and deallocates a ytp_merge_cursor_t object
+ *
+ * @param[in] merge the ytp_merge_cursor_t object
+ * @param[out] error out-parameter for error handling
+ */
+FMMODFUNC void ytp_merge_cursor_del(ytp_merge_cursor_t *merge,
+                                    fmc_error_t **error);
+
+/**
+ * @brief Registers an announcement callback for every input
+ *
+ * @param[in] merge the ytp_merge_cursor_t object
+ * @param[in] cb the callback pointer
+ * @param[in] closure the closure pointer
+ * @param[out] error out-parameter for error handling
+ */
+FMMODFUNC void ytp_merge_cursor_ann_cb(ytp_merge_cursor_t *merge,
+                                       ytp_merge_cursor_ann_cb_t cb,
+                                       void *closure, fmc_error_t **error);
+
+/**
+ * @brief Unregisters an announcement callback
+ *
+ * @param[in] merge the ytp_merge_cursor_t object
+ * @param[in] cb the callback pointer
+ * @param[in] closure the closure pointer
+ * @param[out] error out-parameter for error handling
+ */
+FMMODFUNC void ytp_merge_cursor_ann_cb_rm(ytp_merge_cursor_t *merge,
+                                          ytp_merge_cursor_ann_cb_t cb,
+                                          void *closure, fmc_error_t **error);
+
+/**
+ * @brief Registers a data callback for a stream of an input
+ *
+ * @param[in] merge the ytp_merge_cursor_t object
+ * @param[in] input the index of the input
+ * @param[in] stream the stream id in the input
+ * @param[in] cb the callback pointer
+ * @param[in] closure the closure pointer
+ * @param[out] error out-parameter for error handling
+ */
+FMMODFUNC void ytp_merge_cursor_data_cb(ytp_merge_cursor_t *merge,
+                                        size_t input, ytp_mmnode_offs stream,
+                                        ytp_cursor_data_cb_t cb, void *closure,
+                                        fmc_error_t **error);
+
+/**
+ * @brief Unregisters a data callback for a stream of an input
+ *
+ * @param[in] merge the ytp_merge_cursor_t object
+ * @param[in] input the index of the input
+ * @param[in] stream the stream id in the input
+ * @param[in] cb the callback pointer
+ * @param[in] closure the closure pointer
+ * @param[out] error out-parameter for error handling
+ */
+FMMODFUNC void ytp_merge_cursor_data_cb_rm(ytp_merge_cursor_t *merge,
+                                           size_t input,
+                                           ytp_mmnode_offs stream,
+                                           ytp_cursor_data_cb_t cb,
+                                           void *closure, fmc_error_t **error);
+
+/**
+ * @brief Reads the message with the lowest timestamp across the inputs and
+ * executes the callbacks that apply
+ *
+ * Ties are broken by input order and, within an input, by sequence number.
+ * Inputs that reach their end are checked again on every call, until their
+ * data list is closed. Messages appended to a file afterwards are not ordered
+ * with the messages already delivered from other files.
+ *
+ * @param[in] merge the ytp_merge_cursor_t object
+ * @param[out] error out-parameter for error handling
+ * @return true if a message was processed, false otherwise
+ */
+FMMODFUNC bool ytp_merge_cursor_poll(ytp_merge_cursor_t *merge,
+                                     fmc_error_t **error);
+
+/**
+ * @brief Reads up to max_msgs messages in timestamp order and executes the
+ * callbacks that apply
+ *
+ * Inputs that reach their end are checked again once per call, so messages
+ * appended to them during the call are read by the next call.
+ *
+ * @param[in] merge the ytp_merge_cursor_t object
+ * @param[in] max_msgs maximum number of messages to process
+ * @param[in] max_ns time budget in nanoseconds, negative for no limit
+ * @param[out] error out-parameter for error handling
+ * @return number of messages processed
+ */
+FMMODFUNC size_t ytp_merge_cursor_poll_n(ytp_merge_cursor_t *merge,
+                                         size_t max_msgs, int64_t max_ns,
+                                         fmc_error_t **error);
+
+#ifdef __cplusplus
+}
+#endif
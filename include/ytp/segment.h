@@ -0,0 +1,155 @@
+/******************************************************************************
+        COPYRIGHT (c) 2019-2023 by Featuremine Corporation.
+
+        This Source Code Form is subject to the terms of the Mozilla Public
+        License, v. 2.0. If a copy of the MPL was not distributed with this
+        file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *****************************************************************************/
+
+/**
+ * @file segment.h
+ * @date 18 Oct 2026
+ * @brief File contains C declaration of segmented yamal API
+ *
+ * A segmented yamal is a sequence of closable yamal files named
+ * path.0, path.1, ... The writer starts a new segment when the current one
+ * reaches a size or time threshold. Segments are linked with records in the
+ * index list, so cursors follow them and old segments can be archived.
+ * @see http://www.featuremine.com
+ */
+
+#pragma once
+
+#include <ytp/api.h>
+#include <ytp/cursor.h>
+#include <ytp/yamal.h>
+
+#include <fmc/error.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Index records of the segment links, the stream ids do not collide with
+// announcements and YTP_DATA_TIME_INDEX_STREAM
+#define YTP_SEGMENT_PREV_STREAM ((ytp_mmnode_offs)1)
+#define YTP_SEGMENT_NEXT_STREAM ((ytp_mmnode_offs)2)
+#define YTP_SEGMENT_MAP_STREAM ((ytp_mmnode_offs)3)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ytp_segment ytp_segment_t;
+
+/**
+ * @brief Allocates and initializes a ytp_segment_t writer
+ *
+ * Opens the last segment of path, or creates path.0 if there is none.
+ * Stream ids are unique across segments: a stream keeps the id of the
+ * segment where it was first announced, offset by the size of the segments
+ * that precede it.
+ *
+ * @param[in] path the path of the segments without the segment number
+ * @param[in] max_size size of a segment that triggers a new segment, 0 to
+ * disable
+ * @param[in] max_ns time span of the messages of a segment that triggers a
+ * new segment, 0 to disable
+ * @param[out] error out-parameter for error handling
+ * @return ytp_segment_t object
+ */
+FMMODFUNC ytp_segment_t *ytp_segment_new(const char *path, size_t max_size,
+                                         int64_t max_ns, fmc_error_t **error);
+
+/**
+ * @brief Destroys and deallocates a ytp_segment_t object
+ *
+ * The current segment is left open for writing.
+ *
+ * @param[in] segment the ytp_segment_t object
+ * @param[out] error out-parameter for error handling
+ */
+FMMODFUNC void ytp_segment_del(ytp_segment_t *segment, fmc_error_t **error);
+
+/**
+ * @brief Returns the yamal of the current segment
+ *
+ * @param[in] segment the ytp_segment_t object
+ * @return ytp_yamal_t object
+ */
+FMMODFUNC ytp_yamal_t *ytp_segment_yamal(ytp_segment_t *segment);
+
+/**
+ * @brief Announces a stream in the current segment
+ *
+ * @param[in] segment the ytp_segment_t object
+ * @param[in] psz the peer name size
+ * @param[in] peer the peer name
+ * @param[in] csz the channel name size
+ * @param[in] channel the channel name
+ * @param[in] esz the encoding size
+ * @param[in] encoding the encoding
+ * @param[out] error out-parameter for error handling
+ * @return the stream id
+ */
+FMMODFUNC ytp_mmnode_offs ytp_segment_announce(ytp_segment_t *segment,
+                                               size_t psz, const char *peer,
+                                               size_t csz, const char *channel,
+                                               size_t esz, const char *encoding,
+                                               fmc_error_t **error);
+
+/**
+ * @brief Reserves memory for data in the current segment
+ *
+ * @param[in] segment the ytp_segment_t object
+ * @param[in] sz the size of the data payload
+ * @param[out] error out-parameter for error handling
+ * @return a writable pointer for data
+ */
+FMMODFUNC char *ytp_segment_reserve(ytp_segment_t *segment, size_t sz,
+                                    fmc_error_t **error);
+
+/**
+ * @brief Commits the data to the current segment
+ *
+ * Starts a new segment after the commit if a threshold was reached.
+ *
+ * @param[in] segment the ytp_segment_t object
+ * @param[in] ts the message timestamp
+ * @param[in] stream the stream id returned by ytp_segment_announce
+ * @param[in] data the value returned by ytp_segment_reserve
+ * @param[out] error out-parameter for error handling
+ */
+FMMODFUNC void ytp_segment_commit(ytp_segment_t *segment, int64_t ts,
+                                  ytp_mmnode_offs stream, void *data,
+                                  fmc_error_t **error);
+
+/**
+ * @brief Starts a new segment
+ *
+ * The streams are announced again in the new segment, the current segment is
+ * linked to it and its data list is closed.
+ *
+ * @param[in] segment the ytp_segment_t object
+ * @param[out] error out-parameter for error handling
+ */
+FMMODFUNC void ytp_segment_roll(ytp_segment_t *segment, fmc_error_t **error);
+
+/**
+ * @brief Allocates and initializes a ytp_cursor_t that follows the segments
+ *
+ * The cursor starts at the segment file given and moves to the next segment
+ * once the data list of the current one is closed. Streams announced again in
+ * a later segment are reported once, with the id of their first
+ * announcement. ytp_cursor_seek and ytp_cursor_tell operate within the
+ * current segment.
+ *
+ * @param[in] path the path of a segment file
+ * @param[out] error out-parameter for error handling
+ * @return ytp_cursor_t object
+ */
+FMMODFUNC ytp_cursor_t *ytp_segment_cursor_new(const char *path,
+                                               fmc_error_t **error);
+
+#ifdef __cplusplus
+}
+#endif
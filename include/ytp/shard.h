@@ -0,0 +1,152 @@
+/******************************************************************************
+        COPYRIGHT (c) 2019-2023 by Featuremine Corporation.
+
+        This Source Code Form is subject to the terms of the Mozilla Public
+        License, v. 2.0. If a copy of the MPL was not distributed with this
+        file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *****************************************************************************/
+
+/**
+ * @file shard.h
+ * @date 18 Oct 2026
+ * @brief File contains C declaration of sharded consumer API
+ *
+ * A shard reader walks the data list of a yamal once and dispatches the
+ * messages to a pool of worker threads by stream id. Every stream is handled
+ * by a single worker, so messages of a stream are delivered in order. Idle
+ * workers spin briefly and then sleep until messages are dispatched to them.
+ * @see http://www.featuremine.com
+ */
+
+#pragma once
+
+#include <ytp/api.h>
+#include <ytp/cursor.h>
+#include <ytp/yamal.h>
+
+#include <fmc/error.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ytp_shard ytp_shard_t;
+
+/**
+ * @brief Allocates and initializes a ytp_shard_t object and starts its
+ * worker threads
+ *
+ * @param[in] yamal the ytp_yamal_t object
+ * @param[in] workers the number of worker threads
+ * @param[in] ring_size capacity of the ring of every worker, rounded up to a
+ * power of two
+ * @param[out] error out-parameter for error handling
+ * @return ytp_shard_t object
+ */
+FMMODFUNC ytp_shard_t *ytp_shard_new(ytp_yamal_t *yamal, size_t workers,
+                                     size_t ring_size, fmc_error_t **error);
+
+/**
+ * @brief Waits for the workers to process the dispatched messages, stops
+ * them and deallocates the ytp_shard_t object
+ *
+ * @param[in] shard the ytp_shard_t object
+ * @param[out] error out-parameter for error handling
+ */
+FMMODFUNC void ytp_shard_del(ytp_shard_t *shard, fmc_error_t **error);
+
+/**
+ * @brief Registers an announcement callback
+ *
+ * Announcement callbacks run on the thread that polls the shard.
+ *
+ * @param[in] shard the ytp_shard_t object
+ * @param[in] cb the callback pointer
+ * @param[in] closure the closure pointer
+ * @param[out] error out-parameter for error handling
+ */
+FMMODFUNC void ytp_shard_ann_cb(ytp_shard_t *shard, ytp_cursor_ann_cb_t cb,
+                                void *closure, fmc_error_t **error);
+
+/**
+ * @brief Unregisters an announcement callback
+ *
+ * @param[in] shard the ytp_shard_t object
+ * @param[in] cb the callback pointer
+ * @param[in] closure the closure pointer
+ * @param[out] error out-parameter for error handling
+ */
+FMMODFUNC void ytp_shard_ann_cb_rm(ytp_shard_t *shard, ytp_cursor_ann_cb_t cb,
+                                   void *closure, fmc_error_t **error);
+
+/**
+ * @brief Registers a data callback that runs on the worker of the stream
+ *
+ * Must be called from the thread that polls the shard, for example from an
+ * announcement callback. The callback receives a pointer to the data in the
+ * yamal mapping.
+ *
+ * @param[in] shard the ytp_shard_t object
+ * @param[in] stream the stream id
+ * @param[in] cb the callback pointer
+ * @param[in] closure the closure pointer
+ * @param[out] error out-parameter for error handling
+ */
+FMMODFUNC void ytp_shard_data_cb(ytp_shard_t *shard, ytp_mmnode_offs stream,
+                                 ytp_cursor_data_cb_t cb, void *closure,
+                                 fmc_error_t **error);
+
+/**
+ * @brief Unregisters a data callback
+ *
+ * Must be called from the thread that polls the shard. The callback is not
+ * executed for messages read after this call.
+ *
+ * @param[in] shard the ytp_shard_t object
+ * @param[in] stream the stream id
+ * @param[in] cb the callback pointer
+ * @param[in] closure the closure pointer
+ * @param[out] error out-parameter for error handling
+ */
+FMMODFUNC void ytp_shard_data_cb_rm(ytp_shard_t *shard, ytp_mmnode_offs stream,
+                                    ytp_cursor_data_cb_t cb, void *closure,
+                                    fmc_error_t **error);
+
+/**
+ * @brief Reads one message and dispatches it to the worker of its stream
+ *
+ * Waits for space if the ring of the worker is full.
+ *
+ * @param[in] shard the ytp_shard_t object
+ * @param[out] error out-parameter for error handling
+ * @return true if a message was read, false otherwise
+ */
+FMMODFUNC bool ytp_shard_poll(ytp_shard_t *shard, fmc_error_t **error);
+
+/**
+ * @brief Reads up to max_msgs messages and dispatches them to the workers
+ *
+ * @param[in] shard the ytp_shard_t object
+ * @param[in] max_msgs maximum number of messages to read
+ * @param[in] max_ns time budget in nanoseconds, negative for no limit
+ * @param[out] error out-parameter for error handling
+ * @return number of messages read
+ */
+FMMODFUNC size_t ytp_shard_poll_n(ytp_shard_t *shard, size_t max_msgs,
+                                  int64_t max_ns, fmc_error_t **error);
+
+/**
+ * @brief Waits until the workers have processed every dispatched message
+ *
+ * @param[in] shard the ytp_shard_t object
+ * @param[out] error out-parameter for error handling
+ */
+FMMODFUNC void ytp_shard_drain(ytp_shard_t *shard, fmc_error_t **error);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,172 @@
+/******************************************************************************
+        COPYRIGHT (c) 2019-2023 by Featuremine Corporation.
+
+        This Source Code Form is subject to the terms of the Mozilla Public
+        License, v. 2.0. If a copy of the MPL was not distributed with this
+        file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *****************************************************************************/
+
+/**
+ * @file telemetry.h
+ * @date 18 Oct 2026
+ * @brief File contains C declaration of telemetry API
+ *
+ * A telemetry object publishes the metrics of a yamal, and optionally of
+ * cursors and of the components of a reactor, on a reserved stream of the
+ * same yamal. Every message starts with a ytp_telemetry_hdr followed by
+ * count ytp_telemetry_record, all of them in yamal byte order.
+ * @see http://www.featuremine.com
+ */
+
+#pragma once
+
+#include <ytp/api.h>
+#include <ytp/cursor.h>
+#include <ytp/streams.h>
+#include <ytp/yamal.h>
+
+#include <fmc/error.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define YTP_TELEMETRY_PEER "ytp"
+#define YTP_TELEMETRY_CHANNEL "ytp/telemetry"
+#define YTP_TELEMETRY_ENCODING "Content-Type application/ytp-telemetry"
+#define YTP_TELEMETRY_VERSION 1
+
+typedef enum {
+  // Reservations: count, total and maximum latency in nanoseconds
+  YTP_TELEMETRY_RESERVE = 1,
+  // Commits: count, total and maximum latency in nanoseconds
+  YTP_TELEMETRY_COMMIT = 2,
+  // Pages allocated while reserving: count in the period, total since open
+  YTP_TELEMETRY_SYNC_ALLOCS = 3,
+  // Synchronizations of the auxiliary thread: count, total and maximum
+  // duration in nanoseconds
+  YTP_TELEMETRY_AUX_SYNC = 4,
+  // Bytes reserved after the next message of the cursor in id: count is 1,
+  // total and maximum are the lag
+  YTP_TELEMETRY_CURSOR_LAG = 5,
+  // Executions of the reactor component in id: count, total and maximum
+  // execution time in nanoseconds
+  YTP_TELEMETRY_EXEC = 6,
+} YTP_TELEMETRY_METRIC;
+
+struct ytp_telemetry_hdr {
+  uint32_t pid;
+  uint16_t version;
+  uint16_t count; // number of records that follow
+  int64_t period; // nanoseconds since the previous message
+};
+
+struct ytp_telemetry_record {
+  uint16_t metric; // YTP_TELEMETRY_METRIC
+  uint16_t id;     // cursor or component index, 0 for the yamal metrics
+  uint32_t count;
+  int64_t total;
+  int64_t max;
+};
+
+struct fmc_reactor;
+
+typedef struct ytp_telemetry ytp_telemetry_t;
+
+/**
+ * @brief Allocates and initializes a ytp_telemetry_t object
+ *
+ * Announces the telemetry stream and enables the latency statistics of the
+ * yamal.
+ *
+ * @param[in] yamal the ytp_yamal_t object, must outlive the telemetry
+ * @param[in] streams the ytp_streams_t object of the yamal
+ * @param[in] period_ns minimum interval in nanoseconds between messages
+ * @param[out] error out-parameter for error handling
+ * @return ytp_telemetry_t object
+ */
+FMMODFUNC ytp_telemetry_t *ytp_telemetry_new(ytp_yamal_t *yamal,
+                                             ytp_streams_t *streams,
+                                             int64_t period_ns,
+                                             fmc_error_t **error);
+
+/**
+ * @brief Deallocates a ytp_telemetry_t object
+ *
+ * Disables the statistics enabled by the telemetry.
+ *
+ * @param[in] telemetry the ytp_telemetry_t object
+ * @param[out] error out-parameter for error handling
+ */
+FMMODFUNC void ytp_telemetry_del(ytp_telemetry_t *telemetry,
+                                 fmc_error_t **error);
+
+/**
+ * @brief Publishes the lag of a cursor
+ *
+ * The lag is sampled when the message is published, so the cursor should be
+ * polled on the thread that publishes the telemetry.
+ *
+ * @param[in] telemetry the ytp_telemetry_t object
+ * @param[in] cursor the ytp_cursor_t object, must outlive the telemetry
+ * @param[out] error out-parameter for error handling
+ * @return the id of the cursor in the records
+ */
+FMMODFUNC size_t ytp_telemetry_cursor_add(ytp_telemetry_t *telemetry,
+                                          ytp_cursor_t *cursor,
+                                          fmc_error_t **error);
+
+/**
+ * @brief Publishes the execution times of the components of a reactor
+ *
+ * Enables the statistics of the reactor.
+ *
+ * @param[in] telemetry the ytp_telemetry_t object
+ * @param[in] reactor the reactor, must outlive the telemetry. NULL stops
+ * publishing the execution times.
+ */
+FMMODFUNC void ytp_telemetry_reactor_set(ytp_telemetry_t *telemetry,
+                                         struct fmc_reactor *reactor);
+
+/**
+ * @brief Publishes a message if the period elapsed since the previous one
+ *
+ * @param[in] telemetry the ytp_telemetry_t object
+ * @param[out] error out-parameter for error handling
+ * @return true if a message was published, false otherwise
+ */
+FMMODFUNC bool ytp_telemetry_poll(ytp_telemetry_t *telemetry,
+                                  fmc_error_t **error);
+
+/**
+ * @brief Publishes a message
+ *
+ * @param[in] telemetry the ytp_telemetry_t object
+ * @param[out] error out-parameter for error handling
+ */
+FMMODFUNC void ytp_telemetry_publish(ytp_telemetry_t *telemetry,
+                                     fmc_error_t **error);
+
+/**
+ * @brief Decodes a telemetry message
+ *
+ * @param[in] data the message
+ * @param[in] sz the size of the message
+ * @param[out] hdr the header of the message
+ * @param[out] records the records of the message
+ * @param[in] max maximum number of records to decode
+ * @param[out] error out-parameter for error handling
+ * @return number of records decoded
+ */
+FMMODFUNC size_t ytp_telemetry_decode(const char *data, size_t sz,
+                                      struct ytp_telemetry_hdr *hdr,
+                                      struct ytp_telemetry_record *records,
+                                      size_t max, fmc_error_t **error);
+
+#ifdef __cplusplus
+}
+#endif
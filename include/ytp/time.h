@@ -37,6 +37,19 @@ extern "C" {
 FMMODFUNC char *ytp_time_reserve(ytp_yamal_t *yamal, size_t sz,
                                  fmc_error_t **error);
 
+/**
+ * @brief Reserves memory for a batch of data nodes in the memory mapped list
+ *
+ * @param[in] yamal the ytp_yamal_t object
+ * @param[in] sizes the sizes of the data payloads
+ * @param[out] data the writable pointers for data, one per size
+ * @param[in] count the number of nodes to reserve, up to YTP_YAMAL_BATCH_MAX
+ * @param[out] error out-parameter for error handling
+ */
+FMMODFUNC void ytp_time_reserve_batch(ytp_yamal_t *yamal, const size_t *sizes,
+                                      char **data, size_t count,
+                                      fmc_error_t **error);
+
 /**
  * @brief Commits the data to the memory mapped list on the time level.
  *
@@ -52,6 +65,24 @@ FMMODFUNC ytp_iterator_t ytp_time_commit(ytp_yamal_t *yamal, int64_t ts,
                                          void *data, size_t listidx,
                                          fmc_error_t **error);
 
+/**
+ * @brief Commits a batch of data nodes to the memory mapped list on the time
+ * level.
+ *
+ * @param[in] yamal the ytp_yamal_t object
+ * @param[in] ts the time to publish each message
+ * @param[in] data the values returned by ytp_time_reserve_batch
+ * @param[in] count the number of nodes to commit, up to YTP_YAMAL_BATCH_MAX
+ * @param[in] listidx the list index to commit to
+ * @param[out] error out-parameter for error handling
+ * @return ytp_iterator_t for the first message
+ */
+FMMODFUNC ytp_iterator_t ytp_time_commit_batch(ytp_yamal_t *yamal,
+                                               const int64_t *ts,
+                                               char *const *data, size_t count,
+                                               size_t listidx,
+                                               fmc_error_t **error);
+
 /**
  * @brief Commits a new data node to an existing sublist (first_ptr, last_ptr)
  * that is not in the main memory mapped list
@@ -234,6 +234,22 @@ FMMODFUNC void ytp_timeline_iter_set(ytp_timeline_t *timeline,
  */
 FMMODFUNC bool ytp_timeline_poll(ytp_timeline_t *timeline, fmc_error_t **error);
 
+/**
+ * @brief Reads up to max_msgs available messages and executes the callbacks
+ * that apply.
+ *
+ * Callback vectors are locked once for the whole batch. Idle callbacks are
+ * executed if no message was available.
+ *
+ * @param[in] timeline
+ * @param[in] max_msgs maximum number of messages to process
+ * @param[in] max_ns time budget in nanoseconds, negative for no limit
+ * @param[out] error out-parameter for error handling
+ * @return number of messages processed
+ */
+FMMODFUNC size_t ytp_timeline_poll_n(ytp_timeline_t *timeline, size_t max_msgs,
+                                     int64_t max_ns, fmc_error_t **error);
+
 /**
  * @brief Reads one message and executes the callbacks that applies if timeline
  * is behind src_timeline
@@ -0,0 +1,88 @@
+/******************************************************************************
+        COPYRIGHT (c) 2019-2023 by Featuremine Corporation.
+
+        This Source Code Form is subject to the terms of the Mozilla Public
+        License, v. 2.0. If a copy of the MPL was not distributed with this
+        file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *****************************************************************************/
+
+/**
+ * @file waitable.h
+ * @date 18 Oct 2026
+ * @brief File contains C declaration of waitable cursor API
+ *
+ * A waitable exposes a cursor as an eventfd that can be registered with
+ * epoll, for example with fmc_reactor_ctx_fd_add. A thread blocks in
+ * ytp_yamal_wait after the cursor is polled and makes the descriptor readable
+ * once a writer commits a message. The descriptor is also readable right
+ * away while the cursor has a backlog of messages.
+ * @see http://www.featuremine.com
+ */
+
+#pragma once
+
+#include <ytp/api.h>
+#include <ytp/cursor.h>
+
+#include <fmc/error.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ytp_waitable ytp_waitable_t;
+
+/**
+ * @brief Allocates and initializes a ytp_waitable_t object
+ *
+ * @param[in] cursor the ytp_cursor_t object, must outlive the waitable
+ * @param[in] interval_ns interval in nanoseconds at which new announcements
+ * and closed segments are checked while the cursor has no data messages, up
+ * to 100 milliseconds
+ * @param[out] error out-parameter for error handling
+ * @return ytp_waitable_t object
+ */
+FMMODFUNC ytp_waitable_t *ytp_waitable_new(ytp_cursor_t *cursor,
+                                           int64_t interval_ns,
+                                           fmc_error_t **error);
+
+/**
+ * @brief Deallocates a ytp_waitable_t object
+ *
+ * @param[in] waitable the ytp_waitable_t object
+ * @param[out] error out-parameter for error handling
+ */
+FMMODFUNC void ytp_waitable_del(ytp_waitable_t *waitable, fmc_error_t **error);
+
+/**
+ * @brief Returns the file descriptor of the waitable
+ *
+ * The descriptor is readable when the cursor should be polled. It is owned by
+ * the waitable and must not be read or closed.
+ *
+ * @param[in] waitable the ytp_waitable_t object
+ * @return the file descriptor
+ */
+FMMODFUNC int ytp_waitable_fd(ytp_waitable_t *waitable);
+
+/**
+ * @brief Clears the readiness of the file descriptor and polls the cursor
+ *
+ * If max_msgs messages were read, the descriptor is made readable again so
+ * the remaining messages are read on the next wake up. Otherwise the waitable
+ * waits for new messages after the position of the cursor.
+ *
+ * @param[in] waitable the ytp_waitable_t object
+ * @param[in] max_msgs maximum number of messages to process
+ * @param[out] error out-parameter for error handling
+ * @return number of messages processed
+ */
+FMMODFUNC size_t ytp_waitable_poll(ytp_waitable_t *waitable, size_t max_msgs,
+                                   fmc_error_t **error);
+
+#ifdef __cplusplus
+}
+#endif
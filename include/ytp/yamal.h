@@ -27,26 +27,80 @@
 #include <stddef.h>
 
 #define YTP_MMLIST_PAGE_SIZE ((size_t)(1024 * 1024 * 8))
+#define YTP_MMLIST_PAGE_SIZE_MIN ((size_t)(1024 * 64))
+#define YTP_MMLIST_PAGE_SIZE_MAX ((size_t)(1024 * 1024 * 1024))
 #define YTP_MMLIST_PREALLOC_SIZE ((size_t)(1024 * 1024 * 3))
+#define YTP_MMLIST_PREALLOC_MAX_DEFAULT ((size_t)(1024 * 1024 * 256))
+#define YTP_MMLIST_PREALLOC_HORIZON_DEFAULT ((int64_t)(1000 * 1000 * 1000))
 #define YTP_MMLIST_PAGE_COUNT_MAX ((size_t)(1024 * 64 * 8))
+#define YTP_MMLIST_PAGE_CHUNK_SIZE ((size_t)1024)
+#define YTP_MMLIST_PAGE_CHUNK_COUNT                                            \
+  (YTP_MMLIST_PAGE_COUNT_MAX / YTP_MMLIST_PAGE_CHUNK_SIZE)
 #define YTP_MMNODE_HEADER_SIZE 32
 #define YTP_YAMAL_HEADER_SIZE 536
 #define YTP_YAMAL_LISTS 16
+#define YTP_YAMAL_BATCH_MAX 64
+#define YTP_YAMAL_SYNC_INTERVAL_DEFAULT ((int64_t)(10 * 1000 * 1000))
+#define YTP_YAMAL_WAIT_SPIN_DEFAULT ((int64_t)(50 * 1000))
+#define YTP_YAMAL_WAIT_PARK_DEFAULT ((int64_t)(1000 * 1000))
+#define YTP_YAMAL_TIME_INDEX_INTERVAL_DEFAULT ((size_t)(1024 * 1024))
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+typedef enum {
+  YTP_SYNC_NONE = 0,
+  YTP_SYNC_ASYNC = 1,
+  YTP_SYNC_DURABLE = 2
+} YTP_SYNC_MODE;
+
+struct ytp_yamal_page {
+  struct fmc_fview view;
+  struct ytp_yamal_page *next_mapped;
+};
+
+// Latency statistics of a yamal operation, in nanoseconds
+struct ytp_yamal_stat {
+  size_t count;
+  int64_t total;
+  int64_t max;
+};
+
 typedef struct ytp_yamal {
   pthread_mutex_t m_;
-  pthread_mutex_t pa_mutex_;
   pthread_cond_t cv_;
   pthread_t thread_;
   fmc_fd fd_;
   bool done_;
   bool readonly_;
   bool thread_created_;
-  struct fmc_fview pages_[YTP_MMLIST_PAGE_COUNT_MAX];
+  bool hugepages_;
+  size_t page_size_;
+  size_t page_shift_;
+  YTP_SYNC_MODE sync_mode_;
+  int64_t sync_interval_;
+  int64_t sync_last_;
+  size_t synced_size_;
+  int64_t prealloc_horizon_;
+  size_t prealloc_max_;
+  int64_t prealloc_last_;
+  size_t prealloc_size_;
+  double prealloc_rate_;
+  size_t sync_allocs_;
+  // Latencies collected while stats_ is set
+  bool stats_;
+  struct ytp_yamal_stat reserve_stat_;
+  struct ytp_yamal_stat commit_stat_;
+  struct ytp_yamal_stat sync_stat_;
+  int64_t wait_spin_;
+  int64_t wait_park_;
+  size_t time_index_interval_;
+  size_t time_index_next_;
+  // Pages are looked up through chunks of YTP_MMLIST_PAGE_CHUNK_SIZE entries
+  // that are allocated on demand. Mapped pages are also linked together.
+  struct ytp_yamal_page *mapped_pages_;
+  struct ytp_yamal_page *page_chunks_[YTP_MMLIST_PAGE_CHUNK_COUNT];
 } ytp_yamal_t;
 
 typedef uint64_t ytp_mmnode_offs;
@@ -64,6 +118,15 @@ struct ytp_hdr {
   uint64_t size;
   struct ytp_mmnode hdr[YTP_YAMAL_LISTS];
   uint8_t closable;
+  // log2 of the page size, zero in files created with the default page size
+  // before it was configurable. Files with another page size have a different
+  // magic number, so that older readers reject them
+  uint8_t page_shift;
+  // number of readers parked in ytp_yamal_wait, cleared by writers that find
+  // no reader to wake up
+  uint16_t waiters;
+  // futex word that writers increment to wake up parked readers
+  uint32_t notify;
 };
 
 typedef enum { YTP_CLOSABLE = 1, YTP_UNCLOSABLE = 2 } YTP_CLOSABLE_MODE;
@@ -146,6 +209,133 @@ FMMODFUNC ytp_yamal_t *ytp_yamal_new_3(int fd, bool enable_thread,
                                        YTP_CLOSABLE_MODE closable,
                                        fmc_error_t **error);
 
+/**
+ * @brief Initializes a ytp_yamal_t object with a given page size
+ *
+ * The page size is stored in the file header when the file is created.
+ * Opening an existing file with a page size different from the one in the
+ * file is an error. Files with a page size other than YTP_MMLIST_PAGE_SIZE
+ * can not be opened by versions that do not support the page size. Pages of
+ * files in tmpfs are mapped with transparent huge pages when the page size is
+ * a multiple of the huge page size.
+ *
+ * @param[out] yamal
+ * @param[in] fd a yamal file descriptor
+ * @param[in] enable_thread enable the preallocation and sync thread
+ * @param[in] closable closable mode
+ * @param[in] page_size a power of two between YTP_MMLIST_PAGE_SIZE_MIN and
+ * YTP_MMLIST_PAGE_SIZE_MAX, or zero to use the page size of the file
+ * (YTP_MMLIST_PAGE_SIZE for new files)
+ * @param[out] error out-parameter for error handling
+ */
+FMMODFUNC void ytp_yamal_init_4(ytp_yamal_t *yamal, int fd, bool enable_thread,
+                                YTP_CLOSABLE_MODE closable, size_t page_size,
+                                fmc_error_t **error);
+
+/**
+ * @brief Allocates and initializes a ytp_yamal_t object with a given page size
+ *
+ * @param[in] fd a yamal file descriptor
+ * @param[in] enable_thread enable the preallocation and sync thread
+ * @param[in] closable closable mode
+ * @param[in] page_size a power of two between YTP_MMLIST_PAGE_SIZE_MIN and
+ * YTP_MMLIST_PAGE_SIZE_MAX, or zero to use the page size of the file
+ * (YTP_MMLIST_PAGE_SIZE for new files)
+ * @param[out] error out-parameter for error handling
+ * @return ytp_yamal_t object
+ */
+FMMODFUNC ytp_yamal_t *ytp_yamal_new_4(int fd, bool enable_thread,
+                                       YTP_CLOSABLE_MODE closable,
+                                       size_t page_size, fmc_error_t **error);
+
+/**
+ * @brief Returns the page size of a ytp_yamal_t object
+ *
+ * @param[in] yamal
+ * @return the page size in bytes
+ */
+FMMODFUNC size_t ytp_yamal_page_size(ytp_yamal_t *yamal);
+
+/**
+ * @brief Configures how the auxiliary thread synchronizes the file
+ *
+ * Each time the interval elapses, the auxiliary thread flushes the pages
+ * written since the previous synchronization. YTP_SYNC_ASYNC schedules the
+ * write of the pages, YTP_SYNC_DURABLE waits for it to complete and
+ * YTP_SYNC_NONE leaves it to the system. The default is YTP_SYNC_ASYNC every
+ * YTP_YAMAL_SYNC_INTERVAL_DEFAULT nanoseconds.
+ *
+ * @param[in] yamal
+ * @param[in] mode synchronization mode
+ * @param[in] interval_ns minimum time between synchronizations in nanoseconds
+ * @param[out] error out-parameter for error handling
+ */
+FMMODFUNC void ytp_yamal_set_sync(ytp_yamal_t *yamal, YTP_SYNC_MODE mode,
+                                  int64_t interval_ns, fmc_error_t **error);
+
+/**
+ * @brief Returns the size of the yamal that has been synchronized by the
+ * auxiliary thread
+ *
+ * @param[in] yamal
+ * @return the synchronized size in bytes
+ */
+FMMODFUNC size_t ytp_yamal_synced_size(ytp_yamal_t *yamal);
+
+/**
+ * @brief Configures how far ahead the auxiliary thread allocates pages
+ *
+ * The auxiliary thread keeps an estimate of the rate at which the yamal
+ * grows, which follows bursts immediately and decays exponentially after
+ * them, and allocates the pages for the data expected during the horizon.
+ * At least YTP_MMLIST_PREALLOC_SIZE and at most max_size bytes are allocated
+ * ahead. The defaults are YTP_MMLIST_PREALLOC_HORIZON_DEFAULT and
+ * YTP_MMLIST_PREALLOC_MAX_DEFAULT.
+ *
+ * @param[in] yamal
+ * @param[in] horizon_ns time of writes to allocate ahead in nanoseconds
+ * @param[in] max_size maximum size to allocate ahead in bytes
+ * @param[out] error out-parameter for error handling
+ */
+FMMODFUNC void ytp_yamal_set_prealloc(ytp_yamal_t *yamal, int64_t horizon_ns,
+                                      size_t max_size, fmc_error_t **error);
+
+/**
+ * @brief Returns the number of pages that had to be allocated while reserving
+ *
+ * Pages allocated ahead by the auxiliary thread are not counted.
+ *
+ * @param[in] yamal
+ * @return the number of pages allocated by ytp_yamal_reserve and
+ * ytp_yamal_reserve_batch
+ */
+FMMODFUNC size_t ytp_yamal_sync_allocations(ytp_yamal_t *yamal);
+
+/**
+ * @brief Enables or disables the collection of latency statistics
+ *
+ * While enabled, ytp_yamal_reserve, ytp_yamal_reserve_batch and
+ * ytp_yamal_commit are timed, and so is every synchronization of the file
+ * done by the auxiliary thread.
+ *
+ * @param[in] yamal
+ * @param[in] enable
+ */
+FMMODFUNC void ytp_yamal_stats_set(ytp_yamal_t *yamal, bool enable);
+
+/**
+ * @brief Takes the latency statistics collected since the previous call
+ *
+ * @param[in] yamal
+ * @param[out] reserve statistics of the reservations
+ * @param[out] commit statistics of the commits
+ * @param[out] sync statistics of the synchronizations of the file
+ */
+FMMODFUNC void ytp_yamal_stats_take(ytp_yamal_t *yamal,
+                                    struct ytp_yamal_stat *reserve,
+                                    struct ytp_yamal_stat *commit,
+                                    struct ytp_yamal_stat *sync);
+
 /**
  * @brief Returns the file descriptor from a ytp_yamal_t object
  *
@@ -165,6 +355,22 @@ FMMODFUNC fmc_fd ytp_yamal_fd(ytp_yamal_t *yamal);
 FMMODFUNC char *ytp_yamal_reserve(ytp_yamal_t *yamal, size_t sz,
                                   fmc_error_t **error);
 
+/**
+ * @brief Reserves memory for a batch of data nodes in the memory mapped list
+ *
+ * The space for all of the nodes is claimed with a single atomic operation.
+ * The batch must fit in a single page.
+ *
+ * @param[in] yamal
+ * @param[in] sizes the sizes of the data payloads
+ * @param[out] data the writable pointers for data, one per size
+ * @param[in] count the number of nodes to reserve, up to YTP_YAMAL_BATCH_MAX
+ * @param[out] error out-parameter for error handling
+ */
+FMMODFUNC void ytp_yamal_reserve_batch(ytp_yamal_t *yamal, const size_t *sizes,
+                                       char **data, size_t count,
+                                       fmc_error_t **error);
+
 /**
  * @brief Commits the data to the memory mapped list
  *
@@ -178,6 +384,23 @@ FMMODFUNC char *ytp_yamal_reserve(ytp_yamal_t *yamal, size_t sz,
 FMMODFUNC ytp_iterator_t ytp_yamal_commit(ytp_yamal_t *yamal, void *data,
                                           size_t lstidx, fmc_error_t **error);
 
+/**
+ * @brief Commits a batch of data nodes to the memory mapped list
+ *
+ * The nodes are linked in order and published with a single atomic operation.
+ *
+ * @param[in] yamal
+ * @param[in] data the values returned by ytp_yamal_reserve_batch
+ * @param[in] count the number of nodes to commit, up to YTP_YAMAL_BATCH_MAX
+ * @param[in] lstidx the list index to commit to
+ * @param[out] error out-parameter for error handling
+ * @return ytp_iterator_t for the first message
+ */
+FMMODFUNC ytp_iterator_t ytp_yamal_commit_batch(ytp_yamal_t *yamal,
+                                                char *const *data,
+                                                size_t count, size_t lstidx,
+                                                fmc_error_t **error);
+
 /**
  * @brief Commits a new data node to an existing sublist (first_ptr, last_ptr)
  * that is not in the main memory mapped list
@@ -210,6 +433,41 @@ FMMODFUNC void ytp_yamal_read(ytp_yamal_t *yamal, ytp_iterator_t iterator,
                               uint64_t *seqno, size_t *sz, const char **data,
                               fmc_error_t **error);
 
+/**
+ * @brief Waits until there is a message after the iterator
+ *
+ * The thread spins for a while and then parks until a writer commits a
+ * message. Writers only wake up readers if there is a reader parked. The
+ * count of parked readers is kept in the file; if a reader dies while parked,
+ * the next writer that finds no reader to wake up clears the count.
+ * Readers with a readonly file descriptor cannot register in the file, so
+ * they poll once per park interval instead.
+ *
+ * @param[in] yamal
+ * @param[in] iterator
+ * @param[in] timeout_ns maximum time to wait in nanoseconds, negative to wait
+ * indefinitely
+ * @param[out] error out-parameter for error handling
+ * @return true if there is a message after the iterator, false on timeout
+ */
+FMMODFUNC bool ytp_yamal_wait(ytp_yamal_t *yamal, ytp_iterator_t iterator,
+                              int64_t timeout_ns, fmc_error_t **error);
+
+/**
+ * @brief Configures how ytp_yamal_wait waits
+ *
+ * The defaults are YTP_YAMAL_WAIT_SPIN_DEFAULT and
+ * YTP_YAMAL_WAIT_PARK_DEFAULT.
+ *
+ * @param[in] yamal
+ * @param[in] spin_ns time to spin before parking in nanoseconds
+ * @param[in] park_ns maximum time to park before checking again in
+ * nanoseconds
+ * @param[out] error out-parameter for error handling
+ */
+FMMODFUNC void ytp_yamal_set_wait(ytp_yamal_t *yamal, int64_t spin_ns,
+                                  int64_t park_ns, fmc_error_t **error);
+
 /**
  * @brief Destroys a ytp_yamal_t object
  *
@@ -256,6 +514,18 @@ FMMODFUNC ytp_iterator_t ytp_yamal_end(ytp_yamal_t *yamal, size_t lstidx,
  */
 FMMODFUNC bool ytp_yamal_term(ytp_iterator_t iterator);
 
+/**
+ * @brief Hints the processor to load the message referenced by the iterator
+ *
+ * Does nothing if there are no more messages or if the message is in a page
+ * that is not mapped yet.
+ *
+ * @param[in] yamal
+ * @param[in] iterator
+ */
+FMMODFUNC void ytp_yamal_prefetch(ytp_yamal_t *yamal,
+                                  ytp_iterator_t iterator);
+
 /**
  * @brief Returns the next iterator
  *
@@ -19,6 +19,10 @@
     goto cleanup;                                                              \
   } while (0)
 
+#include "reactor_io.h"
+#include "reactor_profile.h"
+#include "reactor_threads.h"
+
 #include <fmc/component.h>
 #include <fmc/error.h>
 #include <fmc/extension.h>
@@ -26,6 +30,7 @@
 #include <fmc/platform.h>
 #include <fmc/reactor.h>
 #include <fmc/string.h>
+#include <fmc/timer_wheel.h>
 #include <stdarg.h>
 #include <stdlib.h> // calloc() getenv()
 #include <string.h> // memcpy() strtok()
@@ -74,18 +79,29 @@ static void incompatible(struct fmc_component_module *mod, void *unused) {
 
 static void reactor_queue_v1(struct fmc_reactor_ctx *ctx) {
   fmc_error_t *error = &ctx->reactor->err;
+  fmc_reactor_lock(ctx->reactor);
+  FMC_REACTOR_PROFILE_QUEUED(ctx->reactor, ctx->idx);
   utheap_push(&ctx->reactor->toqueue, &ctx->idx, FMC_SIZE_T_PTR_LESS);
 cleanup:
-  return;
+  fmc_reactor_unlock(ctx->reactor);
 }
 
 static void reactor_schedule_v1(struct fmc_reactor_ctx *ctx,
                                 fmc_time64_t time) {
   fmc_error_t *error = &ctx->reactor->err;
   struct sched_item item = {.idx = ctx->idx, .t = time};
+  fmc_reactor_lock(ctx->reactor);
+  FMC_REACTOR_PROFILE_SCHEDULED(ctx->reactor, ctx->idx, time);
+  if (ctx->reactor->wheel) {
+    fmc_error_t *err;
+    fmc_timer_wheel_add(ctx->reactor->wheel, time, ctx->idx, &err);
+    if (err)
+      fmc_error_cpy(error, err);
+    goto cleanup;
+  }
   utheap_push(&ctx->reactor->sched, &item, FMC_INT64_T_PTR_LESS);
 cleanup:
-  return;
+  fmc_reactor_unlock(ctx->reactor);
 }
 
 static void reactor_on_exec_v1(struct fmc_reactor_ctx *ctx,
@@ -114,7 +130,7 @@ void reactor_set_error_v1(struct fmc_reactor_ctx *ctx, const char *fmt, ...) {
 
 void reactor_on_shutdown_v1(struct fmc_reactor_ctx *ctx,
                             fmc_reactor_shutdown_clbck cl) {
-
+  fmc_reactor_lock(ctx->reactor);
   if (!ctx->shutdown && cl) {
     struct fmc_reactor_stop_item *item = calloc(1, sizeof(*item));
     if (!item) {
@@ -131,12 +147,14 @@ void reactor_on_shutdown_v1(struct fmc_reactor_ctx *ctx,
   }
   ctx->shutdown = cl;
 cleanup:
-  return;
+  fmc_reactor_unlock(ctx->reactor);
 }
 
 void reactor_finished_v1(struct fmc_reactor_ctx *ctx) {
+  fmc_reactor_lock(ctx->reactor);
   ctx->reactor->finishing -= ctx->finishing;
   ctx->finishing = false;
+  fmc_reactor_unlock(ctx->reactor);
 }
 
 void reactor_on_dep_v1(struct fmc_reactor_ctx *ctx, fmc_reactor_dep_clbck cl) {
@@ -190,10 +208,15 @@ void reactor_notify_v1(struct fmc_reactor_ctx *ctx, size_t idx,
     struct fmc_reactor_ctx_dep *dep = utarray_eltptr(deps, i);
     struct fmc_reactor_ctx *dep_ctx = ctx->reactor->ctxs[dep->idx];
     if (dep_ctx->dep_upd) {
+      fmc_reactor_dep_lock(ctx->reactor, dep->idx);
       dep_ctx->dep_upd(dep_ctx->comp, dep->inp_idx, mem);
+      fmc_reactor_dep_unlock(ctx->reactor, dep->idx);
     }
-    utheap_push(&ctx->reactor->queued, &dep->idx, FMC_SIZE_T_PTR_LESS);
+    FMC_REACTOR_PROFILE_QUEUED(ctx->reactor, dep->idx);
+    if (!fmc_reactor_dep_queue(ctx->reactor, dep->idx))
+      utheap_push(&ctx->reactor->queued, &dep->idx, FMC_SIZE_T_PTR_LESS);
   }
+  FMC_REACTOR_PROFILE_NOTIFY(ctx->reactor, ctx->idx, ndeps);
 cleanup:
   return;
 }
@@ -472,6 +495,9 @@ cleanup : {
                  utarray_eltidx(&ctx->reactor->sched, val),
                  FMC_INT64_T_PTR_LESS);
   } while (true);
+  if (ctx->reactor->wheel)
+    fmc_timer_wheel_cancel_data(ctx->reactor->wheel, size_t_curridx);
+  fmc_reactor_io_ctx_del(ctx->reactor, size_t_curridx);
 }
   if (fmc_error_has(error))
     fmc_error_set(usr_error, fmc_error_msg(error));
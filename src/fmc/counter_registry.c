@@ -0,0 +1,193 @@
+/******************************************************************************
+        COPYRIGHT (c) 2019-2023 by Featuremine Corporation.
+
+        This Source Code Form is subject to the terms of the Mozilla Public
+        License, v. 2.0. If a copy of the MPL was not distributed with this
+        file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *****************************************************************************/
+
+/**
+ * @file counter_registry.c
+ * @date 18 Oct 2026
+ * @brief File contains C implementation of the shared memory counter registry
+ * @see http://www.featuremine.com
+ */
+
+#include <fmc/counter_registry.h>
+#include <fmc/files.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(FMC_SYS_UNIX)
+#include <unistd.h>
+#endif
+
+struct fmc_counter_registry {
+  fmc_fd fd;
+  fmc_fview_t view;
+  size_t size;
+  bool writable;
+  int lock; // serializes fmc_counter_registry_add
+};
+
+static struct fmc_counter_registry_hdr *
+fmc_counter_registry_hdr(fmc_counter_registry_t *registry) {
+  return (struct fmc_counter_registry_hdr *)fmc_fview_data(&registry->view);
+}
+
+static struct fmc_counter *
+fmc_counter_registry_slots(fmc_counter_registry_t *registry) {
+  return (struct fmc_counter *)(fmc_counter_registry_hdr(registry) + 1);
+}
+
+static fmc_counter_registry_t *fmc_counter_registry_map(const char *path,
+                                                        fmc_fmode mode,
+                                                        size_t size,
+                                                        fmc_error_t **error) {
+  fmc_counter_registry_t *registry =
+      (fmc_counter_registry_t *)calloc(1, sizeof(*registry));
+  if (!registry) {
+    fmc_error_set2(error, FMC_ERROR_MEMORY);
+    return NULL;
+  }
+  registry->writable = mode != READ;
+  registry->fd = fmc_fopen(path, mode, error);
+  if (*error)
+    goto cleanup;
+  if (registry->writable) {
+    // Clears the counters of a previous run
+    fmc_fresize(registry->fd, 0, error);
+    if (*error)
+      goto cleanup;
+    fmc_fresize(registry->fd, size, error);
+  } else {
+    size = fmc_fsize(registry->fd, error);
+    if (!*error && size < sizeof(struct fmc_counter_registry_hdr))
+      fmc_error_set(error, "file %s is not a counter registry", path);
+  }
+  if (*error)
+    goto cleanup;
+  registry->size = size;
+  fmc_fview_init(&registry->view, size, registry->fd, 0, error);
+  if (*error)
+    goto cleanup;
+  return registry;
+cleanup:
+  if (fmc_fvalid(registry->fd)) {
+    fmc_error_t *err;
+    fmc_fclose(registry->fd, &err);
+  }
+  free(registry);
+  return NULL;
+}
+
+fmc_counter_registry_t *fmc_counter_registry_new(const char *path,
+                                                 size_t capacity,
+                                                 fmc_error_t **error) {
+  fmc_error_clear(error);
+  size_t size = sizeof(struct fmc_counter_registry_hdr) +
+                capacity * sizeof(struct fmc_counter);
+  fmc_counter_registry_t *registry =
+      fmc_counter_registry_map(path, READWRITE, size, error);
+  if (!registry)
+    return NULL;
+  struct fmc_counter_registry_hdr *hdr = fmc_counter_registry_hdr(registry);
+  hdr->version = FMC_COUNTER_REGISTRY_VERSION;
+  hdr->capacity = (uint32_t)capacity;
+#if defined(FMC_SYS_WIN)
+  hdr->pid = GetCurrentProcessId();
+#else
+  hdr->pid = getpid();
+#endif
+  // Readers check the magic last
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  memcpy(hdr->magic, FMC_COUNTER_REGISTRY_MAGIC, sizeof(hdr->magic));
+  return registry;
+}
+
+fmc_counter_registry_t *fmc_counter_registry_open(const char *path,
+                                                  fmc_error_t **error) {
+  fmc_error_clear(error);
+  fmc_counter_registry_t *registry =
+      fmc_counter_registry_map(path, READ, 0, error);
+  if (!registry)
+    return NULL;
+  struct fmc_counter_registry_hdr *hdr = fmc_counter_registry_hdr(registry);
+  if (memcmp(hdr->magic, FMC_COUNTER_REGISTRY_MAGIC, sizeof(hdr->magic)) != 0 ||
+      hdr->version != FMC_COUNTER_REGISTRY_VERSION ||
+      registry->size < sizeof(*hdr) + hdr->capacity * sizeof(struct fmc_counter)) {
+    fmc_error_set(error, "file %s is not a counter registry", path);
+    fmc_error_t *err;
+    fmc_counter_registry_del(registry, &err);
+    return NULL;
+  }
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return registry;
+}
+
+void fmc_counter_registry_del(fmc_counter_registry_t *registry,
+                              fmc_error_t **error) {
+  fmc_error_clear(error);
+  fmc_fview_destroy(&registry->view, registry->size, error);
+  fmc_error_t *err;
+  fmc_fclose(registry->fd, *error ? &err : error);
+  free(registry);
+}
+
+struct fmc_counter *fmc_counter_registry_add(fmc_counter_registry_t *registry,
+                                             const char *name,
+                                             fmc_counter_kind kind,
+                                             fmc_error_t **error) {
+  fmc_error_clear(error);
+  if (!registry->writable) {
+    fmc_error_set(error, "counter registry is read only");
+    return NULL;
+  }
+  struct fmc_counter_registry_hdr *hdr = fmc_counter_registry_hdr(registry);
+  struct fmc_counter *slots = fmc_counter_registry_slots(registry);
+  struct fmc_counter *counter = NULL;
+  while (__atomic_exchange_n(&registry->lock, 1, __ATOMIC_ACQUIRE)) {
+  }
+  uint64_t count = hdr->count;
+  for (uint64_t i = 0; i < count; ++i) {
+    if (strncmp(slots[i].name, name, FMC_COUNTER_NAME_SIZE - 1) == 0) {
+      counter = &slots[i];
+      if (counter->kind != (uint32_t)kind) {
+        fmc_error_set(error, "counter %s was added with a different kind",
+                      counter->name);
+        counter = NULL;
+      }
+      goto done;
+    }
+  }
+  if (count == hdr->capacity) {
+    fmc_error_set(error, "counter registry is full");
+    goto done;
+  }
+  counter = &slots[count];
+  strncpy(counter->name, name, FMC_COUNTER_NAME_SIZE - 1);
+  counter->kind = kind;
+  counter->value = 0;
+  // Publishes the slot after it is initialized
+  __atomic_store_n(&hdr->count, count + 1, __ATOMIC_RELEASE);
+done:
+  __atomic_store_n(&registry->lock, 0, __ATOMIC_RELEASE);
+  return counter;
+}
+
+size_t fmc_counter_registry_count(fmc_counter_registry_t *registry) {
+  struct fmc_counter_registry_hdr *hdr = fmc_counter_registry_hdr(registry);
+  uint64_t count = __atomic_load_n(&hdr->count, __ATOMIC_ACQUIRE);
+  return count < hdr->capacity ? count : hdr->capacity;
+}
+
+const struct fmc_counter *
+fmc_counter_registry_get(fmc_counter_registry_t *registry, size_t idx) {
+  return &fmc_counter_registry_slots(registry)[idx];
+}
+
+int64_t fmc_counter_registry_pid(fmc_counter_registry_t *registry) {
+  return fmc_counter_registry_hdr(registry)->pid;
+}
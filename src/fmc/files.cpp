@@ -20,6 +20,8 @@
 #include <fmc/files.h>
 #include <fmc/platform.h>
 
+#include <algorithm>
+
 #if defined(FMC_SYS_MACH)
 #include <fcntl.h>
 #include <limits.h>
@@ -31,12 +33,15 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #elif defined(FMC_SYS_UNIX)
+#include <cerrno>
 #include <cstring>
 #include <fcntl.h>
 #include <linux/limits.h>
+#include <linux/magic.h>
 #include <stdlib.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/vfs.h>
 #include <unistd.h>
 #elif defined(FMC_SYS_WIN)
 #include <io.h>
@@ -486,6 +491,62 @@ done:
 #endif
 }
 
+void fmc_fcopy(fmc_fd dest, fmc_fd src, size_t offset, size_t sz,
+               fmc_error_t **error) {
+  fmc_error_clear(error);
+#if defined(FMC_SYS_UNIX)
+  off_t off = offset;
+  size_t rem = sz;
+#if defined(FMC_SYS_LINUX)
+  // copy_file_range shares the extents on file systems with reflink support,
+  // fall back to a buffered copy if the files cannot be copied in kernel
+  while (rem > 0) {
+    off_t src_off = off;
+    off_t dest_off = off;
+    ssize_t ret = copy_file_range(src, &src_off, dest, &dest_off, rem, 0);
+    if (ret < 0) {
+      if (errno == EXDEV || errno == ENOSYS || errno == EINVAL ||
+          errno == EOPNOTSUPP) {
+        break;
+      }
+      FMC_ERROR_REPORT(error, fmc_syserror_msg());
+      return;
+    }
+    if (ret == 0) {
+      FMC_ERROR_REPORT(error, "unexpected end of file");
+      return;
+    }
+    off += ret;
+    rem -= ret;
+  }
+#endif
+  char buf[1 << 16];
+  while (rem > 0) {
+    ssize_t ret = pread(src, buf, std::min(rem, sizeof(buf)), off);
+    if (ret < 0) {
+      FMC_ERROR_REPORT(error, fmc_syserror_msg());
+      return;
+    }
+    if (ret == 0) {
+      FMC_ERROR_REPORT(error, "unexpected end of file");
+      return;
+    }
+    for (ssize_t written = 0; written < ret;) {
+      ssize_t w = pwrite(dest, buf + written, ret - written, off + written);
+      if (w < 0) {
+        FMC_ERROR_REPORT(error, fmc_syserror_msg());
+        return;
+      }
+      written += w;
+    }
+    off += ret;
+    rem -= ret;
+  }
+#else
+#error "Not supported"
+#endif
+}
+
 void fmc_fview_init(fmc_fview_t *view, size_t length, fmc_fd fd, int64_t offset,
                     fmc_error_t **error) {
   fmc_error_clear(error);
@@ -561,6 +622,53 @@ void fmc_fview_destroy(fmc_fview_t *view, size_t length, fmc_error_t **error) {
 
 void *fmc_fview_data(fmc_fview_t *view) { return view->mem; }
 
+size_t fmc_fview_granularity(fmc_fd fd, fmc_error_t **error) {
+  fmc_error_clear(error);
+#if defined(FMC_SYS_WIN)
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return info.dwAllocationGranularity;
+#else
+#if defined(FMC_SYS_LINUX)
+  // Files in hugetlbfs can only be mapped in multiples of the huge page size
+  struct statfs fs;
+  if (fstatfs(fd, &fs) != 0) {
+    FMC_ERROR_REPORT(error, fmc_syserror_msg());
+    return 0;
+  }
+  if (fs.f_type == HUGETLBFS_MAGIC) {
+    return fs.f_bsize;
+  }
+#endif
+  return sysconf(_SC_PAGESIZE);
+#endif
+}
+
+bool fmc_fhugepages(fmc_fd fd, fmc_error_t **error) {
+  fmc_error_clear(error);
+#if defined(FMC_SYS_LINUX)
+  struct statfs fs;
+  if (fstatfs(fd, &fs) != 0) {
+    FMC_ERROR_REPORT(error, fmc_syserror_msg());
+    return false;
+  }
+  return fs.f_type == TMPFS_MAGIC || fs.f_type == HUGETLBFS_MAGIC;
+#else
+  return false;
+#endif
+}
+
+void fmc_fview_advise_hugepages(fmc_fview_t *view, size_t length,
+                                fmc_error_t **error) {
+  fmc_error_clear(error);
+#if defined(FMC_SYS_LINUX) && defined(MADV_HUGEPAGE)
+  // EINVAL means that the kernel was built without transparent huge pages
+  if (madvise(view->mem, length, MADV_HUGEPAGE) != 0 && errno != EINVAL) {
+    FMC_ERROR_REPORT(error, fmc_syserror_msg());
+  }
+#endif
+}
+
 void fmc_fview_remap(fmc_fview_t *view, fmc_fd fd, size_t old_size,
                      size_t new_size, size_t offset, fmc_error_t **error) {
   fmc_error_clear(error);
@@ -618,6 +726,25 @@ void fmc_fview_sync(fmc_fview_t *view, size_t size, fmc_error_t **error) {
 #endif
 }
 
+void fmc_fview_sync_2(fmc_fview_t *view, size_t offset, size_t size,
+                      bool wait, fmc_error_t **error) {
+  fmc_error_clear(error);
+#if defined(FMC_SYS_WIN)
+  if (!FlushViewOfFile((char *)view->mem + offset, size)) {
+    FMC_ERROR_REPORT(error, "FlushViewOfFile failed on page");
+  }
+  if (wait && !FlushFileBuffers(view->md)) {
+    FMC_ERROR_REPORT(error, "FlushFileBuffers failed on page");
+  }
+#else
+  size_t page_offset = offset - offset % sysconf(_SC_PAGESIZE);
+  if (msync((char *)view->mem + page_offset, size + offset - page_offset,
+            wait ? MS_SYNC : MS_ASYNC) != 0) {
+    FMC_ERROR_REPORT(error, "msync failed on page");
+  }
+#endif
+}
+
 void fmc_fflush() {
   fflush(NULL);
 #ifdef FMC_SYS_UNIX
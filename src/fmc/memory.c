@@ -17,23 +17,262 @@
 #include <fmc/error.h>
 #include <fmc/math.h>
 #include <fmc/memory.h>
+#include <fmc/platform.h>
 
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(FMC_SYS_UNIX)
+#include <sys/mman.h>
+#endif
+
 #include <uthash/utlist.h>
 
+// Buffers and nodes are carved from arenas in size classes. Classes are
+// spaced by 16 bytes up to 128 bytes and then four per power of two up to
+// 64KB. Larger buffers are allocated with malloc.
+#define FMC_SLAB_SMALL 8
+#define FMC_SLAB_CLASSES 44
+#define FMC_SLAB_MAX 65536
+#define FMC_SLAB_ARENA (2u << 20)
+// Blocks moved at once between a thread cache and the central free lists
+#define FMC_SLAB_BATCH 32
+
+// Header stored in front of every block
+struct fmc_slab_block {
+  size_t cap;
+  size_t cls; // FMC_SLAB_CLASSES for blocks allocated with malloc
+};
+
+// Free blocks are linked through their buffer
+#define FMC_SLAB_NEXT(b) (*(struct fmc_slab_block **)((b) + 1))
+
+struct fmc_slab_cache {
+  struct fmc_slab_block *free[FMC_SLAB_CLASSES];
+  size_t count[FMC_SLAB_CLASSES];
+  bool registered;
+};
+
+static struct {
+  int lock;
+  bool huge_pages;
+  struct fmc_slab_block *free[FMC_SLAB_CLASSES];
+  char *arena; // unused part of the current arena
+  size_t left;
+} fmc_slab;
+
+static __thread struct fmc_slab_cache fmc_slab_cache;
+static pthread_key_t fmc_slab_key;
+static pthread_once_t fmc_slab_once = PTHREAD_ONCE_INIT;
+
+static size_t fmc_slab_class(size_t sz) {
+  if (sz <= 16 * FMC_SLAB_SMALL)
+    return sz ? (sz - 1) / 16 : 0;
+  unsigned b = 63 - __builtin_clzll(sz - 1);
+  size_t step = (size_t)1 << (b - 2);
+  size_t idx = (sz - ((size_t)1 << b) + step - 1) / step;
+  return FMC_SLAB_SMALL + (b - 7) * 4 + idx - 1;
+}
+
+static size_t fmc_slab_class_size(size_t cls) {
+  if (cls < FMC_SLAB_SMALL)
+    return 16 * (cls + 1);
+  size_t k = cls - FMC_SLAB_SMALL;
+  unsigned b = 7 + k / 4;
+  return ((size_t)1 << b) + (k % 4 + 1) * ((size_t)1 << (b - 2));
+}
+
+static void fmc_slab_central_lock() {
+  while (__atomic_exchange_n(&fmc_slab.lock, 1, __ATOMIC_ACQUIRE)) {
+  }
+}
+
+static void fmc_slab_central_unlock() {
+  __atomic_store_n(&fmc_slab.lock, 0, __ATOMIC_RELEASE);
+}
+
+static char *fmc_slab_arena_new() {
+#if defined(FMC_SYS_UNIX)
+  void *mem = MAP_FAILED;
+#if defined(FMC_SYS_LINUX)
+  if (fmc_slab.huge_pages) {
+    mem = mmap(NULL, FMC_SLAB_ARENA, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  }
+#endif
+  if (mem == MAP_FAILED) {
+    mem = mmap(NULL, FMC_SLAB_ARENA, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED)
+      return NULL;
+#if defined(FMC_SYS_LINUX)
+    // Transparent huge pages if huge pages are not reserved
+    if (fmc_slab.huge_pages)
+      madvise(mem, FMC_SLAB_ARENA, MADV_HUGEPAGE);
+#endif
+  }
+  return (char *)mem;
+#else
+  return (char *)malloc(FMC_SLAB_ARENA);
+#endif
+}
+
+// Moves blocks of the class from the central free lists to the thread cache,
+// carving new blocks from the arena when there are not enough
+static bool fmc_slab_refill(struct fmc_slab_cache *cache, size_t cls) {
+  size_t sz = sizeof(struct fmc_slab_block) + fmc_slab_class_size(cls);
+  fmc_slab_central_lock();
+  size_t n = 0;
+  for (; n < FMC_SLAB_BATCH && fmc_slab.free[cls]; ++n) {
+    struct fmc_slab_block *b = fmc_slab.free[cls];
+    fmc_slab.free[cls] = FMC_SLAB_NEXT(b);
+    FMC_SLAB_NEXT(b) = cache->free[cls];
+    cache->free[cls] = b;
+  }
+  for (; n < FMC_SLAB_BATCH; ++n) {
+    if (fmc_slab.left < sz) {
+      char *arena = fmc_slab_arena_new();
+      if (!arena)
+        break;
+      fmc_slab.arena = arena;
+      fmc_slab.left = FMC_SLAB_ARENA;
+    }
+    struct fmc_slab_block *b = (struct fmc_slab_block *)fmc_slab.arena;
+    fmc_slab.arena += sz;
+    fmc_slab.left -= sz;
+    b->cap = fmc_slab_class_size(cls);
+    b->cls = cls;
+    FMC_SLAB_NEXT(b) = cache->free[cls];
+    cache->free[cls] = b;
+  }
+  fmc_slab_central_unlock();
+  cache->count[cls] += n;
+  return n;
+}
+
+// Returns up to max blocks of the class from the thread cache to the central
+// free lists
+static void fmc_slab_flush(struct fmc_slab_cache *cache, size_t cls,
+                           size_t max) {
+  fmc_slab_central_lock();
+  for (size_t n = 0; n < max && cache->free[cls]; ++n) {
+    struct fmc_slab_block *b = cache->free[cls];
+    cache->free[cls] = FMC_SLAB_NEXT(b);
+    FMC_SLAB_NEXT(b) = fmc_slab.free[cls];
+    fmc_slab.free[cls] = b;
+    --cache->count[cls];
+  }
+  fmc_slab_central_unlock();
+}
+
+static void fmc_slab_thread_exit(void *ptr) {
+  struct fmc_slab_cache *cache = (struct fmc_slab_cache *)ptr;
+  for (size_t cls = 0; cls < FMC_SLAB_CLASSES; ++cls)
+    fmc_slab_flush(cache, cls, cache->count[cls]);
+}
+
+static void fmc_slab_key_create() {
+  pthread_key_create(&fmc_slab_key, fmc_slab_thread_exit);
+}
+
+// The cache of a thread is returned to the central free lists when the
+// thread exits
+static struct fmc_slab_cache *fmc_slab_cache_get() {
+  struct fmc_slab_cache *cache = &fmc_slab_cache;
+  if (!cache->registered) {
+    pthread_once(&fmc_slab_once, fmc_slab_key_create);
+    pthread_setspecific(fmc_slab_key, cache);
+    cache->registered = true;
+  }
+  return cache;
+}
+
+static void *fmc_slab_alloc(size_t sz) {
+  if (sz > FMC_SLAB_MAX) {
+    struct fmc_slab_block *b =
+        (struct fmc_slab_block *)malloc(sizeof(*b) + sz);
+    if (!b)
+      return NULL;
+    b->cap = sz;
+    b->cls = FMC_SLAB_CLASSES;
+    return b + 1;
+  }
+  size_t cls = fmc_slab_class(sz);
+  struct fmc_slab_cache *cache = fmc_slab_cache_get();
+  if (!cache->free[cls] && !fmc_slab_refill(cache, cls))
+    return NULL;
+  struct fmc_slab_block *b = cache->free[cls];
+  cache->free[cls] = FMC_SLAB_NEXT(b);
+  --cache->count[cls];
+  return b + 1;
+}
+
+static void fmc_slab_free(void *buf) {
+  if (!buf)
+    return;
+  struct fmc_slab_block *b = (struct fmc_slab_block *)buf - 1;
+  if (b->cls == FMC_SLAB_CLASSES) {
+    free(b);
+    return;
+  }
+  struct fmc_slab_cache *cache = fmc_slab_cache_get();
+  FMC_SLAB_NEXT(b) = cache->free[b->cls];
+  cache->free[b->cls] = b;
+  if (++cache->count[b->cls] >= 2 * FMC_SLAB_BATCH)
+    fmc_slab_flush(cache, b->cls, FMC_SLAB_BATCH);
+}
+
+static size_t fmc_slab_cap(void *buf) {
+  return buf ? ((struct fmc_slab_block *)buf - 1)->cap : 0;
+}
+
+// Makes sure the buffer can hold sz bytes, keeping the first keep bytes.
+// Returns NULL and leaves the buffer untouched on failure.
+static void *fmc_slab_resize(void *buf, size_t keep, size_t sz) {
+  if (buf && fmc_slab_cap(buf) >= sz)
+    return buf;
+  void *tmp = fmc_slab_alloc(sz);
+  if (!tmp)
+    return NULL;
+  if (buf) {
+    memcpy(tmp, buf, FMC_MIN(keep, sz));
+    fmc_slab_free(buf);
+  }
+  return tmp;
+}
+
+void fmc_pool_huge_pages_set(bool enable) {
+  fmc_slab_central_lock();
+  fmc_slab.huge_pages = enable;
+  fmc_slab_central_unlock();
+}
+
+static void fmc_pool_lock(struct fmc_pool *p) {
+  if (p->concurrent) {
+    while (__atomic_exchange_n(&p->lock, 1, __ATOMIC_ACQUIRE)) {
+    }
+  }
+}
+
+static void fmc_pool_unlock(struct fmc_pool *p) {
+  if (p->concurrent) {
+    __atomic_store_n(&p->lock, 0, __ATOMIC_RELEASE);
+  }
+}
+
 struct fmc_pool_node *fmc_get_pool_node(struct fmc_pool *p) {
   struct fmc_pool_node *tmp = NULL;
   if (p->free) {
     tmp = p->free;
     DL_DELETE(p->free, tmp);
   } else {
-    tmp = calloc(1, sizeof(*tmp));
+    tmp = (struct fmc_pool_node *)fmc_slab_alloc(sizeof(*tmp));
     if (!tmp) {
       return NULL;
     }
+    memset(tmp, 0, sizeof(*tmp));
     tmp->pool = p;
   }
   tmp->count = 1;
@@ -44,7 +283,9 @@ struct fmc_pool_node *fmc_get_pool_node(struct fmc_pool *p) {
 void **fmc_pool_allocate(struct fmc_pool *p, size_t sz, fmc_error_t **e) {
   fmc_error_clear(e);
 
+  fmc_pool_lock(p);
   struct fmc_pool_node *tmp = fmc_get_pool_node(p);
+  fmc_pool_unlock(p);
   if (!tmp) {
     goto cleanup;
   }
@@ -54,7 +295,8 @@ void **fmc_pool_allocate(struct fmc_pool *p, size_t sz, fmc_error_t **e) {
     tmp->scratch = NULL;
   }
 
-  void *temp_mem = realloc(tmp->buf, sz);
+  // Buffers of recycled nodes are reused if they are large enough
+  void *temp_mem = fmc_slab_resize(tmp->buf, 0, sz);
   if (!temp_mem) {
     goto cleanup;
   }
@@ -65,8 +307,10 @@ void **fmc_pool_allocate(struct fmc_pool *p, size_t sz, fmc_error_t **e) {
 cleanup:
   fmc_error_set2(e, FMC_ERROR_MEMORY);
   if (tmp) {
+    fmc_pool_lock(p);
     DL_DELETE(p->used, tmp);
     DL_PREPEND(p->free, tmp);
+    fmc_pool_unlock(p);
   }
   return NULL;
 }
@@ -74,7 +318,9 @@ cleanup:
 void **fmc_pool_view(struct fmc_pool *p, void *view, size_t sz,
                      fmc_error_t **e) {
   fmc_error_clear(e);
+  fmc_pool_lock(p);
   struct fmc_pool_node *tmp = fmc_get_pool_node(p);
+  fmc_pool_unlock(p);
   if (!tmp) {
     goto cleanup;
   }
@@ -89,8 +335,10 @@ void **fmc_pool_view(struct fmc_pool *p, void *view, size_t sz,
 cleanup:
   fmc_error_set2(e, FMC_ERROR_MEMORY);
   if (tmp) {
+    fmc_pool_lock(p);
     DL_DELETE(p->used, tmp);
     DL_PREPEND(p->free, tmp);
+    fmc_pool_unlock(p);
   }
   return NULL;
 }
@@ -98,18 +346,18 @@ cleanup:
 void fmc_pool_init(struct fmc_pool *p) {
   p->free = NULL;
   p->used = NULL;
+  p->concurrent = false;
+  p->lock = 0;
 }
 
 void fmc_pool_node_list_destroy(struct fmc_pool_node *node) {
   while (node) {
-    if (!node->owner && node->buf) {
-      free(node->buf);
-    }
-    if (node->scratch) {
-      free(node->scratch);
+    if (!node->owner) {
+      fmc_slab_free(node->buf);
     }
+    fmc_slab_free(node->scratch);
     struct fmc_pool_node *next = node->next;
-    free(node);
+    fmc_slab_free(node);
     node = next;
   }
 }
@@ -135,7 +383,9 @@ void fmc_shmem_init_view(struct fmc_shmem *mem, struct fmc_pool *pool, void *v,
 
 void fmc_shmem_init_share(struct fmc_shmem *dest, struct fmc_shmem *src) {
   struct fmc_pool_node *p = (struct fmc_pool_node *)src->view;
+  fmc_pool_lock(p->pool);
   ++p->count;
+  fmc_pool_unlock(p->pool);
   dest->view = src->view;
 }
 
@@ -152,11 +402,14 @@ void fmc_shmem_init_clone(struct fmc_shmem *dest, struct fmc_shmem *src,
 void fmc_shmem_destroy(struct fmc_shmem *mem, fmc_error_t **e) {
   fmc_error_clear(e);
   struct fmc_pool_node *p = (struct fmc_pool_node *)mem->view;
+  struct fmc_pool *pool = p->pool;
+  fmc_pool_lock(pool);
   if (--p->count) {
     if (p->owner == mem) {
-      void *tmp = realloc(p->scratch, p->sz);
+      void *tmp = fmc_slab_resize(p->scratch, 0, p->sz);
       if (!tmp) {
         ++p->count;
+        fmc_pool_unlock(pool);
         fmc_error_set2(e, FMC_ERROR_MEMORY);
         return;
       }
@@ -166,19 +419,21 @@ void fmc_shmem_destroy(struct fmc_shmem *mem, fmc_error_t **e) {
       p->owner = NULL;
     }
   } else {
-    DL_DELETE(p->pool->used, p);
-    DL_PREPEND(p->pool->free, p);
+    DL_DELETE(pool->used, p);
+    DL_PREPEND(pool->free, p);
     if (p->owner) {
       p->buf = NULL;
     }
     p->owner = NULL;
   }
+  fmc_pool_unlock(pool);
 }
 
 void fmc_pool_node_realloc(struct fmc_pool_node *p, size_t sz,
                            fmc_error_t **e) {
   fmc_error_clear(e);
-  void *tmp = realloc(p->owner ? p->scratch : p->buf, sz);
+  void *tmp = p->owner ? fmc_slab_resize(p->scratch, 0, sz)
+                       : fmc_slab_resize(p->buf, p->sz, sz);
   if (!tmp)
     goto cleanup;
   if (p->owner)
@@ -19,11 +19,20 @@
     goto cleanup;                                                              \
   } while (0)
 
+#include "reactor_io.h"
+#include "reactor_profile.h"
+#include "reactor_threads.h"
+
 #include <fmc/component.h>
 #include <fmc/error.h>
 #include <fmc/math.h>
+#include <fmc/process.h>
 #include <fmc/reactor.h>
 #include <fmc/time.h>
+#include <fmc/timer_wheel.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
 #include <stdlib.h> // calloc() free()
 #include <uthash/utarray.h>
 #include <uthash/utheap.h>
@@ -31,6 +40,57 @@
 
 #define FMC_REACTOR_HARD_STOP 3
 
+// Components queued in a run of a multi-threaded reactor are kept in
+// per-worker deques. Owners pop from the bottom and idle workers steal from
+// the top. Every component is queued at most once per run, so the deques are
+// sized to the number of components.
+struct fmc_reactor_deque {
+  int lock;
+  size_t *items;
+  size_t head;
+  size_t tail;
+  size_t cap;
+};
+
+struct fmc_reactor_worker {
+  struct fmc_reactor *reactor;
+  pthread_t thread;
+  int cpu;
+  bool started;
+  fmc_error_t err;
+  uint64_t run;
+  struct fmc_reactor_deque tasks;
+  // Components pinned to the worker, never stolen
+  struct fmc_reactor_deque pinned;
+};
+
+// A component is active from the moment it is queued in a run until its
+// execution completes. Queued components wait until none of their ancestors
+// is active, since an active ancestor may still update them.
+struct fmc_reactor_threads {
+  size_t count;
+  struct fmc_reactor_worker *workers;
+  pthread_mutex_t m;
+  pthread_cond_t cv;
+  uint64_t run;
+  bool quit;
+  bool running;
+  fmc_time64_t now;
+  // Protects the run state below and the reactor state updated by components
+  int lock;
+  bool abort;
+  // Dependency graph of the first size components, rebuilt when it grows
+  size_t size;
+  size_t words;
+  uint64_t *ancestors;
+  uint64_t *active;
+  uint64_t *waiting;
+  size_t nactive;
+  size_t *failed;
+  size_t nfailed;
+  int *dep_locks;
+};
+
 fmc_icd sched_item_icd = {.sz = sizeof(struct sched_item)};
 
 fmc_icd size_t_icd = {.sz = sizeof(size_t)};
@@ -39,6 +99,9 @@ void fmc_reactor_init(struct fmc_reactor *reactor) {
   // important: initialize lists to NULL
   reactor->stop_list = NULL;
   memset(reactor, 0, sizeof(*reactor));
+  reactor->threads = NULL;
+  reactor->wheel = NULL;
+  reactor->io = NULL;
   fmc_array_init(&reactor->sched, &sched_item_icd);
   fmc_array_init(&reactor->queued, &size_t_icd);
   fmc_array_init(&reactor->toqueue, &size_t_icd);
@@ -46,7 +109,28 @@ void fmc_reactor_init(struct fmc_reactor *reactor) {
   fmc_error_init_none(&reactor->err);
 }
 
+void fmc_reactor_init_wheel(struct fmc_reactor *reactor, int64_t tick,
+                            fmc_error_t **error) {
+  fmc_error_clear(error);
+  fmc_reactor_init(reactor);
+  reactor->wheel = (struct fmc_timer_wheel *)malloc(sizeof(*reactor->wheel));
+  if (!reactor->wheel) {
+    fmc_error_set2(error, FMC_ERROR_MEMORY);
+    return;
+  }
+  fmc_timer_wheel_init(reactor->wheel, tick);
+}
+
+static void fmc_reactor_threads_del(struct fmc_reactor *reactor);
+
 void fmc_reactor_destroy(struct fmc_reactor *reactor) {
+  fmc_reactor_threads_del(reactor);
+  fmc_reactor_io_del(reactor);
+  fmc_reactor_profile_del(reactor);
+  if (reactor->wheel) {
+    fmc_timer_wheel_destroy(reactor->wheel);
+    free(reactor->wheel);
+  }
   utarray_done(&reactor->sched);
   utarray_done(&reactor->queued);
   utarray_done(&reactor->toqueue);
@@ -90,6 +174,7 @@ struct fmc_reactor_ctx *fmc_reactor_ctx_new(struct fmc_reactor *reactor,
     goto cleanup;
   ctx->reactor = reactor;
   ctx->idx = reactor->size;
+  ctx->worker = -1;
   fmc_icd deps;
   deps.sz = sizeof(UT_array);
   deps.dtor = utarr_del;
@@ -144,11 +229,73 @@ void fmc_reactor_ctx_del(struct fmc_reactor_ctx *ctx) {
 }
 
 fmc_time64_t fmc_reactor_sched(struct fmc_reactor *reactor) {
+  if (reactor->wheel)
+    return fmc_timer_wheel_next(reactor->wheel);
   struct sched_item *item =
       (struct sched_item *)utarray_front(&(reactor->sched));
   return item ? item->t : fmc_time64_end();
 }
 
+void fmc_reactor_exec_error(struct fmc_reactor_ctx *ctx,
+                            fmc_error_t **usr_error) {
+  if (*usr_error) {
+    fmc_error_set(usr_error,
+                  "%s\nalso, failed to run component %s with error: %s",
+                  fmc_error_msg(*usr_error), ctx->comp->_vt->tp_name,
+                  fmc_error_msg(&ctx->err));
+  } else {
+    fmc_error_set(usr_error, "failed to run component %s with error: %s",
+                  ctx->comp->_vt->tp_name, fmc_error_msg(&ctx->err));
+  }
+}
+
+// Executes a component, timing it while the reactor stats are on. A
+// component is never executed concurrently with itself, but the statistics
+// may be taken from any thread.
+static void fmc_reactor_ctx_exec(struct fmc_reactor_ctx *ctx,
+                                 fmc_time64_t now) {
+#if defined(FMC_REACTOR_PROFILE)
+  struct fmc_reactor_profile *profile = ctx->reactor->profile;
+  uint64_t profile_start = 0;
+  if (profile)
+    profile_start = fmc_reactor_profile_exec_start(profile, ctx->idx);
+#endif
+  if (!__atomic_load_n(&ctx->reactor->stats, __ATOMIC_RELAXED)) {
+    ctx->exec(ctx->comp, ctx, now);
+  } else {
+    int64_t start = fmc_cur_time_ns();
+    ctx->exec(ctx->comp, ctx, now);
+    int64_t elapsed = fmc_cur_time_ns() - start;
+    struct fmc_reactor_stat *stat = &ctx->exec_stat;
+    __atomic_fetch_add(&stat->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stat->total, elapsed, __ATOMIC_RELAXED);
+    int64_t max = __atomic_load_n(&stat->max, __ATOMIC_RELAXED);
+    while (elapsed > max &&
+           !__atomic_compare_exchange_n(&stat->max, &max, elapsed, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+      ;
+  }
+#if defined(FMC_REACTOR_PROFILE)
+  if (profile)
+    fmc_reactor_profile_exec_end(profile, ctx->idx, profile_start);
+#endif
+}
+
+void fmc_reactor_stats_set(struct fmc_reactor *reactor, bool enable) {
+  __atomic_store_n(&reactor->stats, enable, __ATOMIC_RELAXED);
+}
+
+void fmc_reactor_ctx_stat_take(struct fmc_reactor_ctx *ctx,
+                               struct fmc_reactor_stat *stat) {
+  struct fmc_reactor_stat *cur = &ctx->exec_stat;
+  stat->count = __atomic_exchange_n(&cur->count, 0, __ATOMIC_RELAXED);
+  stat->total = __atomic_exchange_n(&cur->total, 0, __ATOMIC_RELAXED);
+  stat->max = __atomic_exchange_n(&cur->max, 0, __ATOMIC_RELAXED);
+}
+
+static void fmc_reactor_threads_run(struct fmc_reactor *reactor,
+                                    fmc_time64_t now, fmc_error_t **usr_error);
+
 bool fmc_reactor_run_once(struct fmc_reactor *reactor, fmc_time64_t now,
                           fmc_error_t **usr_error) {
   fmc_error_t *error = &reactor->err;
@@ -173,22 +320,37 @@ bool fmc_reactor_run_once(struct fmc_reactor *reactor, fmc_time64_t now,
   }
 
   bool busy = utarray_len(&reactor->toqueue) ||
-              utarray_len(&(reactor->sched)) || utarray_len(&reactor->queued);
+              utarray_len(&(reactor->sched)) ||
+              (reactor->wheel && reactor->wheel->count) ||
+              utarray_len(&reactor->queued) || fmc_reactor_io_count(reactor);
   bool stopped = reactor->stop && !reactor->finishing;
   bool hardstop = reactor->stop >= FMC_REACTOR_HARD_STOP;
   if (!busy || stopped || hardstop)
     return false;
 
   ut_swap(&reactor->queued, &reactor->toqueue, sizeof(reactor->queued));
+  fmc_reactor_io_poll(reactor, usr_error);
   // NOTE: queue expried componenents
+  size_t expired;
+  while (reactor->wheel && fmc_timer_wheel_pop(reactor->wheel, now, &expired)) {
+    FMC_REACTOR_PROFILE_QUEUED(reactor, expired);
+    utheap_push(&reactor->queued, &expired, FMC_SIZE_T_PTR_LESS);
+  }
   do {
     struct sched_item *item =
         (struct sched_item *)utarray_front(&reactor->sched);
     if (!item || fmc_time64_greater(item->t, now))
       break;
+    FMC_REACTOR_PROFILE_QUEUED(reactor, item->idx);
     utheap_push(&reactor->queued, &item->idx, FMC_SIZE_T_PTR_LESS);
     utheap_pop(&reactor->sched, FMC_INT64_T_PTR_LESS);
   } while (true);
+  FMC_REACTOR_PROFILE_RUN(reactor, now);
+
+  if (reactor->threads) {
+    fmc_reactor_threads_run(reactor, now, usr_error);
+    goto cleanup;
+  }
 
   size_t last = SIZE_MAX;
   while (!fmc_error_has(&reactor->err)) {
@@ -199,17 +361,9 @@ bool fmc_reactor_run_once(struct fmc_reactor *reactor, fmc_time64_t now,
     utheap_pop(&reactor->queued, FMC_SIZE_T_PTR_LESS);
     struct fmc_reactor_ctx *ctx = reactor->ctxs[ctxidx];
     if (*item != last && !fmc_error_has(&ctx->err) && ctx->exec) {
-      ctx->exec(ctx->comp, ctx, now);
+      fmc_reactor_ctx_exec(ctx, now);
       if (fmc_error_has(&ctx->err)) {
-        if (*usr_error) {
-          fmc_error_set(usr_error,
-                        "%s\nalso, failed to run component %s with error: %s",
-                        fmc_error_msg(*usr_error), ctx->comp->_vt->tp_name,
-                        fmc_error_msg(&ctx->err));
-        } else {
-          fmc_error_set(usr_error, "failed to run component %s with error: %s",
-                        ctx->comp->_vt->tp_name, fmc_error_msg(&ctx->err));
-        }
+        fmc_reactor_exec_error(ctx, usr_error);
       }
     }
     last = ctxidx;
@@ -234,9 +388,405 @@ void fmc_reactor_run(struct fmc_reactor *reactor, bool live,
                             : fmc_reactor_sched(reactor);
     if (!fmc_reactor_run_once(reactor, now, error))
       break;
+    if (live)
+      fmc_reactor_io_wait(reactor, now);
   } while (true);
 }
 
 void fmc_reactor_stop(struct fmc_reactor *reactor) {
   __atomic_fetch_add(&reactor->stop_signal, 1, __ATOMIC_SEQ_CST);
+  fmc_reactor_io_wake(reactor);
+}
+
+// Test-and-set locks, zero when released. Critical sections are a few
+// instructions long, so waiters spin.
+static void fmc_reactor_spin_lock(int *lock) {
+  while (__atomic_exchange_n(lock, 1, __ATOMIC_ACQUIRE)) {
+  }
+}
+
+static void fmc_reactor_spin_unlock(int *lock) {
+  __atomic_store_n(lock, 0, __ATOMIC_RELEASE);
+}
+
+static void fmc_reactor_deque_push(struct fmc_reactor_deque *dq, size_t idx) {
+  fmc_reactor_spin_lock(&dq->lock);
+  dq->items[dq->tail++ % dq->cap] = idx;
+  fmc_reactor_spin_unlock(&dq->lock);
+}
+
+static bool fmc_reactor_deque_pop(struct fmc_reactor_deque *dq, size_t *idx) {
+  bool found = false;
+  fmc_reactor_spin_lock(&dq->lock);
+  if (dq->head != dq->tail) {
+    *idx = dq->items[--dq->tail % dq->cap];
+    found = true;
+  }
+  fmc_reactor_spin_unlock(&dq->lock);
+  return found;
+}
+
+static bool fmc_reactor_deque_steal(struct fmc_reactor_deque *dq,
+                                    size_t *idx) {
+  bool found = false;
+  if (__atomic_load_n(&dq->head, __ATOMIC_RELAXED) ==
+      __atomic_load_n(&dq->tail, __ATOMIC_RELAXED))
+    return false;
+  fmc_reactor_spin_lock(&dq->lock);
+  if (dq->head != dq->tail) {
+    *idx = dq->items[dq->head++ % dq->cap];
+    found = true;
+  }
+  fmc_reactor_spin_unlock(&dq->lock);
+  return found;
+}
+
+#define FMC_REACTOR_BIT(bits, idx) ((bits)[(idx) / 64] & (1ull << ((idx) % 64)))
+#define FMC_REACTOR_BIT_SET(bits, idx) ((bits)[(idx) / 64] |= 1ull << ((idx) % 64))
+#define FMC_REACTOR_BIT_CLR(bits, idx)                                         \
+  ((bits)[(idx) / 64] &= ~(1ull << ((idx) % 64)))
+
+// Rebuilds the dependency graph after components were added to the reactor
+static bool fmc_reactor_threads_graph(struct fmc_reactor *reactor) {
+  struct fmc_reactor_threads *t = reactor->threads;
+  size_t size = reactor->size;
+  if (t->size == size)
+    return true;
+
+  size_t words = (size + 63) / 64;
+  uint64_t *ancestors = calloc(size * words + 2 * words, sizeof(uint64_t));
+  size_t *failed = calloc(size, sizeof(size_t));
+  int *dep_locks = calloc(size, sizeof(int));
+  size_t *items = calloc(2 * t->count * size, sizeof(size_t));
+  if (size && (!ancestors || !failed || !dep_locks || !items)) {
+    free(ancestors);
+    free(failed);
+    free(dep_locks);
+    free(items);
+    fmc_error_reset(&reactor->err, FMC_ERROR_MEMORY, NULL);
+    return false;
+  }
+
+  // Components only depend on components created before them, so the
+  // ancestors of a component are complete once every lower index is visited
+  for (size_t i = 0; i < size; ++i) {
+    uint64_t *anc = ancestors + i * words;
+    UT_array *outs = (UT_array *)&reactor->ctxs[i]->deps;
+    for (UT_array *deps = (UT_array *)utarray_front(outs); deps;
+         deps = (UT_array *)utarray_next(outs, deps)) {
+      for (struct fmc_reactor_ctx_dep *dep =
+               (struct fmc_reactor_ctx_dep *)utarray_front(deps);
+           dep; dep = (struct fmc_reactor_ctx_dep *)utarray_next(deps, dep)) {
+        uint64_t *danc = ancestors + dep->idx * words;
+        for (size_t w = 0; w < words; ++w)
+          danc[w] |= anc[w];
+        FMC_REACTOR_BIT_SET(danc, i);
+      }
+    }
+  }
+  free(t->ancestors);
+  free(t->failed);
+  free(t->dep_locks);
+  free(t->workers[0].tasks.items);
+
+  t->size = size;
+  t->words = words;
+  t->ancestors = ancestors;
+  t->active = ancestors + size * words;
+  t->waiting = t->active + words;
+  t->failed = failed;
+  t->dep_locks = dep_locks;
+  for (size_t i = 0; i < t->count; ++i) {
+    struct fmc_reactor_worker *w = &t->workers[i];
+    w->tasks.items = items + 2 * i * size;
+    w->pinned.items = w->tasks.items + size;
+    w->tasks.cap = w->pinned.cap = size;
+    w->tasks.head = w->tasks.tail = w->pinned.head = w->pinned.tail = 0;
+  }
+  return true;
+}
+
+// Queues the waiting components whose ancestors have all completed.
+// Must be called with the reactor locked.
+// Spreads the components across the workers if spread is set, or queues them
+// to the given worker otherwise.
+static void fmc_reactor_threads_promote(struct fmc_reactor_threads *t,
+                                        size_t worker, bool spread) {
+  for (size_t w = 0; w < t->words; ++w) {
+    uint64_t bits = t->waiting[w];
+    while (bits) {
+      size_t idx = w * 64 + __builtin_ctzll(bits);
+      bits &= bits - 1;
+      uint64_t *anc = t->ancestors + idx * t->words;
+      bool ready = true;
+      for (size_t i = 0; ready && i < t->words; ++i)
+        ready = !(anc[i] & t->active[i]);
+      if (!ready)
+        continue;
+      FMC_REACTOR_BIT_CLR(t->waiting, idx);
+      int pin = t->workers[0].reactor->ctxs[idx]->worker;
+      if (pin >= 0 && (size_t)pin < t->count) {
+        fmc_reactor_deque_push(&t->workers[pin].pinned, idx);
+      } else {
+        fmc_reactor_deque_push(&t->workers[worker].tasks, idx);
+        if (spread)
+          worker = (worker + 1) % t->count;
+      }
+    }
+  }
+}
+
+static void fmc_reactor_threads_activate(struct fmc_reactor_threads *t,
+                                         size_t idx) {
+  if (FMC_REACTOR_BIT(t->active, idx))
+    return;
+  FMC_REACTOR_BIT_SET(t->active, idx);
+  FMC_REACTOR_BIT_SET(t->waiting, idx);
+  __atomic_add_fetch(&t->nactive, 1, __ATOMIC_RELAXED);
+}
+
+static bool fmc_reactor_threads_next(struct fmc_reactor_threads *t,
+                                     size_t id, size_t *idx) {
+  struct fmc_reactor_worker *w = &t->workers[id];
+  if (fmc_reactor_deque_pop(&w->pinned, idx) ||
+      fmc_reactor_deque_pop(&w->tasks, idx))
+    return true;
+  for (size_t i = 1; i < t->count; ++i) {
+    if (fmc_reactor_deque_steal(&t->workers[(id + i) % t->count].tasks, idx))
+      return true;
+  }
+  return false;
+}
+
+// Executes components until every component queued in the run completed
+static void fmc_reactor_threads_work(struct fmc_reactor_threads *t,
+                                     size_t id) {
+  struct fmc_reactor *reactor = t->workers[0].reactor;
+  size_t idx;
+  while (true) {
+    if (!fmc_reactor_threads_next(t, id, &idx)) {
+      if (!__atomic_load_n(&t->nactive, __ATOMIC_ACQUIRE))
+        return;
+      sched_yield();
+      continue;
+    }
+    struct fmc_reactor_ctx *ctx = reactor->ctxs[idx];
+    bool failed = false;
+    if (!__atomic_load_n(&t->abort, __ATOMIC_RELAXED) &&
+        !fmc_error_has(&ctx->err) && ctx->exec) {
+      fmc_reactor_ctx_exec(ctx, t->now);
+      failed = fmc_error_has(&ctx->err);
+    }
+    fmc_reactor_spin_lock(&t->lock);
+    if (failed)
+      t->failed[t->nfailed++] = idx;
+    FMC_REACTOR_BIT_CLR(t->active, idx);
+    if (fmc_error_has(&reactor->err)) {
+      // Stop running components, like the single threaded reactor does
+      __atomic_store_n(&t->abort, true, __ATOMIC_RELAXED);
+      for (size_t w = 0; w < t->words; ++w) {
+        uint64_t bits = t->waiting[w];
+        __atomic_sub_fetch(&t->nactive, __builtin_popcountll(bits),
+                           __ATOMIC_RELAXED);
+        t->active[w] &= ~bits;
+        t->waiting[w] = 0;
+      }
+    } else {
+      fmc_reactor_threads_promote(t, id, false);
+    }
+    __atomic_sub_fetch(&t->nactive, 1, __ATOMIC_RELEASE);
+    fmc_reactor_spin_unlock(&t->lock);
+  }
+}
+
+static int fmc_reactor_failed_cmp(const void *a, const void *b) {
+  size_t lhs = *(const size_t *)a;
+  size_t rhs = *(const size_t *)b;
+  return (lhs > rhs) - (lhs < rhs);
+}
+
+static void fmc_reactor_threads_run(struct fmc_reactor *reactor,
+                                    fmc_time64_t now, fmc_error_t **usr_error) {
+  struct fmc_reactor_threads *t = reactor->threads;
+  if (!fmc_reactor_threads_graph(reactor))
+    return;
+
+  size_t *item;
+  while ((item = (size_t *)utarray_back(&reactor->queued))) {
+    fmc_reactor_threads_activate(t, *item);
+    utarray_pop_back(&reactor->queued);
+  }
+  if (!t->nactive)
+    return;
+  t->now = now;
+  t->abort = false;
+  t->nfailed = 0;
+  fmc_reactor_threads_promote(t, 0, true);
+
+  pthread_mutex_lock(&t->m);
+  __atomic_store_n(&t->running, true, __ATOMIC_RELEASE);
+  ++t->run;
+  pthread_cond_broadcast(&t->cv);
+  pthread_mutex_unlock(&t->m);
+
+  fmc_reactor_threads_work(t, 0);
+
+  fmc_reactor_spin_lock(&t->lock);
+  __atomic_store_n(&t->running, false, __ATOMIC_RELEASE);
+  fmc_reactor_spin_unlock(&t->lock);
+
+  qsort(t->failed, t->nfailed, sizeof(*t->failed), fmc_reactor_failed_cmp);
+  for (size_t i = 0; i < t->nfailed; ++i) {
+    fmc_reactor_exec_error(reactor->ctxs[t->failed[i]], usr_error);
+  }
+}
+
+static void *fmc_reactor_worker_main(void *arg) {
+  struct fmc_reactor_worker *w = (struct fmc_reactor_worker *)arg;
+  struct fmc_reactor_threads *t = w->reactor->threads;
+  size_t id = w - t->workers;
+  if (w->cpu >= 0) {
+    fmc_error_t *error;
+    fmc_set_cur_affinity(w->cpu, &error);
+    if (error)
+      fmc_error_cpy(&w->err, error);
+  }
+  pthread_mutex_lock(&t->m);
+  w->started = true;
+  pthread_cond_broadcast(&t->cv);
+  while (!t->quit) {
+    if (w->run == t->run) {
+      pthread_cond_wait(&t->cv, &t->m);
+      continue;
+    }
+    w->run = t->run;
+    pthread_mutex_unlock(&t->m);
+    fmc_reactor_threads_work(t, id);
+    pthread_mutex_lock(&t->m);
+  }
+  pthread_mutex_unlock(&t->m);
+  return NULL;
+}
+
+static void fmc_reactor_threads_del(struct fmc_reactor *reactor) {
+  struct fmc_reactor_threads *t = reactor->threads;
+  if (!t)
+    return;
+  pthread_mutex_lock(&t->m);
+  t->quit = true;
+  pthread_cond_broadcast(&t->cv);
+  pthread_mutex_unlock(&t->m);
+  for (size_t i = 1; i < t->count; ++i) {
+    struct fmc_reactor_worker *w = &t->workers[i];
+    if (w->started)
+      pthread_join(w->thread, NULL);
+  }
+  for (size_t i = 0; i < t->count; ++i) {
+    struct fmc_reactor_worker *w = &t->workers[i];
+    fmc_error_destroy(&w->err);
+  }
+  free(t->workers[0].tasks.items);
+  free(t->ancestors);
+  free(t->failed);
+  free(t->dep_locks);
+  free(t->workers);
+  pthread_cond_destroy(&t->cv);
+  pthread_mutex_destroy(&t->m);
+  free(t);
+  reactor->threads = NULL;
+  reactor->pool.concurrent = false;
+}
+
+void fmc_reactor_threads_set(struct fmc_reactor *reactor, size_t threads,
+                             const int *cpus, fmc_error_t **error) {
+  fmc_error_clear(error);
+  fmc_reactor_threads_del(reactor);
+  if (threads <= 1)
+    return;
+  if (reactor->profile) {
+    fmc_error_set(error, "reactor profiling requires a single thread");
+    return;
+  }
+
+  struct fmc_reactor_threads *t =
+      (struct fmc_reactor_threads *)calloc(1, sizeof(*t));
+  if (!t) {
+    fmc_error_set2(error, FMC_ERROR_MEMORY);
+    return;
+  }
+  t->workers =
+      (struct fmc_reactor_worker *)calloc(threads, sizeof(*t->workers));
+  if (!t->workers) {
+    free(t);
+    fmc_error_set2(error, FMC_ERROR_MEMORY);
+    return;
+  }
+  t->count = threads;
+  pthread_mutex_init(&t->m, NULL);
+  pthread_cond_init(&t->cv, NULL);
+  for (size_t i = 0; i < threads; ++i) {
+    struct fmc_reactor_worker *w = &t->workers[i];
+    w->reactor = reactor;
+    w->cpu = i && cpus ? cpus[i - 1] : -1;
+    fmc_error_init_none(&w->err);
+  }
+  reactor->threads = t;
+  reactor->pool.concurrent = true;
+
+  for (size_t i = 1; i < threads; ++i) {
+    struct fmc_reactor_worker *w = &t->workers[i];
+    if (pthread_create(&w->thread, NULL, fmc_reactor_worker_main, w) != 0) {
+      fmc_error_set(error, "unable to start reactor worker thread %zu", i);
+      fmc_reactor_threads_del(reactor);
+      return;
+    }
+    pthread_mutex_lock(&t->m);
+    while (!w->started)
+      pthread_cond_wait(&t->cv, &t->m);
+    pthread_mutex_unlock(&t->m);
+    if (fmc_error_has(&w->err)) {
+      fmc_error_set(error, "unable to pin reactor worker thread %zu: %s", i,
+                    fmc_error_msg(&w->err));
+      fmc_reactor_threads_del(reactor);
+      return;
+    }
+  }
+}
+
+void fmc_reactor_ctx_worker_set(struct fmc_reactor_ctx *ctx, int worker) {
+  ctx->worker = worker;
+}
+
+void fmc_reactor_lock(struct fmc_reactor *reactor) {
+  struct fmc_reactor_threads *t = reactor->threads;
+  if (t && __atomic_load_n(&t->running, __ATOMIC_ACQUIRE))
+    fmc_reactor_spin_lock(&t->lock);
+}
+
+void fmc_reactor_unlock(struct fmc_reactor *reactor) {
+  struct fmc_reactor_threads *t = reactor->threads;
+  if (t && __atomic_load_n(&t->running, __ATOMIC_ACQUIRE))
+    fmc_reactor_spin_unlock(&t->lock);
+}
+
+void fmc_reactor_dep_lock(struct fmc_reactor *reactor, size_t idx) {
+  struct fmc_reactor_threads *t = reactor->threads;
+  if (t && __atomic_load_n(&t->running, __ATOMIC_ACQUIRE))
+    fmc_reactor_spin_lock(&t->dep_locks[idx]);
+}
+
+void fmc_reactor_dep_unlock(struct fmc_reactor *reactor, size_t idx) {
+  struct fmc_reactor_threads *t = reactor->threads;
+  if (t && __atomic_load_n(&t->running, __ATOMIC_ACQUIRE))
+    fmc_reactor_spin_unlock(&t->dep_locks[idx]);
+}
+
+bool fmc_reactor_dep_queue(struct fmc_reactor *reactor, size_t idx) {
+  struct fmc_reactor_threads *t = reactor->threads;
+  if (!t || !__atomic_load_n(&t->running, __ATOMIC_ACQUIRE))
+    return false;
+  fmc_reactor_spin_lock(&t->lock);
+  fmc_reactor_threads_activate(t, idx);
+  fmc_reactor_spin_unlock(&t->lock);
+  return true;
 }
@@ -0,0 +1,295 @@
+/******************************************************************************
+        COPYRIGHT (c) 2019-2023 by Featuremine Corporation.
+
+        This Source Code Form is subject to the terms of the Mozilla Public
+        License, v. 2.0. If a copy of the MPL was not distributed with this
+        file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *****************************************************************************/
+
+/**
+ * @file reactor_io.c
+ * @date 18 Oct 2026
+ * @brief File contains C implementation of the Reactor event sources
+ * @see http://www.featuremine.com
+ */
+
+#include "reactor_io.h"
+
+#include <fmc/component.h>
+#include <fmc/error.h>
+#include <fmc/platform.h>
+#include <fmc/reactor.h>
+#include <fmc/time.h>
+#include <stdlib.h> // calloc() free()
+#include <uthash/utarray.h>
+#include <uthash/uthash.h>
+
+#if defined(FMC_SYS_LINUX)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
+#define FMC_REACTOR_IO_EVENTS 64
+
+struct fmc_reactor_fd {
+  int fd;
+  size_t idx;
+  fmc_reactor_fd_clbck cl;
+  UT_hash_handle hh;
+};
+
+struct fmc_reactor_io {
+  int epfd;
+  int wakefd;  // written by fmc_reactor_stop
+  int timerfd; // expires when the next scheduled component is due
+  struct fmc_reactor_fd *fds;
+  int64_t budget;
+  int64_t idle; // time the reactor ran out of work, 0 while busy
+};
+
+#if defined(FMC_SYS_LINUX)
+
+static bool fmc_reactor_io_ctl(struct fmc_reactor_io *io, int op, int fd,
+                               uint32_t events, fmc_error_t **error) {
+  struct epoll_event ev;
+  ev.events = events;
+  ev.data.fd = fd;
+  if (epoll_ctl(io->epfd, op, fd, &ev) != 0) {
+    fmc_error_set(error, "unable to register file descriptor %d: %s", fd,
+                  fmc_syserror_msg());
+    return false;
+  }
+  return true;
+}
+
+static struct fmc_reactor_io *fmc_reactor_io_get(struct fmc_reactor *reactor,
+                                                 fmc_error_t **error) {
+  if (reactor->io)
+    return reactor->io;
+  struct fmc_reactor_io *io = (struct fmc_reactor_io *)calloc(1, sizeof(*io));
+  if (!io) {
+    fmc_error_set2(error, FMC_ERROR_MEMORY);
+    return NULL;
+  }
+  io->epfd = epoll_create1(EPOLL_CLOEXEC);
+  io->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  io->timerfd = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (io->epfd < 0 || io->wakefd < 0 || io->timerfd < 0) {
+    fmc_error_set(error, "unable to create reactor event sources: %s",
+                  fmc_syserror_msg());
+    goto cleanup;
+  }
+  if (!fmc_reactor_io_ctl(io, EPOLL_CTL_ADD, io->wakefd, EPOLLIN, error) ||
+      !fmc_reactor_io_ctl(io, EPOLL_CTL_ADD, io->timerfd, EPOLLIN, error))
+    goto cleanup;
+  reactor->io = io;
+  return io;
+cleanup:
+  if (io->epfd >= 0)
+    close(io->epfd);
+  if (io->wakefd >= 0)
+    close(io->wakefd);
+  if (io->timerfd >= 0)
+    close(io->timerfd);
+  free(io);
+  return NULL;
+}
+
+void fmc_reactor_ctx_fd_add(struct fmc_reactor_ctx *ctx, int fd,
+                            uint32_t events, fmc_reactor_fd_clbck cl,
+                            fmc_error_t **error) {
+  fmc_error_clear(error);
+  struct fmc_reactor_io *io = fmc_reactor_io_get(ctx->reactor, error);
+  if (!io)
+    return;
+  struct fmc_reactor_fd *item;
+  HASH_FIND_INT(io->fds, &fd, item);
+  if (item) {
+    fmc_error_set(error, "file descriptor %d is already registered", fd);
+    return;
+  }
+  item = (struct fmc_reactor_fd *)calloc(1, sizeof(*item));
+  if (!item) {
+    fmc_error_set2(error, FMC_ERROR_MEMORY);
+    return;
+  }
+  uint32_t epevents = (events & FMC_REACTOR_FD_READ ? EPOLLIN : 0) |
+                      (events & FMC_REACTOR_FD_WRITE ? EPOLLOUT : 0);
+  if (!fmc_reactor_io_ctl(io, EPOLL_CTL_ADD, fd, epevents, error)) {
+    free(item);
+    return;
+  }
+  item->fd = fd;
+  item->idx = ctx->idx;
+  item->cl = cl;
+  HASH_ADD_INT(io->fds, fd, item);
+}
+
+void fmc_reactor_ctx_fd_rm(struct fmc_reactor_ctx *ctx, int fd,
+                           fmc_error_t **error) {
+  fmc_error_clear(error);
+  struct fmc_reactor_io *io = ctx->reactor->io;
+  struct fmc_reactor_fd *item = NULL;
+  if (io)
+    HASH_FIND_INT(io->fds, &fd, item);
+  if (!item || item->idx != ctx->idx) {
+    fmc_error_set(error, "file descriptor %d is not registered", fd);
+    return;
+  }
+  HASH_DEL(io->fds, item);
+  free(item);
+  // The descriptor may have been closed already, which unregisters it
+  epoll_ctl(io->epfd, EPOLL_CTL_DEL, fd, NULL);
+}
+
+void fmc_reactor_busy_poll_set(struct fmc_reactor *reactor, int64_t budget,
+                               fmc_error_t **error) {
+  fmc_error_clear(error);
+  struct fmc_reactor_io *io = fmc_reactor_io_get(reactor, error);
+  if (io)
+    io->budget = budget;
+}
+
+size_t fmc_reactor_io_count(struct fmc_reactor *reactor) {
+  return reactor->io ? HASH_COUNT(reactor->io->fds) : 0;
+}
+
+void fmc_reactor_io_poll(struct fmc_reactor *reactor,
+                         fmc_error_t **usr_error) {
+  struct fmc_reactor_io *io = reactor->io;
+  if (!io || !io->fds)
+    return;
+  struct epoll_event evs[FMC_REACTOR_IO_EVENTS];
+  int n = epoll_wait(io->epfd, evs, FMC_REACTOR_IO_EVENTS, 0);
+  for (int i = 0; i < n; ++i) {
+    int fd = evs[i].data.fd;
+    struct fmc_reactor_fd *item;
+    // Callbacks may unregister any file descriptor
+    HASH_FIND_INT(io->fds, &fd, item);
+    if (!item)
+      continue;
+    struct fmc_reactor_ctx *ctx = reactor->ctxs[item->idx];
+    if (fmc_error_has(&ctx->err))
+      continue;
+    uint32_t events =
+        (evs[i].events & EPOLLIN ? FMC_REACTOR_FD_READ : 0) |
+        (evs[i].events & EPOLLOUT ? FMC_REACTOR_FD_WRITE : 0) |
+        (evs[i].events & (EPOLLERR | EPOLLHUP) ? FMC_REACTOR_FD_ERROR : 0);
+    item->cl(ctx->comp, ctx, fd, events);
+    if (fmc_error_has(&ctx->err))
+      fmc_reactor_exec_error(ctx, usr_error);
+  }
+}
+
+void fmc_reactor_io_wait(struct fmc_reactor *reactor, fmc_time64_t now) {
+  struct fmc_reactor_io *io = reactor->io;
+  if (!io)
+    return;
+  fmc_time64_t next = fmc_reactor_sched(reactor);
+  bool busy = utarray_len(&reactor->toqueue) ||
+              utarray_len(&reactor->queued) ||
+              fmc_time64_less_or_equal(next, now) ||
+              __atomic_load_n(&reactor->stop_signal, __ATOMIC_SEQ_CST) !=
+                  reactor->stop;
+  int64_t cur = fmc_time64_to_nanos(now);
+  if (busy || !io->idle) {
+    io->idle = busy ? 0 : cur;
+    return;
+  }
+  if (cur - io->idle < io->budget)
+    return;
+
+  struct itimerspec deadline = {{0, 0}, {0, 0}};
+  if (!fmc_time64_is_end(next)) {
+    int64_t ns = fmc_time64_to_nanos(next);
+    deadline.it_value.tv_sec = ns / 1000000000;
+    deadline.it_value.tv_nsec = ns % 1000000000;
+  }
+  timerfd_settime(io->timerfd, TFD_TIMER_ABSTIME, &deadline, NULL);
+  struct epoll_event evs[FMC_REACTOR_IO_EVENTS];
+  int n = epoll_wait(io->epfd, evs, FMC_REACTOR_IO_EVENTS, -1);
+  for (int i = 0; i < n; ++i) {
+    uint64_t count;
+    if (evs[i].data.fd == io->wakefd || evs[i].data.fd == io->timerfd) {
+      ssize_t ret = read(evs[i].data.fd, &count, sizeof(count));
+      (void)ret;
+    }
+  }
+  io->idle = 0;
+}
+
+void fmc_reactor_io_wake(struct fmc_reactor *reactor) {
+  struct fmc_reactor_io *io = reactor->io;
+  if (io) {
+    uint64_t one = 1;
+    ssize_t ret = write(io->wakefd, &one, sizeof(one));
+    (void)ret;
+  }
+}
+
+void fmc_reactor_io_ctx_del(struct fmc_reactor *reactor, size_t idx) {
+  struct fmc_reactor_io *io = reactor->io;
+  if (!io)
+    return;
+  struct fmc_reactor_fd *item;
+  struct fmc_reactor_fd *tmp;
+  HASH_ITER(hh, io->fds, item, tmp) {
+    if (item->idx == idx) {
+      epoll_ctl(io->epfd, EPOLL_CTL_DEL, item->fd, NULL);
+      HASH_DEL(io->fds, item);
+      free(item);
+    }
+  }
+}
+
+void fmc_reactor_io_del(struct fmc_reactor *reactor) {
+  struct fmc_reactor_io *io = reactor->io;
+  if (!io)
+    return;
+  struct fmc_reactor_fd *item;
+  struct fmc_reactor_fd *tmp;
+  HASH_ITER(hh, io->fds, item, tmp) {
+    HASH_DEL(io->fds, item);
+    free(item);
+  }
+  close(io->epfd);
+  close(io->wakefd);
+  close(io->timerfd);
+  free(io);
+  reactor->io = NULL;
+}
+
+#else
+
+void fmc_reactor_ctx_fd_add(struct fmc_reactor_ctx *ctx, int fd,
+                            uint32_t events, fmc_reactor_fd_clbck cl,
+                            fmc_error_t **error) {
+  FMC_ERROR_REPORT(error, "file descriptor sources are not supported");
+}
+
+void fmc_reactor_ctx_fd_rm(struct fmc_reactor_ctx *ctx, int fd,
+                           fmc_error_t **error) {
+  FMC_ERROR_REPORT(error, "file descriptor sources are not supported");
+}
+
+void fmc_reactor_busy_poll_set(struct fmc_reactor *reactor, int64_t budget,
+                               fmc_error_t **error) {
+  FMC_ERROR_REPORT(error, "file descriptor sources are not supported");
+}
+
+size_t fmc_reactor_io_count(struct fmc_reactor *reactor) { return 0; }
+
+void fmc_reactor_io_poll(struct fmc_reactor *reactor,
+                         fmc_error_t **usr_error) {}
+
+void fmc_reactor_io_wait(struct fmc_reactor *reactor, fmc_time64_t now) {}
+
+void fmc_reactor_io_wake(struct fmc_reactor *reactor) {}
+
+void fmc_reactor_io_ctx_del(struct fmc_reactor *reactor, size_t idx) {}
+
+void fmc_reactor_io_del(struct fmc_reactor *reactor) {}
+
+#endif
@@ -0,0 +1,41 @@
+/******************************************************************************
+        COPYRIGHT (c) 2019-2023 by Featuremine Corporation.
+
+        This Source Code Form is subject to the terms of the Mozilla Public
+        License, v. 2.0. If a copy of the MPL was not distributed with this
+        file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *****************************************************************************/
+
+#pragma once
+
+#include <fmc/error.h>
+#include <fmc/time.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct fmc_reactor;
+struct fmc_reactor_ctx;
+
+// Reports the error of a component that failed to run in usr_error
+void fmc_reactor_exec_error(struct fmc_reactor_ctx *ctx,
+                            fmc_error_t **usr_error);
+
+// Number of registered file descriptors
+size_t fmc_reactor_io_count(struct fmc_reactor *reactor);
+
+// Runs the callbacks of the file descriptors that are ready, without
+// blocking. Errors of the components are reported in usr_error.
+void fmc_reactor_io_poll(struct fmc_reactor *reactor, fmc_error_t **usr_error);
+
+// Blocks until a file descriptor is ready, a component is due or the reactor
+// is stopped, if the reactor has nothing to run at the given time
+void fmc_reactor_io_wait(struct fmc_reactor *reactor, fmc_time64_t now);
+
+// Interrupts fmc_reactor_io_wait, safe to call from a signal handler
+void fmc_reactor_io_wake(struct fmc_reactor *reactor);
+
+// Unregisters the file descriptors of a component
+void fmc_reactor_io_ctx_del(struct fmc_reactor *reactor, size_t idx);
+
+void fmc_reactor_io_del(struct fmc_reactor *reactor);
@@ -0,0 +1,203 @@
+/******************************************************************************
+        COPYRIGHT (c) 2019-2023 by Featuremine Corporation.
+
+        This Source Code Form is subject to the terms of the Mozilla Public
+        License, v. 2.0. If a copy of the MPL was not distributed with this
+        file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *****************************************************************************/
+
+/**
+ * @file reactor_profile.c
+ * @date 18 Oct 2026
+ * @brief File contains C implementation of the Reactor profiling
+ * @see http://www.featuremine.com
+ */
+
+#include "reactor_profile.h"
+
+#include <fmc/component.h>
+#include <fmc/error.h>
+#include <fmc/reactor.h>
+#include <fmc/time.h>
+#include <stdlib.h> // calloc() free()
+
+// Buckets of values below 4 hold a single value, the following ones split
+// every power of two in 4
+uint64_t fmc_reactor_profile_bucket_cycles(size_t bucket) {
+  if (bucket < 4)
+    return bucket;
+  unsigned msb = bucket / 4 + 1;
+  return (uint64_t)(4 + bucket % 4) << (msb - 2);
+}
+
+uint64_t
+fmc_reactor_profile_percentile(const struct fmc_reactor_ctx_profile *profile,
+                               double percentile) {
+  if (!profile->execs)
+    return 0;
+  double target = percentile / 100.0 * profile->execs;
+  uint64_t seen = 0;
+  for (size_t i = 0; i < FMC_REACTOR_PROFILE_BUCKETS; ++i) {
+    seen += profile->exec_hist[i];
+    if (seen && seen >= target)
+      return fmc_reactor_profile_bucket_cycles(i);
+  }
+  return profile->exec_max;
+}
+
+const struct fmc_reactor_ctx_profile *
+fmc_reactor_ctx_profile_get(struct fmc_reactor_ctx *ctx) {
+  struct fmc_reactor_profile *profile = ctx->reactor->profile;
+  if (!profile || ctx->idx >= profile->size)
+    return NULL;
+  return &profile->ctxs[ctx->idx].pub;
+}
+
+double fmc_reactor_profile_cycles_per_ns(struct fmc_reactor *reactor) {
+  return reactor->profile ? reactor->profile->cycles_per_ns : 0.0;
+}
+
+void fmc_reactor_profile_del(struct fmc_reactor *reactor) {
+  struct fmc_reactor_profile *profile = reactor->profile;
+  if (!profile)
+    return;
+  reactor->profile = NULL;
+  free(profile->ctxs);
+  free(profile);
+}
+
+#if defined(FMC_REACTOR_PROFILE)
+
+static size_t fmc_reactor_profile_bucket(uint64_t cycles) {
+  if (cycles < 4)
+    return cycles;
+  unsigned msb = 63 - __builtin_clzll(cycles);
+  return (msb - 1) * 4 + ((cycles >> (msb - 2)) & 3);
+}
+
+static void fmc_reactor_profile_stat_add(struct fmc_reactor_stat *stat,
+                                         int64_t value) {
+  ++stat->count;
+  stat->total += value;
+  if (value > stat->max)
+    stat->max = value;
+}
+
+// Measures the cycle counter against the clock for a millisecond
+static double fmc_reactor_profile_calibrate(void) {
+  int64_t start_ns = fmc_cur_time_ns();
+  uint64_t start = fmc_reactor_profile_cycles();
+  int64_t elapsed;
+  do {
+    elapsed = fmc_cur_time_ns() - start_ns;
+  } while (elapsed < 1000000);
+  double cycles = (double)(fmc_reactor_profile_cycles() - start);
+  return cycles / elapsed;
+}
+
+void fmc_reactor_profile_set(struct fmc_reactor *reactor, bool enable,
+                             fmc_error_t **error) {
+  fmc_error_clear(error);
+  fmc_reactor_profile_del(reactor);
+  if (!enable)
+    return;
+  if (reactor->threads) {
+    fmc_error_set(error, "reactor profiling requires a single thread");
+    return;
+  }
+  struct fmc_reactor_profile *profile =
+      (struct fmc_reactor_profile *)calloc(1, sizeof(*profile));
+  if (!profile) {
+    fmc_error_set2(error, FMC_ERROR_MEMORY);
+    return;
+  }
+  profile->ctxs = (struct fmc_reactor_profile_ctx *)calloc(
+      reactor->size ? reactor->size : 1, sizeof(*profile->ctxs));
+  if (!profile->ctxs) {
+    free(profile);
+    fmc_error_set2(error, FMC_ERROR_MEMORY);
+    return;
+  }
+  profile->size = reactor->size;
+  profile->cycles_per_ns = fmc_reactor_profile_calibrate();
+  reactor->profile = profile;
+}
+
+void fmc_reactor_profile_queued(struct fmc_reactor_profile *profile,
+                                size_t idx) {
+  if (idx < profile->size && !profile->ctxs[idx].queued)
+    profile->ctxs[idx].queued = fmc_reactor_profile_cycles();
+}
+
+void fmc_reactor_profile_scheduled(struct fmc_reactor_profile *profile,
+                                   size_t idx, fmc_time64_t t) {
+  if (idx >= profile->size)
+    return;
+  struct fmc_reactor_profile_ctx *pctx = &profile->ctxs[idx];
+  if (!pctx->scheduled || fmc_time64_less(t, pctx->deadline)) {
+    pctx->deadline = t;
+    pctx->scheduled = true;
+  }
+}
+
+void fmc_reactor_profile_run(struct fmc_reactor_profile *profile,
+                             fmc_time64_t now) {
+  profile->run_start = fmc_reactor_profile_cycles();
+  profile->now = now;
+}
+
+void fmc_reactor_profile_notify(struct fmc_reactor_profile *profile,
+                                size_t idx, size_t fanout) {
+  if (idx < profile->size)
+    fmc_reactor_profile_stat_add(&profile->ctxs[idx].pub.fanout, fanout);
+}
+
+uint64_t fmc_reactor_profile_exec_start(struct fmc_reactor_profile *profile,
+                                        size_t idx) {
+  if (!profile || idx >= profile->size)
+    return 0;
+  struct fmc_reactor_profile_ctx *pctx = &profile->ctxs[idx];
+  uint64_t start = fmc_reactor_profile_cycles();
+  double cpn = profile->cycles_per_ns;
+  if (pctx->queued) {
+    int64_t dwell = start > pctx->queued ? (start - pctx->queued) / cpn : 0;
+    fmc_reactor_profile_stat_add(&pctx->pub.dwell, dwell);
+    pctx->queued = 0;
+  }
+  // The time of the run is behind the clock by the time the run took so far
+  if (pctx->scheduled &&
+      fmc_time64_less_or_equal(pctx->deadline, profile->now)) {
+    int64_t late = fmc_time64_to_nanos(profile->now) -
+                   fmc_time64_to_nanos(pctx->deadline);
+    if (start > profile->run_start)
+      late += (start - profile->run_start) / cpn;
+    fmc_reactor_profile_stat_add(&pctx->pub.lateness, late);
+    pctx->scheduled = false;
+  }
+  return start ? start : 1;
+}
+
+void fmc_reactor_profile_exec_end(struct fmc_reactor_profile *profile,
+                                  size_t idx, uint64_t start) {
+  if (!start)
+    return;
+  struct fmc_reactor_ctx_profile *pub = &profile->ctxs[idx].pub;
+  uint64_t end = fmc_reactor_profile_cycles();
+  uint64_t cycles = end > start ? end - start : 0;
+  ++pub->exec_hist[fmc_reactor_profile_bucket(cycles)];
+  ++pub->execs;
+  pub->exec_cycles += cycles;
+  if (cycles > pub->exec_max)
+    pub->exec_max = cycles;
+}
+
+#else
+
+void fmc_reactor_profile_set(struct fmc_reactor *reactor, bool enable,
+                             fmc_error_t **error) {
+  fmc_error_clear(error);
+  if (enable)
+    fmc_error_set(error, "reactor profiling is not enabled in this build");
+}
+
+#endif
@@ -0,0 +1,105 @@
+/******************************************************************************
+        COPYRIGHT (c) 2019-2023 by Featuremine Corporation.
+
+        This Source Code Form is subject to the terms of the Mozilla Public
+        License, v. 2.0. If a copy of the MPL was not distributed with this
+        file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *****************************************************************************/
+
+#pragma once
+
+#include <fmc/platform.h>
+#include <fmc/reactor_profile.h>
+#include <fmc/time.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(FMC_AMD64)
+#include <x86intrin.h>
+#endif
+
+struct fmc_reactor;
+struct fmc_reactor_ctx;
+
+struct fmc_reactor_profile_ctx {
+  struct fmc_reactor_ctx_profile pub;
+  uint64_t queued; // cycles when the component was queued, 0 if it is not
+  fmc_time64_t deadline; // earliest pending schedule, valid if scheduled
+  bool scheduled;
+};
+
+struct fmc_reactor_profile {
+  struct fmc_reactor_profile_ctx *ctxs;
+  size_t size;
+  double cycles_per_ns;
+  uint64_t run_start; // cycles when the current run started
+  fmc_time64_t now;   // time of the current run
+};
+
+// Releases the profile of the reactor
+void fmc_reactor_profile_del(struct fmc_reactor *reactor);
+
+#if defined(FMC_REACTOR_PROFILE)
+
+static inline uint64_t fmc_reactor_profile_cycles(void) {
+#if defined(FMC_AMD64)
+  return __rdtsc();
+#else
+  return (uint64_t)fmc_cur_time_ns();
+#endif
+}
+
+void fmc_reactor_profile_queued(struct fmc_reactor_profile *profile,
+                                size_t idx);
+void fmc_reactor_profile_scheduled(struct fmc_reactor_profile *profile,
+                                   size_t idx, fmc_time64_t t);
+void fmc_reactor_profile_run(struct fmc_reactor_profile *profile,
+                             fmc_time64_t now);
+void fmc_reactor_profile_notify(struct fmc_reactor_profile *profile,
+                                size_t idx, size_t fanout);
+// Returns the cycles when the execution started, 0 if it is not profiled
+uint64_t fmc_reactor_profile_exec_start(struct fmc_reactor_profile *profile,
+                                        size_t idx);
+void fmc_reactor_profile_exec_end(struct fmc_reactor_profile *profile,
+                                  size_t idx, uint64_t start);
+
+// The hooks only cost a branch while the profiling is disabled at run time
+#define FMC_REACTOR_PROFILE_QUEUED(reactor, idx)                               \
+  do {                                                                         \
+    if ((reactor)->profile)                                                    \
+      fmc_reactor_profile_queued((reactor)->profile, (idx));                   \
+  } while (0)
+#define FMC_REACTOR_PROFILE_SCHEDULED(reactor, idx, t)                         \
+  do {                                                                         \
+    if ((reactor)->profile)                                                    \
+      fmc_reactor_profile_scheduled((reactor)->profile, (idx), (t));           \
+  } while (0)
+#define FMC_REACTOR_PROFILE_RUN(reactor, now)                                  \
+  do {                                                                         \
+    if ((reactor)->profile)                                                    \
+      fmc_reactor_profile_run((reactor)->profile, (now));                      \
+  } while (0)
+#define FMC_REACTOR_PROFILE_NOTIFY(reactor, idx, fanout)                       \
+  do {                                                                         \
+    if ((reactor)->profile)                                                    \
+      fmc_reactor_profile_notify((reactor)->profile, (idx), (fanout));         \
+  } while (0)
+
+#else
+
+#define FMC_REACTOR_PROFILE_QUEUED(reactor, idx)                               \
+  do {                                                                         \
+  } while (0)
+#define FMC_REACTOR_PROFILE_SCHEDULED(reactor, idx, t)                         \
+  do {                                                                         \
+  } while (0)
+#define FMC_REACTOR_PROFILE_RUN(reactor, now)                                  \
+  do {                                                                         \
+  } while (0)
+#define FMC_REACTOR_PROFILE_NOTIFY(reactor, idx, fanout)                       \
+  do {                                                                         \
+  } while (0)
+
+#endif
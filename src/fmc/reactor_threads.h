@@ -0,0 +1,28 @@
+/******************************************************************************
+        COPYRIGHT (c) 2019-2023 by Featuremine Corporation.
+
+        This Source Code Form is subject to the terms of the Mozilla Public
+        License, v. 2.0. If a copy of the MPL was not distributed with this
+        file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *****************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct fmc_reactor;
+
+// Serialize updates of the reactor state made by components running on the
+// worker threads. They do nothing unless a multi-threaded run is in progress.
+void fmc_reactor_lock(struct fmc_reactor *reactor);
+void fmc_reactor_unlock(struct fmc_reactor *reactor);
+
+// Serialize the dependency callbacks of a component, its inputs may be
+// running on different workers
+void fmc_reactor_dep_lock(struct fmc_reactor *reactor, size_t idx);
+void fmc_reactor_dep_unlock(struct fmc_reactor *reactor, size_t idx);
+
+// Queues a component updated by one of its inputs in the current run.
+// Returns false if the component has to be queued in the reactor heap.
+bool fmc_reactor_dep_queue(struct fmc_reactor *reactor, size_t idx);
@@ -0,0 +1,189 @@
+/******************************************************************************
+        COPYRIGHT (c) 2019-2023 by Featuremine Corporation.
+
+        This Source Code Form is subject to the terms of the Mozilla Public
+        License, v. 2.0. If a copy of the MPL was not distributed with this
+        file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *****************************************************************************/
+
+/**
+ * @file timer_wheel.c
+ * @date 18 Oct 2026
+ * @brief File contains C implementation of hierarchical timer wheel
+ * @see http://www.featuremine.com
+ */
+
+#include <fmc/timer_wheel.h>
+#include <stdlib.h> // malloc() free()
+#include <string.h> // memset()
+#include <uthash/utlist.h>
+
+#define FMC_TIMER_WHEEL_BITS 6
+
+// Maps the time to an unsigned value that preserves the order
+static uint64_t fmc_timer_wheel_ticks(struct fmc_timer_wheel *w,
+                                      fmc_time64_t t) {
+  return ((uint64_t)fmc_time64_raw(t) ^ (1ull << 63)) / (uint64_t)w->tick;
+}
+
+static void fmc_timer_wheel_place(struct fmc_timer_wheel *w,
+                                  struct fmc_timer *timer, uint64_t e) {
+  uint64_t diff = e ^ w->cur;
+  unsigned level =
+      diff ? (63 - __builtin_clzll(diff)) / FMC_TIMER_WHEEL_BITS : 0;
+  unsigned slot =
+      (e >> (level * FMC_TIMER_WHEEL_BITS)) & (FMC_TIMER_WHEEL_SLOTS - 1);
+  timer->level = level;
+  timer->slot = slot;
+  DL_APPEND(w->slots[level][slot], timer);
+  w->occupied[level] |= 1ull << slot;
+}
+
+static void fmc_timer_wheel_unlink(struct fmc_timer_wheel *w,
+                                   struct fmc_timer *timer) {
+  DL_DELETE(w->slots[timer->level][timer->slot], timer);
+  if (!w->slots[timer->level][timer->slot])
+    w->occupied[timer->level] &= ~(1ull << timer->slot);
+  if (w->next_valid && fmc_time64_equal(timer->t, w->next))
+    w->next_valid = false;
+  --w->count;
+  timer->next = w->free;
+  w->free = timer;
+}
+
+// Finds the slot with the earliest timers. Every timer in a level expires
+// after the timers in the lower levels, and the slots of a level are ordered.
+static bool fmc_timer_wheel_earliest(struct fmc_timer_wheel *w,
+                                     unsigned *level, unsigned *slot) {
+  for (unsigned l = 0; l < FMC_TIMER_WHEEL_LEVELS; ++l) {
+    if (w->occupied[l]) {
+      *level = l;
+      *slot = __builtin_ctzll(w->occupied[l]);
+      return true;
+    }
+  }
+  return false;
+}
+
+void fmc_timer_wheel_init(struct fmc_timer_wheel *w, int64_t tick) {
+  memset(w, 0, sizeof(*w));
+  w->tick = tick > 0 ? tick : 1;
+}
+
+void fmc_timer_wheel_destroy(struct fmc_timer_wheel *w) {
+  for (unsigned l = 0; l < FMC_TIMER_WHEEL_LEVELS; ++l) {
+    for (unsigned s = 0; s < FMC_TIMER_WHEEL_SLOTS; ++s) {
+      struct fmc_timer *timer;
+      struct fmc_timer *tmp;
+      DL_FOREACH_SAFE(w->slots[l][s], timer, tmp) { free(timer); }
+    }
+  }
+  while (w->free) {
+    struct fmc_timer *timer = w->free;
+    w->free = timer->next;
+    free(timer);
+  }
+  memset(w, 0, sizeof(*w));
+}
+
+struct fmc_timer *fmc_timer_wheel_add(struct fmc_timer_wheel *w,
+                                      fmc_time64_t t, size_t data,
+                                      fmc_error_t **error) {
+  fmc_error_clear(error);
+  struct fmc_timer *timer = w->free;
+  if (timer) {
+    w->free = timer->next;
+  } else {
+    timer = (struct fmc_timer *)malloc(sizeof(*timer));
+    if (!timer) {
+      fmc_error_set2(error, FMC_ERROR_MEMORY);
+      return NULL;
+    }
+  }
+  timer->t = t;
+  timer->data = data;
+  uint64_t e = fmc_timer_wheel_ticks(w, t);
+  fmc_timer_wheel_place(w, timer, e > w->cur ? e : w->cur);
+  if (!w->count) {
+    w->next = t;
+    w->next_valid = true;
+  } else if (w->next_valid && fmc_time64_less(t, w->next)) {
+    w->next = t;
+  }
+  ++w->count;
+  return timer;
+}
+
+void fmc_timer_wheel_cancel(struct fmc_timer_wheel *w,
+                            struct fmc_timer *timer) {
+  fmc_timer_wheel_unlink(w, timer);
+}
+
+void fmc_timer_wheel_cancel_data(struct fmc_timer_wheel *w, size_t data) {
+  for (unsigned l = 0; l < FMC_TIMER_WHEEL_LEVELS; ++l) {
+    for (unsigned s = 0; s < FMC_TIMER_WHEEL_SLOTS; ++s) {
+      struct fmc_timer *timer;
+      struct fmc_timer *tmp;
+      DL_FOREACH_SAFE(w->slots[l][s], timer, tmp) {
+        if (timer->data == data)
+          fmc_timer_wheel_unlink(w, timer);
+      }
+    }
+  }
+}
+
+fmc_time64_t fmc_timer_wheel_next(struct fmc_timer_wheel *w) {
+  if (w->next_valid)
+    return w->next;
+  unsigned level, slot;
+  if (!fmc_timer_wheel_earliest(w, &level, &slot))
+    return fmc_time64_end();
+  struct fmc_timer *timer;
+  w->next = w->slots[level][slot]->t;
+  DL_FOREACH(w->slots[level][slot], timer) {
+    if (fmc_time64_less(timer->t, w->next))
+      w->next = timer->t;
+  }
+  w->next_valid = true;
+  return w->next;
+}
+
+bool fmc_timer_wheel_pop(struct fmc_timer_wheel *w, fmc_time64_t now,
+                         size_t *data) {
+  uint64_t target = fmc_timer_wheel_ticks(w, now);
+  unsigned level, slot;
+  while (fmc_timer_wheel_earliest(w, &level, &slot)) {
+    unsigned shift = level * FMC_TIMER_WHEEL_BITS;
+    uint64_t upper = shift + FMC_TIMER_WHEEL_BITS < 64
+                         ? w->cur >> (shift + FMC_TIMER_WHEEL_BITS)
+                                 << (shift + FMC_TIMER_WHEEL_BITS)
+                         : 0;
+    uint64_t base = upper | ((uint64_t)slot << shift);
+    if (base > target)
+      return false;
+    w->cur = base;
+    struct fmc_timer *head = w->slots[level][slot];
+    if (level == 0) {
+      // Timers of the slot expire in the same tick, not necessarily by now
+      struct fmc_timer *timer;
+      DL_FOREACH(head, timer) {
+        if (fmc_time64_less_or_equal(timer->t, now)) {
+          *data = timer->data;
+          fmc_timer_wheel_unlink(w, timer);
+          return true;
+        }
+      }
+      return false;
+    }
+    // Move the timers of the slot to the lower levels
+    w->slots[level][slot] = NULL;
+    w->occupied[level] &= ~(1ull << slot);
+    struct fmc_timer *timer;
+    struct fmc_timer *tmp;
+    DL_FOREACH_SAFE(head, timer, tmp) {
+      uint64_t e = fmc_timer_wheel_ticks(w, timer->t);
+      fmc_timer_wheel_place(w, timer, e > w->cur ? e : w->cur);
+    }
+  }
+  return false;
+}
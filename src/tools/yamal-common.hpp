@@ -108,12 +108,59 @@ template <typename Handler> struct ann_cl_t {
       return;
     }
 
-    auto *d = ytp_data_reserve(dest_yml, sz, &error);
+    // Upper bound of the node, time and data headers including padding
+    const size_t node_overhead = 64;
+    if (batch_count == YTP_YAMAL_BATCH_MAX ||
+        batch_bytes + sz + node_overhead > ytp_yamal_page_size(dest_yml)) {
+      flush();
+      if (error) {
+        return;
+      }
+    }
+
+    if (sz + node_overhead > ytp_yamal_page_size(dest_yml)) {
+      auto *d = ytp_data_reserve(dest_yml, sz, &error);
+      CHECK(error);
+
+      memcpy(d, data, sz);
+
+      ytp_data_commit(dest_yml, ts, dst_stream, d, &error);
+      CHECK(error);
+      return;
+    }
+
+    // The source pages stay mapped, so the payload is copied when the batch
+    // is flushed
+    batch_src[batch_count] = data;
+    batch_sizes[batch_count] = sz;
+    batch_ts[batch_count] = ts;
+    batch_streams[batch_count] = dst_stream;
+    batch_bytes += sz + node_overhead;
+    ++batch_count;
+  }
+
+  // Upper bound of the bytes queued for the next flush
+  size_t pending_size() const { return batch_bytes; }
+
+  // Copies the pending messages with a single reservation and a single commit
+  void flush() {
+    if (batch_count == 0) {
+      return;
+    }
+    char *dst[YTP_YAMAL_BATCH_MAX];
+    size_t count = batch_count;
+    batch_count = 0;
+    batch_bytes = 0;
+
+    ytp_data_reserve_batch(dest_yml, batch_sizes, dst, count, &error);
     CHECK(error);
 
-    memcpy(d, data, sz);
+    for (size_t i = 0; i < count; ++i) {
+      memcpy(dst[i], batch_src[i], batch_sizes[i]);
+    }
 
-    ytp_data_commit(dest_yml, ts, dst_stream, d, &error);
+    ytp_data_commit_batch(dest_yml, batch_ts, batch_streams, dst, count,
+                          &error);
     CHECK(error);
   }
 
@@ -143,4 +190,10 @@ template <typename Handler> struct ann_cl_t {
   ytp_yamal_t *dest_yml = nullptr;
   ytp_cursor_t *cursor = nullptr;
   ytp_streams_t *streams = nullptr;
+  const char *batch_src[YTP_YAMAL_BATCH_MAX];
+  size_t batch_sizes[YTP_YAMAL_BATCH_MAX];
+  int64_t batch_ts[YTP_YAMAL_BATCH_MAX];
+  ytp_mmnode_offs batch_streams[YTP_YAMAL_BATCH_MAX];
+  size_t batch_count = 0;
+  size_t batch_bytes = 0;
 };
@@ -0,0 +1,85 @@
+/******************************************************************************
+        COPYRIGHT (c) 2019-2023 by Featuremine Corporation.
+
+        This Source Code Form is subject to the terms of the Mozilla Public
+        License, v. 2.0. If a copy of the MPL was not distributed with this
+        file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *****************************************************************************/
+
+#include <tclap/CmdLine.h>
+
+#include <fmc/counter_registry.h>
+#include <fmc/signals.h>
+
+#include <ytp/version.h>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+static std::atomic<bool> run = true;
+static void sig_handler(int s) { run = false; }
+
+static void print_counters(fmc_counter_registry_t *registry) {
+  size_t count = fmc_counter_registry_count(registry);
+  for (size_t i = 0; i < count; ++i) {
+    auto *counter = fmc_counter_registry_get(registry, i);
+    std::cout << counter->name << " ";
+    switch (counter->kind) {
+    case FMC_COUNTER_COUNT:
+      std::cout << __atomic_load_n(&counter->value, __ATOMIC_RELAXED);
+      break;
+    case FMC_COUNTER_GAUGE:
+      std::cout << (int64_t)__atomic_load_n(&counter->value, __ATOMIC_RELAXED);
+      break;
+    default:
+      std::cout << fmc_counter_value(counter);
+    }
+    std::cout << std::endl;
+  }
+}
+
+int main(int argc, char **argv) {
+  fmc_set_signal_handler(sig_handler);
+
+  TCLAP::CmdLine cmd("counter registry tool", ' ', YTP_VERSION);
+
+  TCLAP::UnlabeledValueArg<std::string> registryArg(
+      "registry", "counter registry path", true, "/path", "registry_path");
+
+  TCLAP::SwitchArg followArg("f", "follow", "output the counters periodically",
+                             false);
+
+  TCLAP::ValueArg<int64_t> intervalArg(
+      "i", "interval", "interval in milliseconds used with follow", false, 1000,
+      "milliseconds");
+
+  cmd.add(registryArg);
+  cmd.add(followArg);
+  cmd.add(intervalArg);
+
+  cmd.parse(argc, argv);
+
+  fmc_error_t *error;
+  auto *registry =
+      fmc_counter_registry_open(registryArg.getValue().c_str(), &error);
+  if (error) {
+    std::cerr << "Unable to open counter registry "
+              << registryArg.getValue() << ": " << fmc_error_msg(error)
+              << std::endl;
+    return -1;
+  }
+
+  std::cout << "pid " << fmc_counter_registry_pid(registry) << std::endl;
+  print_counters(registry);
+  while (followArg.getValue() && run) {
+    std::this_thread::sleep_for(
+        std::chrono::milliseconds(intervalArg.getValue()));
+    std::cout << std::endl;
+    print_counters(registry);
+  }
+
+  fmc_counter_registry_del(registry, &error);
+  return 0;
+}
@@ -10,8 +10,110 @@
 
 #include <tclap/CmdLine.h>
 
+#include <fmc/files.h>
 #include <ytp/version.h>
 
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+
+// Copies whole pages of a closed file into an empty destination. Stream ids
+// are offsets in the file, so the copy is valid without remapping them.
+static bool bulk_copy(const char *src_name, const char *dest_name,
+                      fmc_error_t **error) {
+  fmc_error_clear(error);
+  if (fmc_fexists(dest_name, error)) {
+    fmc_fd fd = fmc_fopen(dest_name, fmc_fmode::READ, error);
+    if (*error) {
+      return false;
+    }
+    size_t sz = fmc_fsize(fd, error);
+    fmc_fclose(fd, error);
+    if (*error || sz != 0) {
+      return false;
+    }
+  }
+  if (*error) {
+    return false;
+  }
+
+  fmc_fd src_fd = fmc_fopen(src_name, fmc_fmode::READ, error);
+  if (*error) {
+    fmc_error_set(error, "Unable to open file %s: %s", src_name,
+                  fmc_error_msg(*error));
+    return false;
+  }
+
+  bool copied = false;
+  fmc_fd dest_fd = -1;
+  size_t copy_sz = 0;
+  fmc_fview_t view;
+  auto *src_yml = ytp_yamal_new_2(src_fd, false, error);
+  if (*error) {
+    goto cleanup_src;
+  }
+  if (!ytp_yamal_closed(src_yml, YTP_STREAM_LIST_DATA, error) || *error) {
+    goto cleanup_yamal;
+  }
+  {
+    size_t page_sz = ytp_yamal_page_size(src_yml);
+    size_t reserved = ytp_yamal_reserved_size(src_yml, error);
+    if (*error) {
+      goto cleanup_yamal;
+    }
+    size_t file_sz = fmc_fsize(src_fd, error);
+    if (*error) {
+      goto cleanup_yamal;
+    }
+    copy_sz =
+        std::min((reserved + page_sz - 1) / page_sz * page_sz, file_sz);
+  }
+
+  dest_fd = fmc_fopen(dest_name, fmc_fmode::READWRITE, error);
+  if (*error) {
+    fmc_error_set(error, "Unable to open file %s: %s", dest_name,
+                  fmc_error_msg(*error));
+    goto cleanup_yamal;
+  }
+  fmc_fcopy(dest_fd, src_fd, 0, copy_sz, error);
+  if (*error) {
+    goto cleanup_dest;
+  }
+
+  // Readers parked on the source are not waiting on the copy
+  fmc_fview_init(&view, sizeof(struct ytp_hdr), dest_fd, 0, error);
+  if (*error) {
+    goto cleanup_dest;
+  }
+  {
+    auto *hdr = (struct ytp_hdr *)fmc_fview_data(&view);
+    hdr->waiters = 0;
+    hdr->notify = 0;
+  }
+  fmc_fview_sync(&view, sizeof(struct ytp_hdr), error);
+  if (!*error) {
+    copied = true;
+  }
+  {
+    fmc_error_t *err;
+    fmc_fview_destroy(&view, sizeof(struct ytp_hdr), &err);
+  }
+
+cleanup_dest : {
+  fmc_error_t *err;
+  fmc_fclose(dest_fd, &err);
+}
+cleanup_yamal : {
+  fmc_error_t *err;
+  ytp_yamal_del(src_yml, &err);
+}
+cleanup_src : {
+  fmc_error_t *err;
+  fmc_fclose(src_fd, &err);
+}
+  return copied;
+}
+
 int main(int argc, char **argv) {
   TCLAP::CmdLine cmd("yamal copy tool", ' ', YTP_VERSION);
 
@@ -48,8 +150,9 @@ int main(int argc, char **argv) {
         stop = stop || max_count-- > 0;
       }
       if (max_size >= 0) {
-        stop = stop ||
-               (size_t)max_size >= ytp_yamal_reserved_size(yamal, error) + sz;
+        // Queued messages are not reserved in the destination yet
+        auto reserved = ytp_yamal_reserved_size(yamal, error);
+        stop = stop || (size_t)max_size >= reserved + pending() + sz;
       }
       return !stop;
     }
@@ -62,23 +165,40 @@ int main(int argc, char **argv) {
 
     ssize_t max_count;
     ssize_t max_size;
+    std::function<size_t()> pending;
     int ret = 0;
     bool stop = false;
   } handler{max_count, max_size};
 
+  if (max_count < 0 && max_size < 0 && !fArg.getValue()) {
+    fmc_error_t *error;
+    if (bulk_copy(src_name.c_str(), dest_name.c_str(), &error)) {
+      return 0;
+    }
+    if (error) {
+      handler.on_error(error);
+      return handler.ret;
+    }
+  }
+
   ann_cl_t ann_cl(handler);
+  handler.pending = [&ann_cl]() { return ann_cl.pending_size(); };
   ann_cl.init(src_name.c_str(), dest_name.c_str());
   while (!handler.stop) {
     fmc_error_t *error;
-    auto polled = ytp_cursor_poll(ann_cl.cursor, &error);
+    auto polled = ytp_cursor_poll_n(ann_cl.cursor, 1024, -1, &error);
     if (error) {
       handler.on_error(error);
       return handler.ret;
     }
-    if (!polled && !fArg.getValue()) {
-      break;
+    if (!polled) {
+      ann_cl.flush();
+      if (!fArg.getValue()) {
+        break;
+      }
     }
   }
+  ann_cl.flush();
 
   return handler.ret;
 }
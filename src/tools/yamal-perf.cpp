@@ -6,409 +6,556 @@
         file, You can obtain one at https://mozilla.org/MPL/2.0/.
  *****************************************************************************/
 
-#define FM_COUNTER_ENABLE
-
-#include <atomic>
-#include <chrono>
-#include <cmath>
-#include <cstring>
 #include <tclap/CmdLine.h>
 
 #include <fmc++/counters.hpp>
-#include <fmc++/ordered_map.hpp>
+#include <fmc++/mpl.hpp>
+#include <fmc++/strings.hpp>
 
-#include <fmc/endianness.h>
+#include <fmc/files.h>
 #include <fmc/process.h>
 #include <fmc/signals.h>
 #include <fmc/time.h>
 
-#include <ytp/sequence.h>
+#include <ytp/cursor.h>
+#include <ytp/data.h>
+#include <ytp/streams.h>
 #include <ytp/version.h>
+#include <ytp/yamal.h>
 
-using namespace std::chrono_literals;
+#include <json/json.hpp>
 
-static std::atomic<bool> run = true;
-static void sig_handler(int s) { run = false; }
-
-struct data_msg {
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define PERF_PEER_PREFIX "yamal-perf/"
+#define PERF_ENCODING "Content-Type application/octet-stream"
+
+struct perf_msg {
   uint64_t seqno;
-  int64_t ts;
-  char payload[];
+  uint64_t writer;
 };
 
-int main(int argc, char **argv) {
-  fmc_set_signal_handler(sig_handler);
-
-  bool is_source = argc > 1 && std::string_view(argv[1]) == "source";
-  bool is_sink = argc > 1 && std::string_view(argv[1]) == "sink";
+struct perf_config {
+  size_t writers;
+  size_t readers;
+  size_t size;
+  size_t streams;
+  size_t page_size;
+};
 
-  if (!is_source && !is_sink) {
-    std::cout << "Use:" << std::endl;
-    std::cout << " " << argv[0] << " source --help" << std::endl;
-    std::cout << " " << argv[0] << " sink --help" << std::endl;
-    return -1;
-  }
+// Results of a benchmark process, kept in memory shared with the parent
+struct perf_proc {
+  int64_t end = 0;
+  uint64_t messages = 0;
+  uint64_t out_of_sequence = 0;
+  int64_t latency_max = 0;
+  fmc::counter::hdr_histogram<> latency;
+};
 
-  TCLAP::CmdLine cmd("ytp performance tester", ' ', YTP_VERSION);
+// Shared by the parent and all the benchmark processes of a run
+struct perf_shared {
+  std::atomic<size_t> ready = 0;
+  std::atomic<bool> go = false;
+  std::atomic<bool> stop = false;
+  int64_t start = 0;
 
-  TCLAP::ValueArg<std::string> fileArg("f", "file",
-                                       is_sink
-                                           ? "ytp file to read the messages"
-                                           : "ytp file to publish the messages",
-                                       true, "", "path");
+  // The results of the processes follow the shared header
+  perf_proc &proc(size_t i) {
+    return reinterpret_cast<perf_proc *>(this + 1)[i];
+  }
+};
 
-  TCLAP::ValueArg<std::string> channelName(
-      "c", "channel", "name of the channel prefix to use", false,
-      "performance_test_channel", "string");
+static std::atomic<bool> run = true;
+static perf_shared *shared = nullptr;
 
-  TCLAP::ValueArg<size_t> channelCount(
-      "k", "count", "number of channels to use", false, 2000, "integer");
+static void sig_handler(int s) {
+  run = false;
+  if (shared) {
+    shared->stop = true;
+  }
+}
 
-  TCLAP::ValueArg<size_t> messagesArg("m", "messages",
-                                      "number of messages to publish", false,
-                                      1000000, "integer");
+static std::vector<size_t> parse_list(const std::string &str,
+                                      std::string_view name) {
+  std::vector<size_t> values;
+  std::istringstream is(str);
+  std::string value;
+  while (std::getline(is, value, ',')) {
+    try {
+      values.push_back(std::stoull(value));
+    } catch (const std::exception &) {
+      fmc_runtime_error_unless(false)
+          << "Invalid value " << value << " in " << name;
+    }
+  }
+  fmc_runtime_error_unless(!values.empty()) << "No values provided for "
+                                            << name;
+  return values;
+}
 
-  TCLAP::ValueArg<size_t> sizeArg(
-      "s", "size", "size of the messages to publish", false, 256, "bytes");
+// Returns the exit status of the process, retries when interrupted by signals
+static int wait_process(pid_t pid) {
+  int status;
+  while (waitpid(pid, &status, 0) < 0) {
+    fmc_runtime_error_unless(errno == EINTR)
+        << "Unable to wait for process " << pid << ": " << strerror(errno);
+  }
+  return status;
+}
 
-  TCLAP::ValueArg<size_t> rateArg("r", "rate",
-                                  "number of messages to publish in one second",
-                                  false, 1000000, "messages");
+// Waits until the parent starts the run, false if it was stopped
+static bool wait_go() {
+  while (!shared->go.load(std::memory_order_acquire)) {
+    if (shared->stop.load(std::memory_order_relaxed)) {
+      return false;
+    }
+    std::this_thread::yield();
+  }
+  return true;
+}
 
-  TCLAP::ValueArg<int64_t> timeArg("i", "interval", "statistics interval in ms",
-                                   false, 1000, "time_ms");
+static void run_writer(const perf_config &cfg, fmc_fd fd, size_t idx,
+                       const std::vector<ytp_mmnode_offs> &streams,
+                       size_t messages, size_t rate) {
+  fmc_error_t *error;
+  auto *yamal =
+      ytp_yamal_new_4(fd, true, YTP_UNCLOSABLE, cfg.page_size, &error);
+  fmc_runtime_error_unless(!error)
+      << "Unable to create the ytp yamal: " << fmc_error_msg(error);
+  fmc::scope_end_call del_yamal([&]() { ytp_yamal_del(yamal, &error); });
+  auto &proc = shared->proc(idx);
+
+  ++shared->ready;
+  if (!wait_go()) {
+    return;
+  }
 
-  TCLAP::ValueArg<int> affinityArg("a", "affinity",
-                                   "set the CPU affinity of the main process",
-                                   false, 0, "cpuid");
+  int64_t start = fmc_cur_time_ns();
+  auto *wstreams = &streams[idx * cfg.streams];
+  for (uint64_t i = 0; i < messages; ++i) {
+    if (rate) {
+      int64_t next = start + int64_t(i * 1000000000ull / rate);
+      while (fmc_cur_time_ns() < next) {
+      }
+    }
+    if (shared->stop.load(std::memory_order_relaxed)) {
+      break;
+    }
+    auto *ptr = ytp_data_reserve(yamal, cfg.size, &error);
+    fmc_runtime_error_unless(!error)
+        << "Unable to reserve: " << fmc_error_msg(error);
+    perf_msg msg{i, idx};
+    memcpy(ptr, &msg, sizeof(msg));
+    ytp_data_commit(yamal, fmc_cur_time_ns(), wstreams[i % cfg.streams], ptr,
+                    &error);
+    fmc_runtime_error_unless(!error)
+        << "Unable to commit: " << fmc_error_msg(error);
+    ++proc.messages;
+  }
+  proc.end = fmc_cur_time_ns();
+}
 
-  TCLAP::ValueArg<int> priorityArg(
-      "x", "priority", "set the priority of the main process (1-99)", false, 1,
-      "priority");
+struct reader_t {
+  ytp_cursor_t *cursor;
+  perf_proc *proc;
+  std::vector<uint64_t> seqnos;
+  size_t announced = 0;
+  fmc_error_t *error = nullptr;
+};
 
-  cmd.add(fileArg);
-  cmd.add(channelName);
-  if (is_source) {
-    cmd.add(messagesArg);
-    cmd.add(sizeArg);
-    cmd.add(rateArg);
+static void reader_on_data(void *closure, uint64_t seqno, int64_t ts,
+                           ytp_mmnode_offs stream, size_t sz,
+                           const char *data) {
+  auto &reader = *static_cast<reader_t *>(closure);
+  auto &proc = *reader.proc;
+  int64_t latency = fmc_cur_time_ns() - ts;
+  perf_msg msg;
+  memcpy(&msg, data, sizeof(msg));
+  if (msg.writer >= reader.seqnos.size() ||
+      msg.seqno != reader.seqnos[msg.writer]++) {
+    ++proc.out_of_sequence;
   }
-  cmd.add(timeArg);
-  cmd.add(affinityArg);
-  cmd.add(priorityArg);
+  proc.latency.sample(latency > 0 ? latency : 0);
+  proc.latency_max = std::max(proc.latency_max, latency);
+  ++proc.messages;
+}
 
-  std::vector<const char *> argv_ex(argc - 1);
-  for (int i = 2; i < argc; ++i) {
-    argv_ex[i - 1] = argv[i];
+// Subscribes to the streams of the writers
+static void reader_on_ann(void *closure, uint64_t seqno,
+                          ytp_mmnode_offs stream, size_t peer_sz,
+                          const char *peer_name, size_t ch_sz,
+                          const char *ch_name, size_t encoding_sz,
+                          const char *encoding_data, bool subscribed) {
+  auto &reader = *static_cast<reader_t *>(closure);
+  if (!fmc::starts_with(std::string_view(peer_name, peer_sz),
+                         PERF_PEER_PREFIX)) {
+    return;
   }
-  std::string new_command = std::string(argv[0]) + " " + std::string(argv[1]);
-  argv_ex[0] = new_command.c_str();
-
-  cmd.parse(argv_ex.size(), argv_ex.data());
-
-  const std::string &filename = fileArg.getValue();
+  ytp_cursor_data_cb(reader.cursor, stream, reader_on_data, &reader,
+                     &reader.error);
+  ++reader.announced;
+}
 
+static void run_reader(const perf_config &cfg, fmc_fd fd, size_t idx,
+                       size_t messages) {
   fmc_error_t *error;
-  auto fd = fmc_fopen(filename.c_str(), fmc_fmode::READWRITE, &error);
-  if (error) {
-    std::cerr << "Unable to open file " << filename << ": "
-              << fmc_error_msg(error) << std::endl;
-    return -1;
+  auto *yamal =
+      ytp_yamal_new_4(fd, false, YTP_UNCLOSABLE, cfg.page_size, &error);
+  fmc_runtime_error_unless(!error)
+      << "Unable to create the ytp yamal: " << fmc_error_msg(error);
+  fmc::scope_end_call del_yamal([&]() { ytp_yamal_del(yamal, &error); });
+  auto *cursor = ytp_cursor_new(yamal, &error);
+  fmc_runtime_error_unless(!error)
+      << "Unable to create the ytp cursor: " << fmc_error_msg(error);
+  fmc::scope_end_call del_cursor([&]() { ytp_cursor_del(cursor, &error); });
+
+  reader_t reader;
+  reader.cursor = cursor;
+  reader.proc = &shared->proc(idx);
+  reader.seqnos.resize(cfg.writers, 0);
+
+  ytp_cursor_ann_cb(cursor, reader_on_ann, &reader, &error);
+  fmc_runtime_error_unless(!error)
+      << "Unable to register callback: " << fmc_error_msg(error);
+
+  // Subscribes to all the streams before the writers start
+  while (reader.announced < cfg.writers * cfg.streams) {
+    if (shared->stop.load(std::memory_order_relaxed)) {
+      return;
+    }
+    ytp_cursor_poll(cursor, &error);
+    fmc_runtime_error_unless(!error && !reader.error)
+        << "Unable to poll: " << fmc_error_msg(error ? error : reader.error);
   }
 
-  auto *seq = ytp_sequence_new(fd, &error);
-  if (error) {
-    std::cerr << "Unable to create the ytp sequence: " << fmc_error_msg(error)
-              << std::endl;
-    return -1;
+  ++shared->ready;
+  if (!wait_go()) {
+    return;
   }
 
-  std::string_view peername = "performance_tester";
-  auto peer =
-      ytp_sequence_peer_decl(seq, peername.size(), peername.data(), &error);
-  if (error) {
-    std::cerr << "Unable to declare the ytp peer: " << fmc_error_msg(error)
-              << std::endl;
-    return -1;
+  size_t expected = cfg.writers * messages;
+  auto &proc = *reader.proc;
+  while (proc.messages < expected) {
+    if (!ytp_cursor_poll(cursor, &error) &&
+        shared->stop.load(std::memory_order_relaxed)) {
+      break;
+    }
+    fmc_runtime_error_unless(!error)
+        << "Unable to poll: " << fmc_error_msg(error);
   }
+  proc.end = fmc_cur_time_ns();
+}
 
-  std::vector<ytp_channel_t> out_channels;
-  std::string_view channelname = channelName.getValue();
-
-  if (is_source) {
-    for (size_t i = 0; i < channelCount.getValue(); ++i) {
-      std::string name;
-      name += channelname;
-      name += '/';
-      name += std::to_string(i);
-      out_channels.push_back(ytp_sequence_ch_decl(
-          seq, peer, fmc_cur_time_ns(), name.size(), name.data(), &error));
-
-      if (error) {
-        std::cerr << "Unable to declare the ytp channel: "
-                  << fmc_error_msg(error) << std::endl;
-        return -1;
-      }
-    }
+static nlohmann::json throughput_json(const perf_config &cfg, size_t begin,
+                                      size_t end) {
+  uint64_t messages = 0;
+  int64_t last = shared->start;
+  for (size_t i = begin; i < end; ++i) {
+    messages += shared->proc(i).messages;
+    last = std::max(last, shared->proc(i).end);
   }
+  double seconds = (last - shared->start) / 1000000000.0;
+  nlohmann::json result = {{"messages", messages}, {"seconds", seconds}};
+  if (seconds > 0) {
+    result["msgs_per_sec"] = messages / seconds;
+    result["mb_per_sec"] = messages * cfg.size / seconds / 1024.0 / 1024.0;
+  }
+  return result;
+}
 
-  if (affinityArg.isSet()) {
-    fmc_error_t *error;
-    auto cur_thread = fmc_tid_cur(&error);
-    if (error) {
-      std::string message;
-      message += "Error getting current thread: ";
-      message += fmc_error_msg(error);
-      std::cerr << message << std::endl;
-      return -1;
-    } else {
-      auto cpuid = affinityArg.getValue();
-      fmc_set_affinity(cur_thread, cpuid, &error);
-      if (error) {
-        std::string message;
-        message += "Error set affinity: ";
-        message += fmc_error_msg(error);
-        std::cerr << message << std::endl;
-        return -1;
-      } else {
-        if (priorityArg.isSet()) {
-          auto priority = priorityArg.getValue();
-          fmc_set_sched_fifo(cur_thread, priority, &error);
-          if (error) {
-            std::string message;
-            message += "Error setting fifo scheduler: ";
-            message += fmc_error_msg(error);
-            std::cerr << message << std::endl;
-            return -1;
-          }
-        }
+static nlohmann::json run_config(const perf_config &cfg, const char *dir,
+                                 size_t messages, size_t rate,
+                                 const std::vector<size_t> &cpus,
+                                 int priority) {
+  fmc_error_t *error;
+  fmc_fd fd;
+  if (dir) {
+    std::string path = std::string(dir) + "/yamal-perf-XXXXXX";
+    fd = fmc_ftemp_2(path.data(), &error);
+  } else {
+    fd = fmc_ftemp(&error);
+  }
+  fmc_runtime_error_unless(!error)
+      << "Unable to create the ytp file: " << fmc_error_msg(error);
+  fmc::scope_end_call close_fd([&]() { fmc_fclose(fd, &error); });
+
+  // Streams are announced before the benchmark processes are started, the
+  // streams of writer w are in streams[w * cfg.streams, (w + 1) * cfg.streams)
+  std::vector<ytp_mmnode_offs> streams;
+  {
+    auto *yamal =
+        ytp_yamal_new_4(fd, false, YTP_UNCLOSABLE, cfg.page_size, &error);
+    fmc_runtime_error_unless(!error)
+        << "Unable to create the ytp yamal: " << fmc_error_msg(error);
+    fmc::scope_end_call del_yamal([&]() { ytp_yamal_del(yamal, &error); });
+    auto *ytp_streams = ytp_streams_new(yamal, &error);
+    fmc_runtime_error_unless(!error)
+        << "Unable to create the ytp streams: " << fmc_error_msg(error);
+    fmc::scope_end_call del_streams(
+        [&]() { ytp_streams_del(ytp_streams, &error); });
+    for (size_t w = 0; w < cfg.writers; ++w) {
+      std::string peer = PERF_PEER_PREFIX + std::to_string(w);
+      for (size_t s = 0; s < cfg.streams; ++s) {
+        std::string channel = std::to_string(s);
+        streams.push_back(ytp_streams_announce(
+            ytp_streams, peer.size(), peer.data(), channel.size(),
+            channel.data(), strlen(PERF_ENCODING), PERF_ENCODING, &error));
+        fmc_runtime_error_unless(!error)
+            << "Unable to announce the stream: " << fmc_error_msg(error);
       }
     }
   }
 
-  auto interval =
-      std::chrono::nanoseconds(std::chrono::milliseconds(timeArg.getValue()))
-          .count();
-
-  if (is_source) {
-    auto sleep_ms = std::chrono::microseconds(0);
-    if (rateArg.isSet()) {
-      auto rate = rateArg.getValue();
-      if (rate <= 0) {
-        std::cerr << "Rate must be non-negative" << std::endl;
-        return -1;
+  size_t nprocs = cfg.writers + cfg.readers;
+  size_t shared_sz = sizeof(perf_shared) + nprocs * sizeof(perf_proc);
+  void *mem = mmap(nullptr, shared_sz, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  fmc_runtime_error_unless(mem != MAP_FAILED)
+      << "Unable to map the shared memory: " << strerror(errno);
+  shared = new (mem) perf_shared();
+  for (size_t i = 0; i < nprocs; ++i) {
+    new (&shared->proc(i)) perf_proc();
+  }
+  fmc::scope_end_call unmap([&]() {
+    for (size_t i = 0; i < nprocs; ++i) {
+      shared->proc(i).~perf_proc();
+    }
+    shared->~perf_shared();
+    shared = nullptr;
+    munmap(mem, shared_sz);
+  });
+
+  std::vector<pid_t> pids;
+  fmc::scope_end_call wait_pids([&]() {
+    shared->stop = true;
+    for (auto pid : pids) {
+      int status;
+      while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
       }
-      sleep_ms = std::chrono::microseconds(
-          std::chrono::microseconds(std::chrono::seconds(1)).count() / rate);
     }
-
-    size_t msg_count = 0;
-    auto msg_size = std::max(sizeArg.getValue(), sizeof(data_msg));
-    std::string payload(msg_size - sizeof(data_msg), '.');
-
-    size_t prev_messages_count = 0;
-    int64_t next_timer = fmc_cur_time_ns();
-
-    uint64_t curr_seqnum = 0;
-    for (ssize_t i = messagesArg.getValue();
-         (!messagesArg.isSet() || --i >= 0) && run;) {
-      std::this_thread::sleep_for(sleep_ms);
-
-      auto *ptr = ytp_sequence_reserve(seq, msg_size, &error);
-      if (error) {
-        std::cerr << "Unable to reserve: " << fmc_error_msg(error) << std::endl;
-        return -1;
+  });
+  std::cout.flush();
+  std::cerr.flush();
+  for (size_t i = 0; i < nprocs; ++i) {
+    pid_t pid = fork();
+    fmc_runtime_error_unless(pid != -1)
+        << "Unable to fork: " << strerror(errno);
+    if (pid) {
+      pids.push_back(pid);
+      continue;
+    }
+    int status = 0;
+    try {
+      if (!cpus.empty()) {
+        fmc_set_cur_affinity(cpus[i % cpus.size()], &error);
+        fmc_runtime_error_unless(!error)
+            << "Unable to set the cpu affinity: " << fmc_error_msg(error);
       }
-
-      auto &msg = *reinterpret_cast<data_msg *>(ptr);
-      msg.seqno = fmc_htobe64(curr_seqnum++);
-      memcpy(msg.payload, payload.data(), payload.size());
-
-      auto now = fmc_cur_time_ns();
-      msg.ts = fmc_htobe64(now);
-      ytp_sequence_commit(seq, peer,
-                          out_channels[msg_count % out_channels.size()], now,
-                          ptr, &error);
-      ++msg_count;
-      if (error) {
-        std::cerr << "Unable to commit: " << fmc_error_msg(error) << std::endl;
-        return -1;
+      if (priority) {
+        fmc_set_sched_fifo(fmc_tid_cur(&error), priority, &error);
+        fmc_runtime_error_unless(!error)
+            << "Unable to set the priority: " << fmc_error_msg(error);
       }
-
-      if (next_timer <= now) {
-        auto timer_delayed = now - next_timer;
-        next_timer = now + interval;
-        std::cout << msg_count - prev_messages_count
-                  << " messages sent in the last "
-                  << std::chrono::duration_cast<std::chrono::milliseconds>(
-                         std::chrono::nanoseconds(timer_delayed + interval))
-                         .count()
-                  << "ms" << std::endl;
-        prev_messages_count = msg_count;
+      if (i < cfg.writers) {
+        run_writer(cfg, fd, i, streams, messages, rate);
+      } else {
+        run_reader(cfg, fd, i, messages);
       }
+    } catch (const std::exception &e) {
+      std::cerr << e.what() << std::endl;
+      shared->stop = true;
+      status = 1;
     }
+    _exit(status);
+  }
 
-    std::cout << msg_count << " messages with a size of " << sizeArg.getValue()
-              << " bytes were published to " << filename << std::endl;
-  } else if (is_sink) {
-
-    struct stats_t {
-      ytp_sequence_t *seq;
-      size_t messages_count_;
-      int64_t first_message_;
-      int64_t last_message_;
-      size_t total_size_;
-      int64_t total_time_;
-      size_t seqnum_;
-      int64_t out_of_sequence_count_ = 0;
-      fmc::counter::precision_sampler buckets_;
-
-      stats_t() { reset(); }
-
-      void reset() {
-        messages_count_ = 0;
-        first_message_ = 0;
-        last_message_ = 0;
-        total_size_ = 0;
-        total_time_ = 0;
-        buckets_.clear();
-      }
-
-      void sample(const char *data_ptr, size_t data_sz, int64_t msg_time) {
-        if (data_sz < sizeof(data_msg)) {
-          return;
-        }
-
-        auto now = fmc_cur_time_ns();
-        auto &msg = *reinterpret_cast<const data_msg *>(data_ptr);
-        // now - time = how long it took from writing to receiving the message
-        int64_t msgseqno = fmc_be64toh(msg.seqno);
-        int64_t msgts = fmc_be64toh(msg.ts);
-        int64_t time_write_read = now - msgts;
+  while (shared->ready < nprocs && !shared->stop) {
+    std::this_thread::yield();
+  }
+  shared->start = fmc_cur_time_ns();
+  shared->go.store(true, std::memory_order_release);
 
-        if (first_message_ == 0) {
-          first_message_ = now;
-        }
-        messages_count_ += 1;
-        last_message_ = now;
-        total_size_ += data_sz;
-        total_time_ += time_write_read;
+  bool failed = false;
+  for (auto pid : pids) {
+    failed = wait_process(pid) != 0 || failed;
+  }
+  pids.clear();
+  fmc_runtime_error_unless(!failed) << "Benchmark process failed";
+
+  fmc::counter::hdr_histogram<> latency;
+  uint64_t out_of_sequence = 0;
+  int64_t latency_max = 0;
+  for (size_t i = cfg.writers; i < nprocs; ++i) {
+    auto &proc = shared->proc(i);
+    latency.merge(proc.latency);
+    out_of_sequence += proc.out_of_sequence;
+    latency_max = std::max(latency_max, proc.latency_max);
+  }
 
-        if (msgseqno == 0) {
-          seqnum_ = 0;
-        }
-        if ((uint64_t)msgseqno != seqnum_++) {
-          ++out_of_sequence_count_;
-        }
+  nlohmann::json result = {
+      {"writers", cfg.writers},
+      {"readers", cfg.readers},
+      {"size", cfg.size},
+      {"streams", cfg.streams},
+      {"page_size", cfg.page_size},
+      {"write", throughput_json(cfg, 0, cfg.writers)},
+      {"read", throughput_json(cfg, cfg.writers, nprocs)},
+  };
+  auto &read = result["read"];
+  read["out_of_sequence"] = out_of_sequence;
+  if (latency.total()) {
+    read["latency_ns"] = {
+        {"p50", latency.percentile(50.0)},
+        {"p90", latency.percentile(90.0)},
+        {"p99", latency.percentile(99.0)},
+        {"p99.9", latency.percentile(99.9)},
+        {"max", latency_max},
+    };
+  }
+  return result;
+}
 
-        buckets_.sample(time_write_read);
-      }
+int main(int argc, char **argv) {
+  try {
+    TCLAP::CmdLine cmd("ytp performance benchmark", ' ', YTP_VERSION);
+
+    TCLAP::ValueArg<std::string> writersArg(
+        "w", "writers", "comma separated numbers of writer processes", false,
+        "1", "counts");
+    cmd.add(writersArg);
+
+    TCLAP::ValueArg<std::string> readersArg(
+        "r", "readers", "comma separated numbers of reader processes", false,
+        "1", "counts");
+    cmd.add(readersArg);
+
+    TCLAP::ValueArg<std::string> sizesArg(
+        "s", "sizes", "comma separated message sizes", false, "256", "bytes");
+    cmd.add(sizesArg);
+
+    TCLAP::ValueArg<std::string> streamsArg(
+        "k", "streams", "comma separated numbers of streams of every writer",
+        false, "1", "counts");
+    cmd.add(streamsArg);
+
+    TCLAP::ValueArg<std::string> pageSizesArg(
+        "p", "page-sizes", "comma separated yamal page sizes", false,
+        std::to_string(YTP_MMLIST_PAGE_SIZE), "bytes");
+    cmd.add(pageSizesArg);
+
+    TCLAP::ValueArg<size_t> messagesArg(
+        "m", "messages", "number of messages published by every writer", false,
+        1000000, "messages");
+    cmd.add(messagesArg);
 
-      void print() {
-        auto experiment_time =
-            std::chrono::nanoseconds(last_message_ - first_message_);
-        auto experiment_time_us =
-            std::chrono::duration_cast<std::chrono::microseconds>(
-                experiment_time);
-
-        // Sum of all messages times (from write to read)
-        auto total_time_ns = std::chrono::nanoseconds(total_time_);
-        auto total_time_us =
-            std::chrono::duration_cast<std::chrono::microseconds>(
-                total_time_ns);
-
-        if (out_of_sequence_count_ > 0) {
-          std::cout << out_of_sequence_count_
-                    << " messages were out of sequence\n";
-        }
+    TCLAP::ValueArg<size_t> rateArg(
+        "t", "rate",
+        "number of messages published by every writer in one second, "
+        "unlimited by default",
+        false, 0, "messages");
+    cmd.add(rateArg);
 
-        if (messages_count_ == 0) {
-          std::cout << "No messages\n";
-        } else if (total_time_us.count() < 10) {
-          std::cout << "Time difference between the first message and the last "
-                       "one was too small\n";
-        } else if (experiment_time_us.count() < 1) {
-          std::cout << "Experiment time was too small\n";
-        } else {
-          std::cout << "Total: " << messages_count_ << " messages, "
-                    << ((double)total_size_) / 1024.0 / 1024.0
-                    << " MB\n"
-
-                       "Experiment time: "
-                    << experiment_time_us.count()
-                    << " microseconds\n"
-
-                       "Total message processing time: "
-                    << total_time_us.count()
-                    << " microseconds\n"
-
-                       "Data rate: "
-                    << ((double)total_size_) * 1000000.0 /
-                           ((double)experiment_time_us.count()) / 1024.0 /
-                           1024.0
-                    << " MB/sec, "
-                    << (messages_count_ * 1000000ll) /
-                           experiment_time_us.count()
-                    << " msgs/sec\n"
-
-                       "Average time for each message: "
-                    << total_time_ns.count() / messages_count_
-                    << " nanoseconds\n";
-
-          std::vector<double> percentiles{25.0, 50.0, 75.0, 90.0,
-                                          95.0, 99.0, 100.0};
-          for (double &percentile : percentiles) {
-            std::cout << percentile
-                      << "% percentile: " << buckets_.percentile(percentile)
-                      << " nanoseconds" << std::endl;
+    TCLAP::ValueArg<std::string> cpusArg(
+        "a", "affinity",
+        "comma separated CPU affinity of the writer processes followed by "
+        "the reader processes",
+        false, "", "cpuids");
+    cmd.add(cpusArg);
+
+    TCLAP::ValueArg<int> priorityArg(
+        "x", "priority", "set the priority of the benchmark processes (1-99)",
+        false, 0, "priority");
+    cmd.add(priorityArg);
+
+    TCLAP::ValueArg<std::string> dirArg(
+        "d", "dir", "directory of the temporary ytp files", false, "", "path");
+    cmd.add(dirArg);
+
+    TCLAP::ValueArg<std::string> outputArg(
+        "o", "output", "JSON results file, standard output by default", false,
+        "", "path");
+    cmd.add(outputArg);
+
+    cmd.parse(argc, argv);
+
+    auto writers = parse_list(writersArg.getValue(), "writers");
+    auto readers = parse_list(readersArg.getValue(), "readers");
+    auto sizes = parse_list(sizesArg.getValue(), "sizes");
+    auto streams = parse_list(streamsArg.getValue(), "streams");
+    auto page_sizes = parse_list(pageSizesArg.getValue(), "page sizes");
+    std::vector<size_t> cpus;
+    if (cpusArg.isSet()) {
+      cpus = parse_list(cpusArg.getValue(), "affinity");
+    }
+    fmc_runtime_error_unless(
+        std::all_of(sizes.begin(), sizes.end(),
+                    [](size_t sz) { return sz >= sizeof(perf_msg); }))
+        << "Message sizes must be at least " << sizeof(perf_msg) << " bytes";
+    fmc_runtime_error_unless(
+        std::all_of(writers.begin(), writers.end(),
+                    [](size_t n) { return n > 0; }) &&
+        std::all_of(streams.begin(), streams.end(),
+                    [](size_t n) { return n > 0; }))
+        << "Writers and streams must be at least 1";
+
+    fmc_set_signal_handler(sig_handler);
+
+    nlohmann::json runs = nlohmann::json::array();
+    for (auto page_size : page_sizes) {
+      for (auto nstreams : streams) {
+        for (auto size : sizes) {
+          for (auto nwriters : writers) {
+            for (auto nreaders : readers) {
+              if (!run) {
+                break;
+              }
+              perf_config cfg{nwriters, nreaders, size, nstreams, page_size};
+              auto result = run_config(
+                  cfg, dirArg.isSet() ? dirArg.getValue().c_str() : nullptr,
+                  messagesArg.getValue(), rateArg.getValue(), cpus,
+                  priorityArg.getValue());
+              if (run) {
+                runs.push_back(std::move(result));
+              }
+            }
           }
         }
       }
-    } closure;
-
-    ytp_sequence_data_cb_t on_message =
-        [](void *closure, ytp_peer_t peer, ytp_channel_t channel,
-           uint64_t msg_time, size_t data_sz, const char *data_ptr) {
-          auto &stats = *reinterpret_cast<stats_t *>(closure);
-          stats.sample(data_ptr, data_sz, msg_time);
-        };
-
-    std::string name;
-    name += channelname;
-    name += '/';
-    ytp_sequence_prfx_cb(seq, name.size(), name.data(), on_message, &closure,
-                         &error);
-    if (error) {
-      std::cerr << "Unable to register callback: " << fmc_error_msg(error)
-                << std::endl;
-      return -1;
     }
 
-    int64_t next_timer = fmc_cur_time_ns();
-
-    while (run) {
-      while (ytp_sequence_poll(seq, &error))
-        ;
-      auto now = fmc_cur_time_ns();
-      if (next_timer <= now) {
-        next_timer = now + interval;
-        closure.print();
-        closure.reset();
-      }
+    nlohmann::json output = {
+        {"version", YTP_VERSION},
+        {"messages", messagesArg.getValue()},
+        {"rate", rateArg.getValue()},
+        {"runs", std::move(runs)},
+    };
+    if (outputArg.isSet()) {
+      std::ofstream file(outputArg.getValue());
+      fmc_runtime_error_unless(file.good())
+          << "Unable to open file " << outputArg.getValue();
+      file << output.dump(2) << std::endl;
+    } else {
+      std::cout << output.dump(2) << std::endl;
     }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
   }
 
-  ytp_sequence_del(seq, &error);
-  if (error) {
-    std::cerr << "Unable to delete the ytp sequence: " << fmc_error_msg(error)
-              << std::endl;
-    return -1;
-  }
-
-  fmc_fclose(fd, &error);
-  if (error) {
-    std::cerr << "Unable to close the file descriptor: " << fmc_error_msg(error)
-              << std::endl;
-    return -1;
-  }
+  return 0;
 }
@@ -13,6 +13,8 @@
 #include <fmc/process.h>
 #include <ytp/version.h>
 
+#include <functional>
+
 int main(int argc, char **argv) {
   TCLAP::CmdLine cmd("yamal copy tool", ' ', YTP_VERSION);
 
@@ -70,8 +72,12 @@ int main(int argc, char **argv) {
                     fmc_error_t **error) {
       if (shift != 0) {
         auto wait_until = ts + shift;
-        while (fmc_cur_time_ns() < wait_until)
-          ;
+        if (fmc_cur_time_ns() < wait_until) {
+          // Publish the pending messages before waiting for this one
+          flush();
+          while (fmc_cur_time_ns() < wait_until)
+            ;
+        }
       } else {
         shift = fmc_cur_time_ns() - ts;
       }
@@ -85,16 +91,18 @@ int main(int argc, char **argv) {
       std::cerr << fmc_error_msg(error) << std::endl;
     }
 
+    std::function<void()> flush;
     int64_t shift = 0;
     int ret = 0;
     bool stop = false;
   } handler;
 
   ann_cl_t ann_cl(handler);
+  handler.flush = [&ann_cl]() { ann_cl.flush(); };
   ann_cl.init(src_name.c_str(), dest_name.c_str());
   while (!handler.stop) {
     fmc_error_t *error;
-    auto polled = ytp_cursor_poll(ann_cl.cursor, &error);
+    auto polled = ytp_cursor_poll_n(ann_cl.cursor, 1024, -1, &error);
     if (error) {
       handler.on_error(error);
       break;
@@ -103,6 +111,7 @@ int main(int argc, char **argv) {
       break;
     }
   }
+  ann_cl.flush();
 
   return handler.ret;
 }
@@ -12,6 +12,7 @@
 #include <fmc/config.h>
 #include <fmc/process.h>
 #include <fmc/reactor.h>
+#include <fmc/reactor_profile.h>
 #include <fmc/signals.h>
 
 #include <fmc++/mpl.hpp>
@@ -21,7 +22,12 @@
 #include <ytp/yamal.h>
 
 #include <json/json.hpp>
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
 #include <set>
+#include <sstream>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -209,6 +215,44 @@ fmc_cfg_node_spec yamal_run_spec[] = {
     },
     {NULL}};
 
+static double stat_avg(const struct fmc_reactor_stat &stat) {
+  return stat.count ? double(stat.total) / stat.count : 0.0;
+}
+
+// Prints the profile of every component, times are in nanoseconds
+static void
+profile_report(std::ostream &os,
+               const std::unordered_map<std::string, fmc_component *> &comps) {
+  double cpn = fmc_reactor_profile_cycles_per_ns(&r);
+  auto ns = [cpn](uint64_t cycles) { return cpn ? cycles / cpn : 0.0; };
+  std::vector<std::pair<size_t, std::string>> order;
+  for (auto &[name, comp] : comps) {
+    order.emplace_back(comp->_ctx->idx, name);
+  }
+  std::sort(order.begin(), order.end());
+  os << std::left << std::setw(24) << "component" << std::right
+     << std::setw(12) << "execs" << std::setw(10) << "p50" << std::setw(10)
+     << "p99" << std::setw(10) << "max" << std::setw(10) << "fanout"
+     << std::setw(10) << "dwell" << std::setw(10) << "dwellmax"
+     << std::setw(10) << "late" << std::setw(10) << "latemax" << '\n';
+  os << std::fixed << std::setprecision(0);
+  for (auto &[idx, name] : order) {
+    auto *p = fmc_reactor_ctx_profile_get(comps.at(name)->_ctx);
+    if (!p) {
+      continue;
+    }
+    os << std::left << std::setw(24) << name << std::right << std::setw(12)
+       << p->execs << std::setw(10)
+       << ns(fmc_reactor_profile_percentile(p, 50.0)) << std::setw(10)
+       << ns(fmc_reactor_profile_percentile(p, 99.0)) << std::setw(10)
+       << ns(p->exec_max) << std::setw(10) << std::setprecision(1)
+       << stat_avg(p->fanout) << std::setprecision(0) << std::setw(10)
+       << stat_avg(p->dwell) << std::setw(10) << p->dwell.max
+       << std::setw(10) << stat_avg(p->lateness) << std::setw(10)
+       << p->lateness.max << '\n';
+  }
+}
+
 int main(int argc, char **argv) {
 
   try {
@@ -260,6 +304,37 @@ int main(int argc, char **argv) {
     TCLAP::SwitchArg jsonSwitch("j", "json", "Use JSON configuration.", false);
     cmd.add(jsonSwitch);
 
+    TCLAP::ValueArg<size_t> threadsArg(
+        "t", "threads", "number of threads used to run the components", false,
+        1, "threads");
+    cmd.add(threadsArg);
+
+    TCLAP::ValueArg<std::string> workersAffinityArg(
+        "w", "workers-affinity",
+        "comma separated CPU affinity of the additional worker threads",
+        false, "", "cpuids");
+    cmd.add(workersAffinityArg);
+
+    TCLAP::ValueArg<int64_t> timerWheelArg(
+        "r", "timer-resolution",
+        "keep scheduled components in a timer wheel with the given resolution "
+        "in nanoseconds",
+        false, 1000, "nanoseconds");
+    cmd.add(timerWheelArg);
+
+    TCLAP::ValueArg<int64_t> busyPollArg(
+        "b", "busy-poll",
+        "block while the components are idle after busy polling for the "
+        "given nanoseconds",
+        false, 0, "nanoseconds");
+    cmd.add(busyPollArg);
+
+    TCLAP::SwitchArg profileSwitch(
+        "P", "profile",
+        "profile the components and report their execution statistics on exit",
+        false);
+    cmd.add(profileSwitch);
+
     cmd.parse(argc, argv);
 
     sys_ptr sys;
@@ -287,7 +362,13 @@ int main(int argc, char **argv) {
         << "Invalid combination of arguments. main section argument must be "
            "provided only when ini config is used.";
 
-    fmc_reactor_init(&r);
+    if (timerWheelArg.isSet()) {
+      fmc_reactor_init_wheel(&r, timerWheelArg.getValue(), &err);
+      fmc_runtime_error_unless(!err)
+          << "Unable to initialize reactor: " << fmc_error_msg(err);
+    } else {
+      fmc_reactor_init(&r);
+    }
 
     std::unordered_map<std::string, fmc_component *> components;
 
@@ -561,11 +642,40 @@ int main(int argc, char **argv) {
       }
     }
 
+    if (threadsArg.getValue() > 1) {
+      std::vector<int> cpus(threadsArg.getValue() - 1, -1);
+      std::istringstream cpuids(workersAffinityArg.getValue());
+      std::string cpuid;
+      for (size_t i = 0; i < cpus.size() && std::getline(cpuids, cpuid, ',');
+           ++i) {
+        cpus[i] = std::stoi(cpuid);
+      }
+      fmc_reactor_threads_set(&r, threadsArg.getValue(), cpus.data(), &err);
+      fmc_runtime_error_unless(!err)
+          << "Unable to start reactor threads: " << fmc_error_msg(err);
+    }
+
+    if (busyPollArg.isSet()) {
+      fmc_reactor_busy_poll_set(&r, busyPollArg.getValue(), &err);
+      fmc_runtime_error_unless(!err)
+          << "Unable to set reactor busy poll: " << fmc_error_msg(err);
+    }
+
+    if (profileSwitch.getValue()) {
+      fmc_reactor_profile_set(&r, true, &err);
+      fmc_runtime_error_unless(!err)
+          << "Unable to enable reactor profiling: " << fmc_error_msg(err);
+    }
+
     fmc_set_signal_handler(sig_handler);
     fmc_reactor_run(&r, !schedArg.getValue(), &err);
     fmc_runtime_error_unless(!err)
         << "Unable to run reactor : " << fmc_error_msg(err);
 
+    if (profileSwitch.getValue()) {
+      profile_report(std::cout, components);
+    }
+
   } catch (const std::exception &e) {
     std::cerr << e.what() << '\n';
     return 1;
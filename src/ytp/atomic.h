@@ -11,8 +11,17 @@
 #include <stdatomic.h>
 
 #define atomic_load_cast(a) atomic_load((_Atomic typeof(*(a)) *)(a))
+#define atomic_store_cast(a, b)                                                \
+  atomic_store((_Atomic typeof(*(a)) *)(a), (b))
 #define atomic_fetch_add_cast(a, b)                                            \
   atomic_fetch_add((_Atomic typeof(*(a)) *)(a), (b))
+#define atomic_exchange_cast(a, b)                                             \
+  atomic_exchange((_Atomic typeof(*(a)) *)(a), (b))
+#define atomic_fetch_sub_cast(a, b)                                            \
+  atomic_fetch_sub((_Atomic typeof(*(a)) *)(a), (b))
+
+#define atomic_compare_exchange_strong_cast(a, e, d)                           \
+  atomic_compare_exchange_strong(((_Atomic typeof(*(a)) *)a), (e), (d))
 
 #define atomic_compare_exchange_weak_check(a, e, d)                            \
   ({                                                                           \
@@ -0,0 +1,757 @@
+/******************************************************************************
+        COPYRIGHT (c) 2019-2023 by Featuremine Corporation.
+
+        This Source Code Form is subject to the terms of the Mozilla Public
+        License, v. 2.0. If a copy of the MPL was not distributed with this
+        file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *****************************************************************************/
+
+#include "atomic.h"
+#include "endianess.h"
+
+#include <fmc/error.h>
+#include <ytp/announcement.h>
+#include <ytp/chain.h>
+#include <ytp/data.h>
+
+#include <uthash/utarray.h>
+#include <uthash/uthash.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#undef utarray_oom
+#define utarray_oom()                                                          \
+  do {                                                                         \
+    fmc_error_set2(error, FMC_ERROR_MEMORY);                                   \
+  } while (0)
+
+#undef uthash_fatal
+#undef HASH_RECORD_OOM
+#define HASH_RECORD_OOM(oomed) fmc_error_set2(error, FMC_ERROR_MEMORY)
+
+// Sidecar messages, offsets are serializable positions as returned by
+// ytp_yamal_tell. Links and heads are updated in place after they are
+// committed.
+struct chain_link_msg_t {
+  ytp_mmnode_offs data;
+  uint64_t seqno;
+  ytp_mmnode_offs stream;
+  ytp_mmnode_offs next;
+};
+
+struct chain_head_msg_t {
+  ytp_mmnode_offs stream;
+  ytp_mmnode_offs first;
+  ytp_mmnode_offs last;
+};
+
+struct chain_builder_item_t {
+  UT_hash_handle hh;
+  ytp_mmnode_offs stream;
+  struct chain_head_msg_t *head;
+  struct chain_link_msg_t *last;
+  ytp_mmnode_offs last_offset;
+};
+
+struct chain_reader_item_t {
+  UT_hash_handle hh;
+  ytp_mmnode_offs stream;
+  UT_array cb_data;
+  ytp_mmnode_offs original;
+  bool resolved;
+  struct chain_head_msg_t *head;
+  // Last link delivered and next link to deliver, if already known
+  struct chain_link_msg_t *last;
+  struct chain_link_msg_t *next;
+};
+
+struct ytp_chain {
+  ytp_yamal_t *yamal;
+  ytp_yamal_t *sidecar;
+
+  bool restored;
+  ytp_iterator_t it_build;
+  struct chain_builder_item_t *builder;
+
+  ytp_iterator_t it_ann;
+  uint64_t ann_processed;
+  UT_array cb_ann;
+
+  ytp_iterator_t it_heads;
+  struct chain_reader_item_t *reader;
+  int cb_locked;
+  bool cb_removed;
+};
+
+static void cb_ann_icd_init(void *elt) {}
+static void cb_ann_icd_copy(void *dst, const void *src) {
+  memcpy(dst, src, sizeof(struct ytp_cursor_ann_cb_cl_t));
+}
+static void cb_ann_icd_dtor(void *elt) {}
+
+static const UT_icd chain_cb_ann_icd = {
+    sizeof(struct ytp_cursor_ann_cb_cl_t),
+    cb_ann_icd_init,
+    cb_ann_icd_copy,
+    cb_ann_icd_dtor,
+};
+
+static void cb_data_icd_init(void *elt) {}
+static void cb_data_icd_copy(void *dst, const void *src) {
+  memcpy(dst, src, sizeof(struct ytp_cursor_data_cb_cl_t));
+}
+static void cb_data_icd_dtor(void *elt) {}
+
+static const UT_icd chain_cb_data_icd = {
+    sizeof(struct ytp_cursor_data_cb_cl_t),
+    cb_data_icd_init,
+    cb_data_icd_copy,
+    cb_data_icd_dtor,
+};
+
+static void *chain_msg_read(ytp_yamal_t *sidecar, ytp_iterator_t iterator,
+                            size_t msg_sz, fmc_error_t **error) {
+  uint64_t seqno;
+  size_t sz;
+  const char *data;
+  ytp_yamal_read(sidecar, iterator, &seqno, &sz, &data, error);
+  if (*error) {
+    return NULL;
+  }
+  if (sz < msg_sz) {
+    fmc_error_set(error, "invalid chain message");
+    return NULL;
+  }
+  return (void *)data;
+}
+
+static void *chain_msg_lookup(ytp_yamal_t *sidecar, ytp_mmnode_offs offset,
+                              size_t msg_sz, fmc_error_t **error) {
+  ytp_iterator_t iterator = ytp_yamal_seek(sidecar, offset, error);
+  if (*error) {
+    return NULL;
+  }
+  return chain_msg_read(sidecar, iterator, msg_sz, error);
+}
+
+ytp_chain_t *ytp_chain_new(ytp_yamal_t *yamal, ytp_yamal_t *sidecar,
+                           fmc_error_t **error) {
+  fmc_error_clear(error);
+  ytp_chain_t *chain = (ytp_chain_t *)malloc(sizeof(ytp_chain_t));
+  if (!chain) {
+    fmc_error_set2(error, FMC_ERROR_MEMORY);
+    return NULL;
+  }
+
+  chain->it_ann = ytp_announcement_begin(yamal, error);
+  if (*error) {
+    free(chain);
+    return NULL;
+  }
+
+  chain->yamal = yamal;
+  chain->sidecar = sidecar;
+  chain->restored = false;
+  chain->it_build = NULL;
+  chain->builder = NULL;
+  chain->ann_processed = 0;
+  utarray_init(&chain->cb_ann, &chain_cb_ann_icd);
+  chain->it_heads = NULL;
+  chain->reader = NULL;
+  chain->cb_locked = 0;
+  chain->cb_removed = false;
+  return chain;
+}
+
+void ytp_chain_del(ytp_chain_t *chain, fmc_error_t **error) {
+  fmc_error_clear(error);
+
+  struct chain_builder_item_t *bitem;
+  struct chain_builder_item_t *btmp;
+  HASH_ITER(hh, chain->builder, bitem, btmp) {
+    HASH_DEL(chain->builder, bitem);
+    free(bitem);
+  }
+
+  struct chain_reader_item_t *ritem;
+  struct chain_reader_item_t *rtmp;
+  HASH_ITER(hh, chain->reader, ritem, rtmp) {
+    HASH_DEL(chain->reader, ritem);
+    utarray_done(&ritem->cb_data);
+    free(ritem);
+  }
+
+  utarray_done(&chain->cb_ann);
+  free(chain);
+}
+
+static struct chain_builder_item_t *
+chain_builder_emplace(ytp_chain_t *chain, ytp_mmnode_offs stream,
+                      fmc_error_t **error) {
+  fmc_error_clear(error);
+  struct chain_builder_item_t *item;
+  HASH_FIND(hh, chain->builder, &stream, sizeof(ytp_mmnode_offs), item);
+  if (item) {
+    return item;
+  }
+
+  item = (struct chain_builder_item_t *)malloc(
+      sizeof(struct chain_builder_item_t));
+  if (!item) {
+    fmc_error_set2(error, FMC_ERROR_MEMORY);
+    return NULL;
+  }
+  item->stream = stream;
+  item->head = NULL;
+  item->last = NULL;
+  item->last_offset = 0;
+  HASH_ADD_KEYPTR(hh, chain->builder, &item->stream, sizeof(ytp_mmnode_offs),
+                  item);
+  if (*error) {
+    free(item);
+    return NULL;
+  }
+  return item;
+}
+
+static void chain_builder_link(struct chain_builder_item_t *item,
+                               struct chain_link_msg_t *link,
+                               ytp_mmnode_offs offset) {
+  if (item->last) {
+    atomic_store_cast(&item->last->next, htoye64(offset));
+  } else {
+    atomic_store_cast(&item->head->first, htoye64(offset));
+  }
+  atomic_store_cast(&item->head->last, htoye64(offset));
+  item->last = link;
+  item->last_offset = offset;
+}
+
+// The builder commits the head of a stream before its first link and
+// finishes linking a message before committing the next one, so only the
+// last link of the sidecar may be missing from its chain
+static void chain_builder_restore(ytp_chain_t *chain, fmc_error_t **error) {
+  ytp_iterator_t it =
+      ytp_yamal_begin(chain->sidecar, YTP_CHAIN_LIST_STREAMS, error);
+  if (*error) {
+    return;
+  }
+  while (!ytp_yamal_term(it)) {
+    struct chain_head_msg_t *head =
+        chain_msg_read(chain->sidecar, it, sizeof(*head), error);
+    if (*error) {
+      return;
+    }
+    struct chain_builder_item_t *item =
+        chain_builder_emplace(chain, ye64toh(head->stream), error);
+    if (*error) {
+      return;
+    }
+    item->head = head;
+
+    // The last link recorded in the head may lag behind
+    ytp_mmnode_offs offset = ye64toh(atomic_load_cast(&head->last));
+    if (offset == 0) {
+      offset = ye64toh(atomic_load_cast(&head->first));
+    }
+    while (offset != 0) {
+      item->last =
+          chain_msg_lookup(chain->sidecar, offset, sizeof(*item->last), error);
+      if (*error) {
+        return;
+      }
+      item->last_offset = offset;
+      offset = ye64toh(atomic_load_cast(&item->last->next));
+    }
+
+    it = ytp_yamal_next(chain->sidecar, it, error);
+    if (*error) {
+      return;
+    }
+  }
+
+  it = ytp_yamal_begin(chain->sidecar, YTP_CHAIN_LIST_LINKS, error);
+  if (*error) {
+    return;
+  }
+  if (ytp_yamal_term(it)) {
+    chain->it_build = ytp_data_begin(chain->yamal, error);
+    return;
+  }
+
+  it = ytp_yamal_end(chain->sidecar, YTP_CHAIN_LIST_LINKS, error);
+  while (!*error && !ytp_yamal_term(it)) {
+    it = ytp_yamal_next(chain->sidecar, it, error);
+  }
+  if (*error) {
+    return;
+  }
+  it = ytp_yamal_prev(chain->sidecar, it, error);
+  if (*error) {
+    return;
+  }
+  struct chain_link_msg_t *link =
+      chain_msg_read(chain->sidecar, it, sizeof(*link), error);
+  if (*error) {
+    return;
+  }
+  ytp_mmnode_offs offset = ytp_yamal_tell(chain->sidecar, it, error);
+  if (*error) {
+    return;
+  }
+
+  struct chain_builder_item_t *item;
+  ytp_mmnode_offs stream = ye64toh(link->stream);
+  HASH_FIND(hh, chain->builder, &stream, sizeof(ytp_mmnode_offs), item);
+  if (!item) {
+    fmc_error_set(error, "invalid chain sidecar");
+    return;
+  }
+  if (item->last_offset != offset) {
+    chain_builder_link(item, link, offset);
+  }
+
+  it = ytp_yamal_seek(chain->yamal, ye64toh(link->data), error);
+  if (*error) {
+    return;
+  }
+  chain->it_build = ytp_yamal_next(chain->yamal, it, error);
+}
+
+size_t ytp_chain_update(ytp_chain_t *chain, size_t max_msgs,
+                        fmc_error_t **error) {
+  fmc_error_clear(error);
+  if (!chain->restored) {
+    chain_builder_restore(chain, error);
+    if (*error) {
+      return 0;
+    }
+    chain->restored = true;
+  }
+
+  size_t count = 0;
+  while (count < max_msgs && !ytp_yamal_term(chain->it_build)) {
+    uint64_t seqno;
+    int64_t ts;
+    ytp_mmnode_offs stream;
+    size_t sz;
+    const char *data;
+    ytp_data_read(chain->yamal, chain->it_build, &seqno, &ts, &stream, &sz,
+                  &data, error);
+    if (*error) {
+      return count;
+    }
+    ytp_mmnode_offs data_offset =
+        ytp_yamal_tell(chain->yamal, chain->it_build, error);
+    if (*error) {
+      return count;
+    }
+
+    struct chain_builder_item_t *item =
+        chain_builder_emplace(chain, stream, error);
+    if (*error) {
+      return count;
+    }
+    if (!item->head) {
+      struct chain_head_msg_t *head = (struct chain_head_msg_t *)
+          ytp_yamal_reserve(chain->sidecar, sizeof(*head), error);
+      if (*error) {
+        return count;
+      }
+      head->stream = htoye64(stream);
+      head->first = 0;
+      head->last = 0;
+      ytp_yamal_commit(chain->sidecar, head, YTP_CHAIN_LIST_STREAMS, error);
+      if (*error) {
+        return count;
+      }
+      item->head = head;
+    }
+
+    struct chain_link_msg_t *link = (struct chain_link_msg_t *)
+        ytp_yamal_reserve(chain->sidecar, sizeof(*link), error);
+    if (*error) {
+      return count;
+    }
+    link->data = htoye64(data_offset);
+    link->seqno = htoye64(seqno);
+    link->stream = htoye64(stream);
+    link->next = 0;
+    ytp_iterator_t it =
+        ytp_yamal_commit(chain->sidecar, link, YTP_CHAIN_LIST_LINKS, error);
+    if (*error) {
+      return count;
+    }
+    ytp_mmnode_offs offset = ytp_yamal_tell(chain->sidecar, it, error);
+    if (*error) {
+      return count;
+    }
+    chain_builder_link(item, link, offset);
+
+    ytp_iterator_t next = ytp_yamal_next(chain->yamal, chain->it_build, error);
+    if (*error) {
+      return count;
+    }
+    chain->it_build = next;
+    ++count;
+  }
+  return count;
+}
+
+void ytp_chain_ann_cb(ytp_chain_t *chain, ytp_cursor_ann_cb_t cb,
+                      void *closure, fmc_error_t **error) {
+  fmc_error_clear(error);
+
+  for (size_t i = utarray_len(&chain->cb_ann); i-- > 0;) {
+    struct ytp_cursor_ann_cb_cl_t *p;
+    p = _utarray_eltptr(&chain->cb_ann, i);
+    if (p->cb == cb && p->cl == closure) {
+      return;
+    }
+  }
+
+  struct ytp_cursor_ann_cb_cl_t cl;
+  cl.cb = cb;
+  cl.cl = closure;
+  utarray_push_back(&chain->cb_ann, &cl);
+}
+
+void ytp_chain_ann_cb_rm(ytp_chain_t *chain, ytp_cursor_ann_cb_t cb,
+                         void *closure, fmc_error_t **error) {
+  fmc_error_clear(error);
+
+  size_t new_size = utarray_len(&chain->cb_ann);
+  for (size_t i = utarray_len(&chain->cb_ann); i-- > 0;) {
+    struct ytp_cursor_ann_cb_cl_t *p;
+    p = _utarray_eltptr(&chain->cb_ann, i);
+    if (p->cb == cb && p->cl == closure) {
+      if (chain->cb_locked == 0) {
+        --new_size;
+        ut_swap(_utarray_eltptr(&chain->cb_ann, i),
+                _utarray_eltptr(&chain->cb_ann, new_size),
+                sizeof(struct ytp_cursor_ann_cb_cl_t));
+      } else {
+        p->cb = NULL;
+        chain->cb_removed = true;
+      }
+    }
+  }
+  utarray_resize(&chain->cb_ann, new_size);
+}
+
+void ytp_chain_data_cb(ytp_chain_t *chain, ytp_mmnode_offs stream,
+                       ytp_cursor_data_cb_t cb, void *closure,
+                       fmc_error_t **error) {
+  fmc_error_clear(error);
+
+  struct chain_reader_item_t *item;
+  HASH_FIND(hh, chain->reader, &stream, sizeof(ytp_mmnode_offs), item);
+  if (!item) {
+    item = (struct chain_reader_item_t *)malloc(
+        sizeof(struct chain_reader_item_t));
+    if (!item) {
+      fmc_error_set2(error, FMC_ERROR_MEMORY);
+      return;
+    }
+    item->stream = stream;
+    item->original = 0;
+    item->resolved = false;
+    item->head = NULL;
+    item->last = NULL;
+    item->next = NULL;
+    HASH_ADD_KEYPTR(hh, chain->reader, &item->stream, sizeof(ytp_mmnode_offs),
+                    item);
+    if (*error) {
+      free(item);
+      return;
+    }
+    utarray_init(&item->cb_data, &chain_cb_data_icd);
+    // Look for the head of the new stream from the beginning
+    chain->it_heads = NULL;
+  }
+
+  for (size_t i = utarray_len(&item->cb_data); i-- > 0;) {
+    struct ytp_cursor_data_cb_cl_t *p;
+    p = _utarray_eltptr(&item->cb_data, i);
+    if (p->cb == cb && p->cl == closure) {
+      return;
+    }
+  }
+
+  struct ytp_cursor_data_cb_cl_t cl;
+  cl.cb = cb;
+  cl.cl = closure;
+  utarray_push_back(&item->cb_data, &cl);
+}
+
+void ytp_chain_data_cb_rm(ytp_chain_t *chain, ytp_mmnode_offs stream,
+                          ytp_cursor_data_cb_t cb, void *closure,
+                          fmc_error_t **error) {
+  fmc_error_clear(error);
+
+  struct chain_reader_item_t *item;
+  HASH_FIND(hh, chain->reader, &stream, sizeof(ytp_mmnode_offs), item);
+  if (!item) {
+    return;
+  }
+
+  size_t new_size = utarray_len(&item->cb_data);
+  for (size_t i = utarray_len(&item->cb_data); i-- > 0;) {
+    struct ytp_cursor_data_cb_cl_t *p;
+    p = _utarray_eltptr(&item->cb_data, i);
+    if (p->cb == cb && p->cl == closure) {
+      if (chain->cb_locked == 0) {
+        --new_size;
+        ut_swap(_utarray_eltptr(&item->cb_data, i),
+                _utarray_eltptr(&item->cb_data, new_size),
+                sizeof(struct ytp_cursor_data_cb_cl_t));
+      } else {
+        p->cb = NULL;
+        chain->cb_removed = true;
+      }
+    }
+  }
+  utarray_resize(&item->cb_data, new_size);
+}
+
+static void chain_reader_heads(ytp_chain_t *chain, fmc_error_t **error) {
+  if (!chain->it_heads) {
+    chain->it_heads =
+        ytp_yamal_begin(chain->sidecar, YTP_CHAIN_LIST_STREAMS, error);
+    if (*error) {
+      return;
+    }
+  }
+  while (!ytp_yamal_term(chain->it_heads)) {
+    struct chain_head_msg_t *head =
+        chain_msg_read(chain->sidecar, chain->it_heads, sizeof(*head), error);
+    if (*error) {
+      return;
+    }
+    struct chain_reader_item_t *item;
+    ytp_mmnode_offs stream = ye64toh(head->stream);
+    HASH_FIND(hh, chain->reader, &stream, sizeof(ytp_mmnode_offs), item);
+    if (item && !item->head) {
+      item->head = head;
+    }
+    ytp_iterator_t next =
+        ytp_yamal_next(chain->sidecar, chain->it_heads, error);
+    if (*error) {
+      return;
+    }
+    chain->it_heads = next;
+  }
+}
+
+static struct chain_link_msg_t *
+chain_reader_next(ytp_chain_t *chain, struct chain_reader_item_t *item,
+                  fmc_error_t **error) {
+  if (item->next || !item->head) {
+    return item->next;
+  }
+  ytp_mmnode_offs offset = ye64toh(atomic_load_cast(
+      item->last ? &item->last->next : &item->head->first));
+  if (offset != 0) {
+    item->next =
+        chain_msg_lookup(chain->sidecar, offset, sizeof(*item->next), error);
+  }
+  return item->next;
+}
+
+// Every message before the one found was linked before it was committed,
+// so only the streams that had no pending link when they were checked may
+// have an earlier message by the time the scan is over
+static struct chain_reader_item_t *chain_reader_min(ytp_chain_t *chain,
+                                                    fmc_error_t **error) {
+  chain_reader_heads(chain, error);
+  if (*error) {
+    return NULL;
+  }
+
+  struct chain_reader_item_t *min = NULL;
+  uint64_t min_seqno = 0;
+  bool missing = false;
+  for (struct chain_reader_item_t *item = chain->reader; item;
+       item = (struct chain_reader_item_t *)item->hh.next) {
+    struct chain_link_msg_t *link = chain_reader_next(chain, item, error);
+    if (*error) {
+      return NULL;
+    }
+    if (!link) {
+      missing = true;
+    } else if (!min || ye64toh(link->seqno) < min_seqno) {
+      min = item;
+      min_seqno = ye64toh(link->seqno);
+    }
+  }
+  if (!min || !missing) {
+    return min;
+  }
+
+  chain_reader_heads(chain, error);
+  if (*error) {
+    return NULL;
+  }
+  for (struct chain_reader_item_t *item = chain->reader; item;
+       item = (struct chain_reader_item_t *)item->hh.next) {
+    if (item->next) {
+      continue;
+    }
+    struct chain_link_msg_t *link = chain_reader_next(chain, item, error);
+    if (*error) {
+      return NULL;
+    }
+    if (link && ye64toh(link->seqno) < min_seqno) {
+      min = item;
+      min_seqno = ye64toh(link->seqno);
+    }
+  }
+  return min;
+}
+
+static void chain_cb_release(ytp_chain_t *chain, fmc_error_t **error) {
+  if (--chain->cb_locked != 0 || !chain->cb_removed) {
+    return;
+  }
+  chain->cb_removed = false;
+
+  size_t new_size = utarray_len(&chain->cb_ann);
+  for (size_t i = utarray_len(&chain->cb_ann); i-- > 0;) {
+    struct ytp_cursor_ann_cb_cl_t *p;
+    p = _utarray_eltptr(&chain->cb_ann, i);
+    if (p->cb == NULL) {
+      --new_size;
+      ut_swap(_utarray_eltptr(&chain->cb_ann, i),
+              _utarray_eltptr(&chain->cb_ann, new_size),
+              sizeof(struct ytp_cursor_ann_cb_cl_t));
+    }
+  }
+  utarray_resize(&chain->cb_ann, new_size);
+
+  for (struct chain_reader_item_t *item = chain->reader; item;
+       item = (struct chain_reader_item_t *)item->hh.next) {
+    new_size = utarray_len(&item->cb_data);
+    for (size_t i = utarray_len(&item->cb_data); i-- > 0;) {
+      struct ytp_cursor_data_cb_cl_t *p;
+      p = _utarray_eltptr(&item->cb_data, i);
+      if (p->cb == NULL) {
+        --new_size;
+        ut_swap(_utarray_eltptr(&item->cb_data, i),
+                _utarray_eltptr(&item->cb_data, new_size),
+                sizeof(struct ytp_cursor_data_cb_cl_t));
+      }
+    }
+    utarray_resize(&item->cb_data, new_size);
+  }
+}
+
+static bool chain_poll_ann(ytp_chain_t *chain, fmc_error_t **error) {
+  uint64_t seqno;
+  ytp_mmnode_offs stream;
+  size_t psz;
+  const char *peer;
+  size_t csz;
+  const char *channel;
+  size_t esz;
+  const char *encoding;
+  ytp_mmnode_offs *original_ptr;
+  ytp_mmnode_offs *subscribed_ptr;
+  bool polled = ytp_announcement_next(
+      chain->yamal, &chain->it_ann, &seqno, &stream, &psz, &peer, &csz,
+      &channel, &esz, &encoding, &original_ptr, &subscribed_ptr, error);
+  if (*error || !polled) {
+    return false;
+  }
+
+  chain->ann_processed = seqno;
+
+  ytp_mmnode_offs original = atomic_load_cast(original_ptr);
+  ytp_mmnode_offs subscribed = atomic_load_cast(subscribed_ptr);
+  for (size_t i = utarray_len(&chain->cb_ann); i-- > 0;) {
+    struct ytp_cursor_ann_cb_cl_t *p;
+    p = _utarray_eltptr(&chain->cb_ann, i);
+    if (p->cb == NULL) {
+      continue;
+    }
+    p->cb(p->cl, seqno, original, psz, peer, csz, channel, esz, encoding,
+          subscribed != 0);
+  }
+  return true;
+}
+
+static bool chain_poll_data(ytp_chain_t *chain, fmc_error_t **error) {
+  struct chain_reader_item_t *min = chain_reader_min(chain, error);
+  if (*error || !min) {
+    return false;
+  }
+
+  struct chain_link_msg_t *link = min->next;
+  ytp_iterator_t it = ytp_yamal_seek(chain->yamal, ye64toh(link->data), error);
+  if (*error) {
+    return false;
+  }
+  uint64_t seqno;
+  int64_t ts;
+  ytp_mmnode_offs stream;
+  size_t sz;
+  const char *data;
+  ytp_data_read(chain->yamal, it, &seqno, &ts, &stream, &sz, &data, error);
+  if (*error) {
+    return false;
+  }
+
+  // Streams are delivered with the id of their original announcement, once
+  // the announcement has been delivered, same as ytp_cursor_t
+  if (!min->resolved) {
+    uint64_t stream_seqno;
+    size_t psz;
+    const char *peer;
+    size_t csz;
+    const char *channel;
+    size_t esz;
+    const char *encoding;
+    ytp_mmnode_offs *original;
+    ytp_mmnode_offs *subscribed;
+    ytp_announcement_lookup(chain->yamal, stream, &stream_seqno, &psz, &peer,
+                            &csz, &channel, &esz, &encoding, &original,
+                            &subscribed, error);
+    if (*error) {
+      return false;
+    }
+    if (chain->ann_processed < stream_seqno) {
+      bool polled = chain_poll_ann(chain, error);
+      if (!*error && !polled) {
+        fmc_error_set(error, "data message is using an invalid stream id");
+      }
+      return polled;
+    }
+    min->original = atomic_load_cast(original);
+    min->resolved = true;
+  }
+
+  min->last = link;
+  min->next = NULL;
+
+  for (size_t i = utarray_len(&min->cb_data); i-- > 0;) {
+    struct ytp_cursor_data_cb_cl_t *p;
+    p = _utarray_eltptr(&min->cb_data, i);
+    if (p->cb == NULL) {
+      continue;
+    }
+    p->cb(p->cl, seqno, ts, min->original, sz, data);
+  }
+  return true;
+}
+
+bool ytp_chain_poll(ytp_chain_t *chain, fmc_error_t **error) {
+  fmc_error_clear(error);
+
+  ++chain->cb_locked;
+  bool polled = chain_poll_ann(chain, error);
+  if (!*error && !polled) {
+    polled = chain_poll_data(chain, error);
+  }
+  chain_cb_release(chain, error);
+  return polled;
+}
@@ -8,17 +8,23 @@
 
 #include "cursor.h"
 #include "atomic.h"
+#include "endianess.h"
+#include "segment.h"
 
 #include <fmc/alignment.h>
+#include <fmc/time.h>
 #include <ytp/cursor.h>
 #include <ytp/data.h>
+#include <ytp/index.h>
 #include <ytp/streams.h>
 #include <ytp/subscription.h>
 
 #include <uthash/utarray.h>
 #include <uthash/uthash.h>
 
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #undef utarray_oom
 #define utarray_oom()                                                          \
@@ -56,6 +62,13 @@ const UT_icd cb_data_icd = {
     cb_data_icd_dtor,
 };
 
+const UT_icd time_index_icd = {
+    sizeof(struct ytp_cursor_time_index_entry_t),
+    NULL,
+    NULL,
+    NULL,
+};
+
 static unsigned streams_data_hash(ytp_mmnode_offs key) {
   unsigned ret;
   HASH_VALUE(&key, sizeof(ytp_mmnode_offs), ret);
@@ -110,7 +123,9 @@ streams_data_emplace(struct ytp_cursor_streams_data_item_t **m,
     }
 
     utarray_init(&item->cb_data, &cb_data_icd);
-    item->cb_data_locked = 0;
+    item->original = 0;
+    item->resolved = false;
+    item->announced = false;
   }
   return item;
 }
@@ -152,15 +167,25 @@ void ytp_cursor_init(ytp_cursor_t *cursor, ytp_yamal_t *yamal,
     return;
   }
 
+  cursor->it_idx = ytp_index_begin(yamal, error);
+  if (*error) {
+    return;
+  }
+
   cursor->ann_processed = 0;
   utarray_init(&cursor->cb_ann, &cb_ann_icd);
+  utarray_init(&cursor->time_index, &time_index_icd);
+  cursor->cb_locked = 0;
+  cursor->cb_removed = false;
   cursor->cb_data = NULL;
+  cursor->segment = NULL;
   cursor->yamal = yamal;
 }
 
 void ytp_cursor_destroy(ytp_cursor_t *cursor, fmc_error_t **error) {
   fmc_error_clear(error);
   utarray_done(&cursor->cb_ann);
+  utarray_done(&cursor->time_index);
 
   struct ytp_cursor_streams_data_item_t *item;
   struct ytp_cursor_streams_data_item_t *tmp;
@@ -169,6 +194,12 @@ void ytp_cursor_destroy(ytp_cursor_t *cursor, fmc_error_t **error) {
     utarray_done(&item->cb_data);
     free(item);
   }
+
+  if (cursor->segment) {
+    ytp_cursor_segment_close(cursor->segment);
+    free(cursor->segment);
+    cursor->segment = NULL;
+  }
 }
 
 void ytp_cursor_ann_cb(ytp_cursor_t *cursor, ytp_cursor_ann_cb_t cb,
@@ -200,13 +231,14 @@ void ytp_cursor_ann_cb_rm(ytp_cursor_t *cursor, ytp_cursor_ann_cb_t cb,
   for (size_t i = utarray_len(&cursor->cb_ann); i-- > 0;) {
     p = _utarray_eltptr(&cursor->cb_ann, i);
     if (p->cb == cb && p->cl == closure) {
-      if (cursor->cb_ann_locked == 0) {
+      if (cursor->cb_locked == 0) {
         --new_size;
         ut_swap(_utarray_eltptr(&cursor->cb_ann, i),
                 _utarray_eltptr(&cursor->cb_ann, new_size),
                 sizeof(struct ytp_cursor_ann_cb_cl_t));
       } else {
         p->cb = NULL;
+        cursor->cb_removed = true;
       }
     }
   }
@@ -263,19 +295,23 @@ void ytp_cursor_data_cb_rm(ytp_cursor_t *cursor, ytp_mmnode_offs stream,
 
   struct ytp_cursor_streams_data_item_t *map_item =
       streams_data_get(cursor->cb_data, stream);
+  if (map_item == NULL) {
+    return;
+  }
 
   struct ytp_cursor_data_cb_cl_t *p;
   size_t new_size = utarray_len(&map_item->cb_data);
   for (size_t i = utarray_len(&map_item->cb_data); i-- > 0;) {
     p = _utarray_eltptr(&map_item->cb_data, i);
     if (p->cb == cb && p->cl == closure) {
-      if (map_item->cb_data_locked == 0) {
+      if (cursor->cb_locked == 0) {
         --new_size;
         ut_swap(_utarray_eltptr(&map_item->cb_data, i),
                 _utarray_eltptr(&map_item->cb_data, new_size),
-                sizeof(struct ytp_cursor_ann_cb_cl_t));
+                sizeof(struct ytp_cursor_data_cb_cl_t));
       } else {
         p->cb = NULL;
+        cursor->cb_removed = true;
       }
     }
   }
@@ -309,7 +345,25 @@ static bool ytp_cursor_poll_ann(ytp_cursor_t *cursor, fmc_error_t **error) {
   ytp_mmnode_offs original = atomic_load_cast(original_ptr);
   ytp_mmnode_offs subscribed = atomic_load_cast(subscribed_ptr);
 
-  ++cursor->cb_ann_locked;
+  if (cursor->segment) {
+    original = ytp_segment_stream_global(&cursor->segment->streams,
+                                         cursor->segment->base, original,
+                                         error);
+    if (*error) {
+      return false;
+    }
+    struct ytp_cursor_streams_data_item_t *map_item =
+        streams_data_emplace(&cursor->cb_data, original, error);
+    if (*error) {
+      return false;
+    }
+    // Announced again by the writer of a later segment
+    if (map_item->announced) {
+      return true;
+    }
+    map_item->announced = true;
+  }
+
   for (size_t i = utarray_len(&cursor->cb_ann); i-- > 0;) {
     struct ytp_cursor_ann_cb_cl_t *p;
     p = _utarray_eltptr(&cursor->cb_ann, i);
@@ -319,32 +373,11 @@ static bool ytp_cursor_poll_ann(ytp_cursor_t *cursor, fmc_error_t **error) {
     p->cb(p->cl, seqno, original, psz, peer, csz, channel, esz, encoding,
           subscribed != 0);
   }
-  if (--cursor->cb_ann_locked == 0) {
-    size_t new_size = utarray_len(&cursor->cb_ann);
-    for (size_t i = utarray_len(&cursor->cb_ann); i-- > 0;) {
-      struct ytp_cursor_ann_cb_cl_t *p;
-      p = _utarray_eltptr(&cursor->cb_ann, i);
-      if (p->cb == NULL) {
-        --new_size;
-        ut_swap(_utarray_eltptr(&cursor->cb_ann, i),
-                _utarray_eltptr(&cursor->cb_ann, new_size),
-                sizeof(struct ytp_cursor_ann_cb_cl_t));
-      }
-    }
-    utarray_resize(&cursor->cb_ann, new_size);
-  }
 
   return true;
 }
 
-bool ytp_cursor_poll(ytp_cursor_t *cursor, fmc_error_t **error) {
-  {
-    bool polled = ytp_cursor_poll_ann(cursor, error);
-    if (polled || *error) {
-      return polled;
-    }
-  }
-
+static bool ytp_cursor_poll_data(ytp_cursor_t *cursor, fmc_error_t **error) {
   if (ytp_yamal_term(cursor->it_data)) {
     return false;
   }
@@ -360,53 +393,55 @@ bool ytp_cursor_poll(ytp_cursor_t *cursor, fmc_error_t **error) {
     return false;
   }
 
-  uint64_t stream_seqno;
-  size_t psz;
-  const char *peer;
-  size_t csz;
-  const char *channel;
-  size_t esz;
-  const char *encoding;
-  ytp_mmnode_offs *original;
-  ytp_mmnode_offs *subscribed;
-  ytp_announcement_lookup(cursor->yamal, stream, &stream_seqno, &psz, &peer,
-                          &csz, &channel, &esz, &encoding, &original,
-                          &subscribed, error);
-  if (cursor->ann_processed < stream_seqno) {
-    bool polled = ytp_cursor_poll_ann(cursor, error);
-    if (!*error && !polled) {
-      fmc_error_set(error, "data message is using an invalid stream id");
+  ytp_mmnode_offs key = stream;
+  if (cursor->segment) {
+    key = ytp_segment_stream_global(&cursor->segment->streams,
+                                    cursor->segment->base, stream, error);
+    if (*error) {
+      return false;
     }
-    return polled;
   }
 
   struct ytp_cursor_streams_data_item_t *map_item =
-      streams_data_get(cursor->cb_data, stream);
+      streams_data_emplace(&cursor->cb_data, key, error);
+  if (*error) {
+    return false;
+  }
 
-  if (map_item != NULL) {
-    ++map_item->cb_data_locked;
-    for (size_t i = utarray_len(&map_item->cb_data); i-- > 0;) {
-      struct ytp_cursor_data_cb_cl_t *p;
-      p = _utarray_eltptr(&map_item->cb_data, i);
-      if (p->cb == NULL) {
-        continue;
+  if (!map_item->resolved) {
+    uint64_t stream_seqno;
+    size_t psz;
+    const char *peer;
+    size_t csz;
+    const char *channel;
+    size_t esz;
+    const char *encoding;
+    ytp_mmnode_offs *original;
+    ytp_mmnode_offs *subscribed;
+    ytp_announcement_lookup(cursor->yamal, stream, &stream_seqno, &psz, &peer,
+                            &csz, &channel, &esz, &encoding, &original,
+                            &subscribed, error);
+    if (*error) {
+      return false;
+    }
+    if (cursor->ann_processed < stream_seqno) {
+      bool polled = ytp_cursor_poll_ann(cursor, error);
+      if (!*error && !polled) {
+        fmc_error_set(error, "data message is using an invalid stream id");
       }
-      p->cb(p->cl, seqno, ts, *original, sz, data);
+      return polled;
     }
-    if (--map_item->cb_data_locked == 0) {
-      size_t new_size = utarray_len(&map_item->cb_data);
-      for (size_t i = utarray_len(&map_item->cb_data); i-- > 0;) {
-        struct ytp_cursor_data_cb_cl_t *p;
-        p = _utarray_eltptr(&map_item->cb_data, i);
-        if (p->cb == NULL) {
-          --new_size;
-          ut_swap(_utarray_eltptr(&map_item->cb_data, i),
-                  _utarray_eltptr(&map_item->cb_data, new_size),
-                  sizeof(struct ytp_cursor_data_cb_cl_t));
-        }
+
+    map_item->original = atomic_load_cast(original);
+    if (cursor->segment) {
+      map_item->original = ytp_segment_stream_global(
+          &cursor->segment->streams, cursor->segment->base,
+          map_item->original, error);
+      if (*error) {
+        return false;
       }
-      utarray_resize(&map_item->cb_data, new_size);
     }
+    map_item->resolved = true;
   }
 
   ytp_iterator_t next_it =
@@ -414,11 +449,170 @@ bool ytp_cursor_poll(ytp_cursor_t *cursor, fmc_error_t **error) {
   if (*error) {
     return false;
   }
+  ytp_yamal_prefetch(cursor->yamal, next_it);
+
+  for (size_t i = utarray_len(&map_item->cb_data); i-- > 0;) {
+    struct ytp_cursor_data_cb_cl_t *p;
+    p = _utarray_eltptr(&map_item->cb_data, i);
+    if (p->cb == NULL) {
+      continue;
+    }
+    p->cb(p->cl, seqno, ts, map_item->original, sz, data);
+  }
 
   cursor->it_data = next_it;
   return true;
 }
 
+// Moves to the next segment once the current one is closed and consumed
+static bool ytp_cursor_segment_next(ytp_cursor_t *cursor,
+                                    fmc_error_t **error) {
+  struct ytp_cursor_segment_t *segment = cursor->segment;
+  bool closed = ytp_yamal_closed(cursor->yamal, YTP_STREAM_LIST_DATA, error);
+  if (*error || !closed) {
+    return false;
+  }
+
+  ytp_mmnode_offs base;
+  char *path;
+  ytp_segment_records_load(cursor->yamal, segment->path, &base, NULL, &path,
+                           error);
+  if (*error || !path) {
+    return false;
+  }
+  bool exists = fmc_fexists(path, error);
+  if (*error || !exists) {
+    free(path);
+    return false;
+  }
+
+  struct ytp_cursor_segment_t next;
+  ytp_cursor_segment_open(&next, path, error);
+  free(path);
+  if (*error) {
+    return false;
+  }
+  ytp_iterator_t it_data = ytp_data_begin(next.yamal, error);
+  if (*error) {
+    goto cleanup;
+  }
+  ytp_iterator_t it_ann = ytp_announcement_begin(next.yamal, error);
+  if (*error) {
+    goto cleanup;
+  }
+  ytp_iterator_t it_idx = ytp_index_begin(next.yamal, error);
+  if (*error) {
+    goto cleanup;
+  }
+
+  ytp_cursor_segment_close(segment);
+  *segment = next;
+  cursor->yamal = next.yamal;
+  cursor->it_data = it_data;
+  cursor->it_ann = it_ann;
+  cursor->it_idx = it_idx;
+  cursor->ann_processed = 0;
+  utarray_clear(&cursor->time_index);
+
+  struct ytp_cursor_streams_data_item_t *map_item;
+  struct ytp_cursor_streams_data_item_t *tmp;
+  HASH_ITER(hh, cursor->cb_data, map_item, tmp) {
+    map_item->resolved = false;
+  }
+  return true;
+
+cleanup:
+  ytp_cursor_segment_close(&next);
+  return false;
+}
+
+static bool ytp_cursor_poll_one(ytp_cursor_t *cursor, fmc_error_t **error) {
+  bool polled = ytp_cursor_poll_ann(cursor, error);
+  if (polled || *error) {
+    return polled;
+  }
+  polled = ytp_cursor_poll_data(cursor, error);
+  if (polled || *error || !cursor->segment) {
+    return polled;
+  }
+  if (ytp_cursor_segment_next(cursor, error)) {
+    return ytp_cursor_poll_one(cursor, error);
+  }
+  return false;
+}
+
+static void ytp_cursor_cb_release(ytp_cursor_t *cursor, fmc_error_t **error) {
+  if (--cursor->cb_locked != 0 || !cursor->cb_removed) {
+    return;
+  }
+  cursor->cb_removed = false;
+
+  size_t new_size = utarray_len(&cursor->cb_ann);
+  for (size_t i = utarray_len(&cursor->cb_ann); i-- > 0;) {
+    struct ytp_cursor_ann_cb_cl_t *p;
+    p = _utarray_eltptr(&cursor->cb_ann, i);
+    if (p->cb == NULL) {
+      --new_size;
+      ut_swap(_utarray_eltptr(&cursor->cb_ann, i),
+              _utarray_eltptr(&cursor->cb_ann, new_size),
+              sizeof(struct ytp_cursor_ann_cb_cl_t));
+    }
+  }
+  utarray_resize(&cursor->cb_ann, new_size);
+
+  struct ytp_cursor_streams_data_item_t *map_item;
+  struct ytp_cursor_streams_data_item_t *tmp;
+  HASH_ITER(hh, cursor->cb_data, map_item, tmp) {
+    new_size = utarray_len(&map_item->cb_data);
+    for (size_t i = utarray_len(&map_item->cb_data); i-- > 0;) {
+      struct ytp_cursor_data_cb_cl_t *p;
+      p = _utarray_eltptr(&map_item->cb_data, i);
+      if (p->cb == NULL) {
+        --new_size;
+        ut_swap(_utarray_eltptr(&map_item->cb_data, i),
+                _utarray_eltptr(&map_item->cb_data, new_size),
+                sizeof(struct ytp_cursor_data_cb_cl_t));
+      }
+    }
+    utarray_resize(&map_item->cb_data, new_size);
+  }
+}
+
+bool ytp_cursor_poll_announcement(ytp_cursor_t *cursor, fmc_error_t **error) {
+  ++cursor->cb_locked;
+  bool polled = ytp_cursor_poll_ann(cursor, error);
+  ytp_cursor_cb_release(cursor, error);
+  return polled;
+}
+
+bool ytp_cursor_poll(ytp_cursor_t *cursor, fmc_error_t **error) {
+  ++cursor->cb_locked;
+  bool polled = ytp_cursor_poll_one(cursor, error);
+  ytp_cursor_cb_release(cursor, error);
+  return polled;
+}
+
+size_t ytp_cursor_poll_n(ytp_cursor_t *cursor, size_t max_msgs, int64_t max_ns,
+                         fmc_error_t **error) {
+  fmc_error_clear(error);
+  int64_t deadline = 0;
+  if (max_ns >= 0) {
+    int64_t now = fmc_cur_time_ns();
+    deadline = max_ns < INT64_MAX - now ? now + max_ns : INT64_MAX;
+  }
+
+  size_t count = 0;
+  ++cursor->cb_locked;
+  while (count < max_msgs && ytp_cursor_poll_one(cursor, error)) {
+    ++count;
+    if (max_ns >= 0 && fmc_cur_time_ns() >= deadline) {
+      break;
+    }
+  }
+  ytp_cursor_cb_release(cursor, error);
+  return count;
+}
+
 struct rollback_history_t {
   UT_array *arr;
   size_t old_sz;
@@ -436,14 +630,31 @@ bool ytp_cursor_consume(ytp_cursor_t *dest, ytp_cursor_t *src,
   size_t old_ann_sz = utarray_len(&dest->cb_ann);
   size_t new_ann_sz = old_ann_sz + src_ann_sz;
 
-  struct rollback_history_t rollback_history[HASH_CNT(hh, src->cb_data)];
-  memset(rollback_history, 0, sizeof(rollback_history));
-
-  struct rollback_history_t *h = &rollback_history[0];
-
+  // Items are cached for every stream read, only the ones with callbacks are
+  // moved and need a rollback entry
   struct ytp_cursor_streams_data_item_t *map_item;
   struct ytp_cursor_streams_data_item_t *tmp;
+  size_t cb_items = 0;
   HASH_ITER(hh, src->cb_data, map_item, tmp) {
+    cb_items += utarray_len(&map_item->cb_data) != 0;
+  }
+
+  struct rollback_history_t *rollback_history = NULL;
+  if (cb_items != 0) {
+    rollback_history = (struct rollback_history_t *)malloc(
+        cb_items * sizeof(struct rollback_history_t));
+    if (!rollback_history) {
+      fmc_error_set2(error, FMC_ERROR_MEMORY);
+      return false;
+    }
+  }
+
+  struct rollback_history_t *h = rollback_history;
+
+  HASH_ITER(hh, src->cb_data, map_item, tmp) {
+    if (utarray_len(&map_item->cb_data) == 0) {
+      continue;
+    }
     struct ytp_cursor_streams_data_item_t *dest_map_item = streams_data_emplace(
         &dest->cb_data, (*(ytp_mmnode_offs *)map_item->hh.key), error);
     if (*error) {
@@ -502,18 +713,19 @@ bool ytp_cursor_consume(ytp_cursor_t *dest, ytp_cursor_t *src,
       continue;
     }
 
-    if (map_item->cb_data_locked == 0) {
+    if (src->cb_locked == 0) {
       utarray_clear(&map_item->cb_data);
     } else {
       for (size_t i = 0; i < utarray_len(&map_item->cb_data); ++i) {
-        struct ytp_cursor_ann_cb_cl_t *s;
+        struct ytp_cursor_data_cb_cl_t *s;
         s = _utarray_eltptr(&map_item->cb_data, i);
         s->cb = NULL;
       }
+      src->cb_removed = true;
     }
   }
 
-  if (src->cb_ann_locked == 0) {
+  if (src->cb_locked == 0) {
     utarray_clear(&src->cb_ann);
   } else {
     for (size_t i = 0; i < utarray_len(&src->cb_ann); ++i) {
@@ -521,15 +733,18 @@ bool ytp_cursor_consume(ytp_cursor_t *dest, ytp_cursor_t *src,
       s = _utarray_eltptr(&src->cb_ann, i);
       s->cb = NULL;
     }
+    src->cb_removed = true;
   }
 
+  free(rollback_history);
   return true;
 
 rollback:
-  while (h != &rollback_history[0]) {
+  while (h != rollback_history) {
     --h;
     utarray_resize(h->arr, h->old_sz);
   }
+  free(rollback_history);
 
   utarray_resize(&dest->cb_ann, old_ann_sz);
 
@@ -538,7 +753,7 @@ rollback:
 }
 
 void ytp_cursor_all_cb_rm(ytp_cursor_t *cursor) {
-  if (cursor->cb_ann_locked == 0) {
+  if (cursor->cb_locked == 0) {
     utarray_clear(&cursor->cb_ann);
   } else {
     for (size_t i = utarray_len(&cursor->cb_ann); i-- > 0;) {
@@ -546,12 +761,13 @@ void ytp_cursor_all_cb_rm(ytp_cursor_t *cursor) {
       p = _utarray_eltptr(&cursor->cb_ann, i);
       p->cb = NULL;
     }
+    cursor->cb_removed = true;
   }
 
   struct ytp_cursor_streams_data_item_t *map_item;
   struct ytp_cursor_streams_data_item_t *tmp;
   HASH_ITER(hh, cursor->cb_data, map_item, tmp) {
-    if (map_item->cb_data_locked == 0) {
+    if (cursor->cb_locked == 0) {
       utarray_clear(&map_item->cb_data);
     } else {
       for (size_t i = utarray_len(&map_item->cb_data); i-- > 0;) {
@@ -559,6 +775,7 @@ void ytp_cursor_all_cb_rm(ytp_cursor_t *cursor) {
         p = _utarray_eltptr(&map_item->cb_data, i);
         p->cb = NULL;
       }
+      cursor->cb_removed = true;
     }
   }
 }
@@ -576,3 +793,105 @@ void ytp_cursor_seek(ytp_cursor_t *cursor, ytp_mmnode_offs offset,
 ytp_mmnode_offs ytp_cursor_tell(ytp_cursor_t *cursor, fmc_error_t **error) {
   return ytp_yamal_tell(cursor->yamal, cursor->it_data, error);
 }
+
+static void ytp_cursor_time_index_update(ytp_cursor_t *cursor,
+                                         fmc_error_t **error) {
+  fmc_error_clear(error);
+  while (!ytp_yamal_term(cursor->it_idx)) {
+    uint64_t seqno;
+    ytp_mmnode_offs stream;
+    ytp_mmnode_offs offset;
+    size_t sz;
+    const char *payload;
+    ytp_index_read(cursor->yamal, cursor->it_idx, &seqno, &stream, &offset,
+                   &sz, &payload, error);
+    if (*error) {
+      return;
+    }
+
+    if (stream == YTP_DATA_TIME_INDEX_STREAM && sz == sizeof(int64_t)) {
+      struct ytp_cursor_time_index_entry_t entry;
+      int64_t ts;
+      memcpy(&ts, payload, sizeof(ts));
+      entry.ts = ye64toh(ts);
+      entry.offset = offset;
+      // Keep the entries sorted even if writers are not in time order,
+      // entries that do not move forward in the file are ignored
+      size_t len = utarray_len(&cursor->time_index);
+      struct ytp_cursor_time_index_entry_t *last =
+          len ? _utarray_eltptr(&cursor->time_index, len - 1) : NULL;
+      if (!last || entry.offset > last->offset) {
+        if (last && entry.ts < last->ts) {
+          entry.ts = last->ts;
+        }
+        utarray_push_back(&cursor->time_index, &entry);
+        if (*error) {
+          return;
+        }
+      }
+    }
+
+    ytp_iterator_t next =
+        ytp_yamal_next(cursor->yamal, cursor->it_idx, error);
+    if (*error) {
+      return;
+    }
+    cursor->it_idx = next;
+  }
+}
+
+void ytp_cursor_seek_time(ytp_cursor_t *cursor, int64_t ts,
+                          fmc_error_t **error) {
+  ytp_cursor_time_index_update(cursor, error);
+  if (*error) {
+    return;
+  }
+
+  // Last indexed message before ts
+  size_t lo = 0;
+  size_t hi = utarray_len(&cursor->time_index);
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    struct ytp_cursor_time_index_entry_t *entry =
+        _utarray_eltptr(&cursor->time_index, mid);
+    if (entry->ts < ts) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  ytp_iterator_t it;
+  if (lo == 0) {
+    it = ytp_data_begin(cursor->yamal, error);
+  } else {
+    struct ytp_cursor_time_index_entry_t *entry =
+        _utarray_eltptr(&cursor->time_index, lo - 1);
+    it = ytp_yamal_seek(cursor->yamal, entry->offset, error);
+  }
+  if (*error) {
+    return;
+  }
+
+  while (!ytp_yamal_term(it)) {
+    uint64_t seqno;
+    int64_t msg_ts;
+    ytp_mmnode_offs stream;
+    size_t sz;
+    const char *data;
+    ytp_data_read(cursor->yamal, it, &seqno, &msg_ts, &stream, &sz, &data,
+                  error);
+    if (*error) {
+      return;
+    }
+    if (msg_ts >= ts) {
+      break;
+    }
+    it = ytp_yamal_next(cursor->yamal, it, error);
+    if (*error) {
+      return;
+    }
+  }
+
+  cursor->it_data = it;
+}
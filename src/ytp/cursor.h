@@ -13,6 +13,7 @@
 #include <uthash/utarray.h>
 #include <uthash/uthash.h>
 
+#include <stdbool.h>
 #include <stddef.h>
 
 struct ytp_cursor {
@@ -24,16 +25,42 @@ struct ytp_cursor {
   struct ytp_cursor_streams_data_item_t *cb_data;
 
   UT_array cb_ann;
-  int cb_ann_locked;
+
+  // Time index entries read so far, ordered by timestamp
+  ytp_iterator_t it_idx;
+  UT_array time_index;
+
+  // While callbacks are being dispatched removed callbacks are only cleared
+  // and the arrays are compacted once the last lock is released
+  int cb_locked;
+  bool cb_removed;
+
+  // Segment followed by cursors created with ytp_segment_cursor_new
+  struct ytp_cursor_segment_t *segment;
 };
 
+// Items are created for every stream the cursor reads data from, with or
+// without callbacks, so that the announcement is only looked up once per
+// stream. Cursors that follow segments key the items by the id of the first
+// announcement of the stream and use the announced flag to report it once.
 struct ytp_cursor_streams_data_item_t {
   UT_hash_handle hh;
   ytp_mmnode_offs stream;
   UT_array cb_data;
-  int cb_data_locked;
+  ytp_mmnode_offs original;
+  bool resolved;
+  bool announced;
 };
 
+struct ytp_cursor_time_index_entry_t {
+  int64_t ts;
+  ytp_mmnode_offs offset;
+};
+
+// Reads one announcement without polling the data list
+bool ytp_cursor_poll_announcement(struct ytp_cursor *cursor,
+                                  fmc_error_t **error);
+
 extern struct ytp_cursor_streams_data_item_t *
 streams_data_get(struct ytp_cursor_streams_data_item_t *m, ytp_mmnode_offs key);
 extern struct ytp_cursor_streams_data_item_t *
@@ -6,11 +6,13 @@
         file, You can obtain one at https://mozilla.org/MPL/2.0/.
  *****************************************************************************/
 
+#include "atomic.h"
 #include "endianess.h"
 
 #include <fmc/error.h>
 
 #include <ytp/data.h>
+#include <ytp/index.h>
 #include <ytp/stream.h>
 #include <ytp/time.h>
 
@@ -19,19 +21,95 @@ struct data_msg_t {
   char data[];
 };
 
+// The index is best effort, the data message is already committed when it
+// is updated. Only the first message of a batch is considered.
+static void ytp_data_time_index(ytp_yamal_t *yamal, ytp_iterator_t iterator,
+                                int64_t ts) {
+  size_t interval = atomic_load_cast(&yamal->time_index_interval_);
+  if (interval == 0) {
+    return;
+  }
+
+  fmc_error_t *error;
+  ytp_mmnode_offs offset = ytp_yamal_tell(yamal, iterator, &error);
+  if (error || offset < atomic_load_cast(&yamal->time_index_next_)) {
+    return;
+  }
+
+  int64_t payload = htoye64(ts);
+  ytp_index_write(yamal, YTP_DATA_TIME_INDEX_STREAM, offset, sizeof(payload),
+                  &payload, &error);
+  if (error) {
+    return;
+  }
+  atomic_store_cast(&yamal->time_index_next_,
+                    (offset / interval + 1) * interval);
+}
+
 char *ytp_data_reserve(ytp_yamal_t *yamal, size_t sz, fmc_error_t **error) {
   struct data_msg_t *msg = (struct data_msg_t *)ytp_time_reserve(
       yamal, sz + sizeof(struct data_msg_t), error);
   return msg->data;
 }
 
+void ytp_data_reserve_batch(ytp_yamal_t *yamal, const size_t *sizes,
+                            char **data, size_t count, fmc_error_t **error) {
+  fmc_error_clear(error);
+  if (count > YTP_YAMAL_BATCH_MAX) {
+    FMC_ERROR_REPORT(error, "batch count out of range");
+    return;
+  }
+  size_t data_sizes[YTP_YAMAL_BATCH_MAX];
+  for (size_t i = 0; i < count; ++i) {
+    data_sizes[i] = sizes[i] + sizeof(struct data_msg_t);
+  }
+  ytp_time_reserve_batch(yamal, data_sizes, data, count, error);
+  if (*error) {
+    return;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    data[i] = ((struct data_msg_t *)data[i])->data;
+  }
+}
+
 ytp_iterator_t ytp_data_commit(ytp_yamal_t *yamal, int64_t ts,
                                ytp_mmnode_offs stream, void *data,
                                fmc_error_t **error) {
   struct data_msg_t *msg =
       (struct data_msg_t *)((char *)data - sizeof(struct data_msg_t));
   msg->stream = htoye64(stream);
-  return ytp_time_commit(yamal, ts, (char *)msg, YTP_STREAM_LIST_DATA, error);
+  ytp_iterator_t it =
+      ytp_time_commit(yamal, ts, (char *)msg, YTP_STREAM_LIST_DATA, error);
+  if (*error) {
+    return NULL;
+  }
+  ytp_data_time_index(yamal, it, ts);
+  return it;
+}
+
+ytp_iterator_t ytp_data_commit_batch(ytp_yamal_t *yamal, const int64_t *ts,
+                                     const ytp_mmnode_offs *streams,
+                                     char *const *data, size_t count,
+                                     fmc_error_t **error) {
+  fmc_error_clear(error);
+  if (count > YTP_YAMAL_BATCH_MAX) {
+    FMC_ERROR_REPORT(error, "batch count out of range");
+    return NULL;
+  }
+  char *msgs[YTP_YAMAL_BATCH_MAX];
+  for (size_t i = 0; i < count; ++i) {
+    struct data_msg_t *msg =
+        (struct data_msg_t *)(data[i] - sizeof(struct data_msg_t));
+    msg->stream = htoye64(streams[i]);
+    msgs[i] = (char *)msg;
+  }
+  ytp_iterator_t it = ytp_time_commit_batch(yamal, ts, msgs, count,
+                                            YTP_STREAM_LIST_DATA, error);
+  if (*error) {
+    return NULL;
+  }
+  ytp_data_time_index(yamal, it, ts[0]);
+  return it;
 }
 
 void ytp_data_sublist_commit(ytp_yamal_t *yamal, int64_t ts,
@@ -45,7 +123,22 @@ void ytp_data_sublist_commit(ytp_yamal_t *yamal, int64_t ts,
 
 ytp_iterator_t ytp_data_sublist_finalize(ytp_yamal_t *yamal, void *first_ptr,
                                          fmc_error_t **error) {
-  return ytp_yamal_commit(yamal, first_ptr, YTP_STREAM_LIST_DATA, error);
+  ytp_iterator_t it =
+      ytp_yamal_commit(yamal, first_ptr, YTP_STREAM_LIST_DATA, error);
+  if (*error) {
+    return NULL;
+  }
+
+  uint64_t seqno;
+  int64_t ts;
+  size_t sz;
+  const char *data;
+  fmc_error_t *read_error;
+  ytp_time_read(yamal, it, &seqno, &ts, &sz, &data, &read_error);
+  if (!read_error) {
+    ytp_data_time_index(yamal, it, ts);
+  }
+  return it;
 }
 
 void ytp_data_read(ytp_yamal_t *yamal, ytp_iterator_t iterator, uint64_t *seqno,
@@ -63,3 +156,21 @@ void ytp_data_read(ytp_yamal_t *yamal, ytp_iterator_t iterator, uint64_t *seqno,
   *sz = read_sz - offsetof(struct data_msg_t, data);
   *data = msg->data;
 }
+
+void ytp_data_set_time_index(ytp_yamal_t *yamal, size_t interval,
+                             fmc_error_t **error) {
+  fmc_error_clear(error);
+  if (interval == 0) {
+    atomic_store_cast(&yamal->time_index_interval_, interval);
+    return;
+  }
+  // The beginning of the data list does not need an entry and the blocks
+  // that were already written are not indexed by this handle
+  size_t reserved = ytp_yamal_reserved_size(yamal, error);
+  if (*error) {
+    return;
+  }
+  atomic_store_cast(&yamal->time_index_next_,
+                    (reserved / interval + 1) * interval);
+  atomic_store_cast(&yamal->time_index_interval_, interval);
+}
@@ -0,0 +1,423 @@
+/******************************************************************************
+        COPYRIGHT (c) 2019-2023 by Featuremine Corporation.
+
+        This Source Code Form is subject to the terms of the Mozilla Public
+        License, v. 2.0. If a copy of the MPL was not distributed with this
+        file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *****************************************************************************/
+
+#include "cursor.h"
+
+#include <fmc/error.h>
+#include <fmc/time.h>
+#include <ytp/cursor.h>
+#include <ytp/data.h>
+#include <ytp/merge.h>
+
+#include <uthash/utarray.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#undef utarray_oom
+#define utarray_oom()                                                          \
+  do {                                                                         \
+    fmc_error_set2(error, FMC_ERROR_MEMORY);                                   \
+  } while (0)
+
+struct ytp_merge_ann_cb_cl_t {
+  ytp_merge_cursor_ann_cb_t cb;
+  void *cl;
+};
+
+static const UT_icd merge_ann_cb_icd = {
+    sizeof(struct ytp_merge_ann_cb_cl_t),
+    NULL,
+    NULL,
+    NULL,
+};
+
+// ts is the timestamp of the next data message of the input, it is only
+// valid if the input is not empty
+struct ytp_merge_input_t {
+  struct ytp_merge_cursor *merge;
+  size_t index;
+  ytp_cursor_t cursor;
+  int64_t ts;
+  bool empty;
+};
+
+// The inputs are ordered with a loser tree: tree[0] is the input with the
+// next message and the internal nodes tree[1..count) hold the input that lost
+// the match at that node. The leaf of input i is node i + count.
+struct ytp_merge_cursor {
+  struct ytp_merge_input_t *inputs;
+  size_t *tree;
+  size_t count;
+  // Inputs that were empty when they were last checked and whose data list
+  // is still open, in no particular order
+  size_t *exhausted;
+  size_t nexhausted;
+  UT_array cb_ann;
+  int cb_locked;
+  bool cb_removed;
+};
+
+// count is used as a sentinel that is lower than every input while the tree
+// is built. Empty inputs go last, ties go to the input given first.
+static bool merge_less(struct ytp_merge_cursor *merge, size_t a, size_t b) {
+  if (b == merge->count) {
+    return false;
+  }
+  if (a == merge->count) {
+    return true;
+  }
+  struct ytp_merge_input_t *ia = &merge->inputs[a];
+  struct ytp_merge_input_t *ib = &merge->inputs[b];
+  if (ia->empty != ib->empty) {
+    return ib->empty;
+  }
+  if (!ia->empty && ia->ts != ib->ts) {
+    return ia->ts < ib->ts;
+  }
+  return a < b;
+}
+
+// Replays the matches from the leaf of the input to the root
+static void merge_adjust(struct ytp_merge_cursor *merge, size_t input) {
+  size_t winner = input;
+  for (size_t t = (input + merge->count) / 2; t > 0; t /= 2) {
+    if (merge_less(merge, merge->tree[t], winner)) {
+      size_t tmp = merge->tree[t];
+      merge->tree[t] = winner;
+      winner = tmp;
+    }
+  }
+  merge->tree[0] = winner;
+}
+
+static void merge_build(struct ytp_merge_cursor *merge) {
+  for (size_t t = 0; t < merge->count; ++t) {
+    merge->tree[t] = merge->count;
+  }
+  for (size_t i = merge->count; i-- > 0;) {
+    merge_adjust(merge, i);
+  }
+}
+
+static void merge_peek(struct ytp_merge_input_t *input, fmc_error_t **error) {
+  ytp_cursor_t *cursor = &input->cursor;
+  input->empty = ytp_yamal_term(cursor->it_data);
+  if (input->empty) {
+    return;
+  }
+
+  uint64_t seqno;
+  ytp_mmnode_offs stream;
+  size_t sz;
+  const char *data;
+  ytp_data_read(cursor->yamal, cursor->it_data, &seqno, &input->ts, &stream,
+                &sz, &data, error);
+}
+
+static void merge_ann_cb(void *closure, uint64_t seqno, ytp_mmnode_offs stream,
+                         size_t psz, const char *peer, size_t csz,
+                         const char *channel, size_t esz, const char *encoding,
+                         bool subscribed) {
+  struct ytp_merge_input_t *input = (struct ytp_merge_input_t *)closure;
+  struct ytp_merge_cursor *merge = input->merge;
+  for (size_t i = utarray_len(&merge->cb_ann); i-- > 0;) {
+    struct ytp_merge_ann_cb_cl_t *p;
+    p = _utarray_eltptr(&merge->cb_ann, i);
+    if (p->cb == NULL) {
+      continue;
+    }
+    p->cb(p->cl, input->index, seqno, stream, psz, peer, csz, channel, esz,
+          encoding, subscribed);
+  }
+}
+
+ytp_merge_cursor_t *ytp_merge_cursor_new(ytp_yamal_t *const *yamals,
+                                         size_t count, fmc_error_t **error) {
+  fmc_error_clear(error);
+  if (count == 0) {
+    fmc_error_set(error, "merge cursor requires at least one yamal");
+    return NULL;
+  }
+
+  size_t initialized = 0;
+  ytp_merge_cursor_t *merge =
+      (ytp_merge_cursor_t *)calloc(1, sizeof(ytp_merge_cursor_t));
+  if (!merge) {
+    fmc_error_set2(error, FMC_ERROR_MEMORY);
+    return NULL;
+  }
+  merge->inputs = (struct ytp_merge_input_t *)calloc(
+      count, sizeof(struct ytp_merge_input_t));
+  merge->tree = (size_t *)calloc(count, sizeof(size_t));
+  merge->exhausted = (size_t *)calloc(count, sizeof(size_t));
+  if (!merge->inputs || !merge->tree || !merge->exhausted) {
+    fmc_error_set2(error, FMC_ERROR_MEMORY);
+    goto cleanup_alloc;
+  }
+  utarray_init(&merge->cb_ann, &merge_ann_cb_icd);
+
+  for (; initialized < count; ++initialized) {
+    struct ytp_merge_input_t *input = &merge->inputs[initialized];
+    input->merge = merge;
+    input->index = initialized;
+    ytp_cursor_init(&input->cursor, yamals[initialized], error);
+    if (*error) {
+      goto cleanup_inputs;
+    }
+    ytp_cursor_ann_cb(&input->cursor, merge_ann_cb, input, error);
+    if (*error) {
+      ++initialized;
+      goto cleanup_inputs;
+    }
+    merge_peek(input, error);
+    if (*error) {
+      ++initialized;
+      goto cleanup_inputs;
+    }
+    if (input->empty) {
+      merge->exhausted[merge->nexhausted++] = initialized;
+    }
+  }
+  merge->count = count;
+  merge_build(merge);
+  return merge;
+
+cleanup_inputs:
+  for (size_t i = 0; i < initialized; ++i) {
+    fmc_error_t *err;
+    ytp_cursor_destroy(&merge->inputs[i].cursor, &err);
+  }
+  utarray_done(&merge->cb_ann);
+cleanup_alloc:
+  free(merge->exhausted);
+  free(merge->tree);
+  free(merge->inputs);
+  free(merge);
+  return NULL;
+}
+
+void ytp_merge_cursor_del(ytp_merge_cursor_t *merge, fmc_error_t **error) {
+  fmc_error_clear(error);
+  // Every input is destroyed, only the first error is reported
+  struct fmc_error saved_error;
+  fmc_error_init_none(&saved_error);
+  for (size_t i = 0; i < merge->count; ++i) {
+    fmc_error_t *err;
+    ytp_cursor_destroy(&merge->inputs[i].cursor, &err);
+    if (err && !fmc_error_has(&saved_error)) {
+      fmc_error_cpy(&saved_error, err);
+    }
+  }
+  utarray_done(&merge->cb_ann);
+  free(merge->exhausted);
+  free(merge->tree);
+  free(merge->inputs);
+  free(merge);
+  if (fmc_error_has(&saved_error)) {
+    *error = fmc_error_inst();
+    fmc_error_mov(*error, &saved_error);
+  }
+  fmc_error_destroy(&saved_error);
+}
+
+void ytp_merge_cursor_ann_cb(ytp_merge_cursor_t *merge,
+                             ytp_merge_cursor_ann_cb_t cb, void *closure,
+                             fmc_error_t **error) {
+  fmc_error_clear(error);
+
+  for (size_t i = utarray_len(&merge->cb_ann); i-- > 0;) {
+    struct ytp_merge_ann_cb_cl_t *p;
+    p = _utarray_eltptr(&merge->cb_ann, i);
+    if (p->cb == cb && p->cl == closure) {
+      return;
+    }
+  }
+
+  struct ytp_merge_ann_cb_cl_t item;
+  item.cb = cb;
+  item.cl = closure;
+  utarray_push_back(&merge->cb_ann, &item);
+}
+
+void ytp_merge_cursor_ann_cb_rm(ytp_merge_cursor_t *merge,
+                                ytp_merge_cursor_ann_cb_t cb, void *closure,
+                                fmc_error_t **error) {
+  fmc_error_clear(error);
+  size_t new_size = utarray_len(&merge->cb_ann);
+  for (size_t i = utarray_len(&merge->cb_ann); i-- > 0;) {
+    struct ytp_merge_ann_cb_cl_t *p;
+    p = _utarray_eltptr(&merge->cb_ann, i);
+    if (p->cb == cb && p->cl == closure) {
+      if (merge->cb_locked == 0) {
+        --new_size;
+        ut_swap(_utarray_eltptr(&merge->cb_ann, i),
+                _utarray_eltptr(&merge->cb_ann, new_size),
+                sizeof(struct ytp_merge_ann_cb_cl_t));
+      } else {
+        p->cb = NULL;
+        merge->cb_removed = true;
+      }
+    }
+  }
+  utarray_resize(&merge->cb_ann, new_size);
+}
+
+void ytp_merge_cursor_data_cb(ytp_merge_cursor_t *merge, size_t input,
+                              ytp_mmnode_offs stream, ytp_cursor_data_cb_t cb,
+                              void *closure, fmc_error_t **error) {
+  fmc_error_clear(error);
+  if (input >= merge->count) {
+    fmc_error_set(error, "invalid merge cursor input %zu", input);
+    return;
+  }
+  ytp_cursor_data_cb(&merge->inputs[input].cursor, stream, cb, closure, error);
+}
+
+void ytp_merge_cursor_data_cb_rm(ytp_merge_cursor_t *merge, size_t input,
+                                 ytp_mmnode_offs stream,
+                                 ytp_cursor_data_cb_t cb, void *closure,
+                                 fmc_error_t **error) {
+  fmc_error_clear(error);
+  if (input >= merge->count) {
+    fmc_error_set(error, "invalid merge cursor input %zu", input);
+    return;
+  }
+  ytp_cursor_data_cb_rm(&merge->inputs[input].cursor, stream, cb, closure,
+                        error);
+}
+
+// Once every input is consumed, reads the pending announcements
+static bool merge_poll_announcements(ytp_merge_cursor_t *merge,
+                                     fmc_error_t **error) {
+  bool polled = false;
+  for (size_t i = 0; i < merge->count; ++i) {
+    polled |= ytp_cursor_poll_announcement(&merge->inputs[i].cursor, error);
+    if (*error) {
+      return false;
+    }
+  }
+  return polled;
+}
+
+// Checks the exhausted inputs again, so their new messages are merged before
+// later messages of the inputs that still had data. Inputs whose data list is
+// closed can not grow and are dropped from the list. An input that is not the
+// winner can not be adjusted in place, the tree is rebuilt.
+static void merge_refresh(ytp_merge_cursor_t *merge, fmc_error_t **error) {
+  bool changed = false;
+  for (size_t i = 0; i < merge->nexhausted;) {
+    struct ytp_merge_input_t *input = &merge->inputs[merge->exhausted[i]];
+    merge_peek(input, error);
+    if (*error) {
+      return;
+    }
+    if (input->empty) {
+      bool closed = ytp_yamal_closed(input->cursor.yamal,
+                                     YTP_STREAM_LIST_DATA, error);
+      if (*error) {
+        return;
+      }
+      if (!closed) {
+        ++i;
+        continue;
+      }
+      // A message may be committed right before the list is closed
+      merge_peek(input, error);
+      if (*error) {
+        return;
+      }
+    }
+    changed |= !input->empty;
+    merge->exhausted[i] = merge->exhausted[--merge->nexhausted];
+  }
+  if (changed) {
+    merge_build(merge);
+  }
+}
+
+static bool merge_poll_one(ytp_merge_cursor_t *merge, fmc_error_t **error) {
+  struct ytp_merge_input_t *input = &merge->inputs[merge->tree[0]];
+  if (input->empty) {
+    return merge_poll_announcements(merge, error);
+  }
+
+  // The input cursor may process an announcement instead of the data message
+  ytp_iterator_t it_data = input->cursor.it_data;
+  bool polled = ytp_cursor_poll(&input->cursor, error);
+  if (*error) {
+    return false;
+  }
+  if (input->cursor.it_data != it_data) {
+    merge_peek(input, error);
+    if (*error) {
+      return false;
+    }
+    if (input->empty) {
+      merge->exhausted[merge->nexhausted++] = input->index;
+    }
+    merge_adjust(merge, input->index);
+  }
+  return polled;
+}
+
+static void merge_cb_release(ytp_merge_cursor_t *merge,
+                             fmc_error_t **error) {
+  if (--merge->cb_locked != 0 || !merge->cb_removed) {
+    return;
+  }
+  merge->cb_removed = false;
+
+  size_t new_size = utarray_len(&merge->cb_ann);
+  for (size_t i = utarray_len(&merge->cb_ann); i-- > 0;) {
+    struct ytp_merge_ann_cb_cl_t *p;
+    p = _utarray_eltptr(&merge->cb_ann, i);
+    if (p->cb == NULL) {
+      --new_size;
+      ut_swap(_utarray_eltptr(&merge->cb_ann, i),
+              _utarray_eltptr(&merge->cb_ann, new_size),
+              sizeof(struct ytp_merge_ann_cb_cl_t));
+    }
+  }
+  utarray_resize(&merge->cb_ann, new_size);
+}
+
+bool ytp_merge_cursor_poll(ytp_merge_cursor_t *merge, fmc_error_t **error) {
+  fmc_error_clear(error);
+  ++merge->cb_locked;
+  bool polled = false;
+  merge_refresh(merge, error);
+  if (!*error) {
+    polled = merge_poll_one(merge, error);
+  }
+  merge_cb_release(merge, error);
+  return polled;
+}
+
+size_t ytp_merge_cursor_poll_n(ytp_merge_cursor_t *merge, size_t max_msgs,
+                               int64_t max_ns, fmc_error_t **error) {
+  fmc_error_clear(error);
+  int64_t deadline = 0;
+  if (max_ns >= 0) {
+    int64_t now = fmc_cur_time_ns();
+    deadline = max_ns < INT64_MAX - now ? now + max_ns : INT64_MAX;
+  }
+
+  // Exhausted inputs are checked once per call
+  size_t count = 0;
+  ++merge->cb_locked;
+  merge_refresh(merge, error);
+  while (!*error && count < max_msgs && merge_poll_one(merge, error)) {
+    ++count;
+    if (max_ns >= 0 && fmc_cur_time_ns() >= deadline) {
+      break;
+    }
+  }
+  merge_cb_release(merge, error);
+  return count;
+}
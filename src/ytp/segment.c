@@ -0,0 +1,616 @@
+/******************************************************************************
+        COPYRIGHT (c) 2019-2023 by Featuremine Corporation.
+
+        This Source Code Form is subject to the terms of the Mozilla Public
+        License, v. 2.0. If a copy of the MPL was not distributed with this
+        file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *****************************************************************************/
+
+#include "segment.h"
+#include "atomic.h"
+#include "cursor.h"
+#include "endianess.h"
+
+#include <fmc/error.h>
+#include <fmc/files.h>
+#include <ytp/announcement.h>
+#include <ytp/data.h>
+#include <ytp/index.h>
+#include <ytp/segment.h>
+#include <ytp/stream.h>
+#include <ytp/streams.h>
+#include <ytp/subscription.h>
+
+#include <uthash/uthash.h>
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#undef uthash_fatal
+#undef HASH_RECORD_OOM
+#define HASH_RECORD_OOM(oomed) fmc_error_set2(error, FMC_ERROR_MEMORY)
+
+struct ytp_segment {
+  char *path;
+  size_t index;
+  char *file;
+  fmc_fd fd;
+  ytp_yamal_t *yamal;
+  ytp_streams_t *streams;
+  ytp_mmnode_offs base;
+  size_t max_size;
+  int64_t max_ns;
+  int64_t first_ts;
+  bool empty;
+  // Streams of the current segment by segment id and by writer id
+  struct ytp_segment_stream_t *by_local;
+  struct ytp_segment_writer_stream_t *by_global;
+};
+
+struct ytp_segment_writer_stream_t {
+  UT_hash_handle hh;
+  ytp_mmnode_offs global;
+  ytp_mmnode_offs local;
+};
+
+static char *segment_file(const char *path, size_t index, const char *suffix,
+                          fmc_error_t **error) {
+  int sz = snprintf(NULL, 0, "%s.%zu%s", path, index, suffix);
+  char *file = (char *)malloc(sz + 1);
+  if (!file) {
+    fmc_error_set2(error, FMC_ERROR_MEMORY);
+    return NULL;
+  }
+  snprintf(file, sz + 1, "%s.%zu%s", path, index, suffix);
+  return file;
+}
+
+static const char *segment_basename(const char *file) {
+  const char *slash = strrchr(file, '/');
+  return slash ? slash + 1 : file;
+}
+
+// Segments are linked by file name, relative to the directory of the segment
+static char *segment_sibling(const char *file, size_t sz, const char *name,
+                             fmc_error_t **error) {
+  size_t dirsz = segment_basename(file) - file;
+  char *sibling = (char *)malloc(dirsz + sz + 1);
+  if (!sibling) {
+    fmc_error_set2(error, FMC_ERROR_MEMORY);
+    return NULL;
+  }
+  memcpy(sibling, file, dirsz);
+  memcpy(sibling + dirsz, name, sz);
+  sibling[dirsz + sz] = '\0';
+  return sibling;
+}
+
+static void segment_stream_add(struct ytp_segment_stream_t **streams,
+                               ytp_mmnode_offs local, ytp_mmnode_offs global,
+                               fmc_error_t **error) {
+  struct ytp_segment_stream_t *item;
+  HASH_FIND(hh, *streams, &local, sizeof(local), item);
+  if (item) {
+    return;
+  }
+  item = (struct ytp_segment_stream_t *)malloc(sizeof(*item));
+  if (!item) {
+    fmc_error_set2(error, FMC_ERROR_MEMORY);
+    return;
+  }
+  item->local = local;
+  item->global = global;
+  HASH_ADD(hh, *streams, local, sizeof(item->local), item);
+  if (*error) {
+    free(item);
+  }
+}
+
+void ytp_segment_records_load(ytp_yamal_t *yamal, const char *path,
+                              ytp_mmnode_offs *base,
+                              struct ytp_segment_stream_t **streams,
+                              char **next, fmc_error_t **error) {
+  fmc_error_clear(error);
+  *base = 0;
+  if (next) {
+    *next = NULL;
+  }
+  ytp_iterator_t it = ytp_index_begin(yamal, error);
+  if (*error) {
+    return;
+  }
+  while (!ytp_yamal_term(it)) {
+    uint64_t seqno;
+    ytp_mmnode_offs stream;
+    ytp_mmnode_offs offset;
+    size_t sz;
+    const char *payload;
+    ytp_index_read(yamal, it, &seqno, &stream, &offset, &sz, &payload, error);
+    if (*error) {
+      return;
+    }
+
+    if (stream == YTP_SEGMENT_PREV_STREAM) {
+      *base = offset;
+    } else if (stream == YTP_SEGMENT_MAP_STREAM && streams &&
+               sz == sizeof(ytp_mmnode_offs)) {
+      ytp_mmnode_offs global;
+      memcpy(&global, payload, sizeof(global));
+      segment_stream_add(streams, offset, ye64toh(global), error);
+      if (*error) {
+        return;
+      }
+    } else if (stream == YTP_SEGMENT_NEXT_STREAM && next && !*next) {
+      *next = segment_sibling(path, sz, payload, error);
+      if (*error) {
+        return;
+      }
+    }
+
+    ytp_iterator_t next_it = ytp_yamal_next(yamal, it, error);
+    if (*error) {
+      return;
+    }
+    it = next_it;
+  }
+}
+
+ytp_mmnode_offs ytp_segment_stream_global(struct ytp_segment_stream_t **streams,
+                                          ytp_mmnode_offs base,
+                                          ytp_mmnode_offs local,
+                                          fmc_error_t **error) {
+  fmc_error_clear(error);
+  struct ytp_segment_stream_t *item;
+  HASH_FIND(hh, *streams, &local, sizeof(local), item);
+  if (item) {
+    return item->global;
+  }
+  // Streams first announced in this segment
+  segment_stream_add(streams, local, base + local, error);
+  return base + local;
+}
+
+void ytp_segment_streams_clear(struct ytp_segment_stream_t **streams) {
+  struct ytp_segment_stream_t *item;
+  struct ytp_segment_stream_t *tmp;
+  HASH_ITER(hh, *streams, item, tmp) {
+    HASH_DEL(*streams, item);
+    free(item);
+  }
+}
+
+void ytp_cursor_segment_open(struct ytp_cursor_segment_t *segment,
+                             const char *path, fmc_error_t **error) {
+  fmc_error_clear(error);
+  segment->streams = NULL;
+  segment->path = strdup(path);
+  if (!segment->path) {
+    fmc_error_set2(error, FMC_ERROR_MEMORY);
+    return;
+  }
+  segment->fd = fmc_fopen(path, READ, error);
+  if (*error) {
+    fmc_error_set(error, "unable to open segment %s: %s", path,
+                  fmc_error_msg(*error));
+    goto cleanup_path;
+  }
+  segment->yamal = ytp_yamal_new_2(segment->fd, false, error);
+  if (*error) {
+    goto cleanup_fd;
+  }
+  ytp_segment_records_load(segment->yamal, path, &segment->base,
+                           &segment->streams, NULL, error);
+  if (*error) {
+    goto cleanup_yamal;
+  }
+  return;
+
+cleanup_yamal : {
+  fmc_error_t *err;
+  ytp_segment_streams_clear(&segment->streams);
+  ytp_yamal_del(segment->yamal, &err);
+}
+cleanup_fd : {
+  fmc_error_t *err;
+  fmc_fclose(segment->fd, &err);
+}
+cleanup_path:
+  free(segment->path);
+}
+
+void ytp_cursor_segment_close(struct ytp_cursor_segment_t *segment) {
+  fmc_error_t *error;
+  ytp_segment_streams_clear(&segment->streams);
+  ytp_yamal_del(segment->yamal, &error);
+  fmc_fclose(segment->fd, &error);
+  free(segment->path);
+}
+
+ytp_cursor_t *ytp_segment_cursor_new(const char *path, fmc_error_t **error) {
+  struct ytp_cursor_segment_t *segment =
+      (struct ytp_cursor_segment_t *)malloc(sizeof(*segment));
+  if (!segment) {
+    fmc_error_set2(error, FMC_ERROR_MEMORY);
+    return NULL;
+  }
+  ytp_cursor_segment_open(segment, path, error);
+  if (*error) {
+    free(segment);
+    return NULL;
+  }
+  ytp_cursor_t *cursor = ytp_cursor_new(segment->yamal, error);
+  if (*error) {
+    ytp_cursor_segment_close(segment);
+    free(segment);
+    return NULL;
+  }
+  cursor->segment = segment;
+  return cursor;
+}
+
+static void ytp_segment_streams_reset(ytp_segment_t *segment) {
+  struct ytp_segment_writer_stream_t *item;
+  struct ytp_segment_writer_stream_t *tmp;
+  HASH_ITER(hh, segment->by_global, item, tmp) {
+    HASH_DEL(segment->by_global, item);
+    free(item);
+  }
+  ytp_segment_streams_clear(&segment->by_local);
+}
+
+static void ytp_segment_stream_link(ytp_segment_t *segment,
+                                    ytp_mmnode_offs local,
+                                    ytp_mmnode_offs global,
+                                    fmc_error_t **error) {
+  struct ytp_segment_writer_stream_t *item;
+  HASH_FIND(hh, segment->by_global, &global, sizeof(global), item);
+  if (item) {
+    return;
+  }
+  item = (struct ytp_segment_writer_stream_t *)malloc(sizeof(*item));
+  if (!item) {
+    fmc_error_set2(error, FMC_ERROR_MEMORY);
+    return;
+  }
+  item->global = global;
+  item->local = local;
+  HASH_ADD(hh, segment->by_global, global, sizeof(item->global), item);
+  if (*error) {
+    free(item);
+  }
+}
+
+// Opens the current segment file for writing
+static void ytp_segment_open(ytp_segment_t *segment, const char *file,
+                             fmc_error_t **error) {
+  fmc_error_clear(error);
+  segment->fd = fmc_fopen(file, READWRITE, error);
+  if (*error) {
+    fmc_error_set(error, "unable to open segment %s: %s", file,
+                  fmc_error_msg(*error));
+    return;
+  }
+  segment->yamal = ytp_yamal_new_3(segment->fd, true, YTP_CLOSABLE, error);
+  if (*error) {
+    goto cleanup_fd;
+  }
+  segment->streams = ytp_streams_new(segment->yamal, error);
+  if (*error) {
+    goto cleanup_yamal;
+  }
+  segment->empty = true;
+  return;
+
+cleanup_yamal : {
+  fmc_error_t *err;
+  ytp_yamal_del(segment->yamal, &err);
+}
+cleanup_fd : {
+  fmc_error_t *err;
+  fmc_fclose(segment->fd, &err);
+}
+}
+
+static void ytp_segment_close(ytp_segment_t *segment) {
+  fmc_error_t *error;
+  ytp_streams_del(segment->streams, &error);
+  ytp_yamal_del(segment->yamal, &error);
+  fmc_fclose(segment->fd, &error);
+  ytp_segment_streams_reset(segment);
+}
+
+// Creates a segment under a temporary name and renames it once the link to
+// its predecessor is written, so readers never see a segment without it
+static void ytp_segment_create(ytp_segment_t *segment, const char *file,
+                               const char *prev, ytp_mmnode_offs base,
+                               fmc_error_t **error) {
+  fmc_error_clear(error);
+  char *tmp = segment_file(segment->path, segment->index, ".tmp", error);
+  if (*error) {
+    return;
+  }
+  // A temporary file left by a failed writer is discarded
+  remove(tmp);
+  ytp_segment_open(segment, tmp, error);
+  if (*error) {
+    free(tmp);
+    return;
+  }
+  segment->base = base;
+  ytp_index_write(segment->yamal, YTP_SEGMENT_PREV_STREAM, base, strlen(prev),
+                  prev, error);
+  if (*error) {
+    goto cleanup;
+  }
+  if (rename(tmp, file) != 0) {
+    FMC_ERROR_REPORT(error, fmc_syserror_msg());
+    goto cleanup;
+  }
+  free(tmp);
+  return;
+
+cleanup:
+  ytp_segment_close(segment);
+  free(tmp);
+}
+
+ytp_segment_t *ytp_segment_new(const char *path, size_t max_size,
+                               int64_t max_ns, fmc_error_t **error) {
+  fmc_error_clear(error);
+  ytp_segment_t *segment = (ytp_segment_t *)calloc(1, sizeof(ytp_segment_t));
+  if (!segment) {
+    fmc_error_set2(error, FMC_ERROR_MEMORY);
+    return NULL;
+  }
+  segment->max_size = max_size;
+  segment->max_ns = max_ns;
+  segment->path = strdup(path);
+  if (!segment->path) {
+    fmc_error_set2(error, FMC_ERROR_MEMORY);
+    goto cleanup_segment;
+  }
+
+  // Find the last segment
+  segment->file = segment_file(path, 0, "", error);
+  if (*error) {
+    goto cleanup_path;
+  }
+  bool exists = fmc_fexists(segment->file, error);
+  if (*error) {
+    goto cleanup_file;
+  }
+  if (!exists) {
+    ytp_segment_create(segment, segment->file, "", 0, error);
+    if (*error) {
+      goto cleanup_file;
+    }
+    return segment;
+  }
+  for (;;) {
+    char *file = segment_file(path, segment->index + 1, "", error);
+    if (*error) {
+      goto cleanup_file;
+    }
+    exists = fmc_fexists(file, error);
+    if (*error || !exists) {
+      free(file);
+      if (*error) {
+        goto cleanup_file;
+      }
+      break;
+    }
+    free(segment->file);
+    segment->file = file;
+    ++segment->index;
+  }
+
+  ytp_segment_open(segment, segment->file, error);
+  if (*error) {
+    goto cleanup_file;
+  }
+  ytp_segment_records_load(segment->yamal, segment->file, &segment->base,
+                           &segment->by_local, NULL, error);
+  if (*error) {
+    goto cleanup_open;
+  }
+  bool closed = ytp_yamal_closed(segment->yamal, YTP_STREAM_LIST_DATA, error);
+  if (*error) {
+    goto cleanup_open;
+  }
+  if (closed) {
+    ytp_segment_roll(segment, error);
+    if (*error) {
+      goto cleanup_open;
+    }
+  }
+  return segment;
+
+cleanup_open:
+  ytp_segment_close(segment);
+cleanup_file:
+  free(segment->file);
+cleanup_path:
+  free(segment->path);
+cleanup_segment:
+  free(segment);
+  return NULL;
+}
+
+void ytp_segment_del(ytp_segment_t *segment, fmc_error_t **error) {
+  fmc_error_clear(error);
+  ytp_segment_close(segment);
+  free(segment->file);
+  free(segment->path);
+  free(segment);
+}
+
+ytp_yamal_t *ytp_segment_yamal(ytp_segment_t *segment) {
+  return segment->yamal;
+}
+
+ytp_mmnode_offs ytp_segment_announce(ytp_segment_t *segment, size_t psz,
+                                     const char *peer, size_t csz,
+                                     const char *channel, size_t esz,
+                                     const char *encoding,
+                                     fmc_error_t **error) {
+  ytp_mmnode_offs local =
+      ytp_streams_announce(segment->streams, psz, peer, csz, channel, esz,
+                           encoding, error);
+  if (*error) {
+    return 0;
+  }
+  ytp_mmnode_offs global = ytp_segment_stream_global(
+      &segment->by_local, segment->base, local, error);
+  if (*error) {
+    return 0;
+  }
+  ytp_segment_stream_link(segment, local, global, error);
+  if (*error) {
+    return 0;
+  }
+  return global;
+}
+
+char *ytp_segment_reserve(ytp_segment_t *segment, size_t sz,
+                          fmc_error_t **error) {
+  return ytp_data_reserve(segment->yamal, sz, error);
+}
+
+void ytp_segment_commit(ytp_segment_t *segment, int64_t ts,
+                        ytp_mmnode_offs stream, void *data,
+                        fmc_error_t **error) {
+  fmc_error_clear(error);
+  struct ytp_segment_writer_stream_t *item;
+  HASH_FIND(hh, segment->by_global, &stream, sizeof(stream), item);
+  if (!item) {
+    fmc_error_set(error, "stream was not announced with ytp_segment_announce");
+    return;
+  }
+  ytp_data_commit(segment->yamal, ts, item->local, data, error);
+  if (*error) {
+    return;
+  }
+  if (segment->empty) {
+    segment->first_ts = ts;
+    segment->empty = false;
+  }
+
+  bool roll = segment->max_ns > 0 && ts - segment->first_ts >= segment->max_ns;
+  if (!roll && segment->max_size > 0) {
+    roll = ytp_yamal_reserved_size(segment->yamal, error) >= segment->max_size;
+    if (*error) {
+      return;
+    }
+  }
+  if (roll) {
+    ytp_segment_roll(segment, error);
+  }
+}
+
+void ytp_segment_roll(ytp_segment_t *segment, fmc_error_t **error) {
+  fmc_error_clear(error);
+  ytp_segment_t prev = *segment;
+
+  // Resolve the announcements written by other processes
+  size_t esz;
+  const char *encoding;
+  ytp_streams_lookup(prev.streams, 0, "", 0, "", &esz, &encoding, error);
+  if (*error) {
+    return;
+  }
+  size_t prev_sz = ytp_yamal_reserved_size(prev.yamal, error);
+  if (*error) {
+    return;
+  }
+
+  segment->index = prev.index + 1;
+  segment->file = segment_file(segment->path, segment->index, "", error);
+  if (*error) {
+    *segment = prev;
+    return;
+  }
+  segment->by_local = NULL;
+  segment->by_global = NULL;
+  ytp_segment_create(segment, segment->file, segment_basename(prev.file),
+                     prev.base + prev_sz, error);
+  if (*error) {
+    free(segment->file);
+    *segment = prev;
+    return;
+  }
+
+  // Announce every stream again and map it to its first announcement
+  ytp_iterator_t it = ytp_announcement_begin(prev.yamal, error);
+  if (*error) {
+    goto cleanup;
+  }
+  uint64_t seqno;
+  ytp_mmnode_offs stream;
+  size_t psz;
+  const char *peer;
+  size_t csz;
+  const char *channel;
+  ytp_mmnode_offs *original;
+  ytp_mmnode_offs *subscribed;
+  while (ytp_announcement_next(prev.yamal, &it, &seqno, &stream, &psz, &peer,
+                               &csz, &channel, &esz, &encoding, &original,
+                               &subscribed, error)) {
+    ytp_mmnode_offs global =
+        ytp_segment_stream_global(&prev.by_local, prev.base, stream, error);
+    if (*error) {
+      goto cleanup;
+    }
+    ytp_mmnode_offs local = ytp_streams_announce(
+        segment->streams, psz, peer, csz, channel, esz, encoding, error);
+    if (*error) {
+      goto cleanup;
+    }
+    ytp_mmnode_offs global_ye = htoye64(global);
+    ytp_index_write(segment->yamal, YTP_SEGMENT_MAP_STREAM, local,
+                    sizeof(global_ye), &global_ye, error);
+    if (*error) {
+      goto cleanup;
+    }
+    segment_stream_add(&segment->by_local, local, global, error);
+    if (*error) {
+      goto cleanup;
+    }
+    ytp_segment_stream_link(segment, local, global, error);
+    if (*error) {
+      goto cleanup;
+    }
+    if (atomic_load_cast(subscribed) != 0) {
+      ytp_subscription_commit(segment->yamal, local, error);
+      if (*error) {
+        goto cleanup;
+      }
+    }
+  }
+  if (*error) {
+    goto cleanup;
+  }
+
+  const char *name = segment_basename(segment->file);
+  ytp_index_write(prev.yamal, YTP_SEGMENT_NEXT_STREAM, 0, strlen(name), name,
+                  error);
+  if (*error) {
+    goto cleanup;
+  }
+  ytp_yamal_close(prev.yamal, YTP_STREAM_LIST_DATA, error);
+  if (*error) {
+    goto cleanup;
+  }
+
+  ytp_segment_close(&prev);
+  free(prev.file);
+  return;
+
+  // The new segment is removed, so that the writer stays on the previous one
+cleanup:
+  ytp_segment_close(segment);
+  remove(segment->file);
+  free(segment->file);
+  *segment = prev;
+}
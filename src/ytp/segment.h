@@ -0,0 +1,52 @@
+/******************************************************************************
+        COPYRIGHT (c) 2019-2023 by Featuremine Corporation.
+
+        This Source Code Form is subject to the terms of the Mozilla Public
+        License, v. 2.0. If a copy of the MPL was not distributed with this
+        file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *****************************************************************************/
+
+#pragma once
+
+#include <ytp/yamal.h>
+
+#include <fmc/error.h>
+#include <fmc/files.h>
+
+#include <uthash/uthash.h>
+
+// Maps the stream ids of a segment to the ids of their first announcement
+struct ytp_segment_stream_t {
+  UT_hash_handle hh;
+  ytp_mmnode_offs local;
+  ytp_mmnode_offs global;
+};
+
+struct ytp_cursor_segment_t {
+  char *path;
+  fmc_fd fd;
+  ytp_yamal_t *yamal;
+  ytp_mmnode_offs base;
+  struct ytp_segment_stream_t *streams;
+};
+
+// Reads the base and the stream map of a segment. If next is not NULL, it is
+// set to a copy of the path of the next segment or NULL if there is none.
+void ytp_segment_records_load(ytp_yamal_t *yamal, const char *path,
+                              ytp_mmnode_offs *base,
+                              struct ytp_segment_stream_t **streams,
+                              char **next, fmc_error_t **error);
+
+// Returns the id of the first announcement of a stream of the segment
+ytp_mmnode_offs ytp_segment_stream_global(struct ytp_segment_stream_t **streams,
+                                          ytp_mmnode_offs base,
+                                          ytp_mmnode_offs local,
+                                          fmc_error_t **error);
+
+void ytp_segment_streams_clear(struct ytp_segment_stream_t **streams);
+
+// Opens a segment file for reading
+void ytp_cursor_segment_open(struct ytp_cursor_segment_t *segment,
+                             const char *path, fmc_error_t **error);
+
+void ytp_cursor_segment_close(struct ytp_cursor_segment_t *segment);
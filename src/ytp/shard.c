@@ -0,0 +1,539 @@
+/******************************************************************************
+        COPYRIGHT (c) 2019-2023 by Featuremine Corporation.
+
+        This Source Code Form is subject to the terms of the Mozilla Public
+        License, v. 2.0. If a copy of the MPL was not distributed with this
+        file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *****************************************************************************/
+
+#include "cursor.h"
+
+#include <fmc/error.h>
+#include <fmc/platform.h>
+#include <fmc/time.h>
+#include <ytp/cursor.h>
+#include <ytp/shard.h>
+
+#include <uthash/utarray.h>
+#include <uthash/uthash.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(FMC_SYS_LINUX)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#undef utarray_oom
+#define utarray_oom()                                                          \
+  do {                                                                         \
+    fmc_error_set2(error, FMC_ERROR_MEMORY);                                   \
+  } while (0)
+
+#undef uthash_fatal
+#undef HASH_RECORD_OOM
+#define HASH_RECORD_OOM(oomed) fmc_error_set2(error, FMC_ERROR_MEMORY)
+
+#define SHARD_CACHE_LINE 64
+// Entries a worker processes before it releases their slots
+#define SHARD_WORKER_BATCH 64
+// Time an idle worker spins before it parks
+#define SHARD_WORKER_SPIN_NS ((int64_t)(50 * 1000))
+
+enum shard_op { SHARD_DATA, SHARD_CB_ADD, SHARD_CB_RM };
+
+// Data entries point into the yamal mapping, pages stay mapped until the
+// yamal is destroyed. Callback entries keep the callbacks of a worker in
+// order with the data it receives.
+struct shard_entry_t {
+  enum shard_op op;
+  ytp_mmnode_offs stream;
+  union {
+    struct {
+      uint64_t seqno;
+      int64_t ts;
+      ytp_mmnode_offs original;
+      size_t sz;
+      const char *data;
+    } msg;
+    struct ytp_cursor_data_cb_cl_t cb;
+  };
+};
+
+// Single producer single consumer ring. Each side caches the last index it
+// read from the other side so the shared cache lines are only read when the
+// ring looks full or empty.
+struct shard_ring_t {
+  _Alignas(SHARD_CACHE_LINE) _Atomic size_t head;
+  size_t tail_cache;
+  _Alignas(SHARD_CACHE_LINE) _Atomic size_t tail;
+  size_t head_cache;
+  _Alignas(SHARD_CACHE_LINE) struct shard_entry_t *entries;
+  size_t mask;
+};
+
+struct shard_worker_t {
+  struct shard_ring_t ring;
+  struct ytp_shard *shard;
+  pthread_t thread;
+  struct ytp_cursor_streams_data_item_t *cb_data;
+  // Futex word bumped to wake the worker when it is parked
+  _Atomic uint32_t notify;
+  _Atomic bool parked;
+  _Atomic bool failed;
+  fmc_error_t error;
+};
+
+// Callbacks registered for a stream, the item is the closure of the
+// callback that forwards the messages of the stream to its worker
+struct shard_stream_t {
+  UT_hash_handle hh;
+  ytp_mmnode_offs stream;
+  struct ytp_shard *shard;
+  struct shard_worker_t *worker;
+  UT_array cb_data;
+};
+
+struct ytp_shard {
+  ytp_cursor_t cursor;
+  struct shard_worker_t *workers;
+  size_t count;
+  struct shard_stream_t *streams;
+  _Atomic bool done;
+};
+
+extern const UT_icd cb_data_icd;
+
+static bool shard_ring_empty(struct shard_ring_t *ring) {
+  return atomic_load_explicit(&ring->tail, memory_order_acquire) ==
+         atomic_load_explicit(&ring->head, memory_order_relaxed);
+}
+
+static void shard_worker_wake(struct shard_worker_t *worker) {
+  atomic_fetch_add_explicit(&worker->notify, 1, memory_order_relaxed);
+#if defined(FMC_SYS_LINUX)
+  int saved_errno = errno;
+  syscall(SYS_futex, &worker->notify, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+  errno = saved_errno;
+#endif
+}
+
+// The worker registers before checking the ring again, so either it sees the
+// new entry or the producer sees it parked
+static void shard_worker_park(struct shard_worker_t *worker, size_t tail) {
+  uint32_t notify =
+      atomic_load_explicit(&worker->notify, memory_order_relaxed);
+  atomic_store(&worker->parked, true);
+  if (tail == atomic_load(&worker->ring.head) &&
+      !atomic_load(&worker->shard->done)) {
+#if defined(FMC_SYS_LINUX)
+    int saved_errno = errno;
+    syscall(SYS_futex, &worker->notify, FUTEX_WAIT_PRIVATE, notify, NULL,
+            NULL, 0);
+    errno = saved_errno;
+#else
+    sched_yield();
+#endif
+  }
+  atomic_store_explicit(&worker->parked, false, memory_order_relaxed);
+}
+
+static void shard_push(struct shard_worker_t *worker,
+                       const struct shard_entry_t *entry) {
+  struct shard_ring_t *ring = &worker->ring;
+  size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  while (head - ring->tail_cache > ring->mask) {
+    ring->tail_cache = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head - ring->tail_cache > ring->mask) {
+      sched_yield();
+    }
+  }
+  ring->entries[head & ring->mask] = *entry;
+  atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+  atomic_thread_fence(memory_order_seq_cst);
+  if (atomic_load_explicit(&worker->parked, memory_order_relaxed)) {
+    shard_worker_wake(worker);
+  }
+}
+
+static void shard_worker_fail(struct shard_worker_t *worker,
+                              fmc_error_t *error) {
+  if (!atomic_load_explicit(&worker->failed, memory_order_relaxed)) {
+    fmc_error_cpy(&worker->error, error);
+    atomic_store_explicit(&worker->failed, true, memory_order_release);
+  }
+}
+
+static void shard_worker_process(struct shard_worker_t *worker,
+                                 struct shard_entry_t *entry) {
+  fmc_error_t *err;
+  fmc_error_t **error = &err;
+  fmc_error_clear(error);
+  struct ytp_cursor_streams_data_item_t *item;
+  switch (entry->op) {
+  case SHARD_DATA:
+    item = streams_data_get(worker->cb_data, entry->stream);
+    if (item == NULL) {
+      return;
+    }
+    for (size_t i = utarray_len(&item->cb_data); i-- > 0;) {
+      struct ytp_cursor_data_cb_cl_t *p;
+      p = _utarray_eltptr(&item->cb_data, i);
+      p->cb(p->cl, entry->msg.seqno, entry->msg.ts, entry->msg.original,
+            entry->msg.sz, entry->msg.data);
+    }
+    return;
+  case SHARD_CB_ADD:
+    item = streams_data_emplace(&worker->cb_data, entry->stream, error);
+    if (*error) {
+      shard_worker_fail(worker, *error);
+      return;
+    }
+    utarray_push_back(&item->cb_data, &entry->cb);
+    if (*error) {
+      shard_worker_fail(worker, *error);
+    }
+    return;
+  case SHARD_CB_RM:
+    item = streams_data_get(worker->cb_data, entry->stream);
+    if (item == NULL) {
+      return;
+    }
+    for (size_t i = utarray_len(&item->cb_data); i-- > 0;) {
+      struct ytp_cursor_data_cb_cl_t *p;
+      p = _utarray_eltptr(&item->cb_data, i);
+      if (p->cb == entry->cb.cb && p->cl == entry->cb.cl) {
+        utarray_erase(&item->cb_data, i, 1);
+      }
+    }
+    return;
+  }
+}
+
+static void *shard_worker_run(void *closure) {
+  struct shard_worker_t *worker = (struct shard_worker_t *)closure;
+  struct shard_ring_t *ring = &worker->ring;
+  size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  int64_t idle_start = 0;
+  while (true) {
+    if (tail == ring->head_cache) {
+      ring->head_cache =
+          atomic_load_explicit(&ring->head, memory_order_acquire);
+      if (tail == ring->head_cache) {
+        // done is only checked once the ring is empty, so every entry pushed
+        // before the shard is deleted is processed
+        if (atomic_load_explicit(&worker->shard->done, memory_order_acquire) &&
+            tail == atomic_load_explicit(&ring->head, memory_order_acquire)) {
+          return NULL;
+        }
+        int64_t now = fmc_cur_time_ns();
+        if (idle_start == 0) {
+          idle_start = now;
+        } else if (now - idle_start >= SHARD_WORKER_SPIN_NS) {
+          shard_worker_park(worker, tail);
+          idle_start = 0;
+          continue;
+        }
+        sched_yield();
+        continue;
+      }
+    }
+    idle_start = 0;
+    size_t end = ring->head_cache;
+    if (end - tail > SHARD_WORKER_BATCH) {
+      end = tail + SHARD_WORKER_BATCH;
+    }
+    for (; tail != end; ++tail) {
+      shard_worker_process(worker, &ring->entries[tail & ring->mask]);
+    }
+    atomic_store_explicit(&ring->tail, tail, memory_order_release);
+  }
+}
+
+static void shard_worker_destroy(struct shard_worker_t *worker) {
+  struct ytp_cursor_streams_data_item_t *item;
+  struct ytp_cursor_streams_data_item_t *tmp;
+  HASH_ITER(hh, worker->cb_data, item, tmp) {
+    HASH_DEL(worker->cb_data, item);
+    utarray_done(&item->cb_data);
+    free(item);
+  }
+  fmc_error_destroy(&worker->error);
+  free(worker->ring.entries);
+}
+
+static void shard_stop(ytp_shard_t *shard, size_t started) {
+  atomic_store(&shard->done, true);
+  for (size_t i = 0; i < started; ++i) {
+    shard_worker_wake(&shard->workers[i]);
+  }
+  for (size_t i = 0; i < started; ++i) {
+    pthread_join(shard->workers[i].thread, NULL);
+  }
+  for (size_t i = 0; i < shard->count; ++i) {
+    shard_worker_destroy(&shard->workers[i]);
+  }
+}
+
+ytp_shard_t *ytp_shard_new(ytp_yamal_t *yamal, size_t workers,
+                           size_t ring_size, fmc_error_t **error) {
+  fmc_error_clear(error);
+  if (workers == 0) {
+    fmc_error_set(error, "shard requires at least one worker");
+    return NULL;
+  }
+  size_t capacity = 2;
+  while (capacity < ring_size) {
+    capacity <<= 1;
+  }
+
+  ytp_shard_t *shard = (ytp_shard_t *)calloc(1, sizeof(ytp_shard_t));
+  if (!shard) {
+    fmc_error_set2(error, FMC_ERROR_MEMORY);
+    return NULL;
+  }
+  ytp_cursor_init(&shard->cursor, yamal, error);
+  if (*error) {
+    free(shard);
+    return NULL;
+  }
+  shard->workers = (struct shard_worker_t *)aligned_alloc(
+      SHARD_CACHE_LINE, sizeof(struct shard_worker_t) * workers);
+  if (!shard->workers) {
+    fmc_error_set2(error, FMC_ERROR_MEMORY);
+    goto cleanup_cursor;
+  }
+  memset(shard->workers, 0, sizeof(struct shard_worker_t) * workers);
+  shard->count = workers;
+  atomic_init(&shard->done, false);
+
+  for (size_t i = 0; i < workers; ++i) {
+    struct shard_worker_t *worker = &shard->workers[i];
+    worker->shard = shard;
+    fmc_error_init_none(&worker->error);
+    atomic_init(&worker->notify, 0);
+    atomic_init(&worker->parked, false);
+    atomic_init(&worker->failed, false);
+    atomic_init(&worker->ring.head, 0);
+    atomic_init(&worker->ring.tail, 0);
+    worker->ring.mask = capacity - 1;
+    worker->ring.entries = (struct shard_entry_t *)calloc(
+        capacity, sizeof(struct shard_entry_t));
+    if (!worker->ring.entries) {
+      fmc_error_set2(error, FMC_ERROR_MEMORY);
+      shard_stop(shard, 0);
+      goto cleanup_workers;
+    }
+  }
+
+  for (size_t i = 0; i < workers; ++i) {
+    if (pthread_create(&shard->workers[i].thread, NULL, shard_worker_run,
+                       &shard->workers[i]) != 0) {
+      fmc_error_set(error, "unable to start shard worker: %s",
+                    fmc_syserror_msg());
+      shard_stop(shard, i);
+      goto cleanup_workers;
+    }
+  }
+  return shard;
+
+cleanup_workers:
+  free(shard->workers);
+cleanup_cursor:;
+  fmc_error_t *err;
+  ytp_cursor_destroy(&shard->cursor, &err);
+  free(shard);
+  return NULL;
+}
+
+void ytp_shard_del(ytp_shard_t *shard, fmc_error_t **error) {
+  fmc_error_clear(error);
+  shard_stop(shard, shard->count);
+  free(shard->workers);
+
+  struct shard_stream_t *item;
+  struct shard_stream_t *tmp;
+  HASH_ITER(hh, shard->streams, item, tmp) {
+    HASH_DEL(shard->streams, item);
+    utarray_done(&item->cb_data);
+    free(item);
+  }
+
+  ytp_cursor_destroy(&shard->cursor, error);
+  free(shard);
+}
+
+void ytp_shard_ann_cb(ytp_shard_t *shard, ytp_cursor_ann_cb_t cb,
+                      void *closure, fmc_error_t **error) {
+  ytp_cursor_ann_cb(&shard->cursor, cb, closure, error);
+}
+
+void ytp_shard_ann_cb_rm(ytp_shard_t *shard, ytp_cursor_ann_cb_t cb,
+                         void *closure, fmc_error_t **error) {
+  ytp_cursor_ann_cb_rm(&shard->cursor, cb, closure, error);
+}
+
+static void shard_forward(void *closure, uint64_t seqno, int64_t ts,
+                          ytp_mmnode_offs stream, size_t sz,
+                          const char *data) {
+  struct shard_stream_t *item = (struct shard_stream_t *)closure;
+  struct shard_entry_t entry;
+  entry.op = SHARD_DATA;
+  entry.stream = item->stream;
+  entry.msg.seqno = seqno;
+  entry.msg.ts = ts;
+  entry.msg.original = stream;
+  entry.msg.sz = sz;
+  entry.msg.data = data;
+  shard_push(item->worker, &entry);
+}
+
+// Streams are assigned to workers with a multiplicative hash of the id
+static struct shard_worker_t *shard_worker(ytp_shard_t *shard,
+                                           ytp_mmnode_offs stream) {
+  uint64_t hash = (uint64_t)stream * 0x9e3779b97f4a7c15ull;
+  return &shard->workers[(hash >> 32) % shard->count];
+}
+
+void ytp_shard_data_cb(ytp_shard_t *shard, ytp_mmnode_offs stream,
+                       ytp_cursor_data_cb_t cb, void *closure,
+                       fmc_error_t **error) {
+  fmc_error_clear(error);
+
+  struct shard_stream_t *item;
+  HASH_FIND(hh, shard->streams, &stream, sizeof(stream), item);
+  if (item == NULL) {
+    item = (struct shard_stream_t *)malloc(sizeof(struct shard_stream_t));
+    if (!item) {
+      fmc_error_set2(error, FMC_ERROR_MEMORY);
+      return;
+    }
+    item->stream = stream;
+    item->shard = shard;
+    item->worker = shard_worker(shard, stream);
+    utarray_init(&item->cb_data, &cb_data_icd);
+    HASH_ADD(hh, shard->streams, stream, sizeof(stream), item);
+    if (*error) {
+      utarray_done(&item->cb_data);
+      free(item);
+      return;
+    }
+  }
+
+  for (size_t i = utarray_len(&item->cb_data); i-- > 0;) {
+    struct ytp_cursor_data_cb_cl_t *p;
+    p = _utarray_eltptr(&item->cb_data, i);
+    if (p->cb == cb && p->cl == closure) {
+      return;
+    }
+  }
+
+  struct ytp_cursor_data_cb_cl_t arr_item;
+  arr_item.cb = cb;
+  arr_item.cl = closure;
+  utarray_push_back(&item->cb_data, &arr_item);
+  if (*error) {
+    return;
+  }
+
+  if (utarray_len(&item->cb_data) == 1) {
+    ytp_cursor_data_cb(&shard->cursor, stream, shard_forward, item, error);
+    if (*error) {
+      utarray_pop_back(&item->cb_data);
+      return;
+    }
+  }
+
+  struct shard_entry_t entry;
+  entry.op = SHARD_CB_ADD;
+  entry.stream = stream;
+  entry.cb = arr_item;
+  shard_push(item->worker, &entry);
+}
+
+void ytp_shard_data_cb_rm(ytp_shard_t *shard, ytp_mmnode_offs stream,
+                          ytp_cursor_data_cb_t cb, void *closure,
+                          fmc_error_t **error) {
+  fmc_error_clear(error);
+
+  struct shard_stream_t *item;
+  HASH_FIND(hh, shard->streams, &stream, sizeof(stream), item);
+  if (item == NULL) {
+    return;
+  }
+
+  bool found = false;
+  for (size_t i = utarray_len(&item->cb_data); i-- > 0;) {
+    struct ytp_cursor_data_cb_cl_t *p;
+    p = _utarray_eltptr(&item->cb_data, i);
+    if (p->cb == cb && p->cl == closure) {
+      utarray_erase(&item->cb_data, i, 1);
+      found = true;
+    }
+  }
+  if (!found) {
+    return;
+  }
+
+  if (utarray_len(&item->cb_data) == 0) {
+    ytp_cursor_data_cb_rm(&shard->cursor, stream, shard_forward, item, error);
+    if (*error) {
+      return;
+    }
+  }
+
+  struct shard_entry_t entry;
+  entry.op = SHARD_CB_RM;
+  entry.stream = stream;
+  entry.cb.cb = cb;
+  entry.cb.cl = closure;
+  shard_push(item->worker, &entry);
+}
+
+// Reports the first error of a worker
+static bool shard_check(ytp_shard_t *shard, fmc_error_t **error) {
+  for (size_t i = 0; i < shard->count; ++i) {
+    struct shard_worker_t *worker = &shard->workers[i];
+    if (atomic_load_explicit(&worker->failed, memory_order_acquire)) {
+      fmc_error_set(error, "shard worker %zu failed: %s", i,
+                    fmc_error_msg(&worker->error));
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ytp_shard_poll(ytp_shard_t *shard, fmc_error_t **error) {
+  bool polled = ytp_cursor_poll(&shard->cursor, error);
+  if (*error || !shard_check(shard, error)) {
+    return false;
+  }
+  return polled;
+}
+
+size_t ytp_shard_poll_n(ytp_shard_t *shard, size_t max_msgs, int64_t max_ns,
+                        fmc_error_t **error) {
+  size_t count = ytp_cursor_poll_n(&shard->cursor, max_msgs, max_ns, error);
+  if (*error) {
+    return count;
+  }
+  shard_check(shard, error);
+  return count;
+}
+
+void ytp_shard_drain(ytp_shard_t *shard, fmc_error_t **error) {
+  fmc_error_clear(error);
+  for (size_t i = 0; i < shard->count; ++i) {
+    while (!shard_ring_empty(&shard->workers[i].ring)) {
+      sched_yield();
+    }
+  }
+  shard_check(shard, error);
+}
@@ -0,0 +1,248 @@
+/******************************************************************************
+        COPYRIGHT (c) 2019-2023 by Featuremine Corporation.
+
+        This Source Code Form is subject to the terms of the Mozilla Public
+        License, v. 2.0. If a copy of the MPL was not distributed with this
+        file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *****************************************************************************/
+
+#include "cursor.h"
+#include "endianess.h"
+
+#include <fmc/component.h>
+#include <fmc/error.h>
+#include <fmc/reactor.h>
+#include <fmc/time.h>
+#include <ytp/data.h>
+#include <ytp/telemetry.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <uthash/utarray.h>
+#include <unistd.h>
+
+// Records published for the yamal itself
+#define YTP_TELEMETRY_YAMAL_RECORDS 4
+
+struct ytp_telemetry {
+  ytp_yamal_t *yamal;
+  ytp_mmnode_offs stream;
+  int64_t period;
+  int64_t last;
+  size_t sync_allocs;
+  UT_array cursors;
+  struct fmc_reactor *reactor;
+};
+
+static const UT_icd cursors_icd = {sizeof(ytp_cursor_t *), NULL, NULL, NULL};
+
+ytp_telemetry_t *ytp_telemetry_new(ytp_yamal_t *yamal, ytp_streams_t *streams,
+                                   int64_t period_ns, fmc_error_t **error) {
+  fmc_error_clear(error);
+  if (period_ns < 0) {
+    FMC_ERROR_REPORT(error, "invalid telemetry period");
+    return NULL;
+  }
+  ytp_mmnode_offs stream = ytp_streams_announce(
+      streams, strlen(YTP_TELEMETRY_PEER), YTP_TELEMETRY_PEER,
+      strlen(YTP_TELEMETRY_CHANNEL), YTP_TELEMETRY_CHANNEL,
+      strlen(YTP_TELEMETRY_ENCODING), YTP_TELEMETRY_ENCODING, error);
+  if (*error) {
+    return NULL;
+  }
+  ytp_telemetry_t *telemetry =
+      (ytp_telemetry_t *)calloc(1, sizeof(ytp_telemetry_t));
+  if (!telemetry) {
+    fmc_error_set2(error, FMC_ERROR_MEMORY);
+    return NULL;
+  }
+  telemetry->yamal = yamal;
+  telemetry->stream = stream;
+  telemetry->period = period_ns;
+  telemetry->last = fmc_cur_time_ns();
+  telemetry->sync_allocs = ytp_yamal_sync_allocations(yamal);
+  utarray_init(&telemetry->cursors, &cursors_icd);
+  ytp_yamal_stats_set(yamal, true);
+  return telemetry;
+}
+
+void ytp_telemetry_del(ytp_telemetry_t *telemetry, fmc_error_t **error) {
+  fmc_error_clear(error);
+  ytp_yamal_stats_set(telemetry->yamal, false);
+  if (telemetry->reactor) {
+    fmc_reactor_stats_set(telemetry->reactor, false);
+  }
+  utarray_done(&telemetry->cursors);
+  free(telemetry);
+}
+
+size_t ytp_telemetry_cursor_add(ytp_telemetry_t *telemetry,
+                                ytp_cursor_t *cursor, fmc_error_t **error) {
+  fmc_error_clear(error);
+  utarray_push_back(&telemetry->cursors, &cursor);
+  return utarray_len(&telemetry->cursors) - 1;
+}
+
+void ytp_telemetry_reactor_set(ytp_telemetry_t *telemetry,
+                               struct fmc_reactor *reactor) {
+  if (telemetry->reactor) {
+    fmc_reactor_stats_set(telemetry->reactor, false);
+  }
+  telemetry->reactor = reactor;
+  if (reactor) {
+    fmc_reactor_stats_set(reactor, true);
+  }
+}
+
+static void ytp_telemetry_record_set(struct ytp_telemetry_record *record,
+                                     uint16_t metric, size_t id, size_t count,
+                                     int64_t total, int64_t max) {
+  record->metric = htoye16(metric);
+  record->id = htoye16((uint16_t)id);
+  record->count = htoye32((uint32_t)count);
+  record->total = htoye64(total);
+  record->max = htoye64(max);
+}
+
+// Bytes reserved after the next message of the cursor
+static int64_t ytp_telemetry_cursor_lag(ytp_cursor_t *cursor,
+                                        fmc_error_t **error) {
+  ytp_yamal_t *yamal = cursor->yamal;
+  ytp_iterator_t it = cursor->it_data;
+  if (ytp_yamal_term(it)) {
+    return 0;
+  }
+  size_t reserved = ytp_yamal_reserved_size(yamal, error);
+  if (*error) {
+    return 0;
+  }
+  ytp_iterator_t next = ytp_yamal_next(yamal, it, error);
+  if (*error) {
+    return 0;
+  }
+  size_t offset = ytp_yamal_tell(yamal, next, error);
+  if (*error) {
+    return 0;
+  }
+  return reserved > offset ? (int64_t)(reserved - offset) : 0;
+}
+
+void ytp_telemetry_publish(ytp_telemetry_t *telemetry, fmc_error_t **error) {
+  fmc_error_clear(error);
+  ytp_yamal_t *yamal = telemetry->yamal;
+  size_t ncursors = utarray_len(&telemetry->cursors);
+  size_t ncomps = telemetry->reactor ? telemetry->reactor->size : 0;
+  size_t count = YTP_TELEMETRY_YAMAL_RECORDS + ncursors + ncomps;
+  if (count > UINT16_MAX) {
+    FMC_ERROR_REPORT(error, "too many telemetry records");
+    return;
+  }
+
+  // Taken first, the message itself is accounted for in the next one
+  struct ytp_yamal_stat reserve, commit, sync;
+  ytp_yamal_stats_take(yamal, &reserve, &commit, &sync);
+  size_t sync_allocs = ytp_yamal_sync_allocations(yamal);
+  char *data = ytp_data_reserve(
+      yamal,
+      sizeof(struct ytp_telemetry_hdr) +
+          count * sizeof(struct ytp_telemetry_record),
+      error);
+  if (*error) {
+    return;
+  }
+  int64_t now = fmc_cur_time_ns();
+  struct ytp_telemetry_hdr *hdr = (struct ytp_telemetry_hdr *)data;
+  hdr->pid = htoye32((uint32_t)getpid());
+  hdr->version = htoye16(YTP_TELEMETRY_VERSION);
+  hdr->count = htoye16((uint16_t)count);
+  hdr->period = htoye64(now - telemetry->last);
+  telemetry->last = now;
+
+  struct ytp_telemetry_record *record =
+      (struct ytp_telemetry_record *)(hdr + 1);
+  ytp_telemetry_record_set(record++, YTP_TELEMETRY_RESERVE, 0, reserve.count,
+                           reserve.total, reserve.max);
+  ytp_telemetry_record_set(record++, YTP_TELEMETRY_COMMIT, 0, commit.count,
+                           commit.total, commit.max);
+  ytp_telemetry_record_set(record++, YTP_TELEMETRY_SYNC_ALLOCS, 0,
+                           sync_allocs - telemetry->sync_allocs, sync_allocs,
+                           0);
+  ytp_telemetry_record_set(record++, YTP_TELEMETRY_AUX_SYNC, 0, sync.count,
+                           sync.total, sync.max);
+  telemetry->sync_allocs = sync_allocs;
+
+  // The message is reserved, it is committed even if a cursor fails and the
+  // first error is reported afterwards. The lag of a failed cursor is zero.
+  struct fmc_error saved_error;
+  fmc_error_init_none(&saved_error);
+  for (size_t i = 0; i < ncursors; ++i) {
+    ytp_cursor_t *cursor =
+        *(ytp_cursor_t **)utarray_eltptr(&telemetry->cursors, i);
+    int64_t lag = ytp_telemetry_cursor_lag(cursor, error);
+    if (*error) {
+      if (!fmc_error_has(&saved_error)) {
+        fmc_error_cpy(&saved_error, *error);
+      }
+      fmc_error_clear(error);
+      lag = 0;
+    }
+    ytp_telemetry_record_set(record++, YTP_TELEMETRY_CURSOR_LAG, i, 1, lag,
+                             lag);
+  }
+  for (size_t i = 0; i < ncomps; ++i) {
+    struct fmc_reactor_stat stat;
+    fmc_reactor_ctx_stat_take(telemetry->reactor->ctxs[i], &stat);
+    ytp_telemetry_record_set(record++, YTP_TELEMETRY_EXEC, i, stat.count,
+                             stat.total, stat.max);
+  }
+
+  ytp_data_commit(yamal, now, telemetry->stream, data, error);
+  if (!*error && fmc_error_has(&saved_error)) {
+    *error = fmc_error_inst();
+    fmc_error_mov(*error, &saved_error);
+  }
+  fmc_error_destroy(&saved_error);
+}
+
+bool ytp_telemetry_poll(ytp_telemetry_t *telemetry, fmc_error_t **error) {
+  fmc_error_clear(error);
+  if (fmc_cur_time_ns() - telemetry->last < telemetry->period) {
+    return false;
+  }
+  ytp_telemetry_publish(telemetry, error);
+  return !*error;
+}
+
+size_t ytp_telemetry_decode(const char *data, size_t sz,
+                            struct ytp_telemetry_hdr *hdr,
+                            struct ytp_telemetry_record *records, size_t max,
+                            fmc_error_t **error) {
+  fmc_error_clear(error);
+  if (sz < sizeof(struct ytp_telemetry_hdr)) {
+    FMC_ERROR_REPORT(error, "invalid telemetry message size");
+    return 0;
+  }
+  memcpy(hdr, data, sizeof(*hdr));
+  hdr->pid = ye32toh(hdr->pid);
+  hdr->version = ye16toh(hdr->version);
+  hdr->count = ye16toh(hdr->count);
+  hdr->period = ye64toh(hdr->period);
+  if (hdr->version != YTP_TELEMETRY_VERSION) {
+    FMC_ERROR_REPORT(error, "unsupported telemetry version");
+    return 0;
+  }
+  if (sz < sizeof(*hdr) + hdr->count * sizeof(struct ytp_telemetry_record)) {
+    FMC_ERROR_REPORT(error, "invalid telemetry message size");
+    return 0;
+  }
+  size_t count = hdr->count < max ? hdr->count : max;
+  memcpy(records, data + sizeof(*hdr), count * sizeof(*records));
+  for (size_t i = 0; i < count; ++i) {
+    records[i].metric = ye16toh(records[i].metric);
+    records[i].id = ye16toh(records[i].id);
+    records[i].count = ye32toh(records[i].count);
+    records[i].total = ye64toh(records[i].total);
+    records[i].max = ye64toh(records[i].max);
+  }
+  return count;
+}
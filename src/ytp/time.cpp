@@ -27,6 +27,26 @@ char *ytp_time_reserve(ytp_yamal_t *yamal, size_t size, fmc_error_t **error) {
   return time_msg->data;
 }
 
+void ytp_time_reserve_batch(ytp_yamal_t *yamal, const size_t *sizes,
+                            char **data, size_t count, fmc_error_t **error) {
+  fmc_error_clear(error);
+  if (count > YTP_YAMAL_BATCH_MAX) {
+    FMC_ERROR_REPORT(error, "batch count out of range");
+    return;
+  }
+  size_t time_sizes[YTP_YAMAL_BATCH_MAX];
+  for (size_t i = 0; i < count; ++i) {
+    time_sizes[i] = sizes[i] + sizeof(struct ytp_time_msg);
+  }
+  ytp_yamal_reserve_batch(yamal, time_sizes, data, count, error);
+  if (*error) {
+    return;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    data[i] = ((struct ytp_time_msg *)data[i])->data;
+  }
+}
+
 ytp_iterator_t ytp_time_commit(ytp_yamal_t *yamal, int64_t ts, void *data,
                                size_t listidx, fmc_error_t **error) {
   struct ytp_time_msg *time_msg =
@@ -35,6 +55,23 @@ ytp_iterator_t ytp_time_commit(ytp_yamal_t *yamal, int64_t ts, void *data,
   return ytp_yamal_commit(yamal, time_msg, listidx, error);
 }
 
+ytp_iterator_t ytp_time_commit_batch(ytp_yamal_t *yamal, const int64_t *ts,
+                                     char *const *data, size_t count,
+                                     size_t listidx, fmc_error_t **error) {
+  fmc_error_clear(error);
+  if (count > YTP_YAMAL_BATCH_MAX) {
+    FMC_ERROR_REPORT(error, "batch count out of range");
+    return nullptr;
+  }
+  char *time_data[YTP_YAMAL_BATCH_MAX];
+  for (size_t i = 0; i < count; ++i) {
+    auto *time_msg = (ytp_time_msg *)(data[i] - sizeof(ytp_time_msg));
+    time_msg->ts = htoye64(ts[i]);
+    time_data[i] = (char *)time_msg;
+  }
+  return ytp_yamal_commit_batch(yamal, time_data, count, listidx, error);
+}
+
 void ytp_time_sublist_commit(ytp_yamal_t *yamal, int64_t ts, void **first_ptr,
                              void **last_ptr, void *new_ptr,
                              fmc_error_t **error) {
@@ -15,6 +15,7 @@
 #include <ytp/timeline.h>
 
 #include <fmc++/error.hpp>
+#include <fmc/time.h>
 
 #include "control.hpp"
 #include "timeline.hpp"
@@ -41,6 +42,26 @@ static void prfx_for_each(ytp_timeline_t *timeline, const std::string &namestr,
   }
 }
 
+template <typename T, typename F>
+static void data_cb_erase_if(ytp_timeline_t *timeline,
+                             fmc::lazy_rem_vector<T> &v, const F &f) {
+  if (timeline->cb_locked == 0) {
+    std::erase_if(v, f);
+  } else if (v.mark_if(f)) {
+    timeline->cb_removed = true;
+  }
+}
+
+static void data_cb_release(ytp_timeline_t *timeline) {
+  if (--timeline->cb_locked != 0 || !timeline->cb_removed) {
+    return;
+  }
+  timeline->cb_removed = false;
+  for (auto &&[channel, callbacks] : timeline->idx_cb) {
+    callbacks.compact();
+  }
+}
+
 static void channel_announcement(ytp_timeline_t *timeline, ytp_peer_t peer,
                                  ytp_channel_t channel, int64_t read_time,
                                  size_t name_sz, const char *name_ptr,
@@ -198,8 +219,9 @@ void ytp_timeline_prfx_cb_rm(ytp_timeline_t *timeline, size_t sz,
   }
 
   using V = decltype(timeline->idx_cb)::value_type;
-  prfx_for_each(timeline, namestr, [&c](V &v) {
-    std::erase_if(v, [&](const decltype(c) &item) { return c == item; });
+  prfx_for_each(timeline, namestr, [&](V &v) {
+    data_cb_erase_if(timeline, v,
+                     [&](const decltype(c) &item) { return c == item; });
   });
 }
 
@@ -220,7 +242,8 @@ void ytp_timeline_indx_cb_rm(ytp_timeline_t *timeline, ytp_channel_t channel,
   if (auto it_data = timeline->idx_cb.find(channel);
       it_data != timeline->idx_cb.end()) {
     auto &v = it_data->second;
-    std::erase_if(v, [&](const decltype(p) &item) { return p == item; });
+    data_cb_erase_if(timeline, v,
+                     [&](const decltype(p) &item) { return p == item; });
   }
 }
 
@@ -421,11 +444,12 @@ static bool ytp_timeline_poll_data(ytp_timeline_t *timeline,
   }
 
   timeline->it_data = next;
+  ytp_yamal_prefetch(&timeline->ctrl->yamal, next);
 
   auto &stream_data = stream_it->second;
   if (auto it = timeline->idx_cb.find(stream_data.channel);
       it != timeline->idx_cb.end()) {
-    it->second.lock();
+    ++timeline->cb_locked;
     for (auto it2 = it->second.begin(); it2 != it->second.end(); ++it2) {
       if (it2.was_removed()) {
         continue;
@@ -433,7 +457,7 @@ static bool ytp_timeline_poll_data(ytp_timeline_t *timeline,
       auto &c = *it2;
       c.first(c.second, stream_data.peer, stream_data.channel, ts, sz, data);
     }
-    it->second.release();
+    data_cb_release(timeline);
   }
 
   return true;
@@ -485,6 +509,39 @@ bool ytp_timeline_poll(ytp_timeline_t *timeline, fmc_error_t **error) {
   return false;
 }
 
+size_t ytp_timeline_poll_n(ytp_timeline_t *timeline, size_t max_msgs,
+                           int64_t max_ns, fmc_error_t **error) {
+  fmc_error_clear(error);
+  int64_t deadline = 0;
+  if (max_ns >= 0) {
+    int64_t now = fmc_cur_time_ns();
+    deadline = max_ns < INT64_MAX - now ? now + max_ns : INT64_MAX;
+  }
+
+  // Removed callbacks are compacted once, when the batch is released
+  ++timeline->cb_locked;
+
+  size_t count = 0;
+  bool idle = false;
+  while (count < max_msgs) {
+    if (!ytp_timeline_poll_noidle(timeline, error)) {
+      idle = !*error;
+      break;
+    }
+    ++count;
+    if (max_ns >= 0 && fmc_cur_time_ns() >= deadline) {
+      break;
+    }
+  }
+
+  data_cb_release(timeline);
+
+  if (idle && count == 0) {
+    ytp_timeline_poll_idle(timeline);
+  }
+  return count;
+}
+
 bool ytp_timeline_poll_until(ytp_timeline_t *timeline,
                              const ytp_timeline_t *src_timeline,
                              fmc_error_t **error) {
@@ -556,7 +613,15 @@ void ytp_timeline_cb_rm(ytp_timeline_t *timeline) {
     });
   }
 
-  timeline->idx_cb.clear();
+  // Vectors being dispatched must outlive the dispatch
+  if (timeline->cb_locked == 0) {
+    timeline->idx_cb.clear();
+  } else {
+    for (auto &&[channel, callbacks] : timeline->idx_cb) {
+      data_cb_erase_if(timeline, callbacks,
+                       [](const ytp_timeline_data_cb_cl_t &) { return true; });
+    }
+  }
   timeline->prfx_cb.clear();
   timeline->cb_peer.clear();
   timeline->cb_idle.clear();
@@ -50,6 +50,10 @@ struct ytp_timeline {
   fmc::stable_map<ch_key, fmc::lazy_rem_vector<ytp_timeline_data_cb_cl_t>>
       idx_cb;
   fmc::lazy_rem_vector<ytp_timeline_idle_cb_cl_t> cb_idle;
+  // While data callbacks are being dispatched removed data callbacks are
+  // only marked and the vectors are compacted once the last lock is released
+  int cb_locked = 0;
+  bool cb_removed = false;
   std::vector<uint8_t> ch_announced;
   std::vector<uint8_t> peer_announced;
   std::unordered_set<std::string_view> sub_announced;
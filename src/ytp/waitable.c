@@ -0,0 +1,227 @@
+/******************************************************************************
+        COPYRIGHT (c) 2019-2023 by Featuremine Corporation.
+
+        This Source Code Form is subject to the terms of the Mozilla Public
+        License, v. 2.0. If a copy of the MPL was not distributed with this
+        file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *****************************************************************************/
+
+#include "cursor.h"
+
+#include <fmc/error.h>
+#include <fmc/platform.h>
+#include <ytp/cursor.h>
+#include <ytp/stream.h>
+#include <ytp/waitable.h>
+
+#include <stdlib.h>
+
+#if defined(FMC_SYS_LINUX)
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+// Longest time the bridge thread waits before checking if the waitable is
+// being deleted
+#define YTP_WAITABLE_WAIT_MAX ((int64_t)(100 * 1000 * 1000))
+
+struct ytp_waitable {
+  ytp_cursor_t *cursor;
+  int eventfd;
+  int64_t interval_ns;
+
+  // The bridge thread waits in ytp_yamal_wait at the position the cursor had
+  // after it was last polled, and makes the eventfd readable once there is
+  // something to read. The position is cleared when the eventfd is notified,
+  // so the bridge is idle until the cursor is polled again.
+#if defined(FMC_SYS_LINUX)
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+#endif
+  ytp_yamal_t *yamal;
+  ytp_iterator_t it_data;
+  ytp_iterator_t it_ann;
+  bool waiting;
+  bool done;
+};
+
+#if defined(FMC_SYS_LINUX)
+
+static void ytp_waitable_notify(ytp_waitable_t *waitable) {
+  uint64_t value = 1;
+  ssize_t ret = write(waitable->eventfd, &value, sizeof(value));
+  (void)ret;
+}
+
+// Announcements and closed segments do not move the data iterator, they are
+// checked every interval
+static bool ytp_waitable_ready(ytp_yamal_t *yamal, ytp_iterator_t it_data,
+                               ytp_iterator_t it_ann, int64_t interval_ns,
+                               fmc_error_t **error) {
+  if (ytp_yamal_wait(yamal, it_data, interval_ns, error) || *error) {
+    return true;
+  }
+  if (!ytp_yamal_term(it_ann)) {
+    return true;
+  }
+  return ytp_yamal_closed(yamal, YTP_STREAM_LIST_DATA, error) || *error;
+}
+
+static void *ytp_waitable_run(void *closure) {
+  ytp_waitable_t *waitable = (ytp_waitable_t *)closure;
+  pthread_mutex_lock(&waitable->mutex);
+  while (!waitable->done) {
+    if (!waitable->it_data) {
+      pthread_cond_wait(&waitable->cond, &waitable->mutex);
+      continue;
+    }
+    ytp_yamal_t *yamal = waitable->yamal;
+    ytp_iterator_t it_data = waitable->it_data;
+    ytp_iterator_t it_ann = waitable->it_ann;
+    waitable->waiting = true;
+    pthread_mutex_unlock(&waitable->mutex);
+
+    // Errors are reported by the cursor when it is polled
+    fmc_error_t *error;
+    bool ready = ytp_waitable_ready(yamal, it_data, it_ann,
+                                    waitable->interval_ns, &error);
+
+    pthread_mutex_lock(&waitable->mutex);
+    waitable->waiting = false;
+    pthread_cond_broadcast(&waitable->cond);
+    // The cursor may have been polled while waiting
+    if (ready && waitable->it_data == it_data) {
+      waitable->it_data = NULL;
+      ytp_waitable_notify(waitable);
+    }
+  }
+  pthread_mutex_unlock(&waitable->mutex);
+  return NULL;
+}
+
+ytp_waitable_t *ytp_waitable_new(ytp_cursor_t *cursor, int64_t interval_ns,
+                                 fmc_error_t **error) {
+  fmc_error_clear(error);
+  if (interval_ns <= 0) {
+    fmc_error_set(error, "waitable interval must be positive");
+    return NULL;
+  }
+  ytp_waitable_t *waitable = (ytp_waitable_t *)malloc(sizeof(*waitable));
+  if (!waitable) {
+    fmc_error_set2(error, FMC_ERROR_MEMORY);
+    return NULL;
+  }
+  waitable->cursor = cursor;
+  waitable->interval_ns =
+      interval_ns < YTP_WAITABLE_WAIT_MAX ? interval_ns : YTP_WAITABLE_WAIT_MAX;
+  waitable->yamal = NULL;
+  waitable->it_data = NULL;
+  waitable->it_ann = NULL;
+  waitable->waiting = false;
+  waitable->done = false;
+  waitable->eventfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (waitable->eventfd < 0) {
+    fmc_error_set(error, "unable to create waitable eventfd: %s",
+                  fmc_syserror_msg());
+    goto cleanup_waitable;
+  }
+  if (pthread_mutex_init(&waitable->mutex, NULL) != 0) {
+    fmc_error_set(error, "pthread_mutex_init failed");
+    goto cleanup_eventfd;
+  }
+  if (pthread_cond_init(&waitable->cond, NULL) != 0) {
+    fmc_error_set(error, "pthread_cond_init failed");
+    goto cleanup_mutex;
+  }
+  if (pthread_create(&waitable->thread, NULL, ytp_waitable_run, waitable) !=
+      0) {
+    fmc_error_set(error, "unable to start waitable thread: %s",
+                  fmc_syserror_msg());
+    goto cleanup_cond;
+  }
+  // Messages written before the waitable was created are read right away
+  ytp_waitable_notify(waitable);
+  return waitable;
+
+cleanup_cond:
+  pthread_cond_destroy(&waitable->cond);
+cleanup_mutex:
+  pthread_mutex_destroy(&waitable->mutex);
+cleanup_eventfd:
+  close(waitable->eventfd);
+cleanup_waitable:
+  free(waitable);
+  return NULL;
+}
+
+void ytp_waitable_del(ytp_waitable_t *waitable, fmc_error_t **error) {
+  fmc_error_clear(error);
+  pthread_mutex_lock(&waitable->mutex);
+  waitable->done = true;
+  pthread_cond_broadcast(&waitable->cond);
+  pthread_mutex_unlock(&waitable->mutex);
+  pthread_join(waitable->thread, NULL);
+  pthread_cond_destroy(&waitable->cond);
+  pthread_mutex_destroy(&waitable->mutex);
+  close(waitable->eventfd);
+  free(waitable);
+}
+
+int ytp_waitable_fd(ytp_waitable_t *waitable) { return waitable->eventfd; }
+
+size_t ytp_waitable_poll(ytp_waitable_t *waitable, size_t max_msgs,
+                         fmc_error_t **error) {
+  uint64_t value;
+  ssize_t ret = read(waitable->eventfd, &value, sizeof(value));
+  (void)ret;
+
+  ytp_cursor_t *cursor = waitable->cursor;
+  pthread_mutex_lock(&waitable->mutex);
+  waitable->it_data = NULL;
+  // Segment cursors close the file the bridge may be waiting on
+  while (cursor->segment && waitable->waiting) {
+    pthread_cond_wait(&waitable->cond, &waitable->mutex);
+  }
+  pthread_mutex_unlock(&waitable->mutex);
+
+  size_t count = ytp_cursor_poll_n(cursor, max_msgs, -1, error);
+  if (*error) {
+    return count;
+  }
+  if (count == max_msgs) {
+    ytp_waitable_notify(waitable);
+    return count;
+  }
+
+  pthread_mutex_lock(&waitable->mutex);
+  waitable->yamal = cursor->yamal;
+  waitable->it_data = cursor->it_data;
+  waitable->it_ann = cursor->it_ann;
+  pthread_cond_broadcast(&waitable->cond);
+  pthread_mutex_unlock(&waitable->mutex);
+  return count;
+}
+
+#else
+
+ytp_waitable_t *ytp_waitable_new(ytp_cursor_t *cursor, int64_t interval_ns,
+                                 fmc_error_t **error) {
+  FMC_ERROR_REPORT(error, "waitable cursors are not supported");
+  return NULL;
+}
+
+void ytp_waitable_del(ytp_waitable_t *waitable, fmc_error_t **error) {
+  FMC_ERROR_REPORT(error, "waitable cursors are not supported");
+}
+
+int ytp_waitable_fd(ytp_waitable_t *waitable) { return -1; }
+
+size_t ytp_waitable_poll(ytp_waitable_t *waitable, size_t max_msgs,
+                         fmc_error_t **error) {
+  FMC_ERROR_REPORT(error, "waitable cursors are not supported");
+  return 0;
+}
+
+#endif
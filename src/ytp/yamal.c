@@ -12,25 +12,77 @@
 #include <fmc/alignment.h>
 #include <fmc/error.h>
 #include <fmc/process.h>
+#include <fmc/time.h>
 #include <ytp/yamal.h>
 
 #include <errno.h>
+#include <limits.h>
 #include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+#if defined(FMC_SYS_LINUX)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+_Static_assert(sizeof(struct ytp_hdr) == YTP_YAMAL_HEADER_SIZE,
+               "yamal header size changed");
 
 static const char magic_number[8] = {'Y', 'A', 'M', 'A', 'L', '0', '0', '1'};
+// Files with a page size other than YTP_MMLIST_PAGE_SIZE, readers that do not
+// know about the page size in the header reject them
+static const char magic_number_2[8] = {'Y', 'A', 'M', 'A', 'L', '0', '0', '2'};
+
+// Pages that are a multiple of the huge page size are backed by huge pages
+// when the file is in memory
+static const size_t hugepage_size = 1024 * 1024 * 2;
+
+// Weight of the last aux thread period in the growth rate when it decreases
+static const double prealloc_rate_decay = 0.1;
 
+static struct ytp_yamal_page *mmlist_page(ytp_yamal_t *yamal, size_t page) {
+  struct ytp_yamal_page *chunk = atomic_load_cast(
+      &yamal->page_chunks_[page / YTP_MMLIST_PAGE_CHUNK_SIZE]);
+  return chunk ? chunk + page % YTP_MMLIST_PAGE_CHUNK_SIZE : NULL;
+}
+
+static void *mmlist_page_data(ytp_yamal_t *yamal, size_t page) {
+  struct ytp_yamal_page *mem_page = mmlist_page(yamal, page);
+  return mem_page ? atomic_load_cast(&mem_page->view.mem) : NULL;
+}
+
+// Pages are mapped without locking: every thread that misses a page maps it,
+// the first one to publish its mapping wins and the others unmap their copy
 static void *allocate_page(ytp_yamal_t *yamal, size_t page,
                            fmc_error_t **error) {
   fmc_error_clear(error);
-  struct fmc_fview *mem_page = &yamal->pages_[page];
-  void *page_ptr = fmc_fview_data(mem_page);
+  struct ytp_yamal_page *mem_page = mmlist_page(yamal, page);
+  if (!mem_page) {
+    struct ytp_yamal_page *chunk = (struct ytp_yamal_page *)calloc(
+        YTP_MMLIST_PAGE_CHUNK_SIZE, sizeof(struct ytp_yamal_page));
+    if (!chunk) {
+      fmc_error_set2(error, FMC_ERROR_MEMORY);
+      return NULL;
+    }
+    // A strong exchange only fails when another chunk was published
+    struct ytp_yamal_page *expected = NULL;
+    if (!atomic_compare_exchange_strong_cast(
+            &yamal->page_chunks_[page / YTP_MMLIST_PAGE_CHUNK_SIZE], &expected,
+            chunk)) {
+      free(chunk);
+      chunk = expected;
+    }
+    mem_page = chunk + page % YTP_MMLIST_PAGE_CHUNK_SIZE;
+  }
+  void *page_ptr = atomic_load_cast(&mem_page->view.mem);
 
   if (!page_ptr) {
-    size_t f_offset = page * YTP_MMLIST_PAGE_SIZE;
+    size_t f_offset = page * yamal->page_size_;
     if (!yamal->readonly_) {
-      fmc_falloc(yamal->fd_, f_offset + YTP_MMLIST_PAGE_SIZE, error);
+      fmc_falloc(yamal->fd_, f_offset + yamal->page_size_, error);
       if (*error) {
         return NULL;
       }
@@ -39,21 +91,46 @@ static void *allocate_page(ytp_yamal_t *yamal, size_t page,
       if (*error) {
         return NULL;
       }
-      if (size < f_offset + YTP_MMLIST_PAGE_SIZE) {
+      if (size < f_offset + yamal->page_size_) {
         FMC_ERROR_REPORT(error, "unexpected EOF");
         return NULL;
       }
     }
 
-    fmc_fview_init(mem_page, YTP_MMLIST_PAGE_SIZE, yamal->fd_, f_offset, error);
+    struct fmc_fview view;
+    fmc_fview_init(&view, yamal->page_size_, yamal->fd_, f_offset, error);
     if (*error) {
       return NULL;
     }
-    page_ptr = fmc_fview_data(mem_page);
+    page_ptr = fmc_fview_data(&view);
     if (!page_ptr) {
       FMC_ERROR_REPORT(error, "mmap failed");
       return NULL;
     }
+    if (yamal->hugepages_) {
+      fmc_fview_advise_hugepages(&view, yamal->page_size_, error);
+      if (*error) {
+        fmc_error_t *err;
+        fmc_fview_destroy(&view, yamal->page_size_, &err);
+        return NULL;
+      }
+    }
+
+    void *expected = NULL;
+    if (!atomic_compare_exchange_strong_cast(&mem_page->view.mem, &expected,
+                                             page_ptr)) {
+      fmc_fview_destroy(&view, yamal->page_size_, error);
+      return *error ? NULL : expected;
+    }
+#if defined(FMC_SYS_WIN)
+    mem_page->view.md = view.md;
+#endif
+
+    struct ytp_yamal_page *head = atomic_load_cast(&yamal->mapped_pages_);
+    do {
+      mem_page->next_mapped = head;
+    } while (!atomic_compare_exchange_weak_check(&yamal->mapped_pages_, &head,
+                                                 mem_page));
   }
   return page_ptr;
 }
@@ -71,19 +148,15 @@ static void *get_mapped_memory(ytp_yamal_t *yamal, ytp_mmnode_offs offs,
                                fmc_error_t **error) {
   fmc_error_clear(error);
   size_t loffs = ye64toh(offs);
-  size_t page = loffs / YTP_MMLIST_PAGE_SIZE;
-  size_t mem_offset = loffs % YTP_MMLIST_PAGE_SIZE;
-  void *page_ptr = fmc_fview_data(&yamal->pages_[page]);
+  size_t page = loffs >> yamal->page_shift_;
+  size_t mem_offset = loffs & (yamal->page_size_ - 1);
+  if (page >= YTP_MMLIST_PAGE_COUNT_MAX) {
+    FMC_ERROR_REPORT(error, "page index out of range");
+    return NULL;
+  }
+  void *page_ptr = mmlist_page_data(yamal, page);
   if (!page_ptr) {
-    if (pthread_mutex_lock(&yamal->pa_mutex_) != 0) {
-      FMC_ERROR_REPORT(error, "pthread_mutex_lock failed");
-      return NULL;
-    }
     page_ptr = allocate_page(yamal, page, error);
-    if (pthread_mutex_unlock(&yamal->pa_mutex_) != 0) {
-      FMC_ERROR_REPORT(error, "pthread_mutex_unlock failed");
-      return NULL;
-    }
     if (*error) {
       return NULL;
     }
@@ -123,43 +196,181 @@ static void mmlist_pages_allocation(ytp_yamal_t *yamal, fmc_error_t **error) {
   }
 
   size_t yamal_size = ye64toh(atomic_load_cast(&hdr->size));
-  size_t pred_yamal_size = yamal_size + YTP_MMLIST_PREALLOC_SIZE;
-  size_t pred_page_idx = pred_yamal_size / YTP_MMLIST_PAGE_SIZE;
+  int64_t now = fmc_cur_time_ns();
+  int64_t elapsed = now - yamal->prealloc_last_;
+  if (yamal->prealloc_last_ != 0 && elapsed > 0) {
+    double rate = (double)(yamal_size - yamal->prealloc_size_) / elapsed;
+    yamal->prealloc_rate_ =
+        rate > yamal->prealloc_rate_
+            ? rate
+            : yamal->prealloc_rate_ +
+                  (rate - yamal->prealloc_rate_) * prealloc_rate_decay;
+  }
+  yamal->prealloc_last_ = now;
+  yamal->prealloc_size_ = yamal_size;
 
-  if (!fmc_fview_data(&yamal->pages_[pred_page_idx])) {
-    if (pthread_mutex_lock(&yamal->pa_mutex_) != 0) {
-      FMC_ERROR_REPORT(error, "pthread_mutex_lock failed");
-      return;
-    }
+  double lookahead = yamal->prealloc_rate_ * yamal->prealloc_horizon_;
+  if (lookahead > yamal->prealloc_max_) {
+    lookahead = yamal->prealloc_max_;
+  }
+  if (lookahead < YTP_MMLIST_PREALLOC_SIZE) {
+    lookahead = YTP_MMLIST_PREALLOC_SIZE;
+  }
+  size_t pred_yamal_size = yamal_size + (size_t)lookahead;
+  size_t pred_page_idx = pred_yamal_size >> yamal->page_shift_;
+
+  if (pred_page_idx >= YTP_MMLIST_PAGE_COUNT_MAX) {
+    FMC_ERROR_REPORT(error, "page index out of range");
+    return;
+  }
+
+  if (!mmlist_page_data(yamal, pred_page_idx)) {
     size_t page_idx = pred_page_idx;
-    for (; !fmc_fview_data(&yamal->pages_[page_idx]); page_idx--)
+    for (; !mmlist_page_data(yamal, page_idx); page_idx--)
       ;
     for (++page_idx; page_idx <= pred_page_idx; page_idx++) {
       allocate_page(yamal, page_idx, error);
       if (*error) {
-        goto cleanup;
+        return;
       }
     }
+  }
+}
 
-  cleanup:
-    if (pthread_mutex_unlock(&yamal->pa_mutex_) != 0) {
-      FMC_ERROR_REPORT(error, "pthread_mutex_unlock failed");
+// Records the time elapsed since start if the statistics are enabled
+static void ytp_yamal_stat_add(struct ytp_yamal_stat *stat, int64_t start) {
+  if (!start) {
+    return;
+  }
+  int64_t elapsed = fmc_cur_time_ns() - start;
+  atomic_fetch_add_cast(&stat->count, 1);
+  atomic_fetch_add_cast(&stat->total, elapsed);
+  int64_t max = atomic_load_cast(&stat->max);
+  while (elapsed > max &&
+         !atomic_compare_exchange_weak_check(&stat->max, &max, elapsed))
+    ;
+}
+
+// Returns the start time of an operation, 0 if the statistics are disabled
+static int64_t ytp_yamal_stat_start(ytp_yamal_t *yamal) {
+  return atomic_load_cast(&yamal->stats_) ? fmc_cur_time_ns() : 0;
+}
+
+static void ytp_yamal_stat_take(struct ytp_yamal_stat *stat,
+                                struct ytp_yamal_stat *out) {
+  out->count = atomic_exchange_cast(&stat->count, 0);
+  out->total = atomic_exchange_cast(&stat->total, 0);
+  out->max = atomic_exchange_cast(&stat->max, 0);
+}
+
+void ytp_yamal_stats_set(ytp_yamal_t *yamal, bool enable) {
+  atomic_store_cast(&yamal->stats_, enable);
+}
+
+void ytp_yamal_stats_take(ytp_yamal_t *yamal, struct ytp_yamal_stat *reserve,
+                          struct ytp_yamal_stat *commit,
+                          struct ytp_yamal_stat *sync) {
+  ytp_yamal_stat_take(&yamal->reserve_stat_, reserve);
+  ytp_yamal_stat_take(&yamal->commit_stat_, commit);
+  ytp_yamal_stat_take(&yamal->sync_stat_, sync);
+}
+
+// Must be called with m_ locked
+static void mmlist_sync(ytp_yamal_t *yamal, fmc_error_t **error) {
+  fmc_error_clear(error);
+  if (yamal->sync_mode_ == YTP_SYNC_NONE) {
+    return;
+  }
+  int64_t now = fmc_cur_time_ns();
+  if (now - yamal->sync_last_ < yamal->sync_interval_) {
+    return;
+  }
+  yamal->sync_last_ = now;
+  int64_t start = ytp_yamal_stat_start(yamal);
+
+  struct ytp_hdr *hdr = ytp_yamal_header(yamal, error);
+  if (*error) {
+    return;
+  }
+  size_t size = ye64toh(atomic_load_cast(&hdr->size));
+  size_t synced = yamal->synced_size_;
+  bool wait = yamal->sync_mode_ == YTP_SYNC_DURABLE;
+
+  // Only the pages written since the last synchronization are flushed. The
+  // page of the previous watermark is flushed whole, because nodes reserved
+  // before it may have been committed since.
+  size_t first = synced >> yamal->page_shift_;
+  size_t last = (size - 1) >> yamal->page_shift_;
+  for (size_t page = first; page <= last; ++page) {
+    struct ytp_yamal_page *mem_page = mmlist_page(yamal, page);
+    if (!mem_page || !atomic_load_cast(&mem_page->view.mem)) {
+      continue;
+    }
+    size_t end = page == last ? ((size - 1) & (yamal->page_size_ - 1)) + 1
+                              : yamal->page_size_;
+    fmc_fview_sync_2(&mem_page->view, 0, end, wait, error);
+    if (*error) {
+      return;
+    }
+  }
+  if (first != 0) {
+    fmc_fview_sync_2(&mmlist_page(yamal, 0)->view, 0, sizeof(struct ytp_hdr),
+                     wait, error);
+    if (*error) {
       return;
     }
   }
+  atomic_store_cast(&yamal->synced_size_, size);
+  ytp_yamal_stat_add(&yamal->sync_stat_, start);
 }
 
-static bool mmlist_sync1(ytp_yamal_t *yamal, fmc_error_t **err) {
-  fmc_error_clear(err);
-  for (size_t i = 0; i < YTP_MMLIST_PAGE_COUNT_MAX; ++i) {
-    if (fmc_fview_data(&yamal->pages_[i])) {
-      fmc_fview_sync(&yamal->pages_[i], YTP_MMLIST_PAGE_SIZE, err);
-      if (*err) {
-        return false;
-      }
-    }
+void ytp_yamal_set_sync(ytp_yamal_t *yamal, YTP_SYNC_MODE mode,
+                        int64_t interval_ns, fmc_error_t **error) {
+  fmc_error_clear(error);
+  if (mode != YTP_SYNC_NONE && mode != YTP_SYNC_ASYNC &&
+      mode != YTP_SYNC_DURABLE) {
+    FMC_ERROR_REPORT(error, "invalid sync mode");
+    return;
+  }
+  if (interval_ns < 0) {
+    FMC_ERROR_REPORT(error, "invalid sync interval");
+    return;
+  }
+  if (pthread_mutex_lock(&yamal->m_) != 0) {
+    FMC_ERROR_REPORT(error, "pthread_mutex_lock failed");
+    return;
+  }
+  yamal->sync_mode_ = mode;
+  yamal->sync_interval_ = interval_ns;
+  if (pthread_mutex_unlock(&yamal->m_) != 0) {
+    FMC_ERROR_REPORT(error, "pthread_mutex_unlock failed");
+  }
+}
+
+size_t ytp_yamal_synced_size(ytp_yamal_t *yamal) {
+  return atomic_load_cast(&yamal->synced_size_);
+}
+
+void ytp_yamal_set_prealloc(ytp_yamal_t *yamal, int64_t horizon_ns,
+                            size_t max_size, fmc_error_t **error) {
+  fmc_error_clear(error);
+  if (horizon_ns < 0) {
+    FMC_ERROR_REPORT(error, "invalid preallocation horizon");
+    return;
+  }
+  if (pthread_mutex_lock(&yamal->m_) != 0) {
+    FMC_ERROR_REPORT(error, "pthread_mutex_lock failed");
+    return;
+  }
+  yamal->prealloc_horizon_ = horizon_ns;
+  yamal->prealloc_max_ = max_size;
+  if (pthread_mutex_unlock(&yamal->m_) != 0) {
+    FMC_ERROR_REPORT(error, "pthread_mutex_unlock failed");
   }
-  return true;
+}
+
+size_t ytp_yamal_sync_allocations(ytp_yamal_t *yamal) {
+  return atomic_load_cast(&yamal->sync_allocs_);
 }
 
 inline static ytp_mmnode_offs *offset_from_iterator(ytp_iterator_t iterator) {
@@ -206,6 +417,125 @@ ytp_yamal_t *ytp_yamal_new_2(int fd, bool enable_thread, fmc_error_t **error) {
   return ytp_yamal_new_3(fd, enable_thread, YTP_UNCLOSABLE, error);
 }
 
+void ytp_yamal_init_3(ytp_yamal_t *yamal, int fd, bool enable_thread,
+                      YTP_CLOSABLE_MODE closable, fmc_error_t **error) {
+  ytp_yamal_init_4(yamal, fd, enable_thread, closable, 0, error);
+}
+
+ytp_yamal_t *ytp_yamal_new_3(int fd, bool enable_thread,
+                             YTP_CLOSABLE_MODE closable, fmc_error_t **error) {
+  return ytp_yamal_new_4(fd, enable_thread, closable, 0, error);
+}
+
+static size_t page_shift_from_size(size_t page_size) {
+  size_t shift = 0;
+  while (((size_t)1 << shift) < page_size) {
+    ++shift;
+  }
+  return shift;
+}
+
+static uint64_t mmlist_magic(size_t page_shift) {
+  return page_shift == page_shift_from_size(YTP_MMLIST_PAGE_SIZE)
+             ? *(uint64_t *)magic_number
+             : *(uint64_t *)magic_number_2;
+}
+
+static bool mmlist_magic_valid(uint64_t magic) {
+  return magic == *(uint64_t *)magic_number ||
+         magic == *(uint64_t *)magic_number_2;
+}
+
+static void mmlist_page_size_init(ytp_yamal_t *yamal, size_t page_size,
+                                  fmc_error_t **error) {
+  fmc_error_clear(error);
+  if (page_size != 0 && (page_size < YTP_MMLIST_PAGE_SIZE_MIN ||
+                         page_size > YTP_MMLIST_PAGE_SIZE_MAX ||
+                         (page_size & (page_size - 1)) != 0)) {
+    FMC_ERROR_REPORT(error, "invalid page size");
+    return;
+  }
+  size_t shift = page_shift_from_size(page_size);
+
+  size_t granularity = fmc_fview_granularity(yamal->fd_, error);
+  if (*error) {
+    return;
+  }
+  if (page_size % granularity != 0) {
+    FMC_ERROR_REPORT(
+        error, "page size is not a multiple of the file system page size");
+    return;
+  }
+
+  // The page size is needed to map the first page, so the header is read
+  // through a mapping of its own
+  if (!yamal->readonly_) {
+    fmc_falloc(yamal->fd_, granularity, error);
+    if (*error) {
+      return;
+    }
+  } else {
+    size_t size = fmc_fsize(yamal->fd_, error);
+    if (*error) {
+      return;
+    }
+    if (size < sizeof(struct ytp_hdr)) {
+      FMC_ERROR_REPORT(error, "unexpected EOF");
+      return;
+    }
+  }
+
+  struct fmc_fview view;
+  fmc_fview_init(&view, granularity, yamal->fd_, 0, error);
+  if (*error) {
+    return;
+  }
+  struct ytp_hdr *hdr = (struct ytp_hdr *)fmc_fview_data(&view);
+
+  size_t default_shift = page_shift_from_size(
+      granularity > YTP_MMLIST_PAGE_SIZE ? granularity : YTP_MMLIST_PAGE_SIZE);
+  // The page size is initialized before the magic number, so files with a
+  // magic number and no page size were created with the default page size
+  uint64_t magic = atomic_load_cast(&hdr->magic_number);
+  if (!yamal->readonly_ && magic == 0) {
+    atomic_expect_or_init(&hdr->page_shift,
+                          (uint8_t)(shift ? shift : default_shift));
+  }
+  size_t file_shift = atomic_load_cast(&hdr->page_shift);
+  if (file_shift == 0) {
+    file_shift = page_shift_from_size(YTP_MMLIST_PAGE_SIZE);
+  }
+
+  fmc_fview_destroy(&view, granularity, error);
+  if (*error) {
+    return;
+  }
+
+  if ((magic != 0 || yamal->readonly_) &&
+      (!mmlist_magic_valid(magic) ||
+       file_shift < page_shift_from_size(YTP_MMLIST_PAGE_SIZE_MIN) ||
+       file_shift > page_shift_from_size(YTP_MMLIST_PAGE_SIZE_MAX))) {
+    FMC_ERROR_REPORT(error, "invalid yamal file format");
+    return;
+  }
+
+  if (page_size != 0 && shift != file_shift) {
+    char errormsg[128];
+    snprintf(errormsg, sizeof(errormsg),
+             "configured page size %zu differs from file page size %zu",
+             page_size, (size_t)1 << file_shift);
+    FMC_ERROR_REPORT(error, errormsg);
+    return;
+  }
+
+  yamal->page_shift_ = file_shift;
+  yamal->page_size_ = (size_t)1 << file_shift;
+  // Huge pages are only advised for files in memory, in other file systems
+  // the advice has no effect
+  yamal->hugepages_ = yamal->page_size_ % hugepage_size == 0 &&
+                      fmc_fhugepages(yamal->fd_, error);
+}
+
 static void *ytp_aux_thread(void *closure) {
   ytp_yamal_t *yamal = (ytp_yamal_t *)closure;
   fmc_error_t *error;
@@ -228,7 +558,7 @@ static void *ytp_aux_thread(void *closure) {
       break;
     }
     mmlist_pages_allocation(yamal, &error);
-    mmlist_sync1(yamal, &error);
+    mmlist_sync(yamal, &error);
   }
   if (pthread_mutex_unlock(&yamal->m_) != 0) {
     FMC_ERROR_REPORT(&error, "pthread_mutex_unlock failed");
@@ -238,43 +568,66 @@ static void *ytp_aux_thread(void *closure) {
   return NULL;
 }
 
-void ytp_yamal_init_3(ytp_yamal_t *yamal, int fd, bool enable_thread,
-                      YTP_CLOSABLE_MODE closable, fmc_error_t **error) {
+void ytp_yamal_init_4(ytp_yamal_t *yamal, int fd, bool enable_thread,
+                      YTP_CLOSABLE_MODE closable, size_t page_size,
+                      fmc_error_t **error) {
   fmc_error_clear(error);
   if (pthread_mutex_init(&yamal->m_, NULL) != 0) {
     goto cleanup_0;
   }
 
-  if (pthread_mutex_init(&yamal->pa_mutex_, NULL) != 0) {
-    goto cleanup_1;
-  }
-
   if (pthread_cond_init(&yamal->cv_, NULL) != 0) {
-    goto cleanup_2;
+    goto cleanup_1;
   }
 
-  memset(yamal->pages_, 0, sizeof(yamal->pages_));
+  yamal->mapped_pages_ = NULL;
+  memset(yamal->page_chunks_, 0, sizeof(yamal->page_chunks_));
   yamal->fd_ = fd;
   yamal->done_ = false;
   yamal->readonly_ = fmc_freadonly(fd);
   yamal->thread_created_ = false;
+  yamal->sync_mode_ = YTP_SYNC_ASYNC;
+  yamal->sync_interval_ = YTP_YAMAL_SYNC_INTERVAL_DEFAULT;
+  yamal->sync_last_ = 0;
+  yamal->synced_size_ = 0;
+  yamal->prealloc_horizon_ = YTP_MMLIST_PREALLOC_HORIZON_DEFAULT;
+  yamal->prealloc_max_ = YTP_MMLIST_PREALLOC_MAX_DEFAULT;
+  yamal->prealloc_last_ = 0;
+  yamal->prealloc_size_ = 0;
+  yamal->prealloc_rate_ = 0.0;
+  yamal->sync_allocs_ = 0;
+  yamal->stats_ = false;
+  memset(&yamal->reserve_stat_, 0, sizeof(yamal->reserve_stat_));
+  memset(&yamal->commit_stat_, 0, sizeof(yamal->commit_stat_));
+  memset(&yamal->sync_stat_, 0, sizeof(yamal->sync_stat_));
+  yamal->wait_spin_ = YTP_YAMAL_WAIT_SPIN_DEFAULT;
+  yamal->wait_park_ = YTP_YAMAL_WAIT_PARK_DEFAULT;
+  yamal->time_index_interval_ = 0;
+  yamal->time_index_next_ = 0;
+
+  mmlist_page_size_init(yamal, page_size, error);
+  if (*error) {
+    goto cleanup_2;
+  }
 
   struct ytp_hdr *hdr = ytp_yamal_header(yamal, error);
   if (*error) {
-    goto cleanup_3;
+    goto cleanup_2;
   }
   size_t hdr_sz = sizeof(struct ytp_hdr);
   if (yamal->readonly_) {
-    if (atomic_load_cast(&hdr->magic_number) != *(uint64_t *)magic_number) {
+    if (!mmlist_magic_valid(atomic_load_cast(&hdr->magic_number))) {
       FMC_ERROR_REPORT(error, "invalid yamal file format");
-      goto cleanup_4;
+      goto cleanup_3;
     }
     return;
   }
 
-  if (!atomic_expect_or_init(&hdr->magic_number, *(uint64_t *)magic_number)) {
+  if (!atomic_expect_or_init(&hdr->magic_number,
+                             mmlist_magic(yamal->page_shift_)) &&
+      !mmlist_magic_valid(atomic_load_cast(&hdr->magic_number))) {
     FMC_ERROR_REPORT(error, "invalid yamal file format");
-    goto cleanup_4;
+    goto cleanup_3;
   }
 
   atomic_expect_or_init(&hdr->size, htoye64(hdr_sz));
@@ -292,24 +645,24 @@ void ytp_yamal_init_3(ytp_yamal_t *yamal, int fd, bool enable_thread,
         "configured closable type '%s' differs from file closable type in file",
         (closable == YTP_CLOSABLE) ? "closable" : "unclosable");
     FMC_ERROR_REPORT(error, errormsg);
-    goto cleanup_4;
+    goto cleanup_3;
   }
 
   mmlist_pages_allocation(yamal, error);
   if (*error) {
-    goto cleanup_4;
+    goto cleanup_3;
   }
 
   if (enable_thread) {
     if (pthread_create(&yamal->thread_, NULL, ytp_aux_thread, yamal) != 0) {
       FMC_ERROR_REPORT(error, "unable to create yamal auxiliary thread");
-      goto cleanup_4;
+      goto cleanup_3;
     }
     yamal->thread_created_ = true;
   }
   return;
 
-cleanup_4 : {
+cleanup_3 : {
   struct fmc_error saved_error;
   if (*error) {
     fmc_error_init_mov(&saved_error, *error);
@@ -325,11 +678,8 @@ cleanup_4 : {
   return;
 }
 
-cleanup_3:
-  pthread_cond_destroy(&yamal->cv_);
-
 cleanup_2:
-  pthread_mutex_destroy(&yamal->pa_mutex_);
+  pthread_cond_destroy(&yamal->cv_);
 
 cleanup_1:
   pthread_mutex_destroy(&yamal->m_);
@@ -338,15 +688,16 @@ cleanup_0:
   return;
 }
 
-ytp_yamal_t *ytp_yamal_new_3(int fd, bool enable_thread,
-                             YTP_CLOSABLE_MODE closable, fmc_error_t **error) {
+ytp_yamal_t *ytp_yamal_new_4(int fd, bool enable_thread,
+                             YTP_CLOSABLE_MODE closable, size_t page_size,
+                             fmc_error_t **error) {
   ytp_yamal_t *yamal = (ytp_yamal_t *)malloc(sizeof(ytp_yamal_t));
   if (!yamal) {
     fmc_error_set2(error, FMC_ERROR_MEMORY);
     return NULL;
   }
 
-  ytp_yamal_init_3(yamal, fd, enable_thread, closable, error);
+  ytp_yamal_init_4(yamal, fd, enable_thread, closable, page_size, error);
   if (*error) {
     free(yamal);
     return NULL;
@@ -357,6 +708,34 @@ ytp_yamal_t *ytp_yamal_new_3(int fd, bool enable_thread,
 
 fmc_fd ytp_yamal_fd(ytp_yamal_t *yamal) { return yamal->fd_; }
 
+size_t ytp_yamal_page_size(ytp_yamal_t *yamal) { return yamal->page_size_; }
+
+static size_t mmlist_reserve(struct ytp_hdr *hdr, size_t page_size,
+                             size_t node_size) {
+  size_t old_reserve;
+  do {
+#ifdef DIRECT_BYTE_ORDER
+    old_reserve = atomic_fetch_add_cast(&hdr->size, node_size);
+#else
+    size_t val;
+    size_t expected = atomic_load_cast(&hdr->size);
+    do {
+      old_reserve = ye64toh(expected);
+      val = old_reserve + node_size;
+    } while (!atomic_compare_exchange_weak_check(&hdr->size, &expected,
+                                                 htoye64(val)));
+#endif
+  } while (old_reserve % page_size + node_size > page_size);
+  return old_reserve;
+}
+
+static void mmlist_count_sync_allocation(ytp_yamal_t *yamal, size_t offset) {
+  size_t page = offset >> yamal->page_shift_;
+  if (page < YTP_MMLIST_PAGE_COUNT_MAX && !mmlist_page_data(yamal, page)) {
+    atomic_fetch_add_cast(&yamal->sync_allocs_, 1);
+  }
+}
+
 char *ytp_yamal_reserve(ytp_yamal_t *yamal, size_t sz, fmc_error_t **error) {
   fmc_error_clear(error);
   if (sz == 0) {
@@ -368,26 +747,14 @@ char *ytp_yamal_reserve(ytp_yamal_t *yamal, size_t sz, fmc_error_t **error) {
                      "unable to reserve using a readonly file descriptor");
     return NULL;
   }
+  int64_t start = ytp_yamal_stat_start(yamal);
   size_t node_size = fmc_wordceil(sizeof(struct ytp_mmnode) + sz);
   struct ytp_hdr *hdr = ytp_yamal_header(yamal, error);
   if (*error) {
     return NULL;
   }
-  size_t old_reserve;
-  do {
-#ifdef DIRECT_BYTE_ORDER
-    old_reserve = atomic_fetch_add_cast(&hdr->size, node_size);
-#else
-    size_t val;
-    size_t expected = atomic_load_cast(&hdr->size);
-    do {
-      old_reserve = ye64toh(expected);
-      val = old_reserve + node_size;
-    } while (!atomic_compare_exchange_weak_check(&hdr->size, &expected,
-                                                 htoye64(val)));
-#endif
-  } while (old_reserve % YTP_MMLIST_PAGE_SIZE + node_size >
-           YTP_MMLIST_PAGE_SIZE);
+  size_t old_reserve = mmlist_reserve(hdr, yamal->page_size_, node_size);
+  mmlist_count_sync_allocation(yamal, old_reserve);
 
   ytp_mmnode_offs ptr = htoye64(old_reserve);
   struct ytp_mmnode *node_mem = mmnode_from_offset(yamal, ptr, error);
@@ -399,11 +766,101 @@ char *ytp_yamal_reserve(ytp_yamal_t *yamal, size_t sz, fmc_error_t **error) {
   memset(node_mem->data, 0, sz);
   node_mem->size = htoye64(sz);
   node_mem->prev = ptr;
+  ytp_yamal_stat_add(&yamal->reserve_stat_, start);
   return node_mem->data;
 }
 
-ytp_iterator_t ytp_yamal_commit(ytp_yamal_t *yamal, void *data, size_t lstidx,
-                                fmc_error_t **error) {
+void ytp_yamal_reserve_batch(ytp_yamal_t *yamal, const size_t *sizes,
+                             char **data, size_t count, fmc_error_t **error) {
+  fmc_error_clear(error);
+  if (count == 0 || count > YTP_YAMAL_BATCH_MAX) {
+    FMC_ERROR_REPORT(error, "batch count out of range");
+    return;
+  }
+  if (yamal->readonly_) {
+    FMC_ERROR_REPORT(error,
+                     "unable to reserve using a readonly file descriptor");
+    return;
+  }
+  size_t batch_size = 0;
+  for (size_t i = 0; i < count; ++i) {
+    if (sizes[i] == 0) {
+      FMC_ERROR_REPORT(error, "size is zero");
+      return;
+    }
+    batch_size += fmc_wordceil(sizeof(struct ytp_mmnode) + sizes[i]);
+  }
+  if (batch_size > yamal->page_size_) {
+    FMC_ERROR_REPORT(error, "batch size exceeds page size");
+    return;
+  }
+  int64_t start = ytp_yamal_stat_start(yamal);
+  struct ytp_hdr *hdr = ytp_yamal_header(yamal, error);
+  if (*error) {
+    return;
+  }
+  size_t old_reserve = mmlist_reserve(hdr, yamal->page_size_, batch_size);
+  mmlist_count_sync_allocation(yamal, old_reserve);
+
+  // The whole batch lives in a single page, so it is mapped only once
+  char *batch_mem =
+      (char *)mmnode_from_offset(yamal, htoye64(old_reserve), error);
+  if (*error) {
+    FMC_ERROR_REPORT(error, "unable to initialize node in reserved memory");
+    return;
+  }
+
+  size_t offset = 0;
+  for (size_t i = 0; i < count; ++i) {
+    struct ytp_mmnode *node_mem = (struct ytp_mmnode *)(batch_mem + offset);
+    memset(node_mem->data, 0, sizes[i]);
+    node_mem->size = htoye64(sizes[i]);
+    node_mem->prev = htoye64(old_reserve + offset);
+    data[i] = node_mem->data;
+    offset += fmc_wordceil(sizeof(struct ytp_mmnode) + sizes[i]);
+  }
+  ytp_yamal_stat_add(&yamal->reserve_stat_, start);
+}
+
+static void mmlist_advance_tail(ytp_yamal_t *yamal, struct ytp_mmnode *hdr,
+                                ytp_mmnode_offs expected, ytp_mmnode_offs tail,
+                                uint64_t tail_seqno, fmc_error_t **error) {
+  // hdr->prev is a forward-only hint, not part of the list. Only the
+  // committing writer advances it, walkers never do, so a commit walks from
+  // the hint past the nodes linked by other writers. The hint is replaced only
+  // while it points to a node that precedes the new tail.
+  while (!atomic_compare_exchange_weak_check(&hdr->prev, &expected, tail)) {
+    struct ytp_mmnode *node = mmnode_from_offset(yamal, expected, error);
+    if (*error) {
+      return;
+    }
+    if (ye64toh(atomic_load_cast(&node->seqno)) >= tail_seqno) {
+      return;
+    }
+  }
+}
+
+static void mmlist_notify(struct ytp_hdr *hdr) {
+  // Readers register before checking the list again, so either they see the
+  // new node or the writer sees them registered
+  uint16_t waiters = atomic_load_cast(&hdr->waiters);
+  if (waiters != 0) {
+    atomic_fetch_add_cast(&hdr->notify, 1);
+#if defined(FMC_SYS_LINUX)
+    long woken =
+        syscall(SYS_futex, &hdr->notify, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+    // A reader that dies while parked never unregisters. If nobody was woken
+    // the count is cleared. Live readers that registered but were not asleep
+    // yet see the new node, since it is linked before notify changes.
+    if (woken == 0) {
+      atomic_compare_exchange_strong_cast(&hdr->waiters, &waiters, 0);
+    }
+#endif
+  }
+}
+
+static ytp_iterator_t mmlist_commit(ytp_yamal_t *yamal, void *data,
+                                    size_t lstidx, fmc_error_t **error) {
   struct ytp_mmnode *node = mmnode_from_data(data);
   ytp_mmnode_offs offs = atomic_load_cast(&node->prev);
 
@@ -414,8 +871,11 @@ ytp_iterator_t ytp_yamal_commit(ytp_yamal_t *yamal, void *data, size_t lstidx,
   struct ytp_mmnode *hdr = &ytp_hdr->hdr[lstidx];
   ytp_mmnode_offs closed =
       htoye64((ytp_mmnode_offs) & ((struct ytp_hdr *)0)->hdr[lstidx]);
-  ytp_mmnode_offs last = atomic_load_cast(&hdr->prev);
-  ytp_mmnode_offs next_ptr = last;
+  ytp_mmnode_offs hint = atomic_load_cast(&hdr->prev);
+  ytp_mmnode_offs last;
+  ytp_mmnode_offs next_ptr = hint;
+  ytp_mmnode_offs tail;
+  uint64_t seqno;
   do {
     last = next_ptr;
     node = mmnode_from_offset(yamal, next_ptr, error);
@@ -433,22 +893,61 @@ ytp_iterator_t ytp_yamal_commit(ytp_yamal_t *yamal, void *data, size_t lstidx,
     }
     mem->prev = last;
     struct ytp_mmnode *sublist_node = mem;
-    uint64_t seqno = ye64toh(node->seqno);
+    tail = offs;
+    seqno = ye64toh(node->seqno);
     do {
       sublist_node->seqno = htoye64(++seqno);
       ytp_mmnode_offs next = atomic_load_cast(&sublist_node->next);
       if (next == 0) {
         break;
       }
+      tail = next;
       sublist_node = mmnode_from_offset(yamal, next, error);
       if (*error)
         return NULL;
     } while (true);
   } while (!atomic_compare_exchange_weak_check(&node->next, &next_ptr, offs));
-  hdr->prev = offs;
+  mmlist_notify(ytp_hdr);
+  mmlist_advance_tail(yamal, hdr, hint, tail, seqno, error);
+  if (*error)
+    return NULL;
   return &node->next;
 }
 
+ytp_iterator_t ytp_yamal_commit(ytp_yamal_t *yamal, void *data, size_t lstidx,
+                                fmc_error_t **error) {
+  int64_t start = ytp_yamal_stat_start(yamal);
+  ytp_iterator_t it = mmlist_commit(yamal, data, lstidx, error);
+  if (it) {
+    ytp_yamal_stat_add(&yamal->commit_stat_, start);
+  }
+  return it;
+}
+
+ytp_iterator_t ytp_yamal_commit_batch(ytp_yamal_t *yamal, char *const *data,
+                                      size_t count, size_t lstidx,
+                                      fmc_error_t **error) {
+  fmc_error_clear(error);
+  if (count == 0 || count > YTP_YAMAL_BATCH_MAX) {
+    FMC_ERROR_REPORT(error, "batch count out of range");
+    return NULL;
+  }
+
+  // Link the batch as a sublist so it is published with a single CAS
+  struct ytp_mmnode *prev_node = mmnode_from_data(data[0]);
+  ytp_mmnode_offs prev_off = prev_node->prev;
+  for (size_t i = 1; i < count; ++i) {
+    struct ytp_mmnode *node = mmnode_from_data(data[i]);
+    ytp_mmnode_offs off = node->prev;
+    prev_node->next = off;
+    node->prev = prev_off;
+    prev_node = node;
+    prev_off = off;
+  }
+
+  return ytp_yamal_commit(yamal, data[0], lstidx, error);
+}
+
 void ytp_yamal_sublist_commit(ytp_yamal_t *yamal, void **first_ptr,
                               void **last_ptr, void *new_ptr,
                               fmc_error_t **error) {
@@ -496,6 +995,82 @@ void ytp_yamal_read(ytp_yamal_t *yamal, ytp_iterator_t iterator,
   *seqno = ye64toh(node->seqno);
 }
 
+static void mmlist_park(ytp_yamal_t *yamal, struct ytp_hdr *hdr,
+                        ytp_iterator_t iterator, int64_t ns) {
+  struct timespec spec;
+  spec.tv_sec = ns / 1000000000ll;
+  spec.tv_nsec = ns % 1000000000ll;
+  // Timeouts and interruptions are expected, so errno is preserved
+  int saved_errno = errno;
+#if defined(FMC_SYS_LINUX)
+  if (!yamal->readonly_) {
+    atomic_fetch_add_cast(&hdr->waiters, 1);
+    uint32_t notify = atomic_load_cast(&hdr->notify);
+    if (ytp_yamal_term(iterator)) {
+      syscall(SYS_futex, &hdr->notify, FUTEX_WAIT, notify, &spec, NULL, 0);
+    }
+    // The count may have been cleared by a writer, it never goes below zero
+    uint16_t waiters = atomic_load_cast(&hdr->waiters);
+    while (waiters != 0 && !atomic_compare_exchange_weak_check(
+                               &hdr->waiters, &waiters, waiters - 1))
+      ;
+    errno = saved_errno;
+    return;
+  }
+#endif
+  nanosleep(&spec, NULL);
+  errno = saved_errno;
+}
+
+bool ytp_yamal_wait(ytp_yamal_t *yamal, ytp_iterator_t iterator,
+                    int64_t timeout_ns, fmc_error_t **error) {
+  fmc_error_clear(error);
+  if (!ytp_yamal_term(iterator)) {
+    return true;
+  }
+
+  int64_t start = fmc_cur_time_ns();
+  int64_t spin = yamal->wait_spin_;
+  if (timeout_ns >= 0 && timeout_ns < spin) {
+    spin = timeout_ns;
+  }
+  int64_t now = start;
+  while (now - start < spin) {
+    if (!ytp_yamal_term(iterator)) {
+      return true;
+    }
+    now = fmc_cur_time_ns();
+  }
+
+  struct ytp_hdr *hdr = ytp_yamal_header(yamal, error);
+  if (*error) {
+    return false;
+  }
+  while (timeout_ns < 0 || now - start < timeout_ns) {
+    int64_t park = yamal->wait_park_;
+    if (timeout_ns >= 0 && start + timeout_ns - now < park) {
+      park = start + timeout_ns - now;
+    }
+    mmlist_park(yamal, hdr, iterator, park);
+    if (!ytp_yamal_term(iterator)) {
+      return true;
+    }
+    now = fmc_cur_time_ns();
+  }
+  return false;
+}
+
+void ytp_yamal_set_wait(ytp_yamal_t *yamal, int64_t spin_ns, int64_t park_ns,
+                        fmc_error_t **error) {
+  fmc_error_clear(error);
+  if (spin_ns < 0 || park_ns <= 0) {
+    FMC_ERROR_REPORT(error, "invalid wait configuration");
+    return;
+  }
+  yamal->wait_spin_ = spin_ns;
+  yamal->wait_park_ = park_ns;
+}
+
 void ytp_yamal_destroy(ytp_yamal_t *yamal, fmc_error_t **error) {
   fmc_error_clear(error);
   if (yamal->thread_created_) {
@@ -516,18 +1091,21 @@ void ytp_yamal_destroy(ytp_yamal_t *yamal, fmc_error_t **error) {
     }
   }
 
-  for (unsigned long int i = 0; i < YTP_MMLIST_PAGE_COUNT_MAX; ++i) {
-    if (fmc_fview_data(&yamal->pages_[i])) {
-      fmc_fview_destroy(&yamal->pages_[i], YTP_MMLIST_PAGE_SIZE, error);
-      if (*error) {
-        return;
-      }
+  for (struct ytp_yamal_page *mem_page = yamal->mapped_pages_; mem_page;
+       mem_page = mem_page->next_mapped) {
+    fmc_fview_destroy(&mem_page->view, yamal->page_size_, error);
+    if (*error) {
+      return;
     }
   }
+  yamal->mapped_pages_ = NULL;
+  for (size_t i = 0; i < YTP_MMLIST_PAGE_CHUNK_COUNT; ++i) {
+    free(yamal->page_chunks_[i]);
+    yamal->page_chunks_[i] = NULL;
+  }
 
   pthread_cond_destroy(&yamal->cv_);
   pthread_mutex_destroy(&yamal->m_);
-  pthread_mutex_destroy(&yamal->pa_mutex_);
 }
 
 void ytp_yamal_del(ytp_yamal_t *yamal, fmc_error_t **error) {
@@ -562,6 +1140,23 @@ bool ytp_yamal_term(ytp_iterator_t iterator) {
          sizeof(struct ytp_hdr);
 }
 
+void ytp_yamal_prefetch(ytp_yamal_t *yamal, ytp_iterator_t iterator) {
+  size_t loffs = ye64toh(atomic_load_cast(offset_from_iterator(iterator)));
+  size_t page = loffs >> yamal->page_shift_;
+  if (loffs < sizeof(struct ytp_hdr) || page >= YTP_MMLIST_PAGE_COUNT_MAX) {
+    return;
+  }
+  char *page_ptr = mmlist_page_data(yamal, page);
+  if (!page_ptr) {
+    return;
+  }
+#if defined(__GNUC__)
+  char *node = page_ptr + (loffs & (yamal->page_size_ - 1));
+  __builtin_prefetch(node, 0, 3);
+  __builtin_prefetch(node + sizeof(struct ytp_mmnode), 0, 3);
+#endif
+}
+
 ytp_iterator_t ytp_yamal_next(ytp_yamal_t *yamal, ytp_iterator_t iterator,
                               fmc_error_t **error) {
   ytp_mmnode_offs offset = atomic_load_cast(offset_from_iterator(iterator));
@@ -667,6 +1262,7 @@ void ytp_yamal_close(ytp_yamal_t *yamal, size_t lstidx, fmc_error_t **error) {
       }
     }
   } while (!atomic_compare_exchange_weak_check(&node->next, &next_ptr, closed));
+  mmlist_notify(hdr);
 }
 
 bool ytp_yamal_closed(ytp_yamal_t *yamal, size_t lstidx, fmc_error_t **error) {
@@ -713,8 +1309,7 @@ void ytp_yamal_allocate_pages(ytp_yamal_t *yamal, size_t first, size_t last,
 }
 
 void ytp_yamal_allocate(ytp_yamal_t *yamal, size_t sz, fmc_error_t **error) {
-  size_t required_pages =
-      (sz + YTP_MMLIST_PAGE_SIZE - 1) / YTP_MMLIST_PAGE_SIZE;
+  size_t required_pages = (sz + yamal->page_size_ - 1) >> yamal->page_shift_;
   ytp_yamal_allocate_pages(yamal, 0, required_pages, error);
 }
 
@@ -723,6 +1318,6 @@ size_t ytp_yamal_used_size(ytp_yamal_t *yamal, fmc_error_t **error) {
   if (*error)
     return 0;
   size_t reserved_pages =
-      (reserved + YTP_MMLIST_PAGE_SIZE - 1) / YTP_MMLIST_PAGE_SIZE;
-  return reserved_pages * YTP_MMLIST_PAGE_SIZE;
+      (reserved + yamal->page_size_ - 1) >> yamal->page_shift_;
+  return reserved_pages << yamal->page_shift_;
 }
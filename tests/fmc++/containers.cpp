@@ -182,6 +182,34 @@ TEST(lazy_rem_vector, test_1) {
   ASSERT_EQ(it, vec.end());
 }
 
+TEST(lazy_rem_vector, mark_if) {
+  fmc::lazy_rem_vector<int> vec;
+  for (int i = 0; i < 4; ++i) {
+    fmc::push_unique(vec, i);
+  }
+
+  ASSERT_TRUE(vec.mark_if([](const int &val) { return val % 2 == 1; }));
+  ASSERT_FALSE(vec.mark_if([](const int &val) { return val == 1; }));
+  ASSERT_EQ(vec.size(), 4);
+  std::vector<int> kept;
+  for (auto it = vec.begin(); it != vec.end(); ++it) {
+    if (!it.was_removed()) {
+      kept.push_back(*it);
+    }
+  }
+  ASSERT_EQ(kept, std::vector<int>({0, 2}));
+
+  // Pushing a marked element back keeps it
+  fmc::push_unique(vec, 3);
+  vec.compact();
+  kept.clear();
+  for (auto it = vec.begin(); it != vec.end(); ++it) {
+    ASSERT_FALSE(it.was_removed());
+    kept.push_back(*it);
+  }
+  ASSERT_EQ(kept, std::vector<int>({0, 2, 3}));
+}
+
 #include "shared_map.cpp"
 #include "static_vector.cpp"
 #include "threaded.cpp"
@@ -11,9 +11,17 @@
 #define FMC_COUNTER_ENABLE
 #include "fmc++/counters.hpp"
 
+#include "fmc++/ordered_map.hpp"
+
+#include <algorithm>
 #include <chrono>
 #include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <random>
 #include <thread>
+#include <vector>
 
 TEST(counters, counters) {
   using namespace fmc::counter;
@@ -30,7 +38,222 @@ TEST(counters, counters) {
   ASSERT_LT(err, 100.0);
 }
 
+TEST(counters, hdr_histogram_buckets) {
+  using histogram_t = fmc::counter::hdr_histogram<7>;
+  std::mt19937_64 gen(42);
+  // Values under 2^7 are exact, above only the 8 highest bits are kept
+  for (uint64_t x = 0; x < 1000; ++x) {
+    unsigned shift = x < 128 ? 0 : FMC_FLOORLOG2(x) - 7;
+    ASSERT_EQ(histogram_t::lower_bound(histogram_t::index(x)),
+              x >> shift << shift);
+  }
+  size_t last = 0;
+  for (int i = 0; i < 100000; ++i) {
+    uint64_t x = gen() >> (gen() % 64);
+    auto idx = histogram_t::index(x);
+    ASSERT_LT(idx, histogram_t::N);
+    auto lower = histogram_t::lower_bound(idx);
+    ASSERT_LE(lower, x);
+    ASSERT_LE(double(x - lower), double(x) / 128.0);
+  }
+  for (uint64_t x = 1; x < (1ull << 20); x += x / 64 + 1) {
+    auto idx = histogram_t::index(x);
+    ASSERT_GE(idx, last);
+    last = idx;
+  }
+  ASSERT_EQ(histogram_t::index(UINT64_MAX), histogram_t::N - 1);
+}
+
+TEST(counters, hdr_histogram_percentile) {
+  fmc::counter::hdr_histogram<10> histogram;
+  ASSERT_TRUE(std::isnan(histogram.percentile(50)));
+  std::mt19937_64 gen(42);
+  std::lognormal_distribution<double> dist(8.0, 1.5);
+  std::vector<uint64_t> values;
+  for (int i = 0; i < 100000; ++i) {
+    values.push_back(uint64_t(dist(gen)));
+    histogram.sample(values.back());
+  }
+  std::sort(values.begin(), values.end());
+  ASSERT_EQ(histogram.total(), values.size());
+  for (double p : {0.0, 1.0, 25.0, 50.0, 90.0, 99.0, 99.9, 100.0}) {
+    size_t count = std::max<size_t>((int64_t(values.size() * p) + 99) / 100, 1);
+    double expected = values[count - 1];
+    ASSERT_LE(histogram.percentile(p), expected);
+    ASSERT_GE(histogram.percentile(p), expected * (1.0 - 1.0 / 1024.0));
+  }
+
+  // Merging histograms of parts of the samples
+  fmc::counter::hdr_histogram<10> first;
+  fmc::counter::hdr_histogram<10> second;
+  for (size_t i = 0; i < values.size(); ++i) {
+    (i % 3 ? first : second).sample(values[i]);
+  }
+  first.merge(second);
+  ASSERT_EQ(first.total(), histogram.total());
+  for (double p : {1.0, 50.0, 99.0, 100.0}) {
+    ASSERT_EQ(first.percentile(p), histogram.percentile(p));
+  }
+  histogram.clear();
+  ASSERT_EQ(histogram.total(), 0);
+  ASSERT_TRUE(std::isnan(histogram.percentile(50)));
+}
+
+TEST(counters, atomic_hdr_histogram) {
+  fmc::counter::atomic_hdr_histogram<> histogram;
+  const uint64_t samples = 200000;
+  std::atomic<bool> done = false;
+  std::vector<std::thread> threads;
+  for (uint64_t t = 0; t < 4; ++t) {
+    threads.emplace_back([&, t]() {
+      auto &recorder = histogram.add_recorder();
+      for (uint64_t i = 0; i < samples; ++i) {
+        recorder.sample(t * samples + i);
+      }
+    });
+  }
+  // Snapshots taken while the threads record
+  uint64_t last = 0;
+  while (last < 4 * samples) {
+    fmc::counter::hdr_histogram<> snapshot;
+    histogram.snapshot(snapshot);
+    ASSERT_GE(snapshot.total(), last);
+    last = snapshot.total();
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  fmc::counter::hdr_histogram<> snapshot;
+  histogram.snapshot(snapshot);
+  ASSERT_EQ(snapshot.total(), 4 * samples);
+  ASSERT_NEAR(snapshot.percentile(50), 2 * samples, 2 * samples / 128.0);
+}
+
+// The previous precision sampler, kept to compare with the histogram
+class ordered_sampler {
+public:
+  void sample(uint64_t x) {
+    auto c = fmc::counter::floor_log10(x).first;
+    auto b = uint64_t((x / c) * c);
+    if (auto where = buckets_.find(b); where == buckets_.end()) {
+      buckets_.emplace(b, 1);
+    } else {
+      where->second++;
+    }
+  }
+  double percentile(double p) const {
+    uint64_t total = 0;
+    for (auto &&[b, c] : buckets_) {
+      total += c;
+    }
+    uint64_t sample_count = (int64_t(total * p) + 99ull) / 100ull;
+    uint64_t current = 0;
+    for (auto &&[b, c] : buckets_) {
+      current += c;
+      if (current >= sample_count) {
+        return double(b);
+      }
+    }
+    return NAN;
+  }
+
+private:
+  fmc::ordered_multimap<uint64_t, uint64_t> buckets_;
+};
+
+TEST(counters, hdr_histogram_performance) {
+  using namespace std::chrono;
+  std::mt19937_64 gen(42);
+  std::lognormal_distribution<double> dist(8.0, 2.0);
+  std::vector<uint64_t> values(1000000);
+  for (auto &value : values) {
+    value = uint64_t(dist(gen));
+  }
+  auto run = [&](auto &sampler, const char *name) {
+    auto start = steady_clock::now();
+    for (auto value : values) {
+      sampler.sample(value);
+    }
+    auto sample_elapsed = duration<double>(steady_clock::now() - start);
+    start = steady_clock::now();
+    double sum = 0;
+    for (int i = 0; i < 1000; ++i) {
+      sum += sampler.percentile(99.0);
+    }
+    auto percentile_elapsed = duration<double>(steady_clock::now() - start);
+    std::cout << name << ": " << values.size() / sample_elapsed.count()
+              << " samples/sec, " << 1000 / percentile_elapsed.count()
+              << " percentiles/sec, p99 " << sum / 1000 << std::endl;
+  };
+  ordered_sampler ordered;
+  run(ordered, "ordered_multimap");
+  fmc::counter::precision_sampler histogram;
+  run(histogram, "hdr_histogram");
+}
+
+static std::string registry_path =
+    (std::filesystem::temp_directory_path() /
+     ("fmc_counters_test." + std::to_string(fmc::counter::nanoseconds()())))
+        .string();
+
+TEST(counters, registry) {
+  using namespace fmc::counter;
+  counter_record<nano_record<avg>> record("registry_record");
+  record.start();
+  record.stop();
+  samples smpls;
+  smpls.get<fmc::counter::last>("registry_last").sample(42.0);
+  smpls.publish();
+
+  fmc_error_t *error;
+  auto *registry = fmc_counter_registry_open(registry_path.c_str(), &error);
+  ASSERT_EQ(error, nullptr);
+  std::unordered_map<std::string, double> values;
+  for (size_t i = 0; i < fmc_counter_registry_count(registry); ++i) {
+    auto *counter = fmc_counter_registry_get(registry, i);
+    values[counter->name] = fmc_counter_value(counter);
+  }
+  ASSERT_EQ(values.count("registry_record"), 1);
+  ASSERT_EQ(values["registry_record"], record.value());
+  ASSERT_EQ(values["registry_last"], 42.0);
+
+  smpls.get<fmc::counter::last>("registry_last").sample(43.0);
+  smpls.publish();
+  ASSERT_EQ(fmc_counter_value(fmc_counter_registry_get(
+                registry, fmc_counter_registry_count(registry) - 1)),
+            43.0);
+  fmc_counter_registry_del(registry, &error);
+  ASSERT_EQ(error, nullptr);
+}
+
+static void registry_macro_sleep() {
+  FMC_NANO_AVG(registry_macro);
+  std::this_thread::sleep_for(std::chrono::microseconds(100));
+}
+
+TEST(counters, registry_macro) {
+  for (int i = 0; i < 3; ++i) {
+    registry_macro_sleep();
+  }
+
+  fmc_error_t *error;
+  auto *registry = fmc_counter_registry_open(registry_path.c_str(), &error);
+  ASSERT_EQ(error, nullptr);
+  std::unordered_map<std::string, double> values;
+  for (size_t i = 0; i < fmc_counter_registry_count(registry); ++i) {
+    auto *counter = fmc_counter_registry_get(registry, i);
+    values[counter->name] = fmc_counter_value(counter);
+  }
+  ASSERT_EQ(values.count("FMC_NANO_AVG(registry_macro)"), 1);
+  ASSERT_GE(values["FMC_NANO_AVG(registry_macro)"], 100000.0);
+  fmc_counter_registry_del(registry, &error);
+  ASSERT_EQ(error, nullptr);
+}
+
 GTEST_API_ int main(int argc, char **argv) {
+  setenv("FMC_COUNTER_REGISTRY", registry_path.c_str(), 1);
   testing::InitGoogleTest(&argc, argv);
-  return RUN_ALL_TESTS();
+  int ret = RUN_ALL_TESTS();
+  std::filesystem::remove(registry_path);
+  return ret;
 }
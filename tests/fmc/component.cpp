@@ -19,12 +19,21 @@
 #include <fmc/error.h>
 #include <fmc/platform.h>
 #include <fmc/reactor.h>
+#include <fmc/reactor_profile.h>
 #include <stdlib.h>
 
 #include <fmc++/fs.hpp>
 #include <fmc++/gtestwrap.hpp>
 #include <fmc++/strings.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
 #include "iocomponent.h"
 #include "shutdowncomponent.h"
 
@@ -398,6 +407,87 @@ TEST(reactor, reactorsched) {
   ASSERT_EQ(sys.modules, nullptr);
 }
 
+TEST(reactor, reactorsched_wheel) {
+  struct fmc_reactor r;
+  fmc_error_t *err;
+  fmc_reactor_init_wheel(&r, 1, &err);
+  ASSERT_EQ(err, nullptr);
+  fmc_component_sys_init(&sys);
+  const char *paths[] = {components_path.c_str(), nullptr};
+  fmc_component_sys_paths_set(&sys, paths, &err);
+  ASSERT_EQ(err, nullptr);
+
+  struct fmc_component_module *mod =
+      fmc_component_module_get(&sys, "testcomponent", &err);
+  ASSERT_EQ(err, nullptr);
+  struct fmc_component_type *tp =
+      fmc_component_module_type_get(mod, "testcomponentsched", &err);
+  ASSERT_EQ(err, nullptr);
+
+  struct fmc_cfg_sect_item *cfg =
+      fmc_cfg_sect_item_add_str(nullptr, "teststr", "message", &err);
+  ASSERT_EQ(err, nullptr);
+  struct fmc_component *comp = fmc_component_new(&r, tp, cfg, nullptr, &err);
+  ASSERT_EQ(err, nullptr);
+  struct test_component *testcomp = (struct test_component *)comp;
+  ASSERT_TRUE(fmc_time64_equal(fmc_reactor_sched(&r), fmc_time64_start()));
+
+  fmc_reactor_run(&r, false, &err);
+  ASSERT_EQ(err, nullptr);
+  ASSERT_TRUE(fmc_time64_equal(
+      testcomp->timesim,
+      fmc_time64_add(fmc_time64_start(), fmc_time64_from_nanos(100))));
+  ASSERT_TRUE(fmc_time64_equal(fmc_reactor_sched(&r), fmc_time64_end()));
+
+  fmc_reactor_destroy(&r);
+  fmc_cfg_sect_del(cfg);
+  fmc_component_module_del(mod);
+  fmc_component_sys_destroy(&sys);
+}
+
+TEST(reactor, stats) {
+  struct fmc_reactor r;
+  fmc_reactor_init(&r);
+  fmc_error_t *err;
+  fmc_component_sys_init(&sys);
+  const char *paths[] = {components_path.c_str(), nullptr};
+  fmc_component_sys_paths_set(&sys, paths, &err);
+  ASSERT_EQ(err, nullptr);
+
+  struct fmc_component_module *mod =
+      fmc_component_module_get(&sys, "testcomponent", &err);
+  ASSERT_EQ(err, nullptr);
+  struct fmc_component_type *tp =
+      fmc_component_module_type_get(mod, "testcomponentsched", &err);
+  ASSERT_EQ(err, nullptr);
+
+  struct fmc_cfg_sect_item *cfg =
+      fmc_cfg_sect_item_add_str(nullptr, "teststr", "message", &err);
+  ASSERT_EQ(err, nullptr);
+  struct fmc_component *comp = fmc_component_new(&r, tp, cfg, nullptr, &err);
+  ASSERT_EQ(err, nullptr);
+
+  fmc_reactor_stats_set(&r, true);
+  fmc_reactor_run(&r, false, &err);
+  ASSERT_EQ(err, nullptr);
+  struct fmc_reactor_stat stat;
+  fmc_reactor_ctx_stat_take(comp->_ctx, &stat);
+  ASSERT_EQ(stat.count, 11);
+  ASSERT_GE(stat.total, stat.max);
+  ASSERT_GT(stat.max, 0);
+
+  // Taking the statistics resets them
+  fmc_reactor_ctx_stat_take(comp->_ctx, &stat);
+  ASSERT_EQ(stat.count, 0);
+  ASSERT_EQ(stat.total, 0);
+  ASSERT_EQ(stat.max, 0);
+
+  fmc_reactor_destroy(&r);
+  fmc_cfg_sect_del(cfg);
+  fmc_component_module_del(mod);
+  fmc_component_sys_destroy(&sys);
+}
+
 TEST(reactor, reactorlive) {
   struct fmc_reactor r;
   fmc_reactor_init(&r);
@@ -1244,6 +1334,256 @@ TEST(reactor, nostop_shutdown) {
   ASSERT_EQ(sys.modules, nullptr);
 }
 
+TEST(reactor, fd) {
+  struct fmc_reactor r;
+  fmc_reactor_init(&r);
+  fmc_error_t *err;
+  fmc_component_sys_init(&sys);
+  const char *paths[] = {components_path.c_str(), nullptr};
+  fmc_component_sys_paths_set(&sys, paths, &err);
+  ASSERT_EQ(err, nullptr);
+  struct fmc_component_module *mod =
+      fmc_component_module_get(&sys, "iocomponent", &err);
+  ASSERT_EQ(err, nullptr);
+  struct fmc_component_type *tp =
+      fmc_component_module_type_get(mod, "pipecomponent", &err);
+  ASSERT_EQ(err, nullptr);
+  struct fmc_component *comp =
+      fmc_component_new(&r, tp, nullptr, nullptr, &err);
+  ASSERT_EQ(err, nullptr);
+  auto *pipecomp = (struct pipe_component *)comp;
+
+  fmc_reactor_ctx_fd_rm(comp->_ctx, pipecomp->fds[1], &err);
+  ASSERT_NE(err, nullptr);
+
+  std::thread writer([fd = pipecomp->fds[1]]() {
+    for (int i = 0; i < 10; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      ASSERT_EQ(write(fd, "x", 1), 1);
+    }
+    ASSERT_EQ(write(fd, "q", 1), 1);
+  });
+  timespec cpu_start, cpu_end;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_start);
+  auto start = std::chrono::steady_clock::now();
+  fmc_reactor_run(&r, true, &err);
+  auto elapsed = std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_end);
+  writer.join();
+  ASSERT_EQ(err, nullptr);
+  ASSERT_EQ(pipecomp->received, 10);
+
+  // The reactor blocks while it waits for the pipe
+  double cpu = (cpu_end.tv_sec - cpu_start.tv_sec) +
+               (cpu_end.tv_nsec - cpu_start.tv_nsec) / 1e9;
+  ASSERT_GE(elapsed, 0.1);
+  ASSERT_LT(cpu, elapsed / 2);
+
+  fmc_reactor_destroy(&r);
+  fmc_component_module_del(mod);
+  fmc_component_sys_destroy(&sys);
+}
+
+// Runs a source that fans out into independent chains of load nodes on the
+// given number of threads and returns the state of the nodes
+static std::vector<load_node_component>
+run_load_graph(size_t threads, size_t chains, size_t depth, bool pin,
+               double *secs = nullptr) {
+  struct fmc_reactor r;
+  fmc_reactor_init(&r);
+  fmc_error_t *err;
+  fmc_component_sys_init(&sys);
+  const char *paths[] = {components_path.c_str(), nullptr};
+  fmc_component_sys_paths_set(&sys, paths, &err);
+  EXPECT_EQ(err, nullptr);
+  struct fmc_component_module *mod =
+      fmc_component_module_get(&sys, "iocomponent", &err);
+  EXPECT_EQ(err, nullptr);
+  struct fmc_component_type *srctp =
+      fmc_component_module_type_get(mod, "loadsource", &err);
+  EXPECT_EQ(err, nullptr);
+  struct fmc_component_type *nodetp =
+      fmc_component_module_type_get(mod, "loadnode", &err);
+  EXPECT_EQ(err, nullptr);
+
+  struct fmc_component *src =
+      fmc_component_new(&r, srctp, nullptr, nullptr, &err);
+  EXPECT_EQ(err, nullptr);
+  std::vector<struct fmc_component *> nodes;
+  for (size_t chain = 0; chain < chains; ++chain) {
+    struct fmc_component *prev = src;
+    for (size_t i = 0; i < depth; ++i) {
+      struct fmc_component_input inputs[] = {{prev, 0}, {NULL, 0}};
+      prev = fmc_component_new(&r, nodetp, nullptr, inputs, &err);
+      EXPECT_EQ(err, nullptr);
+      if (pin) {
+        fmc_reactor_ctx_worker_set(prev->_ctx, chain % threads);
+      }
+      nodes.push_back(prev);
+    }
+  }
+
+  fmc_reactor_threads_set(&r, threads, nullptr, &err);
+  EXPECT_EQ(err, nullptr);
+  auto start = std::chrono::steady_clock::now();
+  fmc_reactor_run(&r, false, &err);
+  EXPECT_EQ(err, nullptr);
+  if (secs) {
+    *secs = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                          start)
+                .count();
+  }
+  EXPECT_EQ(((struct load_source_component *)src)->count, 200);
+
+  std::vector<load_node_component> result;
+  for (auto *node : nodes) {
+    result.push_back(*(struct load_node_component *)node);
+  }
+  fmc_reactor_destroy(&r);
+  fmc_component_module_del(mod);
+  fmc_component_sys_destroy(&sys);
+  return result;
+}
+
+TEST(reactor, profile) {
+  for (size_t bucket = 1; bucket < FMC_REACTOR_PROFILE_BUCKETS - 4; ++bucket) {
+    ASSERT_LT(fmc_reactor_profile_bucket_cycles(bucket - 1),
+              fmc_reactor_profile_bucket_cycles(bucket));
+  }
+
+  struct fmc_reactor r;
+  fmc_reactor_init(&r);
+  fmc_error_t *err;
+  fmc_component_sys_init(&sys);
+  const char *paths[] = {components_path.c_str(), nullptr};
+  fmc_component_sys_paths_set(&sys, paths, &err);
+  ASSERT_EQ(err, nullptr);
+
+  struct fmc_component_module *iomod =
+      fmc_component_module_get(&sys, "iocomponent", &err);
+  ASSERT_EQ(err, nullptr);
+  struct fmc_component_type *ptp =
+      fmc_component_module_type_get(iomod, "producercomponent", &err);
+  ASSERT_EQ(err, nullptr);
+  struct fmc_component_type *ctp =
+      fmc_component_module_type_get(iomod, "consumercomponent", &err);
+  ASSERT_EQ(err, nullptr);
+  struct fmc_component_module *mod =
+      fmc_component_module_get(&sys, "testcomponent", &err);
+  ASSERT_EQ(err, nullptr);
+  struct fmc_component_type *stp =
+      fmc_component_module_type_get(mod, "testcomponentsched", &err);
+  ASSERT_EQ(err, nullptr);
+
+  struct fmc_component *pcomp =
+      fmc_component_new(&r, ptp, nullptr, nullptr, &err);
+  ASSERT_EQ(err, nullptr);
+  struct fmc_component_input inputs[] = {{pcomp, 0}, {NULL, 0}};
+  struct fmc_component *ccomp1 =
+      fmc_component_new(&r, ctp, nullptr, inputs, &err);
+  ASSERT_EQ(err, nullptr);
+  struct fmc_component *ccomp2 =
+      fmc_component_new(&r, ctp, nullptr, inputs, &err);
+  ASSERT_EQ(err, nullptr);
+  struct fmc_cfg_sect_item *cfg =
+      fmc_cfg_sect_item_add_str(nullptr, "teststr", "message", &err);
+  ASSERT_EQ(err, nullptr);
+  struct fmc_component *scomp = fmc_component_new(&r, stp, cfg, nullptr, &err);
+  ASSERT_EQ(err, nullptr);
+
+  fmc_reactor_profile_set(&r, true, &err);
+  if (err) {
+#if defined(FMC_REACTOR_PROFILE)
+    FAIL() << fmc_error_msg(err);
+#endif
+    // The library was built without FMC_REACTOR_PROFILE
+    ASSERT_EQ(fmc_reactor_ctx_profile_get(pcomp->_ctx), nullptr);
+    fmc_reactor_destroy(&r);
+    fmc_cfg_sect_del(cfg);
+    fmc_component_module_del(mod);
+    fmc_component_module_del(iomod);
+    fmc_component_sys_destroy(&sys);
+    GTEST_SKIP() << fmc_error_msg(err);
+  }
+  ASSERT_GT(fmc_reactor_profile_cycles_per_ns(&r), 0.0);
+
+  fmc_reactor_run(&r, false, &err);
+  ASSERT_EQ(err, nullptr);
+
+  // The producer queues itself until it notified the consumers 10 times
+  auto *pprof = fmc_reactor_ctx_profile_get(pcomp->_ctx);
+  ASSERT_NE(pprof, nullptr);
+  ASSERT_EQ(pprof->execs, 11);
+  ASSERT_EQ(pprof->fanout.count, 10);
+  ASSERT_EQ(pprof->fanout.total, 20);
+  ASSERT_EQ(pprof->fanout.max, 2);
+  ASSERT_EQ(pprof->dwell.count, 10);
+  size_t hist = 0;
+  for (auto count : pprof->exec_hist) {
+    hist += count;
+  }
+  ASSERT_EQ(hist, pprof->execs);
+  ASSERT_LE(fmc_reactor_profile_percentile(pprof, 50),
+            fmc_reactor_profile_percentile(pprof, 100));
+  ASSERT_LE(fmc_reactor_profile_percentile(pprof, 100), pprof->exec_max);
+
+  for (auto *ccomp : {ccomp1, ccomp2}) {
+    auto *cprof = fmc_reactor_ctx_profile_get(ccomp->_ctx);
+    ASSERT_EQ(cprof->execs, 10);
+    ASSERT_EQ(cprof->dwell.count, 10);
+    ASSERT_EQ(cprof->fanout.count, 0);
+    ASSERT_EQ(cprof->lateness.count, 0);
+  }
+
+  // The first schedule of the component was made before profiling
+  auto *sprof = fmc_reactor_ctx_profile_get(scomp->_ctx);
+  ASSERT_EQ(sprof->execs, 11);
+  ASSERT_EQ(sprof->lateness.count, 10);
+  ASSERT_GE(sprof->lateness.max, 0);
+  ASSERT_LT(sprof->lateness.max, 1000000000);
+
+  fmc_reactor_profile_set(&r, false, &err);
+  ASSERT_EQ(err, nullptr);
+  ASSERT_EQ(fmc_reactor_ctx_profile_get(pcomp->_ctx), nullptr);
+
+  fmc_reactor_destroy(&r);
+  fmc_cfg_sect_del(cfg);
+  fmc_component_module_del(mod);
+  fmc_component_module_del(iomod);
+  fmc_component_sys_destroy(&sys);
+}
+
+TEST(reactor, threads) {
+  auto expected = run_load_graph(1, 8, 4, false);
+  ASSERT_EQ(expected.size(), 32);
+  for (auto &node : expected) {
+    ASSERT_EQ(node.executed, 200);
+    ASSERT_EQ(node.input, 200);
+  }
+  for (bool pin : {false, true}) {
+    for (size_t threads : {2, 3, 4}) {
+      auto result = run_load_graph(threads, 8, 4, pin);
+      ASSERT_EQ(result.size(), expected.size());
+      for (size_t i = 0; i < result.size(); ++i) {
+        ASSERT_EQ(result[i].executed, expected[i].executed);
+        ASSERT_EQ(result[i].checksum, expected[i].checksum);
+      }
+    }
+  }
+}
+
+TEST(reactor, threads_scaling) {
+  size_t max_threads = std::max(2u, std::thread::hardware_concurrency());
+  for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+    double secs = 0;
+    run_load_graph(threads, 16, 4, false, &secs);
+    std::cout << threads << " threads: " << 200 * 16 * 4 / secs
+              << " component executions/sec" << std::endl;
+  }
+}
+
 GTEST_API_ int main(int argc, char **argv) {
   testing::InitGoogleTest(&argc, argv);
   components_path = fs::path(argv[1]).parent_path();
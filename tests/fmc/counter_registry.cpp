@@ -0,0 +1,150 @@
+/******************************************************************************
+        COPYRIGHT (c) 2019-2023 by Featuremine Corporation.
+
+        This Source Code Form is subject to the terms of the Mozilla Public
+        License, v. 2.0. If a copy of the MPL was not distributed with this
+        file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *****************************************************************************/
+
+/**
+ * @file counter_registry.cpp
+ * @date 18 Oct 2026
+ * @brief File contains tests for FMC counter registry
+ *
+ * @see http://www.featuremine.com
+ */
+
+#include <fmc++/gtestwrap.hpp>
+#include <fmc/counter_registry.h>
+#include <fmc/files.h>
+
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+static std::string registry_path(const char *name) {
+  return (std::filesystem::temp_directory_path() /
+          (std::string(name) + "." + std::to_string(getpid())))
+      .string();
+}
+
+TEST(counter_registry, counters) {
+  auto path = registry_path("counter_registry_counters");
+  fmc_error_t *error;
+  auto *writer = fmc_counter_registry_new(path.c_str(), 4, &error);
+  ASSERT_EQ(error, nullptr);
+  auto *reader = fmc_counter_registry_open(path.c_str(), &error);
+  ASSERT_EQ(error, nullptr);
+  ASSERT_EQ(fmc_counter_registry_count(reader), 0);
+  ASSERT_EQ(fmc_counter_registry_pid(reader), getpid());
+
+  auto *messages =
+      fmc_counter_registry_add(writer, "messages", FMC_COUNTER_COUNT, &error);
+  ASSERT_EQ(error, nullptr);
+  auto *lag = fmc_counter_registry_add(writer, "lag", FMC_COUNTER_GAUGE, &error);
+  ASSERT_EQ(error, nullptr);
+  auto *latency =
+      fmc_counter_registry_add(writer, "latency", FMC_COUNTER_DOUBLE, &error);
+  ASSERT_EQ(error, nullptr);
+  fmc_counter_add(messages, 3);
+  fmc_counter_add(messages, 4);
+  fmc_counter_set(lag, -5);
+  fmc_counter_set_double(latency, 1.5);
+
+  ASSERT_EQ(fmc_counter_registry_count(reader), 3);
+  auto *counter = fmc_counter_registry_get(reader, 0);
+  ASSERT_STREQ(counter->name, "messages");
+  ASSERT_EQ(fmc_counter_value(counter), 7.0);
+  counter = fmc_counter_registry_get(reader, 1);
+  ASSERT_STREQ(counter->name, "lag");
+  ASSERT_EQ(fmc_counter_value(counter), -5.0);
+  counter = fmc_counter_registry_get(reader, 2);
+  ASSERT_STREQ(counter->name, "latency");
+  ASSERT_EQ(fmc_counter_value(counter), 1.5);
+
+  // Counters are looked up by name
+  ASSERT_EQ(
+      fmc_counter_registry_add(writer, "messages", FMC_COUNTER_COUNT, &error),
+      messages);
+  ASSERT_EQ(error, nullptr);
+  fmc_counter_registry_add(writer, "messages", FMC_COUNTER_GAUGE, &error);
+  ASSERT_NE(error, nullptr);
+  std::string name(100, 'x');
+  auto *truncated = fmc_counter_registry_add(writer, name.c_str(),
+                                             FMC_COUNTER_COUNT, &error);
+  ASSERT_EQ(error, nullptr);
+  ASSERT_EQ(std::string(truncated->name), name.substr(0, 47));
+  fmc_counter_registry_add(writer, "full", FMC_COUNTER_COUNT, &error);
+  ASSERT_NE(error, nullptr);
+  fmc_counter_registry_add(reader, "reader", FMC_COUNTER_COUNT, &error);
+  ASSERT_NE(error, nullptr);
+
+  fmc_counter_registry_del(reader, &error);
+  ASSERT_EQ(error, nullptr);
+  fmc_counter_registry_del(writer, &error);
+  ASSERT_EQ(error, nullptr);
+  std::filesystem::remove(path);
+}
+
+TEST(counter_registry, invalid) {
+  auto path = registry_path("counter_registry_invalid");
+  fmc_error_t *error;
+  ASSERT_EQ(fmc_counter_registry_open(path.c_str(), &error), nullptr);
+  ASSERT_NE(error, nullptr);
+  auto fd = fmc_fopen(path.c_str(), READWRITE, &error);
+  ASSERT_EQ(error, nullptr);
+  fmc_fresize(fd, 4096, &error);
+  ASSERT_EQ(error, nullptr);
+  fmc_fclose(fd, &error);
+  ASSERT_EQ(fmc_counter_registry_open(path.c_str(), &error), nullptr);
+  ASSERT_NE(error, nullptr);
+  std::filesystem::remove(path);
+}
+
+// Reads the counters while another thread updates them
+TEST(counter_registry, concurrent) {
+  auto path = registry_path("counter_registry_concurrent");
+  fmc_error_t *error;
+  auto *writer = fmc_counter_registry_new(path.c_str(), 64, &error);
+  ASSERT_EQ(error, nullptr);
+  auto *reader = fmc_counter_registry_open(path.c_str(), &error);
+  ASSERT_EQ(error, nullptr);
+  const uint64_t updates = 1000000;
+  std::thread thread([&]() {
+    fmc_error_t *error;
+    std::vector<fmc_counter *> counters;
+    for (int i = 0; i < 64; ++i) {
+      counters.push_back(fmc_counter_registry_add(
+          writer, ("counter" + std::to_string(i)).c_str(), FMC_COUNTER_COUNT,
+          &error));
+    }
+    for (uint64_t i = 0; i < updates; ++i) {
+      fmc_counter_add(counters[i % 64], 1);
+    }
+  });
+  std::vector<double> last(64, 0.0);
+  bool done = false;
+  while (!done) {
+    size_t count = fmc_counter_registry_count(reader);
+    done = count == 64;
+    for (size_t i = 0; i < count; ++i) {
+      auto *counter = fmc_counter_registry_get(reader, i);
+      ASSERT_EQ(std::string(counter->name), "counter" + std::to_string(i));
+      auto value = fmc_counter_value(counter);
+      ASSERT_GE(value, last[i]);
+      last[i] = value;
+      done &= value == updates / 64;
+    }
+  }
+  thread.join();
+  fmc_counter_registry_del(reader, &error);
+  fmc_counter_registry_del(writer, &error);
+  std::filesystem::remove(path);
+}
+
+GTEST_API_ int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
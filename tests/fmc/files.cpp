@@ -271,6 +271,52 @@ TEST(fmc, falloc) {
   ASSERT_EQ(error, nullptr);
 }
 
+TEST(fmc, fcopy) {
+  fmc_error_t *error;
+
+  error = ERROR_UNINITIALIZED_VALUE;
+  auto src = fmc_ftemp(&error);
+  ASSERT_EQ(error, nullptr);
+
+  error = ERROR_UNINITIALIZED_VALUE;
+  auto dest = fmc_ftemp(&error);
+  ASSERT_EQ(error, nullptr);
+
+  std::string data;
+  for (int i = 0; i < 100000; ++i) {
+    data.push_back('a' + i % 26);
+  }
+  ASSERT_EQ(write(src, data.data(), data.size()), data.size());
+
+  error = ERROR_UNINITIALIZED_VALUE;
+  fmc_fcopy(dest, src, 0, 4096, &error);
+  ASSERT_EQ(error, nullptr);
+
+  error = ERROR_UNINITIALIZED_VALUE;
+  fmc_fcopy(dest, src, 4096, data.size() - 4096, &error);
+  ASSERT_EQ(error, nullptr);
+
+  error = ERROR_UNINITIALIZED_VALUE;
+  ASSERT_EQ(fmc_fsize(dest, &error), data.size());
+  ASSERT_EQ(error, nullptr);
+
+  std::string copy(data.size(), '\0');
+  ASSERT_EQ(pread(dest, copy.data(), copy.size(), 0), copy.size());
+  ASSERT_EQ(copy, data);
+
+  error = ERROR_UNINITIALIZED_VALUE;
+  fmc_fcopy(dest, src, data.size(), 1, &error);
+  ASSERT_NE(error, nullptr);
+
+  error = ERROR_UNINITIALIZED_VALUE;
+  fmc_fclose(src, &error);
+  ASSERT_EQ(error, nullptr);
+
+  error = ERROR_UNINITIALIZED_VALUE;
+  fmc_fclose(dest, &error);
+  ASSERT_EQ(error, nullptr);
+}
+
 TEST(fmc, fview) {
   fmc_error_t *error;
 
@@ -15,6 +15,7 @@
 #include <fmc/time.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include <uthash/utlist.h>
 
 struct fmc_reactor_api_v1 *_reactor;
@@ -305,6 +306,153 @@ cleanup:
   return NULL;
 };
 
+#define LOAD_SOURCE_RUNS 200
+#define LOAD_NODE_WORK 5000
+
+static void load_source_component_process_one(struct fmc_component *self,
+                                              struct fmc_reactor_ctx *ctx,
+                                              fmc_time64_t time) {
+  struct load_source_component *c = (struct load_source_component *)self;
+  if (c->count == LOAD_SOURCE_RUNS) {
+    return;
+  }
+  ++c->count;
+  struct fmc_shmem mem;
+  fmc_error_t *err = NULL;
+  fmc_shmem_init_view(&mem, _reactor->get_pool(ctx), &c->count,
+                      sizeof(c->count), &err);
+  if (err) {
+    _reactor->set_error(ctx, fmc_error_msg(err));
+    return;
+  }
+  _reactor->notify(ctx, 0, mem);
+  fmc_shmem_destroy(&mem, &err);
+  _reactor->queue(ctx);
+};
+
+static struct load_source_component *
+load_source_component_new(struct fmc_cfg_sect_item *cfg,
+                          struct fmc_reactor_ctx *ctx, char **inp_tps) {
+  if (inp_tps && inp_tps[0]) {
+    _reactor->set_error(ctx, "load source component does not expect inputs");
+    return NULL;
+  }
+  struct load_source_component *c =
+      (struct load_source_component *)calloc(1, sizeof(*c));
+  if (!c)
+    goto cleanup;
+  _reactor->on_exec(ctx, &load_source_component_process_one);
+  _reactor->add_output(ctx, "load", "load");
+  _reactor->queue(ctx);
+  return c;
+cleanup:
+  _reactor->set_error(ctx, NULL, FMC_ERROR_MEMORY);
+  return NULL;
+};
+
+static void load_node_component_on_dep(struct fmc_component *self, int idx,
+                                       struct fmc_shmem in) {
+  struct load_node_component *c = (struct load_node_component *)self;
+  c->input = *(size_t *)*in.view;
+}
+
+// Does a fixed amount of work on its input and forwards it
+static void load_node_component_process_one(struct fmc_component *self,
+                                            struct fmc_reactor_ctx *ctx,
+                                            fmc_time64_t time) {
+  struct load_node_component *c = (struct load_node_component *)self;
+  ++c->executed;
+  uint64_t x = c->input;
+  for (int i = 0; i < LOAD_NODE_WORK; ++i) {
+    x = x * 6364136223846793005ull + 1442695040888963407ull;
+  }
+  c->checksum += x >> 32;
+  struct fmc_shmem mem;
+  fmc_error_t *err = NULL;
+  fmc_shmem_init_view(&mem, _reactor->get_pool(ctx), &c->input,
+                      sizeof(c->input), &err);
+  if (err) {
+    _reactor->set_error(ctx, fmc_error_msg(err));
+    return;
+  }
+  _reactor->notify(ctx, 0, mem);
+  fmc_shmem_destroy(&mem, &err);
+};
+
+static struct load_node_component *
+load_node_component_new(struct fmc_cfg_sect_item *cfg,
+                        struct fmc_reactor_ctx *ctx, char **inp_tps) {
+  if (!inp_tps || !inp_tps[0] || inp_tps[1]) {
+    _reactor->set_error(ctx, "load node component expects a single input");
+    return NULL;
+  }
+  struct load_node_component *c =
+      (struct load_node_component *)calloc(1, sizeof(*c));
+  if (!c)
+    goto cleanup;
+  _reactor->on_exec(ctx, &load_node_component_process_one);
+  _reactor->on_dep(ctx, &load_node_component_on_dep);
+  _reactor->add_output(ctx, "load", "load");
+  return c;
+cleanup:
+  _reactor->set_error(ctx, NULL, FMC_ERROR_MEMORY);
+  return NULL;
+};
+
+// Counts the bytes written to a pipe until it reads 'q'
+static void pipe_component_on_read(struct fmc_component *self,
+                                   struct fmc_reactor_ctx *ctx, int fd,
+                                   uint32_t events) {
+  struct pipe_component *c = (struct pipe_component *)self;
+  char buf[64];
+  ssize_t n = read(fd, buf, sizeof(buf));
+  if (n <= 0) {
+    _reactor->set_error(ctx, "unable to read from pipe");
+    return;
+  }
+  for (ssize_t i = 0; i < n; ++i) {
+    if (buf[i] != 'q') {
+      ++c->received;
+      continue;
+    }
+    fmc_error_t *err;
+    fmc_reactor_ctx_fd_rm(ctx, fd, &err);
+    if (err)
+      _reactor->set_error(ctx, fmc_error_msg(err));
+    return;
+  }
+}
+
+static struct pipe_component *
+pipe_component_new(struct fmc_cfg_sect_item *cfg, struct fmc_reactor_ctx *ctx,
+                   char **inp_tps) {
+  struct pipe_component *c = (struct pipe_component *)calloc(1, sizeof(*c));
+  if (!c)
+    goto cleanup;
+  if (pipe(c->fds) != 0) {
+    free(c);
+    _reactor->set_error(ctx, "unable to create pipe");
+    return NULL;
+  }
+  fmc_error_t *err;
+  fmc_reactor_ctx_fd_add(ctx, c->fds[0], FMC_REACTOR_FD_READ,
+                         &pipe_component_on_read, &err);
+  if (err) {
+    _reactor->set_error(ctx, fmc_error_msg(err));
+  }
+  return c;
+cleanup:
+  _reactor->set_error(ctx, NULL, FMC_ERROR_MEMORY);
+  return NULL;
+};
+
+static void pipe_component_del(struct fmc_component *comp) {
+  struct pipe_component *c = (struct pipe_component *)comp;
+  close(c->fds[0]);
+  close(c->fds[1]);
+  free(comp);
+};
+
 struct fmc_cfg_node_spec empty_cfg_spec[] = {{NULL}};
 
 struct fmc_component_def_v1 components[] = {
@@ -356,6 +504,30 @@ struct fmc_component_def_v1 components[] = {
         .tp_new = (fmc_newfunc)&consumer_component_3_new,
         .tp_del = &generic_component_del,
     },
+    {
+        .tp_name = "loadsource",
+        .tp_descr = "Source component for multi-threaded reactor test",
+        .tp_size = sizeof(struct load_source_component),
+        .tp_cfgspec = empty_cfg_spec,
+        .tp_new = (fmc_newfunc)&load_source_component_new,
+        .tp_del = &generic_component_del,
+    },
+    {
+        .tp_name = "loadnode",
+        .tp_descr = "Component that does a fixed amount of work per update",
+        .tp_size = sizeof(struct load_node_component),
+        .tp_cfgspec = empty_cfg_spec,
+        .tp_new = (fmc_newfunc)&load_node_component_new,
+        .tp_del = &generic_component_del,
+    },
+    {
+        .tp_name = "pipecomponent",
+        .tp_descr = "Component that reads from a pipe when it is readable",
+        .tp_size = sizeof(struct pipe_component),
+        .tp_cfgspec = empty_cfg_spec,
+        .tp_new = (fmc_newfunc)&pipe_component_new,
+        .tp_del = &pipe_component_del,
+    },
     {NULL},
 };
 
@@ -45,6 +45,28 @@ struct consumer_component_3 {
   fmc_error_t *e;
 };
 
+/*Components for multi-threaded reactor test*/
+
+struct load_source_component {
+  fmc_component_HEAD;
+  size_t count;
+};
+
+struct load_node_component {
+  fmc_component_HEAD;
+  size_t input;
+  size_t executed;
+  uint64_t checksum;
+};
+
+/*Component for file descriptor sources test*/
+
+struct pipe_component {
+  fmc_component_HEAD;
+  int fds[2];
+  size_t received;
+};
+
 #ifdef __cplusplus
 }
 #endif
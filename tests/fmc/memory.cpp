@@ -18,7 +18,14 @@
 #include <fmc/memory.h>
 
 #include <fmc++/gtestwrap.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
 #include <string_view>
+#include <thread>
+#include <vector>
 
 #include <uthash/utlist.h>
 
@@ -835,6 +842,149 @@ TEST(fmc_memory, resize) {
   fmc_pool_destroy(&p);
 }
 
+TEST(fmc_memory, size_classes) {
+  struct fmc_pool p;
+  fmc_pool_init(&p);
+  fmc_error_t *e = nullptr;
+
+  std::vector<struct fmc_shmem> mems;
+  for (size_t sz = 0; sz < 70000; sz += 1 + sz / 8) {
+    struct fmc_shmem mem;
+    fmc_shmem_init_alloc(&mem, &p, sz, &e);
+    ASSERT_EQ(e, nullptr);
+    ASSERT_EQ(fmc_shmem_sz(&mem), sz);
+    memset(*mem.view, (int)(sz % 251), sz);
+    mems.push_back(mem);
+  }
+  for (auto &mem : mems) {
+    size_t sz = fmc_shmem_sz(&mem);
+    auto *data = (unsigned char *)*mem.view;
+    for (size_t i = 0; i < sz; ++i) {
+      ASSERT_EQ(data[i], sz % 251);
+    }
+    fmc_shmem_realloc(&mem, sz * 2 + 1, &e);
+    ASSERT_EQ(e, nullptr);
+    data = (unsigned char *)*mem.view;
+    for (size_t i = 0; i < sz; ++i) {
+      ASSERT_EQ(data[i], sz % 251);
+    }
+    fmc_shmem_destroy(&mem, &e);
+    ASSERT_EQ(e, nullptr);
+  }
+  fmc_pool_destroy(&p);
+}
+
+TEST(fmc_memory, huge_pages) {
+  fmc_pool_huge_pages_set(true);
+  struct fmc_pool p;
+  fmc_pool_init(&p);
+  fmc_error_t *e = nullptr;
+  // Enough buffers to map new arenas
+  std::vector<struct fmc_shmem> mems(256);
+  for (auto &mem : mems) {
+    fmc_shmem_init_alloc(&mem, &p, 60000, &e);
+    ASSERT_EQ(e, nullptr);
+    memset(*mem.view, 1, 60000);
+  }
+  for (auto &mem : mems) {
+    fmc_shmem_destroy(&mem, &e);
+    ASSERT_EQ(e, nullptr);
+  }
+  fmc_pool_destroy(&p);
+  fmc_pool_huge_pages_set(false);
+}
+
+// Buffers allocated on one thread and released on another, like messages
+// passed between components running on different reactor workers
+TEST(fmc_memory, threads) {
+  struct fmc_pool p;
+  fmc_pool_init(&p);
+  p.concurrent = true;
+  const size_t count = 100000;
+  std::vector<struct fmc_shmem> mems(count);
+  std::atomic<size_t> ready = 0;
+  std::thread producer([&]() {
+    fmc_error_t *e;
+    for (size_t i = 0; i < count; ++i) {
+      fmc_shmem_init_alloc(&mems[i], &p, 8 + i % 1000, &e);
+      ASSERT_EQ(e, nullptr);
+      memcpy(*mems[i].view, &i, sizeof(i));
+      ready.store(i + 1, std::memory_order_release);
+    }
+  });
+  fmc_error_t *e;
+  for (size_t i = 0; i < count; ++i) {
+    while (ready.load(std::memory_order_acquire) <= i) {
+    }
+    size_t value;
+    memcpy(&value, *mems[i].view, sizeof(value));
+    ASSERT_EQ(value, i);
+    fmc_shmem_destroy(&mems[i], &e);
+    ASSERT_EQ(e, nullptr);
+  }
+  producer.join();
+  fmc_pool_destroy(&p);
+}
+
+// Mixed message sizes going through a window of live buffers
+TEST(fmc_memory, churn_performance) {
+  using namespace std::chrono;
+  const size_t ops = 2000000;
+  const size_t window = 64;
+  std::mt19937_64 gen(42);
+  std::vector<size_t> sizes(4096);
+  for (auto &sz : sizes) {
+    sz = gen() % 100 ? 16 + gen() % 2048 : 16384 + gen() % 32768;
+  }
+
+  std::vector<void *> ptrs(window, nullptr);
+  auto start = steady_clock::now();
+  for (size_t i = 0; i < ops; ++i) {
+    size_t sz = sizes[i % sizes.size()];
+    auto &ptr = ptrs[i % window];
+    free(ptr);
+    ptr = malloc(sz);
+    memset(ptr, 0, 16);
+    if (i % 8 == 0) {
+      ptr = realloc(ptr, sz * 2);
+    }
+  }
+  auto malloc_elapsed = duration<double>(steady_clock::now() - start).count();
+  for (auto ptr : ptrs) {
+    free(ptr);
+  }
+
+  struct fmc_pool p;
+  fmc_pool_init(&p);
+  fmc_error_t *e;
+  std::vector<struct fmc_shmem> mems(window);
+  for (auto &mem : mems) {
+    fmc_shmem_init_alloc(&mem, &p, 16, &e);
+  }
+  start = steady_clock::now();
+  for (size_t i = 0; i < ops; ++i) {
+    size_t sz = sizes[i % sizes.size()];
+    auto &mem = mems[i % window];
+    fmc_shmem_destroy(&mem, &e);
+    fmc_shmem_init_alloc(&mem, &p, sz, &e);
+    memset(*mem.view, 0, 16);
+    if (i % 8 == 0) {
+      fmc_shmem_realloc(&mem, sz * 2, &e);
+    }
+  }
+  auto pool_elapsed = duration<double>(steady_clock::now() - start).count();
+  ASSERT_EQ(e, nullptr);
+  for (auto &mem : mems) {
+    fmc_shmem_destroy(&mem, &e);
+  }
+  fmc_pool_destroy(&p);
+
+  std::cout << "malloc: " << ops / malloc_elapsed << " allocations/sec"
+            << std::endl;
+  std::cout << "pool: " << ops / pool_elapsed << " allocations/sec"
+            << std::endl;
+}
+
 GTEST_API_ int main(int argc, char **argv) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
@@ -0,0 +1,220 @@
+/******************************************************************************
+        COPYRIGHT (c) 2019-2023 by Featuremine Corporation.
+
+        This Source Code Form is subject to the terms of the Mozilla Public
+        License, v. 2.0. If a copy of the MPL was not distributed with this
+        file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *****************************************************************************/
+
+/**
+ * @file timer_wheel.cpp
+ * @date 18 Oct 2026
+ * @brief File contains tests for FMC timer wheel
+ *
+ * @see http://www.featuremine.com
+ */
+
+#include <fmc++/gtestwrap.hpp>
+#include <fmc/component.h>
+#include <fmc/math.h>
+#include <fmc/reactor.h>
+#include <fmc/timer_wheel.h>
+#include <uthash/utarray.h>
+#include <uthash/utheap.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+static fmc_time64_t nanos(int64_t value) {
+  return fmc_time64_from_nanos(value);
+}
+
+TEST(timer_wheel, empty) {
+  fmc_timer_wheel w;
+  fmc_timer_wheel_init(&w, 1000);
+  size_t data;
+  ASSERT_TRUE(fmc_time64_is_end(fmc_timer_wheel_next(&w)));
+  ASSERT_FALSE(fmc_timer_wheel_pop(&w, fmc_time64_end(), &data));
+  fmc_timer_wheel_destroy(&w);
+}
+
+TEST(timer_wheel, pop) {
+  fmc_timer_wheel w;
+  fmc_timer_wheel_init(&w, 1000);
+  fmc_error_t *e;
+  fmc_timer_wheel_add(&w, nanos(2500), 2, &e);
+  ASSERT_EQ(e, nullptr);
+  fmc_timer_wheel_add(&w, nanos(2100), 1, &e);
+  ASSERT_EQ(e, nullptr);
+  fmc_timer_wheel_add(&w, fmc_time64_start(), 0, &e);
+  ASSERT_EQ(e, nullptr);
+  fmc_timer_wheel_add(&w, nanos(1000000000), 3, &e);
+  ASSERT_EQ(e, nullptr);
+
+  size_t data;
+  ASSERT_TRUE(fmc_time64_equal(fmc_timer_wheel_next(&w), fmc_time64_start()));
+  ASSERT_TRUE(fmc_timer_wheel_pop(&w, nanos(-5), &data));
+  ASSERT_EQ(data, 0);
+  ASSERT_FALSE(fmc_timer_wheel_pop(&w, nanos(-5), &data));
+
+  // Timers in the same tick only expire once their time is reached
+  ASSERT_TRUE(fmc_time64_equal(fmc_timer_wheel_next(&w), nanos(2100)));
+  ASSERT_TRUE(fmc_timer_wheel_pop(&w, nanos(2200), &data));
+  ASSERT_EQ(data, 1);
+  ASSERT_FALSE(fmc_timer_wheel_pop(&w, nanos(2200), &data));
+  ASSERT_TRUE(fmc_time64_equal(fmc_timer_wheel_next(&w), nanos(2500)));
+  ASSERT_TRUE(fmc_timer_wheel_pop(&w, nanos(2500), &data));
+  ASSERT_EQ(data, 2);
+
+  // Timers added in the past expire right away
+  fmc_timer_wheel_add(&w, nanos(0), 4, &e);
+  ASSERT_EQ(e, nullptr);
+  ASSERT_TRUE(fmc_time64_equal(fmc_timer_wheel_next(&w), nanos(0)));
+  ASSERT_TRUE(fmc_timer_wheel_pop(&w, nanos(2500), &data));
+  ASSERT_EQ(data, 4);
+
+  ASSERT_TRUE(fmc_timer_wheel_pop(&w, fmc_time64_end(), &data));
+  ASSERT_EQ(data, 3);
+  ASSERT_EQ(w.count, 0);
+  fmc_timer_wheel_destroy(&w);
+}
+
+TEST(timer_wheel, cancel) {
+  fmc_timer_wheel w;
+  fmc_timer_wheel_init(&w, 1);
+  fmc_error_t *e;
+  auto *first = fmc_timer_wheel_add(&w, nanos(10), 1, &e);
+  ASSERT_EQ(e, nullptr);
+  fmc_timer_wheel_add(&w, nanos(20), 2, &e);
+  fmc_timer_wheel_add(&w, nanos(30), 3, &e);
+  fmc_timer_wheel_add(&w, nanos(40), 2, &e);
+  ASSERT_EQ(w.count, 4);
+
+  fmc_timer_wheel_cancel(&w, first);
+  ASSERT_TRUE(fmc_time64_equal(fmc_timer_wheel_next(&w), nanos(20)));
+  fmc_timer_wheel_cancel_data(&w, 2);
+  ASSERT_EQ(w.count, 1);
+  ASSERT_TRUE(fmc_time64_equal(fmc_timer_wheel_next(&w), nanos(30)));
+
+  size_t data;
+  ASSERT_TRUE(fmc_timer_wheel_pop(&w, fmc_time64_end(), &data));
+  ASSERT_EQ(data, 3);
+  ASSERT_FALSE(fmc_timer_wheel_pop(&w, fmc_time64_end(), &data));
+  fmc_timer_wheel_destroy(&w);
+}
+
+// Compares the wheel with a sorted reference while adding timers at random
+// times around the current time
+TEST(timer_wheel, random) {
+  std::mt19937_64 gen(42);
+  for (int64_t tick : {1, 7, 1000}) {
+    fmc_timer_wheel w;
+    fmc_timer_wheel_init(&w, tick);
+    std::vector<std::pair<int64_t, size_t>> expected;
+    int64_t now = -1000000;
+    size_t next_data = 0;
+    for (int step = 0; step < 20000; ++step) {
+      for (int i = gen() % 4; i > 0; --i) {
+        int64_t t = now + (int64_t)(gen() % (1ull << (gen() % 40))) - 100;
+        fmc_error_t *e;
+        fmc_timer_wheel_add(&w, nanos(t), next_data, &e);
+        ASSERT_EQ(e, nullptr);
+        expected.emplace_back(t, next_data++);
+      }
+      auto min = std::min_element(expected.begin(), expected.end());
+      if (min != expected.end()) {
+        ASSERT_EQ(fmc_time64_raw(fmc_timer_wheel_next(&w)), min->first);
+      }
+      now += gen() % 5000;
+      std::vector<size_t> popped;
+      size_t data;
+      while (fmc_timer_wheel_pop(&w, nanos(now), &data)) {
+        popped.push_back(data);
+      }
+      std::vector<size_t> due;
+      for (auto it = expected.begin(); it != expected.end();) {
+        if (it->first <= now) {
+          due.push_back(it->second);
+          it = expected.erase(it);
+        } else {
+          ++it;
+        }
+      }
+      std::sort(popped.begin(), popped.end());
+      std::sort(due.begin(), due.end());
+      ASSERT_EQ(popped, due);
+      ASSERT_EQ(w.count, expected.size());
+    }
+    fmc_timer_wheel_destroy(&w);
+  }
+}
+
+// Periodic timers with different periods, like heartbeats and bar builders
+TEST(timer_wheel, performance) {
+  using namespace std::chrono;
+  const size_t timers = 10000;
+  const int64_t end = 10000000000ll;
+  std::vector<int64_t> periods;
+  for (size_t i = 0; i < timers; ++i) {
+    periods.push_back(1000000 * (1 + i % 100));
+  }
+
+  size_t heap_fired = 0;
+  UT_array heap;
+  UT_icd icd = {sizeof(struct sched_item), nullptr, nullptr, nullptr};
+  utarray_init(&heap, &icd);
+  auto start = steady_clock::now();
+  for (size_t i = 0; i < timers; ++i) {
+    struct sched_item item = {nanos(periods[i]), i};
+    utheap_push(&heap, &item, FMC_INT64_T_PTR_LESS);
+  }
+  while (true) {
+    auto *item = (struct sched_item *)utarray_front(&heap);
+    if (fmc_time64_raw(item->t) > end)
+      break;
+    struct sched_item next = {
+        fmc_time64_add(item->t, nanos(periods[item->idx])), item->idx};
+    utheap_pop(&heap, FMC_INT64_T_PTR_LESS);
+    utheap_push(&heap, &next, FMC_INT64_T_PTR_LESS);
+    ++heap_fired;
+  }
+  auto heap_elapsed = duration<double>(steady_clock::now() - start).count();
+  utarray_done(&heap);
+
+  size_t wheel_fired = 0;
+  fmc_timer_wheel w;
+  fmc_timer_wheel_init(&w, 1000);
+  fmc_error_t *e;
+  start = steady_clock::now();
+  for (size_t i = 0; i < timers; ++i) {
+    fmc_timer_wheel_add(&w, nanos(periods[i]), i, &e);
+  }
+  std::vector<int64_t> due(periods);
+  while (true) {
+    auto now = fmc_timer_wheel_next(&w);
+    if (fmc_time64_raw(now) > end)
+      break;
+    size_t idx;
+    while (fmc_timer_wheel_pop(&w, now, &idx)) {
+      due[idx] += periods[idx];
+      fmc_timer_wheel_add(&w, nanos(due[idx]), idx, &e);
+      ++wheel_fired;
+    }
+  }
+  auto wheel_elapsed = duration<double>(steady_clock::now() - start).count();
+  fmc_timer_wheel_destroy(&w);
+
+  ASSERT_EQ(heap_fired, wheel_fired);
+  std::cout << "heap: " << heap_fired / heap_elapsed << " timers/sec"
+            << std::endl;
+  std::cout << "wheel: " << wheel_fired / wheel_elapsed << " timers/sec"
+            << std::endl;
+}
+
+GTEST_API_ int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,326 @@
+/******************************************************************************
+        COPYRIGHT (c) 2019-2023 by Featuremine Corporation.
+
+        This Source Code Form is subject to the terms of the Mozilla Public
+        License, v. 2.0. If a copy of the MPL was not distributed with this
+        file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *****************************************************************************/
+
+/**
+ * @file chain.cpp
+ * @date 18 Oct 2026
+ * @brief File contains tests for YTP stream chain API
+ *
+ * @see http://www.featuremine.com
+ */
+
+#include <ytp/chain.h>
+#include <ytp/cursor.h>
+#include <ytp/data.h>
+#include <ytp/streams.h>
+#include <ytp/yamal.h>
+
+#include <fmc++/counters.hpp>
+#include <fmc++/gtestwrap.hpp>
+#include <fmc/files.h>
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct chain_fixture {
+  chain_fixture() {
+    fd = fmc_ftemp(&error);
+    EXPECT_EQ(error, nullptr);
+    yamal = ytp_yamal_new(fd, &error);
+    EXPECT_EQ(error, nullptr);
+    sidecar_fd = fmc_ftemp(&error);
+    EXPECT_EQ(error, nullptr);
+    sidecar = ytp_yamal_new(sidecar_fd, &error);
+    EXPECT_EQ(error, nullptr);
+    streams = ytp_streams_new(yamal, &error);
+    EXPECT_EQ(error, nullptr);
+  }
+  ~chain_fixture() {
+    ytp_streams_del(streams, &error);
+    EXPECT_EQ(error, nullptr);
+    ytp_yamal_del(sidecar, &error);
+    EXPECT_EQ(error, nullptr);
+    fmc_fclose(sidecar_fd, &error);
+    EXPECT_EQ(error, nullptr);
+    ytp_yamal_del(yamal, &error);
+    EXPECT_EQ(error, nullptr);
+    fmc_fclose(fd, &error);
+    EXPECT_EQ(error, nullptr);
+  }
+
+  ytp_mmnode_offs announce(const std::string &channel) {
+    auto stream =
+        ytp_streams_announce(streams, 4, "peer", channel.size(),
+                             channel.data(), 8, "encoding", &error);
+    EXPECT_EQ(error, nullptr);
+    return stream;
+  }
+
+  void write(int64_t ts, ytp_mmnode_offs stream) {
+    auto *ptr = ytp_data_reserve(yamal, sizeof(ts), &error);
+    ASSERT_EQ(error, nullptr);
+    std::memcpy(ptr, &ts, sizeof(ts));
+    ytp_data_commit(yamal, ts, stream, ptr, &error);
+    ASSERT_EQ(error, nullptr);
+  }
+
+  fmc_error_t *error;
+  fmc_fd fd;
+  fmc_fd sidecar_fd;
+  ytp_yamal_t *yamal;
+  ytp_yamal_t *sidecar;
+  ytp_streams_t *streams;
+};
+
+struct chain_reader {
+  chain_reader(ytp_chain_t *chain, std::vector<ytp_mmnode_offs> streams)
+      : chain(chain) {
+    fmc_error_t *error;
+    for (auto stream : streams) {
+      ytp_chain_data_cb(chain, stream, &callback, this, &error);
+      EXPECT_EQ(error, nullptr);
+    }
+  }
+
+  static void callback(void *closure, uint64_t seqno, int64_t ts,
+                       ytp_mmnode_offs stream, size_t sz, const char *data) {
+    auto &self = *(chain_reader *)closure;
+    EXPECT_EQ(sz, sizeof(ts));
+    EXPECT_EQ(std::memcmp(data, &ts, sizeof(ts)), 0);
+    EXPECT_GT(seqno, self.seqno);
+    self.seqno = seqno;
+    self.output.push_back(ts);
+  }
+
+  std::vector<int64_t> poll() {
+    fmc_error_t *error;
+    while (ytp_chain_poll(chain, &error)) {
+      EXPECT_EQ(error, nullptr);
+    }
+    EXPECT_EQ(error, nullptr);
+    return std::move(output);
+  }
+
+  ytp_chain_t *chain;
+  uint64_t seqno = 0;
+  std::vector<int64_t> output;
+};
+
+TEST(chain, merge) {
+  chain_fixture f;
+  std::vector<ytp_mmnode_offs> streams;
+  for (int i = 0; i < 4; ++i) {
+    streams.push_back(f.announce("ch" + std::to_string(i)));
+  }
+  for (int64_t ts = 0; ts < 20; ++ts) {
+    f.write(ts, streams[ts % 4]);
+  }
+
+  fmc_error_t *error;
+  auto *chain = ytp_chain_new(f.yamal, f.sidecar, &error);
+  ASSERT_EQ(error, nullptr);
+  ASSERT_EQ(ytp_chain_update(chain, 5, &error), 5);
+  ASSERT_EQ(error, nullptr);
+
+  chain_reader reader(chain, {streams[1], streams[3]});
+  ASSERT_EQ(reader.poll(), std::vector<int64_t>({1, 3}));
+
+  ASSERT_EQ(ytp_chain_update(chain, 100, &error), 15);
+  ASSERT_EQ(error, nullptr);
+  ASSERT_EQ(reader.poll(),
+            std::vector<int64_t>({5, 7, 9, 11, 13, 15, 17, 19}));
+
+  // Streams subscribed later start from their first message
+  ytp_chain_data_cb(chain, streams[0], &chain_reader::callback, &reader,
+                    &error);
+  ASSERT_EQ(error, nullptr);
+  reader.seqno = 0;
+  ASSERT_EQ(reader.poll(), std::vector<int64_t>({0, 4, 8, 12, 16}));
+
+  ytp_chain_data_cb_rm(chain, streams[0], &chain_reader::callback, &reader,
+                       &error);
+  ASSERT_EQ(error, nullptr);
+  for (int64_t ts = 20; ts < 24; ++ts) {
+    f.write(ts, streams[ts % 4]);
+  }
+  ASSERT_EQ(ytp_chain_update(chain, 100, &error), 4);
+  ASSERT_EQ(error, nullptr);
+  ASSERT_EQ(reader.poll(), std::vector<int64_t>({21, 23}));
+
+  ytp_chain_del(chain, &error);
+  ASSERT_EQ(error, nullptr);
+}
+
+TEST(chain, resume) {
+  chain_fixture f;
+  std::vector<ytp_mmnode_offs> streams;
+  for (int i = 0; i < 3; ++i) {
+    streams.push_back(f.announce("ch" + std::to_string(i)));
+  }
+  for (int64_t ts = 0; ts < 30; ++ts) {
+    f.write(ts, streams[ts % 3]);
+  }
+
+  fmc_error_t *error;
+  auto *chain = ytp_chain_new(f.yamal, f.sidecar, &error);
+  ASSERT_EQ(error, nullptr);
+  ASSERT_EQ(ytp_chain_update(chain, 10, &error), 10);
+  ASSERT_EQ(error, nullptr);
+  ytp_chain_del(chain, &error);
+  ASSERT_EQ(error, nullptr);
+
+  // A new builder continues where the previous one stopped
+  chain = ytp_chain_new(f.yamal, f.sidecar, &error);
+  ASSERT_EQ(error, nullptr);
+  ASSERT_EQ(ytp_chain_update(chain, 100, &error), 20);
+  ASSERT_EQ(error, nullptr);
+  ASSERT_EQ(ytp_chain_update(chain, 100, &error), 0);
+  ASSERT_EQ(error, nullptr);
+  ytp_chain_del(chain, &error);
+  ASSERT_EQ(error, nullptr);
+
+  chain = ytp_chain_new(f.yamal, f.sidecar, &error);
+  ASSERT_EQ(error, nullptr);
+  chain_reader reader(chain, {streams[0], streams[2]});
+  std::vector<int64_t> expected;
+  for (int64_t ts = 0; ts < 30; ++ts) {
+    if (ts % 3 != 1) {
+      expected.push_back(ts);
+    }
+  }
+  ASSERT_EQ(reader.poll(), expected);
+  ytp_chain_del(chain, &error);
+  ASSERT_EQ(error, nullptr);
+}
+
+TEST(chain, announcements) {
+  chain_fixture f;
+  auto stream0 = f.announce("ch0");
+  f.write(0, stream0);
+  auto stream1 = f.announce("ch1");
+  f.write(1, stream1);
+  f.write(2, stream0);
+
+  fmc_error_t *error;
+  auto *chain = ytp_chain_new(f.yamal, f.sidecar, &error);
+  ASSERT_EQ(error, nullptr);
+  ASSERT_EQ(ytp_chain_update(chain, 100, &error), 3);
+  ASSERT_EQ(error, nullptr);
+
+  // Announcements are delivered before the data of their streams, and data
+  // is delivered with the id of the announcement
+  using events_t = std::vector<std::pair<std::string, ytp_mmnode_offs>>;
+  events_t events;
+  auto ann_cb = [](void *closure, uint64_t seqno, ytp_mmnode_offs stream,
+                   size_t peer_sz, const char *peer_name, size_t ch_sz,
+                   const char *ch_name, size_t encoding_sz,
+                   const char *encoding_data, bool subscribed) {
+    auto &events = *(events_t *)closure;
+    events.emplace_back(std::string(ch_name, ch_sz), stream);
+  };
+  auto data_cb = [](void *closure, uint64_t seqno, int64_t ts,
+                    ytp_mmnode_offs stream, size_t sz, const char *data) {
+    auto &events = *(events_t *)closure;
+    events.emplace_back(std::to_string(ts), stream);
+  };
+  ytp_chain_ann_cb(chain, ann_cb, &events, &error);
+  ASSERT_EQ(error, nullptr);
+  ytp_chain_data_cb(chain, stream0, data_cb, &events, &error);
+  ASSERT_EQ(error, nullptr);
+  ytp_chain_data_cb(chain, stream1, data_cb, &events, &error);
+  ASSERT_EQ(error, nullptr);
+  while (ytp_chain_poll(chain, &error)) {
+    ASSERT_EQ(error, nullptr);
+  }
+  ASSERT_EQ(error, nullptr);
+  events_t expected{{"ch0", stream0}, {"ch1", stream1}, {"0", stream0},
+                    {"1", stream1},   {"2", stream0}};
+  ASSERT_EQ(events, expected);
+
+  ytp_chain_ann_cb_rm(chain, ann_cb, &events, &error);
+  ASSERT_EQ(error, nullptr);
+  ytp_chain_del(chain, &error);
+  ASSERT_EQ(error, nullptr);
+}
+
+TEST(chain, sparse_performance) {
+  using namespace std::chrono;
+  chain_fixture f;
+  const size_t stream_count = 2000;
+  const size_t messages = 1000000;
+  std::vector<ytp_mmnode_offs> streams;
+  for (size_t i = 0; i < stream_count; ++i) {
+    streams.push_back(f.announce("ch" + std::to_string(i)));
+  }
+  for (size_t i = 0; i < messages; ++i) {
+    f.write(i, streams[i % stream_count]);
+  }
+
+  fmc_error_t *error;
+  std::vector<ytp_mmnode_offs> subscribed{streams[0], streams[10], streams[100],
+                                          streams[500], streams[1000]};
+
+  auto start = steady_clock::now();
+  auto *cursor = ytp_cursor_new(f.yamal, &error);
+  ASSERT_EQ(error, nullptr);
+  size_t count = 0;
+  auto cb = [](void *closure, uint64_t seqno, int64_t ts,
+               ytp_mmnode_offs stream, size_t sz, const char *data) {
+    ++*(size_t *)closure;
+  };
+  for (auto stream : subscribed) {
+    ytp_cursor_data_cb(cursor, stream, cb, &count, &error);
+    ASSERT_EQ(error, nullptr);
+  }
+  while (ytp_cursor_poll(cursor, &error))
+    ;
+  ASSERT_EQ(error, nullptr);
+  auto cursor_time = steady_clock::now() - start;
+  ytp_cursor_del(cursor, &error);
+  ASSERT_EQ(count, subscribed.size() * messages / stream_count);
+
+  auto *chain = ytp_chain_new(f.yamal, f.sidecar, &error);
+  ASSERT_EQ(error, nullptr);
+  start = steady_clock::now();
+  ASSERT_EQ(ytp_chain_update(chain, messages, &error), messages);
+  ASSERT_EQ(error, nullptr);
+  auto update_time = steady_clock::now() - start;
+
+  start = steady_clock::now();
+  count = 0;
+  for (auto stream : subscribed) {
+    ytp_chain_data_cb(chain, stream, cb, &count, &error);
+    ASSERT_EQ(error, nullptr);
+  }
+  while (ytp_chain_poll(chain, &error))
+    ;
+  ASSERT_EQ(error, nullptr);
+  auto chain_time = steady_clock::now() - start;
+  ASSERT_EQ(count, subscribed.size() * messages / stream_count);
+  ytp_chain_del(chain, &error);
+  ASSERT_EQ(error, nullptr);
+
+  std::cout << subscribed.size() << " of " << stream_count << " streams, "
+            << messages << " messages" << std::endl;
+  std::cout << "  ytp_cursor_poll: "
+            << duration_cast<microseconds>(cursor_time).count()
+            << " microseconds" << std::endl;
+  std::cout << "  ytp_chain_update: "
+            << duration_cast<microseconds>(update_time).count()
+            << " microseconds" << std::endl;
+  std::cout << "  ytp_chain_poll: "
+            << duration_cast<microseconds>(chain_time).count()
+            << " microseconds" << std::endl;
+}
+
+GTEST_API_ int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,245 @@
+/******************************************************************************
+        COPYRIGHT (c) 2019-2023 by Featuremine Corporation.
+
+        This Source Code Form is subject to the terms of the Mozilla Public
+        License, v. 2.0. If a copy of the MPL was not distributed with this
+        file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *****************************************************************************/
+
+/**
+ * @file merge.cpp
+ * @date 18 Oct 2026
+ * @brief File contains tests for YTP merge cursor API
+ *
+ * @see http://www.featuremine.com
+ */
+
+#include <ytp/data.h>
+#include <ytp/merge.h>
+#include <ytp/streams.h>
+
+#include <fmc++/gtestwrap.hpp>
+#include <fmc/files.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+struct merge_input {
+  merge_input() {
+    fmc_error_t *error;
+    fd = fmc_ftemp(&error);
+    EXPECT_EQ(error, nullptr);
+    yamal = ytp_yamal_new(fd, &error);
+    EXPECT_EQ(error, nullptr);
+    streams = ytp_streams_new(yamal, &error);
+    EXPECT_EQ(error, nullptr);
+    stream = ytp_streams_announce(streams, 4, "peer", 2, "ch", 8, "encoding",
+                                  &error);
+    EXPECT_EQ(error, nullptr);
+  }
+  ~merge_input() {
+    fmc_error_t *error;
+    ytp_streams_del(streams, &error);
+    ytp_yamal_del(yamal, &error);
+    fmc_fclose(fd, &error);
+  }
+  void write(int64_t ts, uint64_t value) {
+    fmc_error_t *error;
+    auto *ptr = ytp_data_reserve(yamal, sizeof(value), &error);
+    ASSERT_EQ(error, nullptr);
+    std::memcpy(ptr, &value, sizeof(value));
+    ytp_data_commit(yamal, ts, stream, ptr, &error);
+    ASSERT_EQ(error, nullptr);
+  }
+  fmc_fd fd;
+  ytp_yamal_t *yamal;
+  ytp_streams_t *streams;
+  ytp_mmnode_offs stream;
+};
+
+// Subscribes to every stream announced in the inputs and records the
+// messages as (ts, input, value)
+struct merge_reader {
+  merge_reader(std::vector<std::unique_ptr<merge_input>> &inputs) {
+    std::vector<ytp_yamal_t *> yamals;
+    for (auto &input : inputs) {
+      yamals.push_back(input->yamal);
+    }
+    fmc_error_t *error;
+    merge = ytp_merge_cursor_new(yamals.data(), yamals.size(), &error);
+    EXPECT_EQ(error, nullptr);
+    closures.resize(yamals.size());
+    ytp_merge_cursor_ann_cb(
+        merge,
+        [](void *closure, size_t input, uint64_t seqno, ytp_mmnode_offs stream,
+           size_t psz, const char *peer, size_t csz, const char *channel,
+           size_t esz, const char *encoding, bool subscribed) {
+          auto &self = *(merge_reader *)closure;
+          self.closures[input] = {&self, input};
+          fmc_error_t *error;
+          ytp_merge_cursor_data_cb(self.merge, input, stream, &data_cb,
+                                   &self.closures[input], &error);
+          EXPECT_EQ(error, nullptr);
+        },
+        this, &error);
+    EXPECT_EQ(error, nullptr);
+  }
+  ~merge_reader() {
+    fmc_error_t *error;
+    ytp_merge_cursor_del(merge, &error);
+    EXPECT_EQ(error, nullptr);
+  }
+  static void data_cb(void *closure, uint64_t seqno, int64_t ts,
+                      ytp_mmnode_offs stream, size_t sz, const char *data) {
+    auto &[self, input] = *(std::pair<merge_reader *, size_t> *)closure;
+    uint64_t value;
+    ASSERT_EQ(sz, sizeof(value));
+    std::memcpy(&value, data, sz);
+    self->messages.emplace_back(ts, input, value);
+  }
+  void poll() {
+    fmc_error_t *error;
+    while (ytp_merge_cursor_poll(merge, &error)) {
+      ASSERT_EQ(error, nullptr);
+    }
+    ASSERT_EQ(error, nullptr);
+  }
+  ytp_merge_cursor_t *merge;
+  std::vector<std::pair<merge_reader *, size_t>> closures;
+  std::vector<std::tuple<int64_t, size_t, uint64_t>> messages;
+};
+
+static std::vector<std::unique_ptr<merge_input>> make_inputs(size_t count) {
+  std::vector<std::unique_ptr<merge_input>> inputs;
+  for (size_t i = 0; i < count; ++i) {
+    inputs.push_back(std::make_unique<merge_input>());
+  }
+  return inputs;
+}
+
+TEST(merge, order) {
+  auto inputs = make_inputs(5);
+  // Input 3 stays empty, timestamps repeat within and across inputs
+  for (uint64_t i = 0; i < 200; ++i) {
+    for (size_t input = 0; input < 5; ++input) {
+      if (input == 3 || (i + input) % (input + 1) != 0) {
+        continue;
+      }
+      inputs[input]->write(i / 2, i);
+    }
+  }
+
+  merge_reader reader(inputs);
+  reader.poll();
+
+  std::vector<std::tuple<int64_t, size_t, uint64_t>> expected;
+  for (size_t input = 0; input < 5; ++input) {
+    for (uint64_t i = 0; i < 200; ++i) {
+      if (input == 3 || (i + input) % (input + 1) != 0) {
+        continue;
+      }
+      expected.emplace_back(i / 2, input, i);
+    }
+  }
+  std::stable_sort(expected.begin(), expected.end(),
+                   [](auto &a, auto &b) {
+                     return std::make_pair(std::get<0>(a), std::get<1>(a)) <
+                            std::make_pair(std::get<0>(b), std::get<1>(b));
+                   });
+  ASSERT_EQ(reader.messages, expected);
+}
+
+TEST(merge, follow) {
+  auto inputs = make_inputs(3);
+  inputs[0]->write(10, 0);
+  merge_reader reader(inputs);
+  reader.poll();
+  ASSERT_EQ(reader.messages.size(), 1);
+
+  // Inputs that were empty are picked up on the next poll
+  inputs[2]->write(20, 1);
+  inputs[1]->write(20, 2);
+  inputs[0]->write(30, 3);
+  reader.poll();
+  ASSERT_EQ(reader.messages.size(), 4);
+  ASSERT_EQ(reader.messages[1], std::make_tuple(20, 1, 2));
+  ASSERT_EQ(reader.messages[2], std::make_tuple(20, 2, 1));
+  ASSERT_EQ(reader.messages[3], std::make_tuple(30, 0, 3));
+
+  // Even while other inputs still have messages
+  inputs[0]->write(40, 4);
+  inputs[0]->write(50, 5);
+  fmc_error_t *error;
+  ASSERT_TRUE(ytp_merge_cursor_poll(reader.merge, &error));
+  ASSERT_EQ(error, nullptr);
+  ASSERT_EQ(reader.messages.size(), 5);
+  inputs[1]->write(45, 6);
+  reader.poll();
+  ASSERT_EQ(reader.messages.size(), 7);
+  ASSERT_EQ(reader.messages[5], std::make_tuple(45, 1, 6));
+  ASSERT_EQ(reader.messages[6], std::make_tuple(50, 0, 5));
+
+  ytp_merge_cursor_data_cb(reader.merge, 3, inputs[0]->stream,
+                           &merge_reader::data_cb, nullptr, &error);
+  ASSERT_NE(error, nullptr);
+}
+
+// Merges lengths[i] messages from input i and reports the throughput
+static void merge_performance(const std::vector<size_t> &lengths) {
+  using namespace std::chrono;
+  const size_t input_count = lengths.size();
+  const size_t messages = *std::max_element(lengths.begin(), lengths.end());
+  auto inputs = make_inputs(input_count);
+  size_t total = 0;
+  for (size_t i = 0; i < messages; ++i) {
+    for (size_t input = 0; input < input_count; ++input) {
+      if (i >= lengths[input]) {
+        continue;
+      }
+      inputs[input]->write(i * input_count + (input * 7919) % input_count, i);
+      ++total;
+    }
+  }
+
+  merge_reader reader(inputs);
+  reader.messages.reserve(total);
+  auto start = steady_clock::now();
+  fmc_error_t *error;
+  while (ytp_merge_cursor_poll_n(reader.merge, 1024, -1, &error)) {
+    ASSERT_EQ(error, nullptr);
+  }
+  auto elapsed = duration_cast<nanoseconds>(steady_clock::now() - start);
+  ASSERT_EQ(reader.messages.size(), total);
+  for (size_t i = 1; i < reader.messages.size(); ++i) {
+    ASSERT_LT(std::get<0>(reader.messages[i - 1]),
+              std::get<0>(reader.messages[i]));
+  }
+  std::cout << "merged " << reader.messages.size() << " messages from "
+            << input_count << " inputs at "
+            << reader.messages.size() * 1e9 / elapsed.count() << " msgs/sec"
+            << std::endl;
+}
+
+TEST(merge, performance) {
+  merge_performance(std::vector<size_t>(64, 20000));
+}
+
+TEST(merge, performance_unequal) {
+  // Input i ends after (i + 1) / 64 of the longest input
+  std::vector<size_t> lengths;
+  for (size_t input = 0; input < 64; ++input) {
+    lengths.push_back(40000 * (input + 1) / 64);
+  }
+  merge_performance(lengths);
+}
+
+GTEST_API_ int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
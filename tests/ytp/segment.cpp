@@ -0,0 +1,219 @@
+/******************************************************************************
+        COPYRIGHT (c) 2019-2023 by Featuremine Corporation.
+
+        This Source Code Form is subject to the terms of the Mozilla Public
+        License, v. 2.0. If a copy of the MPL was not distributed with this
+        file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *****************************************************************************/
+
+/**
+ * @file segment.cpp
+ * @date 18 Oct 2026
+ * @brief File contains tests for YTP segment API
+ *
+ * @see http://www.featuremine.com
+ */
+
+#include <ytp/cursor.h>
+#include <ytp/segment.h>
+#include <ytp/stream.h>
+
+#include <fmc++/fs.hpp>
+#include <fmc++/gtestwrap.hpp>
+#include <fmc/files.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+struct segment_dir {
+  segment_dir() {
+    char tmpl[] = "/tmp/ytp_segment_XXXXXX";
+    dir = mkdtemp(tmpl);
+    path = dir + "/test.ytp";
+  }
+  ~segment_dir() { fs::remove_all(dir); }
+  std::string file(size_t index) { return path + "." + std::to_string(index); }
+  std::string dir;
+  std::string path;
+};
+
+struct segment_writer {
+  segment_writer(const std::string &path, size_t max_size, int64_t max_ns) {
+    fmc_error_t *error;
+    segment = ytp_segment_new(path.c_str(), max_size, max_ns, &error);
+    EXPECT_EQ(error, nullptr);
+  }
+  ~segment_writer() {
+    fmc_error_t *error;
+    ytp_segment_del(segment, &error);
+    EXPECT_EQ(error, nullptr);
+  }
+  ytp_mmnode_offs announce(const std::string &channel) {
+    fmc_error_t *error;
+    auto stream = ytp_segment_announce(segment, 4, "peer", channel.size(),
+                                       channel.data(), 8, "encoding", &error);
+    EXPECT_EQ(error, nullptr);
+    return stream;
+  }
+  void write(int64_t ts, ytp_mmnode_offs stream) {
+    fmc_error_t *error;
+    auto *ptr = ytp_segment_reserve(segment, sizeof(ts), &error);
+    ASSERT_EQ(error, nullptr);
+    std::memcpy(ptr, &ts, sizeof(ts));
+    ytp_segment_commit(segment, ts, stream, ptr, &error);
+    ASSERT_EQ(error, nullptr);
+  }
+  ytp_segment_t *segment;
+};
+
+struct segment_reader {
+  segment_reader(const std::string &file) {
+    fmc_error_t *error;
+    cursor = ytp_segment_cursor_new(file.c_str(), &error);
+    EXPECT_EQ(error, nullptr);
+    ytp_cursor_ann_cb(
+        cursor,
+        [](void *closure, uint64_t seqno, ytp_mmnode_offs stream, size_t psz,
+           const char *peer, size_t csz, const char *channel, size_t esz,
+           const char *encoding, bool subscribed) {
+          auto &self = *(segment_reader *)closure;
+          EXPECT_EQ(self.channels.count(stream), 0);
+          self.channels[stream] = std::string(channel, csz);
+          fmc_error_t *error;
+          ytp_cursor_data_cb(self.cursor, stream, &data_cb, closure, &error);
+          EXPECT_EQ(error, nullptr);
+        },
+        this, &error);
+    EXPECT_EQ(error, nullptr);
+  }
+  ~segment_reader() {
+    fmc_error_t *error;
+    ytp_cursor_del(cursor, &error);
+    EXPECT_EQ(error, nullptr);
+  }
+  static void data_cb(void *closure, uint64_t seqno, int64_t ts,
+                      ytp_mmnode_offs stream, size_t sz, const char *data) {
+    auto &self = *(segment_reader *)closure;
+    EXPECT_EQ(sz, sizeof(ts));
+    EXPECT_EQ(std::memcmp(data, &ts, sizeof(ts)), 0);
+    self.messages.emplace_back(ts, stream);
+  }
+  void poll() {
+    fmc_error_t *error;
+    while (ytp_cursor_poll(cursor, &error)) {
+      ASSERT_EQ(error, nullptr);
+    }
+    ASSERT_EQ(error, nullptr);
+  }
+  ytp_cursor_t *cursor;
+  std::map<ytp_mmnode_offs, std::string> channels;
+  std::vector<std::pair<int64_t, ytp_mmnode_offs>> messages;
+};
+
+TEST(segment, roll_size) {
+  segment_dir dir;
+  std::vector<ytp_mmnode_offs> streams;
+  {
+    segment_writer writer(dir.path, 64 * 1024, 0);
+    for (int i = 0; i < 3; ++i) {
+      streams.push_back(writer.announce("ch" + std::to_string(i)));
+    }
+    for (int64_t ts = 0; ts < 10000; ++ts) {
+      writer.write(ts, streams[ts % 3]);
+    }
+  }
+  ASSERT_TRUE(fs::exists(dir.file(3)));
+
+  segment_reader reader(dir.file(0));
+  reader.poll();
+  ASSERT_EQ(reader.channels.size(), 3);
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(reader.channels[streams[i]], "ch" + std::to_string(i));
+  }
+  ASSERT_EQ(reader.messages.size(), 10000);
+  for (int64_t ts = 0; ts < 10000; ++ts) {
+    ASSERT_EQ(reader.messages[ts].first, ts);
+    ASSERT_EQ(reader.messages[ts].second, streams[ts % 3]);
+  }
+
+  // Segments keep the stream ids of the first announcement
+  segment_reader middle(dir.file(2));
+  middle.poll();
+  ASSERT_EQ(middle.channels.size(), 3);
+  ASSERT_FALSE(middle.messages.empty());
+  ASSERT_EQ(middle.messages.back().first, 9999);
+  for (auto &[ts, stream] : middle.messages) {
+    ASSERT_EQ(stream, streams[ts % 3]);
+  }
+}
+
+TEST(segment, follow) {
+  segment_dir dir;
+  segment_writer writer(dir.path, 0, 100);
+  auto first = writer.announce("first");
+  segment_reader reader(dir.file(0));
+
+  int64_t ts = 0;
+  for (; ts < 150; ++ts) {
+    writer.write(ts, first);
+  }
+  reader.poll();
+  ASSERT_EQ(reader.messages.size(), 150);
+
+  // Streams announced in later segments get ids unique across segments
+  auto second = writer.announce("second");
+  ASSERT_NE(second, first);
+  for (; ts < 450; ++ts) {
+    writer.write(ts, ts % 2 ? first : second);
+  }
+  reader.poll();
+  ASSERT_TRUE(fs::exists(dir.file(4)));
+  ASSERT_EQ(reader.channels.size(), 2);
+  ASSERT_EQ(reader.channels[second], "second");
+  ASSERT_EQ(reader.messages.size(), 450);
+  for (int64_t i = 150; i < 450; ++i) {
+    ASSERT_EQ(reader.messages[i].first, i);
+    ASSERT_EQ(reader.messages[i].second, i % 2 ? first : second);
+  }
+}
+
+TEST(segment, resume) {
+  segment_dir dir;
+  ytp_mmnode_offs stream;
+  {
+    segment_writer writer(dir.path, 0, 10);
+    stream = writer.announce("ch");
+    for (int64_t ts = 0; ts < 25; ++ts) {
+      writer.write(ts, stream);
+    }
+  }
+  ASSERT_TRUE(fs::exists(dir.file(2)));
+  ASSERT_FALSE(fs::exists(dir.file(3)));
+  {
+    segment_writer writer(dir.path, 0, 10);
+    ASSERT_EQ(writer.announce("ch"), stream);
+    for (int64_t ts = 25; ts < 35; ++ts) {
+      writer.write(ts, stream);
+    }
+    fmc_error_t *error;
+    ytp_segment_roll(writer.segment, &error);
+    ASSERT_EQ(error, nullptr);
+    writer.write(35, stream);
+  }
+
+  segment_reader reader(dir.file(0));
+  reader.poll();
+  ASSERT_EQ(reader.messages.size(), 36);
+  for (int64_t ts = 0; ts < 36; ++ts) {
+    ASSERT_EQ(reader.messages[ts].first, ts);
+    ASSERT_EQ(reader.messages[ts].second, stream);
+  }
+}
+
+GTEST_API_ int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,214 @@
+/******************************************************************************
+        COPYRIGHT (c) 2019-2023 by Featuremine Corporation.
+
+        This Source Code Form is subject to the terms of the Mozilla Public
+        License, v. 2.0. If a copy of the MPL was not distributed with this
+        file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *****************************************************************************/
+
+/**
+ * @file shard.cpp
+ * @date 18 Oct 2026
+ * @brief File contains tests for YTP shard API
+ *
+ * @see http://www.featuremine.com
+ */
+
+#include <ytp/data.h>
+#include <ytp/shard.h>
+#include <ytp/streams.h>
+
+#include <fmc++/gtestwrap.hpp>
+#include <fmc/files.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct shard_fixture {
+  shard_fixture() {
+    fmc_error_t *error;
+    fd = fmc_ftemp(&error);
+    EXPECT_EQ(error, nullptr);
+    yamal = ytp_yamal_new(fd, &error);
+    EXPECT_EQ(error, nullptr);
+    streams = ytp_streams_new(yamal, &error);
+    EXPECT_EQ(error, nullptr);
+  }
+  ~shard_fixture() {
+    fmc_error_t *error;
+    ytp_streams_del(streams, &error);
+    ytp_yamal_del(yamal, &error);
+    fmc_fclose(fd, &error);
+  }
+  ytp_mmnode_offs announce(const std::string &channel) {
+    fmc_error_t *error;
+    auto stream = ytp_streams_announce(streams, 4, "peer", channel.size(),
+                                       channel.data(), 8, "encoding", &error);
+    EXPECT_EQ(error, nullptr);
+    return stream;
+  }
+  void write(ytp_mmnode_offs stream, uint64_t value) {
+    fmc_error_t *error;
+    auto *ptr = ytp_data_reserve(yamal, sizeof(value), &error);
+    ASSERT_EQ(error, nullptr);
+    std::memcpy(ptr, &value, sizeof(value));
+    ytp_data_commit(yamal, value, stream, ptr, &error);
+    ASSERT_EQ(error, nullptr);
+  }
+  fmc_fd fd;
+  ytp_yamal_t *yamal;
+  ytp_streams_t *streams;
+};
+
+// Counts the messages of a stream and checks they arrive in order on a
+// single thread
+struct stream_counter {
+  static void cb(void *closure, uint64_t seqno, int64_t ts,
+                 ytp_mmnode_offs stream, size_t sz, const char *data) {
+    auto &self = *(stream_counter *)closure;
+    uint64_t value;
+    std::memcpy(&value, data, sizeof(value));
+    if (self.count == 0) {
+      self.thread = std::this_thread::get_id();
+    }
+    self.ordered &= self.thread == std::this_thread::get_id() &&
+                    value >= self.last && stream == self.stream;
+    self.last = value;
+    ++self.count;
+  }
+  ytp_mmnode_offs stream = 0;
+  std::thread::id thread;
+  uint64_t last = 0;
+  size_t count = 0;
+  bool ordered = true;
+};
+
+TEST(shard, order) {
+  shard_fixture f;
+  const size_t stream_count = 16;
+  std::vector<ytp_mmnode_offs> streams;
+  for (size_t i = 0; i < stream_count; ++i) {
+    streams.push_back(f.announce("ch" + std::to_string(i)));
+  }
+  for (uint64_t i = 0; i < 100000; ++i) {
+    f.write(streams[(i * 7) % stream_count], i);
+  }
+
+  fmc_error_t *error;
+  auto *shard = ytp_shard_new(f.yamal, 4, 256, &error);
+  ASSERT_EQ(error, nullptr);
+
+  struct context {
+    ytp_shard_t *shard;
+    std::vector<stream_counter> counters;
+  } ctx{shard, std::vector<stream_counter>(stream_count)};
+  ytp_shard_ann_cb(
+      shard,
+      [](void *closure, uint64_t seqno, ytp_mmnode_offs stream, size_t psz,
+         const char *peer, size_t csz, const char *channel, size_t esz,
+         const char *encoding, bool subscribed) {
+        auto &ctx = *(context *)closure;
+        auto index = std::stoul(std::string(channel + 2, csz - 2));
+        auto &counter = ctx.counters[index];
+        counter.stream = stream;
+        fmc_error_t *error;
+        ytp_shard_data_cb(ctx.shard, stream, stream_counter::cb, &counter,
+                          &error);
+        EXPECT_EQ(error, nullptr);
+      },
+      &ctx, &error);
+  ASSERT_EQ(error, nullptr);
+
+  size_t polled = 0;
+  while (size_t count = ytp_shard_poll_n(shard, 1000, -1, &error)) {
+    ASSERT_EQ(error, nullptr);
+    polled += count;
+  }
+  ASSERT_EQ(error, nullptr);
+  ASSERT_EQ(polled, stream_count + 100000);
+  ytp_shard_drain(shard, &error);
+  ASSERT_EQ(error, nullptr);
+
+  for (auto &counter : ctx.counters) {
+    ASSERT_EQ(counter.count, 100000 / stream_count);
+    ASSERT_TRUE(counter.ordered);
+  }
+
+  // Messages read after a callback is removed are not delivered to it
+  ytp_shard_data_cb_rm(shard, streams[0], stream_counter::cb, &ctx.counters[0],
+                       &error);
+  ASSERT_EQ(error, nullptr);
+  f.write(streams[0], 100000);
+  f.write(streams[1], 100001);
+  while (ytp_shard_poll(shard, &error))
+    ;
+  ASSERT_EQ(error, nullptr);
+
+  ytp_shard_del(shard, &error);
+  ASSERT_EQ(error, nullptr);
+  ASSERT_EQ(ctx.counters[0].count, 100000 / stream_count);
+  ASSERT_EQ(ctx.counters[1].count, 100000 / stream_count + 1);
+}
+
+// Simulates a handler that does some work for every message
+static void busy_cb(void *closure, uint64_t seqno, int64_t ts,
+                    ytp_mmnode_offs stream, size_t sz, const char *data) {
+  uint64_t value;
+  std::memcpy(&value, data, sizeof(value));
+  for (int i = 0; i < 500; ++i) {
+    value = value * 6364136223846793005ull + 1442695040888963407ull;
+  }
+  ((std::atomic<uint64_t> *)closure)->fetch_add(value & 1,
+                                                std::memory_order_relaxed);
+}
+
+TEST(shard, performance) {
+  using namespace std::chrono;
+  shard_fixture f;
+  const size_t stream_count = 64;
+  const size_t messages = 500000;
+  std::vector<ytp_mmnode_offs> streams;
+  for (size_t i = 0; i < stream_count; ++i) {
+    streams.push_back(f.announce("ch" + std::to_string(i)));
+  }
+  for (uint64_t i = 0; i < messages; ++i) {
+    f.write(streams[i % stream_count], i);
+  }
+
+  size_t max_workers = std::max(2u, std::thread::hardware_concurrency());
+  for (size_t workers = 1; workers <= max_workers; workers *= 2) {
+    fmc_error_t *error;
+    auto *shard = ytp_shard_new(f.yamal, workers, 4096, &error);
+    ASSERT_EQ(error, nullptr);
+    std::atomic<uint64_t> odd = 0;
+    for (auto stream : streams) {
+      ytp_shard_data_cb(shard, stream, busy_cb, &odd, &error);
+      ASSERT_EQ(error, nullptr);
+    }
+    auto start = steady_clock::now();
+    size_t polled = 0;
+    while (size_t count = ytp_shard_poll_n(shard, 1024, -1, &error)) {
+      polled += count;
+    }
+    ASSERT_EQ(error, nullptr);
+    ytp_shard_drain(shard, &error);
+    ASSERT_EQ(error, nullptr);
+    auto elapsed = duration_cast<nanoseconds>(steady_clock::now() - start);
+    ASSERT_EQ(polled, messages + stream_count);
+    std::cout << workers << " workers: " << messages * 1e9 / elapsed.count()
+              << " msgs/sec" << std::endl;
+    ytp_shard_del(shard, &error);
+    ASSERT_EQ(error, nullptr);
+  }
+}
+
+GTEST_API_ int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
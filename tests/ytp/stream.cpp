@@ -25,11 +25,14 @@
 #include <ytp/subscription.h>
 #include <ytp/yamal.h>
 
+#include <fmc++/counters.hpp>
 #include <fmc++/gtestwrap.hpp>
 #include <fmc/files.h>
 
 #include <deque>
+#include <iostream>
 #include <list>
+#include <vector>
 
 #include "buildmsg.hpp"
 #include "tostr.hpp"
@@ -883,6 +886,427 @@ TEST(stream, cursor_consume) {
   ASSERT_EQ(error, nullptr);
 }
 
+TEST(stream, data_batch) {
+  callback_helper helper;
+
+  fmc_error_t *error;
+  auto fd = fmc_ftemp(&error);
+  ASSERT_EQ(error, nullptr);
+
+  auto *yamal = ytp_yamal_new(fd, &error);
+  ASSERT_EQ(error, nullptr);
+
+  auto *anns = ytp_streams_new(yamal, &error);
+  ASSERT_EQ(error, nullptr);
+
+  auto stream1 =
+      ytp_streams_announce(anns, 5, "peer1", 3, "ch1", 9, "encoding1", &error);
+  ASSERT_EQ(error, nullptr);
+
+  auto stream2 =
+      ytp_streams_announce(anns, 5, "peer1", 3, "ch2", 9, "encoding2", &error);
+  ASSERT_EQ(error, nullptr);
+
+  const size_t count = 3;
+  size_t sizes[count] = {4, 5, 6};
+  int64_t times[count] = {1000, 1001, 1002};
+  ytp_mmnode_offs streams[count] = {stream1, stream2, stream1};
+  char *ptrs[count];
+  ytp_data_reserve_batch(yamal, sizes, ptrs, count, &error);
+  ASSERT_EQ(error, nullptr);
+  std::memcpy(ptrs[0], "0000", 4);
+  std::memcpy(ptrs[1], "00001", 5);
+  std::memcpy(ptrs[2], "000002", 6);
+  ASSERT_NE(ytp_data_commit_batch(yamal, times, streams, ptrs, count, &error),
+            nullptr);
+  ASSERT_EQ(error, nullptr);
+
+  auto *cursor = ytp_cursor_new(yamal, &error);
+  ASSERT_EQ(error, nullptr);
+
+  std::list<std::string> output;
+  for (auto stream : {stream1, stream2}) {
+    auto cb = helper.datacb([&](uint64_t seqno, int64_t msgtime,
+                                ytp_mmnode_offs stream, size_t sz,
+                                const char *data) {
+      output.emplace_back(std::to_string(msgtime) + " " +
+                          std::to_string(stream) + " " +
+                          std::string(data, sz));
+    });
+    ytp_cursor_data_cb(cursor, stream, cb.first, cb.second, &error);
+    ASSERT_EQ(error, nullptr);
+  }
+
+  while (ytp_cursor_poll(cursor, &error)) {
+    ASSERT_EQ(error, nullptr);
+  }
+  ASSERT_EQ(error, nullptr);
+
+  std::list<std::string> expected = {
+      "1000 " + std::to_string(stream1) + " 0000",
+      "1001 " + std::to_string(stream2) + " 00001",
+      "1002 " + std::to_string(stream1) + " 000002",
+  };
+  ASSERT_EQ(output, expected);
+
+  ytp_cursor_del(cursor, &error);
+  ASSERT_EQ(error, nullptr);
+
+  ytp_streams_del(anns, &error);
+  ASSERT_EQ(error, nullptr);
+
+  ytp_yamal_del(yamal, &error);
+  ASSERT_EQ(error, nullptr);
+
+  fmc_fclose(fd, &error);
+  ASSERT_EQ(error, nullptr);
+}
+
+TEST(stream, cursor_poll_n) {
+  callback_helper helper;
+
+  fmc_error_t *error;
+  auto fd = fmc_ftemp(&error);
+  ASSERT_EQ(error, nullptr);
+
+  auto *yamal = ytp_yamal_new(fd, &error);
+  ASSERT_EQ(error, nullptr);
+
+  auto *anns = ytp_streams_new(yamal, &error);
+  ASSERT_EQ(error, nullptr);
+
+  auto stream =
+      ytp_streams_announce(anns, 5, "peer1", 3, "ch1", 9, "encoding1", &error);
+  ASSERT_EQ(error, nullptr);
+
+  publisher_t publish{yamal, error};
+  for (int64_t msgtime : {1000, 1001, 1002}) {
+    publish(MsgData{msgtime, stream, "data"});
+    ASSERT_EQ(error, nullptr);
+  }
+
+  auto *cursor = ytp_cursor_new(yamal, &error);
+  ASSERT_EQ(error, nullptr);
+
+  std::list<std::string> output;
+  auto cb2 = helper.datacb([&](uint64_t seqno, int64_t msgtime,
+                               ytp_mmnode_offs stream, size_t sz,
+                               const char *data) {
+    output.emplace_back("cb2 " + std::to_string(msgtime));
+  });
+  auto cb1 = helper.datacb([&](uint64_t seqno, int64_t msgtime,
+                               ytp_mmnode_offs stream, size_t sz,
+                               const char *data) {
+    output.emplace_back("cb1 " + std::to_string(msgtime));
+    ytp_cursor_data_cb_rm(cursor, stream, cb2.first, cb2.second, &error);
+  });
+  ytp_cursor_data_cb(cursor, stream, cb2.first, cb2.second, &error);
+  ASSERT_EQ(error, nullptr);
+  ytp_cursor_data_cb(cursor, stream, cb1.first, cb1.second, &error);
+  ASSERT_EQ(error, nullptr);
+
+  // The announcement and the first data message
+  ASSERT_EQ(ytp_cursor_poll_n(cursor, 2, -1, &error), 2);
+  ASSERT_EQ(error, nullptr);
+  ASSERT_EQ(ytp_cursor_poll_n(cursor, 100, -1, &error), 2);
+  ASSERT_EQ(error, nullptr);
+  ASSERT_EQ(ytp_cursor_poll_n(cursor, 100, -1, &error), 0);
+  ASSERT_EQ(error, nullptr);
+
+  std::list<std::string> expected = {"cb1 1000", "cb1 1001", "cb1 1002"};
+  ASSERT_EQ(output, expected);
+
+  publish(MsgData{1003, stream, "data"});
+  ASSERT_EQ(error, nullptr);
+  ASSERT_EQ(ytp_cursor_poll_n(cursor, 100, 0, &error), 1);
+  ASSERT_EQ(error, nullptr);
+  expected.emplace_back("cb1 1003");
+  ASSERT_EQ(output, expected);
+
+  ytp_cursor_del(cursor, &error);
+  ASSERT_EQ(error, nullptr);
+
+  ytp_streams_del(anns, &error);
+  ASSERT_EQ(error, nullptr);
+
+  ytp_yamal_del(yamal, &error);
+  ASSERT_EQ(error, nullptr);
+
+  fmc_fclose(fd, &error);
+  ASSERT_EQ(error, nullptr);
+}
+
+TEST(stream, cursor_seek_time) {
+  fmc_error_t *error;
+  auto fd = fmc_ftemp(&error);
+  ASSERT_EQ(error, nullptr);
+
+  auto *yamal = ytp_yamal_new(fd, &error);
+  ASSERT_EQ(error, nullptr);
+
+  auto *anns = ytp_streams_new(yamal, &error);
+  ASSERT_EQ(error, nullptr);
+
+  ytp_mmnode_offs streams[] = {
+      ytp_streams_announce(anns, 5, "peer1", 3, "ch1", 9, "encoding1", &error),
+      ytp_streams_announce(anns, 5, "peer1", 3, "ch2", 9, "encoding1", &error),
+  };
+  ASSERT_EQ(error, nullptr);
+
+  ytp_data_set_time_index(yamal, 4096, &error);
+  ASSERT_EQ(error, nullptr);
+
+  const int64_t messages = 10000;
+  publisher_t publish{yamal, error};
+  for (int64_t i = 0; i < messages; ++i) {
+    publish(MsgData{i * 10, streams[i % 2], "data"});
+    ASSERT_EQ(error, nullptr);
+  }
+
+  size_t entries = 0;
+  for (auto it = ytp_index_begin(yamal, &error); !ytp_yamal_term(it);
+       it = ytp_yamal_next(yamal, it, &error)) {
+    uint64_t seqno;
+    ytp_mmnode_offs stream;
+    ytp_mmnode_offs offset;
+    size_t sz;
+    const char *payload;
+    ytp_index_read(yamal, it, &seqno, &stream, &offset, &sz, &payload, &error);
+    ASSERT_EQ(error, nullptr);
+    ASSERT_EQ(stream, YTP_DATA_TIME_INDEX_STREAM);
+    ASSERT_EQ(sz, sizeof(int64_t));
+    ++entries;
+  }
+  ASSERT_EQ(error, nullptr);
+  ASSERT_GT(entries, 10);
+
+  auto *cursor = ytp_cursor_new(yamal, &error);
+  ASSERT_EQ(error, nullptr);
+
+  int64_t polled_ts = -1;
+  auto cb = [](void *closure, uint64_t seqno, int64_t ts,
+               ytp_mmnode_offs stream, size_t sz, const char *data) {
+    *(int64_t *)closure = ts;
+  };
+  for (auto stream : streams) {
+    ytp_cursor_data_cb(cursor, stream, cb, &polled_ts, &error);
+    ASSERT_EQ(error, nullptr);
+  }
+
+  auto poll_data = [&]() {
+    polled_ts = -1;
+    while (polled_ts == -1 && ytp_cursor_poll(cursor, &error))
+      ;
+    return polled_ts;
+  };
+
+  for (int64_t ts : {0, 1, 9, 10, 12345, 50000, 99980, 99990}) {
+    ytp_cursor_seek_time(cursor, ts, &error);
+    ASSERT_EQ(error, nullptr);
+    ASSERT_EQ(poll_data(), (ts + 9) / 10 * 10);
+    ASSERT_EQ(error, nullptr);
+  }
+
+  ytp_cursor_seek_time(cursor, 99991, &error);
+  ASSERT_EQ(error, nullptr);
+  ASSERT_EQ(poll_data(), -1);
+  ASSERT_EQ(error, nullptr);
+
+  // Messages written after the first seek are indexed too
+  for (int64_t i = messages; i < 2 * messages; ++i) {
+    publish(MsgData{i * 10, streams[i % 2], "data"});
+    ASSERT_EQ(error, nullptr);
+  }
+  ytp_cursor_seek_time(cursor, 150005, &error);
+  ASSERT_EQ(error, nullptr);
+  ASSERT_EQ(poll_data(), 150010);
+  ASSERT_EQ(error, nullptr);
+
+  ytp_cursor_del(cursor, &error);
+  ASSERT_EQ(error, nullptr);
+
+  ytp_streams_del(anns, &error);
+  ASSERT_EQ(error, nullptr);
+
+  ytp_yamal_del(yamal, &error);
+  ASSERT_EQ(error, nullptr);
+
+  fmc_fclose(fd, &error);
+  ASSERT_EQ(error, nullptr);
+}
+
+TEST(stream, time_index_opt_in) {
+  fmc_error_t *error;
+  auto fd = fmc_ftemp(&error);
+  ASSERT_EQ(error, nullptr);
+
+  auto *writer = ytp_yamal_new(fd, &error);
+  ASSERT_EQ(error, nullptr);
+  auto *indexer = ytp_yamal_new(fd, &error);
+  ASSERT_EQ(error, nullptr);
+
+  auto *anns = ytp_streams_new(writer, &error);
+  ASSERT_EQ(error, nullptr);
+  auto stream =
+      ytp_streams_announce(anns, 5, "peer1", 3, "ch1", 9, "encoding1", &error);
+  ASSERT_EQ(error, nullptr);
+
+  auto count_entries = [&]() {
+    size_t entries = 0;
+    for (auto it = ytp_index_begin(writer, &error); !ytp_yamal_term(it);
+         it = ytp_yamal_next(writer, it, &error)) {
+      ++entries;
+    }
+    return entries;
+  };
+
+  // Nothing is indexed unless a writer enables the index
+  publisher_t publish{writer, error};
+  for (int64_t i = 0; i < 1000; ++i) {
+    publish(MsgData{i, stream, "data"});
+    ASSERT_EQ(error, nullptr);
+  }
+  ASSERT_EQ(count_entries(), 0);
+  ASSERT_EQ(error, nullptr);
+
+  // Only the designated writer records entries, starting after the blocks
+  // that were already written
+  ytp_data_set_time_index(indexer, 4096, &error);
+  ASSERT_EQ(error, nullptr);
+  publisher_t publish_indexed{indexer, error};
+  for (int64_t i = 1000; i < 2000; ++i) {
+    publish(MsgData{i, stream, "data"});
+    ASSERT_EQ(error, nullptr);
+  }
+  ASSERT_EQ(count_entries(), 0);
+  ASSERT_EQ(error, nullptr);
+  for (int64_t i = 2000; i < 3000; ++i) {
+    publish_indexed(MsgData{i, stream, "data"});
+    ASSERT_EQ(error, nullptr);
+  }
+  ASSERT_GT(count_entries(), 0);
+  ASSERT_EQ(error, nullptr);
+
+  ytp_streams_del(anns, &error);
+  ASSERT_EQ(error, nullptr);
+  ytp_yamal_del(indexer, &error);
+  ASSERT_EQ(error, nullptr);
+  ytp_yamal_del(writer, &error);
+  ASSERT_EQ(error, nullptr);
+
+  fmc_fclose(fd, &error);
+  ASSERT_EQ(error, nullptr);
+}
+
+TEST(stream, cursor_poll_performance) {
+  using counter_t = fmc::counter::nanoseconds;
+  using sampler_t = fmc::counter::precision_sampler;
+  using record_t = fmc::counter::record<counter_t, sampler_t>;
+
+  const size_t messages = 1 << 20;
+  std::vector<double> percentiles{50.0, 99.0, 99.9, 100.0};
+
+  for (size_t stream_count : {1, 16, 256}) {
+    fmc_error_t *error;
+    auto fd = fmc_ftemp(&error);
+    ASSERT_EQ(error, nullptr);
+
+    auto *yamal = ytp_yamal_new(fd, &error);
+    ASSERT_EQ(error, nullptr);
+
+    auto *anns = ytp_streams_new(yamal, &error);
+    ASSERT_EQ(error, nullptr);
+
+    std::vector<ytp_mmnode_offs> streams;
+    for (size_t i = 0; i < stream_count; ++i) {
+      auto channel = "ch" + std::to_string(i);
+      streams.push_back(ytp_streams_announce(anns, 4, "peer", channel.size(),
+                                             channel.data(), 8, "encoding",
+                                             &error));
+      ASSERT_EQ(error, nullptr);
+    }
+
+    for (size_t i = 0; i < messages; ++i) {
+      auto *ptr = ytp_data_reserve(yamal, 8, &error);
+      ASSERT_EQ(error, nullptr);
+      std::memcpy(ptr, "00000000", 8);
+      ytp_data_commit(yamal, i, streams[i % stream_count], ptr, &error);
+      ASSERT_EQ(error, nullptr);
+    }
+
+    // Only half of the streams have callbacks, the rest are skipped
+    auto *cursor = ytp_cursor_new(yamal, &error);
+    ASSERT_EQ(error, nullptr);
+    size_t count = 0;
+    auto cb = [](void *closure, uint64_t seqno, int64_t ts,
+                 ytp_mmnode_offs stream, size_t sz, const char *data) {
+      ++*(size_t *)closure;
+    };
+    for (size_t i = 0; i < stream_count; i += 2) {
+      ytp_cursor_data_cb(cursor, streams[i], cb, &count, &error);
+      ASSERT_EQ(error, nullptr);
+    }
+
+    record_t record;
+    bool polled = true;
+    while (polled) {
+      fmc::counter::scoped_sampler s(record);
+      polled = ytp_cursor_poll(cursor, &error);
+    }
+    ASSERT_EQ(error, nullptr);
+    ASSERT_EQ(count, (messages / stream_count) * ((stream_count + 1) / 2));
+
+    std::cout << "ytp_cursor_poll with " << stream_count << " streams"
+              << std::endl;
+    for (double &percentile : percentiles) {
+      std::cout << "  " << percentile
+                << "% percentile: " << record.percentile(percentile)
+                << " nanoseconds" << std::endl;
+    }
+    std::cout << std::endl;
+
+    // Same messages polled in batches with a fresh cursor
+    ytp_cursor_del(cursor, &error);
+    ASSERT_EQ(error, nullptr);
+    cursor = ytp_cursor_new(yamal, &error);
+    ASSERT_EQ(error, nullptr);
+    for (size_t i = 0; i < stream_count; i += 2) {
+      ytp_cursor_data_cb(cursor, streams[i], cb, &count, &error);
+      ASSERT_EQ(error, nullptr);
+    }
+
+    const size_t batch = 256;
+    record_t batch_record;
+    size_t polled_n = batch;
+    while (polled_n == batch) {
+      fmc::counter::scoped_sampler s(batch_record);
+      polled_n = ytp_cursor_poll_n(cursor, batch, -1, &error);
+    }
+    ASSERT_EQ(error, nullptr);
+
+    std::cout << "ytp_cursor_poll_n of " << batch << " messages with "
+              << stream_count << " streams" << std::endl;
+    for (double &percentile : percentiles) {
+      std::cout << "  " << percentile
+                << "% percentile: " << batch_record.percentile(percentile)
+                << " nanoseconds" << std::endl;
+    }
+    std::cout << std::endl;
+
+    ytp_cursor_del(cursor, &error);
+    ASSERT_EQ(error, nullptr);
+
+    ytp_streams_del(anns, &error);
+    ASSERT_EQ(error, nullptr);
+
+    ytp_yamal_del(yamal, &error);
+    ASSERT_EQ(error, nullptr);
+
+    fmc_fclose(fd, &error);
+    ASSERT_EQ(error, nullptr);
+  }
+}
+
 GTEST_API_ int main(int argc, char **argv) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
@@ -0,0 +1,185 @@
+/******************************************************************************
+        COPYRIGHT (c) 2019-2023 by Featuremine Corporation.
+
+        This Source Code Form is subject to the terms of the Mozilla Public
+        License, v. 2.0. If a copy of the MPL was not distributed with this
+        file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *****************************************************************************/
+
+/**
+ * @file telemetry.cpp
+ * @date 18 Oct 2026
+ * @brief File contains tests for YTP telemetry API
+ *
+ * @see http://www.featuremine.com
+ */
+
+#include <ytp/announcement.h>
+#include <ytp/cursor.h>
+#include <ytp/data.h>
+#include <ytp/streams.h>
+#include <ytp/telemetry.h>
+
+#include <fmc++/gtestwrap.hpp>
+#include <fmc/files.h>
+
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct telemetry_msgs {
+  std::vector<std::string> msgs;
+};
+
+TEST(telemetry, publish) {
+  fmc_error_t *error;
+  auto fd = fmc_ftemp(&error);
+  ASSERT_EQ(error, nullptr);
+  auto *yamal = ytp_yamal_new(fd, &error);
+  ASSERT_EQ(error, nullptr);
+  auto *streams = ytp_streams_new(yamal, &error);
+  ASSERT_EQ(error, nullptr);
+  auto stream = ytp_streams_announce(streams, 4, "peer", 2, "ch", 8,
+                                     "encoding", &error);
+  ASSERT_EQ(error, nullptr);
+
+  auto *telemetry = ytp_telemetry_new(yamal, streams, 0, &error);
+  ASSERT_EQ(error, nullptr);
+  auto *lagging = ytp_cursor_new(yamal, &error);
+  ASSERT_EQ(error, nullptr);
+  ASSERT_EQ(ytp_telemetry_cursor_add(telemetry, lagging, &error), 0);
+  ASSERT_EQ(error, nullptr);
+
+  for (uint64_t i = 0; i < 10; ++i) {
+    auto *ptr = ytp_data_reserve(yamal, sizeof(i), &error);
+    ASSERT_EQ(error, nullptr);
+    std::memcpy(ptr, &i, sizeof(i));
+    ytp_data_commit(yamal, i, stream, ptr, &error);
+    ASSERT_EQ(error, nullptr);
+  }
+  ASSERT_TRUE(ytp_telemetry_poll(telemetry, &error));
+  ASSERT_EQ(error, nullptr);
+
+  // The telemetry stream is a regular stream
+  auto *cursor = ytp_cursor_new(yamal, &error);
+  ASSERT_EQ(error, nullptr);
+  ytp_mmnode_offs tstream = 0;
+  ytp_cursor_ann_cb(
+      cursor,
+      [](void *closure, uint64_t seqno, ytp_mmnode_offs stream, size_t peer_sz,
+         const char *peer_name, size_t ch_sz, const char *ch_name,
+         size_t encoding_sz, const char *encoding_data, bool subscribed) {
+        if (std::string_view(ch_name, ch_sz) == YTP_TELEMETRY_CHANNEL &&
+            std::string_view(encoding_data, encoding_sz) ==
+                YTP_TELEMETRY_ENCODING) {
+          *(ytp_mmnode_offs *)closure = stream;
+        }
+      },
+      &tstream, &error);
+  ASSERT_EQ(error, nullptr);
+  telemetry_msgs msgs;
+  auto data_cb = [](void *closure, uint64_t seqno, int64_t ts,
+                    ytp_mmnode_offs stream, size_t sz, const char *data) {
+    ((telemetry_msgs *)closure)->msgs.emplace_back(data, sz);
+  };
+  while (ytp_cursor_poll(cursor, &error)) {
+    if (tstream && msgs.msgs.empty()) {
+      ytp_cursor_data_cb(cursor, tstream, data_cb, &msgs, &error);
+      ASSERT_EQ(error, nullptr);
+    }
+  }
+  ASSERT_EQ(error, nullptr);
+  ASSERT_NE(tstream, 0);
+  ASSERT_EQ(msgs.msgs.size(), 1);
+
+  ytp_telemetry_hdr hdr;
+  ytp_telemetry_record records[8];
+  auto msg = msgs.msgs[0];
+  size_t count = ytp_telemetry_decode(msg.data(), msg.size(), &hdr, records, 8,
+                                      &error);
+  ASSERT_EQ(error, nullptr);
+  ASSERT_EQ(hdr.version, YTP_TELEMETRY_VERSION);
+  ASSERT_EQ(hdr.count, 5);
+  ASSERT_EQ(count, 5);
+  ASSERT_GT(hdr.period, 0);
+  ASSERT_EQ(records[0].metric, YTP_TELEMETRY_RESERVE);
+  ASSERT_EQ(records[0].count, 10);
+  ASSERT_GE(records[0].total, records[0].max);
+  ASSERT_EQ(records[1].metric, YTP_TELEMETRY_COMMIT);
+  ASSERT_EQ(records[1].count, 10);
+  ASSERT_EQ(records[2].metric, YTP_TELEMETRY_SYNC_ALLOCS);
+  ASSERT_EQ(records[3].metric, YTP_TELEMETRY_AUX_SYNC);
+  // The cursor did not read the messages
+  ASSERT_EQ(records[4].metric, YTP_TELEMETRY_CURSOR_LAG);
+  ASSERT_EQ(records[4].id, 0);
+  ASSERT_GT(records[4].total, 10 * sizeof(uint64_t));
+
+  // The statistics are reset after every message, the previous telemetry
+  // message and the subscription of the cursor are accounted for in the next
+  // one
+  ytp_telemetry_publish(telemetry, &error);
+  ASSERT_EQ(error, nullptr);
+  while (ytp_cursor_poll(cursor, &error)) {
+  }
+  ASSERT_EQ(msgs.msgs.size(), 2);
+  count = ytp_telemetry_decode(msgs.msgs[1].data(), msgs.msgs[1].size(), &hdr,
+                               records, 8, &error);
+  ASSERT_EQ(error, nullptr);
+  ASSERT_EQ(count, 5);
+  ASSERT_EQ(records[0].count, 2);
+  ASSERT_EQ(records[1].count, 2);
+  ASSERT_EQ(records[2].count, 0);
+
+  // Catching up clears the lag
+  while (ytp_cursor_poll(lagging, &error)) {
+  }
+  ytp_telemetry_publish(telemetry, &error);
+  ASSERT_EQ(error, nullptr);
+  while (ytp_cursor_poll(cursor, &error)) {
+  }
+  ASSERT_EQ(msgs.msgs.size(), 3);
+  count = ytp_telemetry_decode(msgs.msgs[2].data(), msgs.msgs[2].size(), &hdr,
+                               records, 8, &error);
+  ASSERT_EQ(error, nullptr);
+  ASSERT_EQ(records[4].total, 0);
+
+  // Malformed messages are rejected
+  ytp_telemetry_decode(msg.data(), msg.size() - 1, &hdr, records, 8, &error);
+  ASSERT_NE(error, nullptr);
+
+  ytp_cursor_del(lagging, &error);
+  ytp_cursor_del(cursor, &error);
+  ytp_telemetry_del(telemetry, &error);
+  ASSERT_EQ(error, nullptr);
+  ytp_streams_del(streams, &error);
+  ytp_yamal_del(yamal, &error);
+  fmc_fclose(fd, &error);
+}
+
+TEST(telemetry, period) {
+  fmc_error_t *error;
+  auto fd = fmc_ftemp(&error);
+  ASSERT_EQ(error, nullptr);
+  auto *yamal = ytp_yamal_new(fd, &error);
+  ASSERT_EQ(error, nullptr);
+  auto *streams = ytp_streams_new(yamal, &error);
+  ASSERT_EQ(error, nullptr);
+  auto *telemetry = ytp_telemetry_new(yamal, streams, 3600000000000ll, &error);
+  ASSERT_EQ(error, nullptr);
+  ASSERT_FALSE(ytp_telemetry_poll(telemetry, &error));
+  ASSERT_EQ(error, nullptr);
+  ytp_telemetry_del(telemetry, &error);
+  ASSERT_EQ(error, nullptr);
+
+  ASSERT_EQ(ytp_telemetry_new(yamal, streams, -1, &error), nullptr);
+  ASSERT_NE(error, nullptr);
+  ytp_streams_del(streams, &error);
+  ytp_yamal_del(yamal, &error);
+  fmc_fclose(fd, &error);
+}
+
+GTEST_API_ int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -1751,6 +1751,93 @@ TEST(timeline, data_callback_removal_2) {
   ASSERT_EQ(error, nullptr);
 }
 
+TEST(timeline, poll_n) {
+  fmc_error_t *error;
+  auto fd = fmc_ftemp(&error);
+  ASSERT_EQ(error, nullptr);
+
+  auto *ctrl = ytp_control_new(fd, &error);
+  ASSERT_EQ(error, nullptr);
+
+  auto *timeline = ytp_timeline_new(ctrl, &error);
+  ASSERT_EQ(error, nullptr);
+
+  auto peer = ytp_control_peer_decl(ctrl, 4, "peer", &error);
+  ASSERT_EQ(error, nullptr);
+  auto ch = ytp_control_ch_decl(ctrl, peer, 0, 2, "ch", &error);
+  ASSERT_EQ(error, nullptr);
+
+  struct callback_t {
+    static void c_callback(void *closure, ytp_peer_t peer,
+                           ytp_channel_t channel, uint64_t time, size_t sz,
+                           const char *data) {
+      auto &self = *reinterpret_cast<callback_t *>(closure);
+      self.callback(time);
+    }
+    static void c_idle(void *closure) {
+      auto &self = *reinterpret_cast<callback_t *>(closure);
+      self.callback(0);
+    }
+    std::function<void(uint64_t)> callback;
+  };
+
+  std::vector<int> execution;
+  std::vector<int> expected;
+  size_t idle = 0;
+
+  callback_t c2{[&](uint64_t time) { execution.emplace_back(time + 2); }};
+  callback_t c1{[&](uint64_t time) {
+    execution.emplace_back(time + 1);
+    ytp_timeline_indx_cb_rm(timeline, ch, callback_t::c_callback, &c2, &error);
+  }};
+  callback_t c_idle{[&](uint64_t) { ++idle; }};
+
+  ytp_timeline_indx_cb(timeline, ch, callback_t::c_callback, &c1, &error);
+  ytp_timeline_indx_cb(timeline, ch, callback_t::c_callback, &c2, &error);
+  ytp_timeline_idle_cb(timeline, callback_t::c_idle, &c_idle, &error);
+  ASSERT_EQ(error, nullptr);
+
+  ASSERT_GT(ytp_timeline_poll_n(timeline, 100, -1, &error), 0);
+  ASSERT_EQ(error, nullptr);
+  EXPECT_EQ(idle, 0);
+
+  for (uint64_t time : {10, 20, 30}) {
+    ytp_control_commit(ctrl, peer, ch, time,
+                       ytp_control_reserve(ctrl, 1, &error), &error);
+    ASSERT_EQ(error, nullptr);
+  }
+
+  ASSERT_EQ(ytp_timeline_poll_n(timeline, 1, -1, &error), 1);
+  ASSERT_EQ(error, nullptr);
+  expected = {11};
+  EXPECT_EQ(execution, expected);
+
+  ASSERT_EQ(ytp_timeline_poll_n(timeline, 100, -1, &error), 2);
+  ASSERT_EQ(error, nullptr);
+  expected = {11, 21, 31};
+  EXPECT_EQ(execution, expected);
+  EXPECT_EQ(idle, 0);
+
+  ASSERT_EQ(ytp_timeline_poll_n(timeline, 100, -1, &error), 0);
+  ASSERT_EQ(error, nullptr);
+  EXPECT_EQ(idle, 1);
+
+  ytp_control_commit(ctrl, peer, ch, 40, ytp_control_reserve(ctrl, 1, &error),
+                     &error);
+  ASSERT_EQ(error, nullptr);
+  ASSERT_EQ(ytp_timeline_poll_n(timeline, 100, 0, &error), 1);
+  ASSERT_EQ(error, nullptr);
+  expected = {11, 21, 31, 41};
+  EXPECT_EQ(execution, expected);
+
+  ytp_timeline_del(timeline, &error);
+  ASSERT_EQ(error, nullptr);
+  ytp_control_del(ctrl, &error);
+  ASSERT_EQ(error, nullptr);
+  fmc_fclose(fd, &error);
+  ASSERT_EQ(error, nullptr);
+}
+
 GTEST_API_ int main(int argc, char **argv) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
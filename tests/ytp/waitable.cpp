@@ -0,0 +1,117 @@
+/******************************************************************************
+        COPYRIGHT (c) 2019-2023 by Featuremine Corporation.
+
+        This Source Code Form is subject to the terms of the Mozilla Public
+        License, v. 2.0. If a copy of the MPL was not distributed with this
+        file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *****************************************************************************/
+
+/**
+ * @file waitable.cpp
+ * @date 18 Oct 2026
+ * @brief File contains tests for YTP waitable API
+ *
+ * @see http://www.featuremine.com
+ */
+
+#include <ytp/cursor.h>
+#include <ytp/data.h>
+#include <ytp/streams.h>
+#include <ytp/waitable.h>
+
+#include <fmc++/gtestwrap.hpp>
+#include <fmc/files.h>
+
+#include <chrono>
+#include <cstring>
+#include <poll.h>
+#include <string>
+
+static bool readable(int fd, int timeout_ms) {
+  pollfd pfd = {fd, POLLIN, 0};
+  return poll(&pfd, 1, timeout_ms) == 1;
+}
+
+TEST(waitable, poll) {
+  fmc_error_t *error;
+  auto fd = fmc_ftemp(&error);
+  ASSERT_EQ(error, nullptr);
+  auto *yamal = ytp_yamal_new(fd, &error);
+  ASSERT_EQ(error, nullptr);
+  auto *streams = ytp_streams_new(yamal, &error);
+  ASSERT_EQ(error, nullptr);
+  auto stream = ytp_streams_announce(streams, 4, "peer", 2, "ch", 8,
+                                     "encoding", &error);
+  ASSERT_EQ(error, nullptr);
+  auto write = [&](uint64_t value) {
+    auto *ptr = ytp_data_reserve(yamal, sizeof(value), &error);
+    ASSERT_EQ(error, nullptr);
+    std::memcpy(ptr, &value, sizeof(value));
+    ytp_data_commit(yamal, value, stream, ptr, &error);
+    ASSERT_EQ(error, nullptr);
+  };
+  for (uint64_t i = 0; i < 10; ++i) {
+    write(i);
+  }
+
+  auto *cursor = ytp_cursor_new(yamal, &error);
+  ASSERT_EQ(error, nullptr);
+  size_t count = 0;
+  ytp_cursor_data_cb(
+      cursor, stream,
+      [](void *closure, uint64_t seqno, int64_t ts, ytp_mmnode_offs stream,
+         size_t sz, const char *data) { ++*(size_t *)closure; },
+      &count, &error);
+  ASSERT_EQ(error, nullptr);
+
+  // A long interval, the descriptor is only readable right away when there
+  // is a backlog
+  auto *waitable = ytp_waitable_new(cursor, 10000000000ll, &error);
+  ASSERT_EQ(error, nullptr);
+  int wfd = ytp_waitable_fd(waitable);
+  ASSERT_TRUE(readable(wfd, 100));
+  // The announcement and four messages
+  ASSERT_EQ(ytp_waitable_poll(waitable, 5, &error), 5);
+  ASSERT_EQ(error, nullptr);
+  ASSERT_EQ(count, 4);
+  ASSERT_TRUE(readable(wfd, 100));
+  ASSERT_EQ(ytp_waitable_poll(waitable, 10, &error), 6);
+  ASSERT_EQ(error, nullptr);
+  ASSERT_EQ(count, 10);
+  ASSERT_FALSE(readable(wfd, 50));
+  ytp_waitable_del(waitable, &error);
+  ASSERT_EQ(error, nullptr);
+
+  // Messages written later wake up the waitable, without waiting for the
+  // interval
+  waitable = ytp_waitable_new(cursor, 10000000000ll, &error);
+  ASSERT_EQ(error, nullptr);
+  wfd = ytp_waitable_fd(waitable);
+  ASSERT_TRUE(readable(wfd, 100));
+  ASSERT_EQ(ytp_waitable_poll(waitable, 10, &error), 0);
+  write(10);
+  auto start = std::chrono::steady_clock::now();
+  while (count < 11) {
+    ASSERT_TRUE(readable(wfd, 100));
+    ytp_waitable_poll(waitable, 10, &error);
+    ASSERT_EQ(error, nullptr);
+  }
+  ASSERT_LT(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds(100));
+  ytp_waitable_del(waitable, &error);
+  ASSERT_EQ(error, nullptr);
+
+  ASSERT_EQ(ytp_waitable_new(cursor, 0, &error), nullptr);
+  ASSERT_NE(error, nullptr);
+
+  ytp_cursor_del(cursor, &error);
+  ASSERT_EQ(error, nullptr);
+  ytp_streams_del(streams, &error);
+  ytp_yamal_del(yamal, &error);
+  fmc_fclose(fd, &error);
+}
+
+GTEST_API_ int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
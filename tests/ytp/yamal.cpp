@@ -15,12 +15,18 @@
  * @see http://www.featuremine.com
  */
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <iostream>
 #include <random>
+#include <string_view>
 #include <thread>
+#include <vector>
 
 #include <ytp/yamal.h>
 
+#include <fmc++/counters.hpp>
 #include <fmc++/fs.hpp>
 #include <fmc++/gtestwrap.hpp>
 #include <fmc/alignment.h>
@@ -475,6 +481,434 @@ TEST(yamal, commit_sublist) {
   ASSERT_EQ(total_processed, total_messages);
 }
 
+TEST(yamal, batch) {
+  fmc_error_t *error;
+
+  auto fd = fmc_ftemp(&error);
+  ASSERT_EQ(error, nullptr);
+
+  const unsigned batches = 1000;
+  const unsigned producers = 2;
+  auto producer = [&](unsigned id) {
+    fmc_error_t *error;
+    auto *yamal = ytp_yamal_new_2(fd, false, &error);
+    ASSERT_EQ(error, nullptr);
+
+    size_t sizes[YTP_YAMAL_BATCH_MAX];
+    char *ptrs[YTP_YAMAL_BATCH_MAX];
+    for (unsigned i = 0; i < batches; ++i) {
+      size_t count = 1 + i % YTP_YAMAL_BATCH_MAX;
+      for (size_t j = 0; j < count; ++j) {
+        sizes[j] = sizeof(test_msg) + j;
+      }
+      ytp_yamal_reserve_batch(yamal, sizes, ptrs, count, &error);
+      ASSERT_EQ(error, nullptr);
+      for (size_t j = 0; j < count; ++j) {
+        auto *msg = (test_msg *)ptrs[j];
+        msg->index = j;
+        strncpy(msg->check, j + 1 == count ? "end" : "", sizeof(msg->check));
+        msg->check[5] = id;
+      }
+      ASSERT_NE(ytp_yamal_commit_batch(yamal, ptrs, count, 0, &error), nullptr);
+      ASSERT_EQ(error, nullptr);
+    }
+    ytp_yamal_del(yamal, &error);
+    ASSERT_EQ(error, nullptr);
+  };
+
+  thread t1(producer, 0);
+  thread t2(producer, 1);
+  t1.join();
+  t2.join();
+
+  auto *yamal = ytp_yamal_new_2(fd, false, &error);
+  ASSERT_EQ(error, nullptr);
+  auto it = ytp_yamal_begin(yamal, 0, &error);
+  ASSERT_EQ(error, nullptr);
+  uint64_t expected_seqno = 0;
+  unsigned total_batches = 0;
+  while (!ytp_yamal_term(it)) {
+    // Every batch must be contiguous in the list
+    char producer_id = 0;
+    for (unsigned expected_idx = 0;; ++expected_idx) {
+      ASSERT_FALSE(ytp_yamal_term(it));
+      size_t sz;
+      test_msg *data;
+      uint64_t seqno;
+      ytp_yamal_read(yamal, it, &seqno, &sz, (const char **)&data, &error);
+      ASSERT_EQ(error, nullptr);
+      ASSERT_EQ(sz, sizeof(test_msg) + expected_idx);
+      ASSERT_EQ(data->index, expected_idx);
+      ASSERT_EQ(seqno, ++expected_seqno);
+      if (expected_idx == 0) {
+        producer_id = data->check[5];
+      }
+      ASSERT_EQ(data->check[5], producer_id);
+      it = ytp_yamal_next(yamal, it, &error);
+      ASSERT_EQ(error, nullptr);
+      if (strcmp(data->check, "end") == 0) {
+        break;
+      }
+    }
+    ++total_batches;
+  }
+  ASSERT_EQ(total_batches, producers * batches);
+
+  size_t sizes[YTP_YAMAL_BATCH_MAX + 1] = {0};
+  char *ptrs[YTP_YAMAL_BATCH_MAX + 1];
+  ytp_yamal_reserve_batch(yamal, sizes, ptrs, YTP_YAMAL_BATCH_MAX + 1, &error);
+  ASSERT_NE(error, nullptr);
+  sizes[0] = YTP_MMLIST_PAGE_SIZE;
+  ytp_yamal_reserve_batch(yamal, sizes, ptrs, 1, &error);
+  ASSERT_NE(error, nullptr);
+
+  ytp_yamal_del(yamal, &error);
+  ASSERT_EQ(error, nullptr);
+
+  fmc_fclose(fd, &error);
+  ASSERT_EQ(error, nullptr);
+}
+
+TEST(yamal, commit_performance) {
+  using counter_t = fmc::counter::nanoseconds;
+  using sampler_t = fmc::counter::precision_sampler;
+  using record_t = fmc::counter::record<counter_t, sampler_t>;
+
+  const unsigned messages = 10000;
+  std::vector<double> percentiles{50.0, 90.0, 99.0};
+
+  for (unsigned writers : {1, 2, 4, 8, 16}) {
+    fmc_error_t *error;
+    auto fd = fmc_ftemp(&error);
+    ASSERT_EQ(error, nullptr);
+
+    std::vector<record_t> records(writers);
+    std::atomic<unsigned> ready = 0;
+    auto writer = [&](record_t &record) {
+      fmc_error_t *error;
+      auto *yamal = ytp_yamal_new_2(fd, false, &error);
+      ASSERT_EQ(error, nullptr);
+      ++ready;
+      while (ready.load() < writers) {
+        this_thread::yield();
+      }
+      for (unsigned i = 0; i < messages; ++i) {
+        auto *msg =
+            (test_msg *)ytp_yamal_reserve(yamal, sizeof(test_msg), &error);
+        ASSERT_EQ(error, nullptr);
+        msg->index = i;
+        {
+          fmc::counter::scoped_sampler s(record);
+          ytp_yamal_commit(yamal, msg, 0, &error);
+        }
+        ASSERT_EQ(error, nullptr);
+      }
+      ytp_yamal_del(yamal, &error);
+      ASSERT_EQ(error, nullptr);
+    };
+
+    std::vector<thread> threads;
+    for (auto &record : records) {
+      threads.emplace_back(writer, std::ref(record));
+    }
+    for (auto &t : threads) {
+      t.join();
+    }
+
+    std::cout << "ytp_yamal_commit with " << writers << " writers"
+              << std::endl;
+    for (double &percentile : percentiles) {
+      double worst = 0.0;
+      for (auto &record : records) {
+        worst = std::max(worst, record.percentile(percentile));
+      }
+      std::cout << "  " << percentile << "% percentile: " << worst
+                << " nanoseconds" << std::endl;
+    }
+    std::cout << std::endl;
+
+    fmc_fclose(fd, &error);
+    ASSERT_EQ(error, nullptr);
+  }
+}
+
+TEST(yamal, page_boundary_performance) {
+  using counter_t = fmc::counter::nanoseconds;
+  using sampler_t = fmc::counter::precision_sampler;
+  using record_t = fmc::counter::record<counter_t, sampler_t>;
+
+  const unsigned messages = 200000;
+  std::vector<double> percentiles{50.0, 99.0, 99.9, 100.0};
+
+  // Readers share a handle and follow the writer, so they all find the next
+  // page unmapped at the same time
+  for (unsigned readers : {1, 2, 4}) {
+    fmc_error_t *error;
+    auto fd = fmc_ftemp(&error);
+    ASSERT_EQ(error, nullptr);
+    auto *yamal = ytp_yamal_new_4(fd, false, YTP_UNCLOSABLE,
+                                  YTP_MMLIST_PAGE_SIZE_MIN, &error);
+    ASSERT_EQ(error, nullptr);
+    auto *shared = ytp_yamal_new_2(fd, false, &error);
+    ASSERT_EQ(error, nullptr);
+
+    std::vector<record_t> records(readers);
+    auto reader = [&](record_t &record) {
+      fmc_error_t *error;
+      auto it = ytp_yamal_begin(shared, 0, &error);
+      ASSERT_EQ(error, nullptr);
+      for (unsigned i = 0; i < messages;) {
+        if (ytp_yamal_term(it)) {
+          this_thread::yield();
+          continue;
+        }
+        uint64_t seqno;
+        size_t sz;
+        const char *data;
+        {
+          fmc::counter::scoped_sampler s(record);
+          ytp_yamal_read(shared, it, &seqno, &sz, &data, &error);
+          it = ytp_yamal_next(shared, it, &error);
+        }
+        ASSERT_EQ(error, nullptr);
+        ASSERT_EQ(seqno, ++i);
+      }
+    };
+
+    std::vector<thread> threads;
+    for (auto &record : records) {
+      threads.emplace_back(reader, std::ref(record));
+    }
+    for (unsigned i = 0; i < messages; ++i) {
+      auto *msg =
+          (test_msg *)ytp_yamal_reserve(yamal, sizeof(test_msg), &error);
+      ASSERT_EQ(error, nullptr);
+      msg->index = i;
+      ytp_yamal_commit(yamal, msg, 0, &error);
+      ASSERT_EQ(error, nullptr);
+    }
+    for (auto &t : threads) {
+      t.join();
+    }
+
+    std::cout << "ytp_yamal_next across pages with " << readers << " readers"
+              << std::endl;
+    for (double &percentile : percentiles) {
+      double worst = 0.0;
+      for (auto &record : records) {
+        worst = std::max(worst, record.percentile(percentile));
+      }
+      std::cout << "  " << percentile << "% percentile: " << worst
+                << " nanoseconds" << std::endl;
+    }
+    std::cout << std::endl;
+
+    ytp_yamal_del(shared, &error);
+    ASSERT_EQ(error, nullptr);
+    ytp_yamal_del(yamal, &error);
+    ASSERT_EQ(error, nullptr);
+    fmc_fclose(fd, &error);
+    ASSERT_EQ(error, nullptr);
+  }
+}
+
+TEST(yamal, sync) {
+  fmc_error_t *error;
+  auto fd = fmc_ftemp(&error);
+  ASSERT_EQ(error, nullptr);
+  auto *yamal = ytp_yamal_new_4(fd, true, YTP_UNCLOSABLE,
+                                YTP_MMLIST_PAGE_SIZE_MIN, &error);
+  ASSERT_EQ(error, nullptr);
+
+  ytp_yamal_set_sync(yamal, (YTP_SYNC_MODE)3, 0, &error);
+  ASSERT_NE(error, nullptr);
+  ytp_yamal_set_sync(yamal, YTP_SYNC_ASYNC, -1, &error);
+  ASSERT_NE(error, nullptr);
+
+  auto write = [&](unsigned count) {
+    for (unsigned i = 0; i < count; ++i) {
+      auto *msg =
+          (test_msg *)ytp_yamal_reserve(yamal, sizeof(test_msg), &error);
+      ASSERT_EQ(error, nullptr);
+      msg->index = i;
+      ytp_yamal_commit(yamal, msg, 0, &error);
+      ASSERT_EQ(error, nullptr);
+    }
+  };
+  auto wait_synced = [&]() {
+    auto reserved = ytp_yamal_reserved_size(yamal, &error);
+    for (unsigned i = 0; i < 500 && ytp_yamal_synced_size(yamal) < reserved;
+         ++i) {
+      this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return ytp_yamal_synced_size(yamal) == reserved;
+  };
+
+  // The watermark follows the writer across pages
+  ytp_yamal_set_sync(yamal, YTP_SYNC_DURABLE, 0, &error);
+  ASSERT_EQ(error, nullptr);
+  for (unsigned round = 0; round < 3; ++round) {
+    write(5000);
+    ASSERT_TRUE(wait_synced());
+  }
+
+  // Nothing is synchronized when sync is disabled
+  ytp_yamal_set_sync(yamal, YTP_SYNC_NONE, 0, &error);
+  ASSERT_EQ(error, nullptr);
+  auto synced = ytp_yamal_synced_size(yamal);
+  write(5000);
+  this_thread::sleep_for(std::chrono::milliseconds(50));
+  ASSERT_EQ(ytp_yamal_synced_size(yamal), synced);
+
+  ytp_yamal_set_sync(yamal, YTP_SYNC_ASYNC, YTP_YAMAL_SYNC_INTERVAL_DEFAULT,
+                     &error);
+  ASSERT_EQ(error, nullptr);
+  ASSERT_TRUE(wait_synced());
+
+  ytp_yamal_del(yamal, &error);
+  ASSERT_EQ(error, nullptr);
+  fmc_fclose(fd, &error);
+  ASSERT_EQ(error, nullptr);
+}
+
+TEST(yamal, preallocation) {
+  const size_t page_size = YTP_MMLIST_PAGE_SIZE_MIN;
+  const size_t msg_size = 1024;
+  const unsigned bursts = 200;
+
+  // Writes a page worth of messages every couple of milliseconds
+  auto sync_allocations = [&](bool enable_thread) {
+    fmc_error_t *error;
+    auto fd = fmc_ftemp(&error);
+    EXPECT_EQ(error, nullptr);
+    auto *yamal =
+        ytp_yamal_new_4(fd, enable_thread, YTP_UNCLOSABLE, page_size, &error);
+    EXPECT_EQ(error, nullptr);
+    ytp_yamal_set_prealloc(yamal, -1, YTP_MMLIST_PREALLOC_MAX_DEFAULT, &error);
+    EXPECT_NE(error, nullptr);
+    ytp_yamal_set_prealloc(yamal, YTP_MMLIST_PREALLOC_HORIZON_DEFAULT,
+                           YTP_MMLIST_PREALLOC_MAX_DEFAULT, &error);
+    EXPECT_EQ(error, nullptr);
+    for (unsigned burst = 0; burst < bursts; ++burst) {
+      for (size_t i = 0; i < page_size / msg_size; ++i) {
+        auto *msg = ytp_yamal_reserve(yamal, msg_size, &error);
+        EXPECT_EQ(error, nullptr);
+        ytp_yamal_commit(yamal, msg, 0, &error);
+        EXPECT_EQ(error, nullptr);
+      }
+      this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    auto count = ytp_yamal_sync_allocations(yamal);
+    ytp_yamal_del(yamal, &error);
+    EXPECT_EQ(error, nullptr);
+    fmc_fclose(fd, &error);
+    EXPECT_EQ(error, nullptr);
+    return count;
+  };
+
+  // Without the aux thread only the initial preallocation is available
+  auto without_thread = sync_allocations(false);
+  ASSERT_GT(without_thread,
+            bursts - YTP_MMLIST_PREALLOC_SIZE / page_size - 2);
+
+  // The aux thread allocates ahead of the observed rate
+  auto with_thread = sync_allocations(true);
+  ASSERT_LT(with_thread, bursts / 4);
+}
+
+TEST(yamal, wait) {
+  fmc_error_t *error;
+  auto fd = fmc_ftemp(&error);
+  ASSERT_EQ(error, nullptr);
+  auto *writer = ytp_yamal_new_2(fd, false, &error);
+  ASSERT_EQ(error, nullptr);
+  auto *reader = ytp_yamal_new_2(fd, false, &error);
+  ASSERT_EQ(error, nullptr);
+  auto *hdr = (ytp_hdr *)((char *)ytp_yamal_begin(reader, 0, &error) -
+                          offsetof(ytp_hdr, hdr[0].next));
+
+  ytp_yamal_set_wait(reader, -1, YTP_YAMAL_WAIT_PARK_DEFAULT, &error);
+  ASSERT_NE(error, nullptr);
+  ytp_yamal_set_wait(reader, YTP_YAMAL_WAIT_SPIN_DEFAULT, 0, &error);
+  ASSERT_NE(error, nullptr);
+
+  // Times out on an empty list
+  auto it = ytp_yamal_begin(reader, 0, &error);
+  ASSERT_EQ(error, nullptr);
+  auto start = std::chrono::steady_clock::now();
+  ASSERT_FALSE(ytp_yamal_wait(reader, it, 20000000, &error));
+  ASSERT_EQ(error, nullptr);
+  ASSERT_GE(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds(20));
+
+  // A parked reader is woken up by the writer
+  ytp_yamal_set_wait(reader, 0, 1000000000, &error);
+  ASSERT_EQ(error, nullptr);
+  std::atomic<bool> woken = false;
+  thread waiter([&]() {
+    fmc_error_t *error;
+    woken = ytp_yamal_wait(reader, it, -1, &error);
+    ASSERT_EQ(error, nullptr);
+  });
+  while (__atomic_load_n(&hdr->waiters, __ATOMIC_ACQUIRE) == 0) {
+    this_thread::yield();
+  }
+  auto *msg = (test_msg *)ytp_yamal_reserve(writer, sizeof(test_msg), &error);
+  ASSERT_EQ(error, nullptr);
+  start = std::chrono::steady_clock::now();
+  ytp_yamal_commit(writer, msg, 0, &error);
+  ASSERT_EQ(error, nullptr);
+  waiter.join();
+  ASSERT_TRUE(woken);
+  ASSERT_LT(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds(500));
+  ASSERT_EQ(__atomic_load_n(&hdr->waiters, __ATOMIC_ACQUIRE), 0);
+
+  // Returns right away when there is a message
+  ASSERT_TRUE(ytp_yamal_wait(reader, it, 0, &error));
+  ASSERT_EQ(error, nullptr);
+
+  // The count left by a reader that died while parked is cleared
+  __atomic_store_n(&hdr->waiters, 1, __ATOMIC_RELEASE);
+  msg = (test_msg *)ytp_yamal_reserve(writer, sizeof(test_msg), &error);
+  ASSERT_EQ(error, nullptr);
+  ytp_yamal_commit(writer, msg, 0, &error);
+  ASSERT_EQ(error, nullptr);
+  ASSERT_EQ(__atomic_load_n(&hdr->waiters, __ATOMIC_ACQUIRE), 0);
+
+  // Readonly readers poll
+  auto path = "/proc/self/fd/" + std::to_string(fd);
+  auto rdfd = fmc_fopen(path.c_str(), fmc_fmode::READ, &error);
+  ASSERT_EQ(error, nullptr);
+  auto *rdreader = ytp_yamal_new_2(rdfd, false, &error);
+  ASSERT_EQ(error, nullptr);
+  it = ytp_yamal_next(rdreader, ytp_yamal_begin(rdreader, 0, &error), &error);
+  ASSERT_EQ(error, nullptr);
+  thread rdwaiter([&]() {
+    fmc_error_t *error;
+    woken = ytp_yamal_wait(rdreader, it, 5000000000, &error);
+    ASSERT_EQ(error, nullptr);
+  });
+  this_thread::sleep_for(std::chrono::milliseconds(10));
+  msg = (test_msg *)ytp_yamal_reserve(writer, sizeof(test_msg), &error);
+  ASSERT_EQ(error, nullptr);
+  ytp_yamal_commit(writer, msg, 0, &error);
+  ASSERT_EQ(error, nullptr);
+  rdwaiter.join();
+  ASSERT_TRUE(woken);
+
+  ytp_yamal_del(rdreader, &error);
+  ASSERT_EQ(error, nullptr);
+  fmc_fclose(rdfd, &error);
+  ASSERT_EQ(error, nullptr);
+  ytp_yamal_del(reader, &error);
+  ASSERT_EQ(error, nullptr);
+  ytp_yamal_del(writer, &error);
+  ASSERT_EQ(error, nullptr);
+  fmc_fclose(fd, &error);
+  ASSERT_EQ(error, nullptr);
+}
+
 TEST(yamal, allocate_closable) {
   fmc_error_t *error;
   FILE *fp = tmpfile();
@@ -869,6 +1303,215 @@ TEST(yamal, used_size) {
   ASSERT_EQ(error, nullptr);
 }
 
+TEST(yamal, page_size) {
+  fmc_error_t *error;
+  auto fd = fmc_ftemp(&error);
+  ASSERT_EQ(error, nullptr);
+
+  const size_t page_size = YTP_MMLIST_PAGE_SIZE_MIN * 2;
+
+  // Validate that only powers of two in range are accepted
+  for (size_t invalid : {page_size + 1, YTP_MMLIST_PAGE_SIZE_MIN / 2,
+                         YTP_MMLIST_PAGE_SIZE_MAX * 2}) {
+    ASSERT_EQ(ytp_yamal_new_4(fd, false, YTP_UNCLOSABLE, invalid, &error),
+              nullptr);
+    ASSERT_NE(error, nullptr);
+    ASSERT_EQ(std::string_view(fmc_error_msg(error), 19),
+              "invalid page size (");
+  }
+
+  auto *yamal = ytp_yamal_new_4(fd, false, YTP_UNCLOSABLE, page_size, &error);
+  ASSERT_EQ(error, nullptr);
+  ASSERT_EQ(ytp_yamal_page_size(yamal), page_size);
+  ASSERT_EQ(ytp_yamal_used_size(yamal, &error), page_size);
+  ASSERT_EQ(error, nullptr);
+
+  // Messages span several pages and never cross a page boundary
+  const unsigned messages = 10000;
+  std::vector<ytp_mmnode_offs> offsets;
+  for (unsigned i = 0; i < messages; ++i) {
+    auto *msg = (test_msg *)ytp_yamal_reserve(yamal, sizeof(test_msg), &error);
+    ASSERT_EQ(error, nullptr);
+    msg->index = i;
+    auto it = ytp_yamal_commit(yamal, msg, 0, &error);
+    ASSERT_EQ(error, nullptr);
+    offsets.push_back(ytp_yamal_tell(yamal, it, &error));
+    ASSERT_EQ(error, nullptr);
+    auto node_size = fmc_wordceil(sizeof(ytp_mmnode) + sizeof(test_msg));
+    ASSERT_LE(offsets.back() % page_size + node_size, page_size);
+  }
+  ASSERT_GT(ytp_yamal_reserved_size(yamal, &error), 2 * page_size);
+  ASSERT_EQ(error, nullptr);
+  ytp_yamal_del(yamal, &error);
+  ASSERT_EQ(error, nullptr);
+
+  // Files with a non-default page size use a different magic number, so
+  // readers without page size support refuse to open them
+  ytp_hdr page_hdr;
+  ASSERT_EQ(pread(fd, &page_hdr, sizeof(page_hdr), 0), sizeof(page_hdr));
+  ASSERT_EQ(std::string_view((const char *)&page_hdr.magic_number, 8),
+            "YAMAL002");
+
+  // The page size is taken from the file
+  yamal = ytp_yamal_new_2(fd, false, &error);
+  ASSERT_EQ(error, nullptr);
+  ASSERT_EQ(ytp_yamal_page_size(yamal), page_size);
+  auto it = ytp_yamal_begin(yamal, 0, &error);
+  ASSERT_EQ(error, nullptr);
+  for (unsigned i = 0; i < messages; ++i) {
+    ASSERT_FALSE(ytp_yamal_term(it));
+    uint64_t seqno;
+    size_t sz;
+    const test_msg *msg;
+    ytp_yamal_read(yamal, it, &seqno, &sz, (const char **)&msg, &error);
+    ASSERT_EQ(error, nullptr);
+    ASSERT_EQ(seqno, i + 1);
+    ASSERT_EQ(msg->index, i);
+    ASSERT_EQ(ytp_yamal_tell(yamal, it, &error), offsets[i]);
+    it = ytp_yamal_next(yamal, it, &error);
+    ASSERT_EQ(error, nullptr);
+  }
+  ASSERT_TRUE(ytp_yamal_term(it));
+  ytp_yamal_del(yamal, &error);
+  ASSERT_EQ(error, nullptr);
+
+  // Validate that we cannot open the file with a different page size
+  ASSERT_EQ(ytp_yamal_new_4(fd, false, YTP_UNCLOSABLE, YTP_MMLIST_PAGE_SIZE,
+                            &error),
+            nullptr);
+  ASSERT_NE(error, nullptr);
+
+  fmc_fclose(fd, &error);
+  ASSERT_EQ(error, nullptr);
+
+  // Files without a page size in the header use the default page size
+  fd = fmc_ftemp(&error);
+  ASSERT_EQ(error, nullptr);
+  yamal = ytp_yamal_new_2(fd, false, &error);
+  ASSERT_EQ(error, nullptr);
+  ytp_yamal_del(yamal, &error);
+  ASSERT_EQ(error, nullptr);
+  ytp_hdr hdr;
+  ASSERT_EQ(pread(fd, &hdr, sizeof(hdr), 0), sizeof(hdr));
+  hdr.page_shift = 0;
+  ASSERT_EQ(pwrite(fd, &hdr, sizeof(hdr), 0), sizeof(hdr));
+  yamal = ytp_yamal_new_4(fd, false, YTP_UNCLOSABLE, YTP_MMLIST_PAGE_SIZE,
+                          &error);
+  ASSERT_EQ(error, nullptr);
+  ASSERT_EQ(ytp_yamal_page_size(yamal), YTP_MMLIST_PAGE_SIZE);
+  ytp_yamal_del(yamal, &error);
+  ASSERT_EQ(error, nullptr);
+  fmc_fclose(fd, &error);
+  ASSERT_EQ(error, nullptr);
+}
+
+TEST(yamal, page_directory) {
+  // The page directory grows on demand instead of being embedded in the
+  // handle
+  ASSERT_LT(sizeof(ytp_yamal_t), 64 * 1024);
+
+  fmc_error_t *error;
+  auto fd = fmc_ftemp(&error);
+  ASSERT_EQ(error, nullptr);
+  auto *yamal = ytp_yamal_new_4(fd, false, YTP_UNCLOSABLE,
+                                YTP_MMLIST_PAGE_SIZE_MIN, &error);
+  ASSERT_EQ(error, nullptr);
+
+  // Map pages sparsely across several chunks of the directory
+  const size_t page_size = YTP_MMLIST_PAGE_SIZE_MIN;
+  std::vector<size_t> pages{YTP_MMLIST_PAGE_CHUNK_SIZE - 1,
+                            YTP_MMLIST_PAGE_CHUNK_SIZE,
+                            YTP_MMLIST_PAGE_CHUNK_SIZE * 2 + 1};
+  for (auto page : pages) {
+    ytp_yamal_allocate_page(yamal, page, &error);
+    ASSERT_EQ(error, nullptr);
+  }
+
+  ytp_yamal_allocate_page(yamal, YTP_MMLIST_PAGE_COUNT_MAX, &error);
+  ASSERT_NE(error, nullptr);
+  ASSERT_EQ(std::string_view(fmc_error_msg(error), 25),
+            "page index out of range (");
+
+  ytp_yamal_del(yamal, &error);
+  ASSERT_EQ(error, nullptr);
+
+  // Readers map the sparse pages on demand
+  yamal = ytp_yamal_new_2(fd, false, &error);
+  ASSERT_EQ(error, nullptr);
+  for (auto page : pages) {
+    ASSERT_NE(ytp_yamal_seek(yamal, page * page_size, &error), nullptr);
+    ASSERT_EQ(error, nullptr);
+  }
+  ytp_yamal_seek(yamal, YTP_MMLIST_PAGE_COUNT_MAX * page_size, &error);
+  ASSERT_NE(error, nullptr);
+  ytp_yamal_del(yamal, &error);
+  ASSERT_EQ(error, nullptr);
+
+  fmc_fclose(fd, &error);
+  ASSERT_EQ(error, nullptr);
+}
+
+TEST(yamal, page_size_read_performance) {
+  using counter_t = fmc::counter::nanoseconds;
+  using sampler_t = fmc::counter::precision_sampler;
+  using record_t = fmc::counter::record<counter_t, sampler_t>;
+
+  const unsigned messages = 500000;
+  std::vector<double> percentiles{50.0, 90.0, 99.0};
+
+  // Random reads over a file larger than the TLB reach of small pages
+  for (size_t page_size : {YTP_MMLIST_PAGE_SIZE_MIN, (size_t)1024 * 1024 * 2,
+                           YTP_MMLIST_PAGE_SIZE, (size_t)1024 * 1024 * 64}) {
+    fmc_error_t *error;
+    auto fd = fmc_ftemp(&error);
+    ASSERT_EQ(error, nullptr);
+    auto *yamal =
+        ytp_yamal_new_4(fd, false, YTP_UNCLOSABLE, page_size, &error);
+    ASSERT_EQ(error, nullptr);
+
+    std::vector<ytp_mmnode_offs> offsets;
+    for (unsigned i = 0; i < messages; ++i) {
+      auto *msg = (char *)ytp_yamal_reserve(yamal, 64, &error);
+      ASSERT_EQ(error, nullptr);
+      *(unsigned *)msg = i;
+      auto it = ytp_yamal_commit(yamal, msg, 0, &error);
+      ASSERT_EQ(error, nullptr);
+      offsets.push_back(ytp_yamal_tell(yamal, it, &error));
+    }
+    std::shuffle(offsets.begin(), offsets.end(), std::mt19937_64(page_size));
+
+    record_t record;
+    size_t checksum = 0;
+    for (auto offset : offsets) {
+      uint64_t seqno;
+      size_t sz;
+      const char *data;
+      {
+        fmc::counter::scoped_sampler s(record);
+        auto it = ytp_yamal_seek(yamal, offset, &error);
+        ytp_yamal_read(yamal, it, &seqno, &sz, &data, &error);
+        checksum += *(const unsigned *)data;
+      }
+      ASSERT_EQ(error, nullptr);
+    }
+    ASSERT_EQ(checksum, (size_t)messages * (messages - 1) / 2);
+
+    std::cout << "ytp_yamal_read with " << page_size << " bytes pages"
+              << std::endl;
+    for (double &percentile : percentiles) {
+      std::cout << "  " << percentile
+                << "% percentile: " << record.percentile(percentile)
+                << " nanoseconds" << std::endl;
+    }
+    std::cout << std::endl;
+
+    ytp_yamal_del(yamal, &error);
+    ASSERT_EQ(error, nullptr);
+    fmc_fclose(fd, &error);
+    ASSERT_EQ(error, nullptr);
+  }
+}
+
 GTEST_API_ int main(int argc, char **argv) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();